@@ -0,0 +1,1071 @@
+// bench.c - Microbenchmarks for the core kernels
+//
+// Times the hot algorithms in isolation across size sweeps and writes one
+// CSV row per (kernel, size). Runs as a singleton MPI process; when started
+// under mpirun only rank 0 measures.
+//
+//   bin/astp_bench [--quick] [--filter NAME] [--reps N] [--out FILE]
+//                  [--baseline FILE] [--threshold PCT]
+//
+// With --baseline, each row is compared against the matching row of a
+// previous CSV and the exit status is non-zero if any kernel regressed by
+// more than the threshold (default 10%).
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "common.h"
+#include "node.h"
+#include "transaction.h"
+#include "dag.h"
+#include "zones.h"
+#include "phases.h"
+#include "consensus.h"
+#include "bloom.h"
+#include "ledger.h"
+#include "wheel.h"
+#include "finality.h"
+#include "ghostdag.h"
+#include "affinity.h"
+#include "partition.h"
+#include "probe.h"
+#include "iblt.h"
+#include "arena.h"
+
+#define BENCH_MAX_SIZES 4
+#define BENCH_MAX_ROWS 64
+
+typedef struct {
+    const char* name;
+    // Runs the kernel once at the given size; returns elapsed seconds and
+    // stores the number of operations performed in *ops.
+    double (*run)(int size, long* ops);
+    int sizes[BENCH_MAX_SIZES];
+    int quick_sizes[BENCH_MAX_SIZES];
+} BenchCase;
+
+typedef struct {
+    char kernel[64];
+    int size;
+    double ns_per_op;
+} BenchRow;
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// Prevents the compiler from discarding results of timed loops
+static volatile long bench_sink;
+
+// Secondary figure a case may report next to its timing (printed to stderr)
+static char bench_note[128];
+
+// Scratch file for the DAG log cases
+static void dag_log_path(char* path, size_t len) {
+    snprintf(path, len, "/tmp/astp_bench_%d.dag", (int)getpid());
+}
+
+// ------------------------------------------------------------------
+// Fixtures
+// ------------------------------------------------------------------
+
+// Fills a DAG the way the main loop does: each tx references the two
+// most recent entries.
+static DAG* build_dag(int n) {
+    DAG* dag = create_dag(n);
+    for (int i = 0; i < n; i++) {
+        int* parents = get_latest_transactions(dag, 2);
+        Transaction tx = create_transaction(i % 16, rng_int(RNG_WORKLOAD, 16),
+                                            rand_double() * 100.0,
+                                            parents, 0, PHASE_NORMAL);
+        tx.tx_id = i;
+        tx.timestamp = (double)i;
+        transaction_seal(&tx);
+        arena_reset(&g_scratch.iteration);
+        add_transaction(dag, &tx);
+    }
+    return dag;
+}
+
+// n distinct sealed txs, so sealing stays out of the timed insert loops
+static Transaction* build_sealed_transactions(int n) {
+    Transaction* txs = (Transaction*)malloc((size_t)n * sizeof(Transaction));
+    for (int i = 0; i < n; i++) {
+        txs[i] = create_transaction(i % 16, (i + 1) % 16, 1.0, NULL, 0, PHASE_NORMAL);
+        txs[i].tx_id = i;
+        transaction_seal(&txs[i]);
+    }
+    return txs;
+}
+
+// Parent links of a wide DAG, as many concurrent issuers produce: each tx
+// approves one of the 4 newest txs and one of the 16 newest. Only the
+// parent fields are filled; the reachability cases read nothing else.
+static Transaction* build_wide_dag(int n) {
+    Transaction* txs = (Transaction*)calloc((size_t)n, sizeof(Transaction));
+    for (int i = 0; i < n; i++) {
+        int a = i - 1 - rng_int(RNG_WORKLOAD, 4);
+        int b = i - 1 - rng_int(RNG_WORKLOAD, 16);
+        txs[i].parents[0] = a >= 0 ? a : -1;
+        txs[i].parents[1] = b >= 0 ? b : -1;
+    }
+    return txs;
+}
+
+static Reachability* build_reachability(const Transaction* txs, int n) {
+    Reachability* reach = create_reachability(n, g_params.ghostdag_k);
+    for (int i = 0; i < n; i++) {
+        reach_add(reach, txs, i);
+    }
+    return reach;
+}
+
+// Places n nodes on integer positions in the three geographic clusters
+// used by assign_geography().
+static void place_clusters(int n, double* xs, double* ys) {
+    int cluster_size = MAX(n / 3, 1);
+    for (int i = 0; i < n; i++) {
+        int cluster = MIN(i / cluster_size, 2);
+        xs[i] = 100.0 + 200.0 * cluster + rng_int(RNG_SYSTEM, 50) - 25;
+        ys[i] = 100.0 + rng_int(RNG_SYSTEM, 50) - 25;
+    }
+}
+
+static double* similarity_matrix_at(int n, const double* xs, const double* ys) {
+    double* matrix = (double*)malloc((size_t)n * n * sizeof(double));
+    for (int i = 0; i < n; i++) {
+        for (int j = 0; j < n; j++) {
+            double latency = calculate_latency(xs[i], ys[i], xs[j], ys[j]);
+            double norm_latency = MIN(latency / 300.0, 1.0);
+            matrix[(size_t)i * n + j] = g_params.latency_weight * (1.0 - norm_latency);
+        }
+    }
+    return matrix;
+}
+
+// Similarity matrix for n clustered nodes
+static double* build_similarity_matrix(int n) {
+    double* xs = (double*)malloc(n * sizeof(double));
+    double* ys = (double*)malloc(n * sizeof(double));
+    place_clusters(n, xs, ys);
+    double* matrix = similarity_matrix_at(n, xs, ys);
+    free(xs);
+    free(ys);
+    return matrix;
+}
+
+// k-NN similarity graph over the same geography, for sizes where an n x n
+// matrix does not fit. Nodes are bucketed into unit cells. Each takes its
+// zone_knn lowest-latency peers from the window of cells around it, which
+// is widened until it holds enough candidates.
+#define KNN_GRID_WIDTH 600
+#define KNN_GRID_HEIGHT 200
+static ZoneGraph* build_knn_fixture(int n, const double* xs, const double* ys) {
+    int cells = KNN_GRID_WIDTH * KNN_GRID_HEIGHT;
+    int* start = (int*)calloc(cells + 1, sizeof(int));
+    int* order = (int*)malloc(n * sizeof(int));
+    for (int i = 0; i < n; i++) start[(int)ys[i] * KNN_GRID_WIDTH + (int)xs[i] + 1]++;
+    for (int c = 0; c < cells; c++) start[c + 1] += start[c];
+    int* cursor = (int*)malloc(cells * sizeof(int));
+    memcpy(cursor, start, cells * sizeof(int));
+    for (int i = 0; i < n; i++) order[cursor[(int)ys[i] * KNN_GRID_WIDTH + (int)xs[i]]++] = i;
+
+    int knn = MAX(MIN(g_params.zone_knn, n - 1), 1);
+    int* src = (int*)malloc((size_t)n * knn * sizeof(int));
+    int* dst = (int*)malloc((size_t)n * knn * sizeof(int));
+    int* weight = (int*)malloc((size_t)n * knn * sizeof(int));
+    int* nearest = (int*)malloc(knn * sizeof(int));
+    double* nearest_latency = (double*)malloc(knn * sizeof(double));
+    int n_edges = 0;
+
+    for (int i = 0; i < n; i++) {
+        int x = (int)xs[i], y = (int)ys[i];
+        int found = 0;
+        for (int r = 1; found < knn && r < KNN_GRID_WIDTH; r++) {
+            found = 0;
+            for (int cy = MAX(y - r, 0); cy <= MIN(y + r, KNN_GRID_HEIGHT - 1); cy++) {
+                for (int cx = MAX(x - r, 0); cx <= MIN(x + r, KNN_GRID_WIDTH - 1); cx++) {
+                    int c = cy * KNN_GRID_WIDTH + cx;
+                    for (int s = start[c]; s < start[c + 1]; s++) {
+                        int j = order[s];
+                        if (j == i) continue;
+                        double latency = calculate_latency(xs[i], ys[i], xs[j], ys[j]);
+                        if (found == knn && latency >= nearest_latency[knn - 1]) continue;
+                        int pos = (found < knn) ? found++ : knn - 1;
+                        while (pos > 0 && nearest_latency[pos - 1] > latency) {
+                            nearest[pos] = nearest[pos - 1];
+                            nearest_latency[pos] = nearest_latency[pos - 1];
+                            pos--;
+                        }
+                        nearest[pos] = j;
+                        nearest_latency[pos] = latency;
+                    }
+                }
+            }
+        }
+        for (int t = 0; t < found; t++) {
+            src[n_edges] = i;
+            dst[n_edges] = nearest[t];
+            weight[n_edges++] = similarity_edge_weight(nearest_latency[t], 0.0);
+        }
+    }
+
+    ZoneGraph* graph = graph_from_edges(n, n_edges, src, dst, weight);
+    free(src);
+    free(dst);
+    free(weight);
+    free(nearest);
+    free(nearest_latency);
+    free(cursor);
+    free(order);
+    free(start);
+    return graph;
+}
+
+// ------------------------------------------------------------------
+// Kernels
+// ------------------------------------------------------------------
+
+static double bench_update_weights(int size, long* ops) {
+    DAG* dag = build_dag(size);
+    double start = now_seconds();
+    update_weights(dag);
+    double elapsed = now_seconds() - start;
+    bench_sink += dag->weights[0];
+    destroy_dag(dag);
+    *ops = 1;
+    return elapsed;
+}
+
+static double bench_add_transaction(int size, long* ops) {
+    DAG* dag = create_dag(size);
+    Transaction* txs = build_sealed_transactions(size);
+    double start = now_seconds();
+    for (int i = 0; i < size; i++) {
+        add_transaction(dag, &txs[i]);
+    }
+    double elapsed = now_seconds() - start;
+    bench_sink += dag->count;
+    destroy_dag(dag);
+    free(txs);
+    *ops = size;
+    return elapsed;
+}
+
+// Appends through the mapped log with the default group commit policy
+static double bench_dag_log_append(int size, long* ops) {
+    char path[64];
+    dag_log_path(path, sizeof(path));
+    unlink(path);
+
+    DAG* dag = create_logged_dag(path, size);
+    Transaction* txs = build_sealed_transactions(size);
+    double start = now_seconds();
+    for (int i = 0; i < size; i++) {
+        add_transaction(dag, &txs[i]);
+    }
+    dag_log_commit(dag->log);
+    double elapsed = now_seconds() - start;
+
+    snprintf(bench_note, sizeof(bench_note), "write_amplification=%.2f commits=%llu",
+             dag_log_write_amplification(dag->log),
+             (unsigned long long)dag->log->commits);
+    bench_sink += dag->count;
+    destroy_dag(dag);
+    free(txs);
+    unlink(path);
+    *ops = size;
+    return elapsed;
+}
+
+// Time to reopen a log of `size` committed records and touch the newest,
+// including the digest index rebuilt over them
+static double bench_dag_log_recover(int size, long* ops) {
+    char path[64];
+    dag_log_path(path, sizeof(path));
+    unlink(path);
+
+    DAG* dag = create_logged_dag(path, size);
+    Transaction* txs = build_sealed_transactions(size);
+    for (int i = 0; i < size; i++) {
+        add_transaction(dag, &txs[i]);
+    }
+    destroy_dag(dag);
+    free(txs);
+
+    double start = now_seconds();
+    dag = create_logged_dag(path, size);
+    bench_sink += last_tx_id_from(dag, 0);
+    double elapsed = now_seconds() - start;
+
+    snprintf(bench_note, sizeof(bench_note), "recovered=%d indexed=%d labeled=%d",
+             dag->count, dag->indexed, dag->reach ? dag->reach->labeled : 0);
+    destroy_dag(dag);
+    unlink(path);
+    *ops = 1;
+    return elapsed;
+}
+
+// One digest per tx, the path taken by a single-threaded receiver
+static double bench_transaction_verify(int size, long* ops) {
+    Transaction* txs = build_sealed_transactions(size);
+    long valid = 0;
+    double start = now_seconds();
+    for (int i = 0; i < size; i++) {
+        valid += transaction_verify(&txs[i]);
+    }
+    double elapsed = now_seconds() - start;
+    bench_sink += valid;
+    free(txs);
+    *ops = size;
+    return elapsed;
+}
+
+// Four digests in lock-step, the path taken for relay batches
+static double bench_transaction_verify_batch(int size, long* ops) {
+    Transaction* txs = build_sealed_transactions(size);
+    int* ok = (int*)malloc(size * sizeof(int));
+    double start = now_seconds();
+    transaction_verify_batch(txs, size, ok);
+    double elapsed = now_seconds() - start;
+    for (int i = 0; i < size; i++) bench_sink += ok[i];
+    free(ok);
+    free(txs);
+    *ops = size;
+    return elapsed;
+}
+
+// Inserts `size` new digests into a filter sized for them, then reports
+// the false positive rate seen by as many digests that were never inserted
+static double bench_bloom_check_insert(int size, long* ops) {
+    Transaction* txs = build_sealed_transactions(2 * size);
+    BloomFilter* filter = create_bloom_filter(size, DEDUP_FP_RATE);
+    long hits = 0;
+    double start = now_seconds();
+    for (int i = 0; i < size; i++) {
+        hits += bloom_check_insert(filter, txs[i].digest);
+    }
+    double elapsed = now_seconds() - start;
+
+    long false_positives = 0;
+    for (int i = size; i < 2 * size; i++) {
+        false_positives += bloom_contains(filter, txs[i].digest);
+    }
+    snprintf(bench_note, sizeof(bench_note), "fp_rate=%.5f", (double)false_positives / size);
+    bench_sink += hits;
+    destroy_bloom_filter(filter);
+    free(txs);
+    *ops = size;
+    return elapsed;
+}
+
+// Digest lookups against a full DAG, half of them misses
+static double bench_dag_find(int size, long* ops) {
+    DAG* dag = build_dag(size);
+    Transaction* absent = build_sealed_transactions(size);
+    long found = 0;
+    double start = now_seconds();
+    for (int i = 0; i < size; i++) {
+        const uint8_t* digest = (i & 1) ? absent[i].digest : dag->transactions[i].digest;
+        found += dag_find(dag, digest) >= 0;
+    }
+    double elapsed = now_seconds() - start;
+    bench_sink += found;
+    free(absent);
+    destroy_dag(dag);
+    *ops = size;
+    return elapsed;
+}
+
+// Tracks every tx of a fresh DAG, then one weight pass, re-key and drain
+// of the confirmed ones; one op per tracked tx
+static double bench_finality_tracker(int size, long* ops) {
+    DAG* dag = build_dag(size);
+    FinalityTracker* tracker = create_finality_tracker(dag->capacity);
+    double start = now_seconds();
+    for (int i = 0; i < dag->count; i++) {
+        finality_track(tracker, dag, i);
+    }
+    update_weights(dag);
+    finality_refresh(tracker, dag, dag->changed, dag->n_changed);
+    int position;
+    long finalized = 0;
+    while (finality_next(tracker, dag, &position)) finalized++;
+    double elapsed = now_seconds() - start;
+    snprintf(bench_note, sizeof(bench_note), "finalized=%ld pending=%d", finalized, tracker->count);
+    bench_sink += finalized;
+    destroy_finality_tracker(tracker);
+    destroy_dag(dag);
+    *ops = size;
+    return elapsed;
+}
+
+// Indexes a wide DAG one tx at a time; one op per tx
+static double bench_ghostdag_insert(int size, long* ops) {
+    Transaction* txs = build_wide_dag(size);
+    double start = now_seconds();
+    Reachability* reach = build_reachability(txs, size);
+    double elapsed = now_seconds() - start;
+    snprintf(bench_note, sizeof(bench_note), "blues=%ld reds=%ld", reach->blues, reach->reds);
+    bench_sink += reach->blue_score[size - 1];
+    destroy_reachability(reach);
+    free(txs);
+    *ops = size;
+    return elapsed;
+}
+
+// Random ancestor queries over a wide DAG: a near pair and a far pair per
+// op, as a sender checking a recent or an old tx would issue
+#define REACH_QUERIES 1000000
+static double bench_reach_query(int size, long* ops) {
+    Transaction* txs = build_wide_dag(size);
+    Reachability* reach = build_reachability(txs, size);
+    int* pairs = (int*)malloc(4 * (size_t)REACH_QUERIES * sizeof(int));
+    for (int q = 0; q < REACH_QUERIES; q++) {
+        int b = 1 + rng_int(RNG_WORKLOAD, size - 1);
+        pairs[4 * q] = MAX(b - 1 - rng_int(RNG_WORKLOAD, 64), 0);
+        pairs[4 * q + 1] = b;
+        pairs[4 * q + 2] = rng_int(RNG_WORKLOAD, b);
+        pairs[4 * q + 3] = b;
+    }
+
+    long reachable = 0;
+    double start = now_seconds();
+    for (int q = 0; q < 2 * REACH_QUERIES; q++) {
+        reachable += reach_is_ancestor(reach, pairs[2 * q], pairs[2 * q + 1]);
+    }
+    double elapsed = now_seconds() - start;
+    snprintf(bench_note, sizeof(bench_note), "reachable=%.1f%%", 50.0 * reachable / REACH_QUERIES);
+    bench_sink += reachable;
+    free(pairs);
+    destroy_reachability(reach);
+    free(txs);
+    *ops = 2 * REACH_QUERIES;
+    return elapsed;
+}
+
+// Full GHOSTDAG order of an indexed wide DAG; one op per tx ordered
+static double bench_ghostdag_order(int size, long* ops) {
+    Transaction* txs = build_wide_dag(size);
+    Reachability* reach = build_reachability(txs, size);
+    int* order = (int*)malloc((size_t)size * sizeof(int));
+    double start = now_seconds();
+    int n = ghostdag_order(reach, order);
+    double elapsed = now_seconds() - start;
+    bench_sink += order[n - 1];
+    free(order);
+    destroy_reachability(reach);
+    free(txs);
+    *ops = n;
+    return elapsed;
+}
+
+// Zipf-distributed traffic partners among `size` ranks, observed 1 ms
+// apart, then the top-k a zone formation round ships; one op per tx
+#define AFFINITY_OBSERVATIONS 1000000
+static double bench_affinity_sketch(int size, long* ops) {
+    double* cdf = create_zipf_cdf(size, 1.0);
+    int* peers = (int*)malloc(AFFINITY_OBSERVATIONS * sizeof(int));
+    for (int i = 0; i < AFFINITY_OBSERVATIONS; i++) {
+        peers[i] = sample_zipf(cdf, size, rng_uniform(RNG_WORKLOAD));
+    }
+    AffinitySketch* sketch = create_affinity_sketch(g_params.affinity_slots,
+                                                    g_params.affinity_half_life);
+    AffinityShare* top = (AffinityShare*)malloc(g_params.affinity_top * sizeof(AffinityShare));
+
+    double start = now_seconds();
+    for (int i = 0; i < AFFINITY_OBSERVATIONS; i++) {
+        affinity_observe(sketch, peers[i], i * 0.001);
+    }
+    affinity_top(sketch, top, g_params.affinity_top);
+    double elapsed = now_seconds() - start;
+    snprintf(bench_note, sizeof(bench_note), "evictions=%ld top=%d (%.3f)",
+             sketch->evictions, top[0].peer, top[0].share);
+    bench_sink += top[0].peer;
+    free(top);
+    destroy_affinity_sketch(sketch);
+    free(peers);
+    free(cdf);
+    *ops = AFFINITY_OBSERVATIONS;
+    return elapsed;
+}
+
+// Link emulation pattern: txs arrive at 1 ms steps, each held for up to
+// 300 ms (LINK_TICK ticks), and due ones are taken after every step.
+// One op is a schedule plus its expiry.
+#define BENCH_WHEEL_ARRIVALS_PER_STEP 64
+static double bench_timing_wheel(int size, long* ops) {
+    TimingWheel* wheel = create_timing_wheel(sizeof(Transaction), LINK_TICK, 0.0);
+    Transaction tx;
+    memset(&tx, 0, sizeof(tx));
+    long taken = 0;
+    double now = 0.0;
+    double start = now_seconds();
+    for (int i = 0; i < size || wheel->pending > 0; now += 0.001) {
+        for (int k = 0; k < BENCH_WHEEL_ARRIVALS_PER_STEP && i < size; k++, i++) {
+            tx.tx_id = i;
+            wheel_schedule(wheel, &tx, now + ((i * 7919) % 600) * 0.0005);
+        }
+        wheel_advance(wheel, now);
+        while (wheel_next(wheel, &tx)) taken++;
+    }
+    double elapsed = now_seconds() - start;
+    snprintf(bench_note, sizeof(bench_note), "max_pending=%d", wheel->max_pending);
+    bench_sink += taken;
+    destroy_timing_wheel(wheel);
+    *ops = size;
+    return elapsed;
+}
+
+// Executes `size` finalized txs among 16 ranks in LEDGER_BATCH batches on
+// two threads plus the caller
+#define BENCH_LEDGER_RANKS 16
+#define BENCH_LEDGER_THREADS 2
+
+static double bench_ledger(int size, long* ops, int mode, const char* dist) {
+    char saved[PARAMS_STR_LEN];
+    snprintf(saved, sizeof(saved), "%s", g_params.receiver_dist);
+    snprintf(g_params.receiver_dist, sizeof(g_params.receiver_dist), "%s", dist);
+
+    double* cdf = create_zipf_cdf(BENCH_LEDGER_RANKS, g_params.receiver_zipf);
+    Transaction* txs = (Transaction*)malloc((size_t)size * sizeof(Transaction));
+    for (int i = 0; i < size; i++) {
+        int receiver = strcmp(dist, "zipf") == 0
+            ? sample_zipf(cdf, BENCH_LEDGER_RANKS, rng_uniform(RNG_WORKLOAD))
+            : rng_int(RNG_WORKLOAD, BENCH_LEDGER_RANKS);
+        txs[i] = create_transaction(i % BENCH_LEDGER_RANKS, receiver,
+                                    rng_uniform(RNG_WORKLOAD) * 100.0, NULL, 0, PHASE_NORMAL);
+        txs[i].tx_id = i;
+        transaction_seal(&txs[i]);
+    }
+    Ledger* ledger = create_ledger(BENCH_LEDGER_RANKS, LEDGER_ACCOUNTS, mode,
+                                   BENCH_LEDGER_THREADS, LEDGER_BATCH);
+
+    double start = now_seconds();
+    for (int i = 0; i < size; i++) {
+        ledger_submit(ledger, &txs[i]);
+    }
+    ledger_flush(ledger);
+    double elapsed = now_seconds() - start;
+
+    snprintf(bench_note, sizeof(bench_note), "conflicts=%.4f reexecuted=%.4f waves_per_batch=%.2f",
+             (double)ledger->conflicts / size, (double)ledger->reexecuted / size,
+             (double)ledger->waves / ledger->batches);
+    bench_sink += ledger->applied;
+    destroy_ledger(ledger);
+    free(txs);
+    free(cdf);
+    snprintf(g_params.receiver_dist, sizeof(g_params.receiver_dist), "%s", saved);
+    *ops = size;
+    return elapsed;
+}
+
+static double bench_ledger_static_uniform(int size, long* ops) {
+    return bench_ledger(size, ops, LEDGER_STATIC, "uniform");
+}
+
+static double bench_ledger_static_zipf(int size, long* ops) {
+    return bench_ledger(size, ops, LEDGER_STATIC, "zipf");
+}
+
+static double bench_ledger_optimistic_uniform(int size, long* ops) {
+    return bench_ledger(size, ops, LEDGER_OPTIMISTIC, "uniform");
+}
+
+static double bench_ledger_optimistic_zipf(int size, long* ops) {
+    return bench_ledger(size, ops, LEDGER_OPTIMISTIC, "zipf");
+}
+
+static double bench_weighted_dag_lookup(int size, long* ops) {
+    DAG* dag = build_dag(size);
+    Node* node = create_node(0, 1);
+    const int lookups = 1000;
+    long accepted = 0;
+
+    double start = now_seconds();
+    for (int i = 0; i < lookups; i++) {
+        Transaction* tx = &dag->transactions[rng_int(RNG_WORKLOAD, size)];
+        accepted += weighted_dag_consensus(tx, node, dag);
+    }
+    double elapsed = now_seconds() - start;
+
+    bench_sink += accepted;
+    destroy_node(node);
+    destroy_dag(dag);
+    *ops = lookups;
+    return elapsed;
+}
+
+// One main-loop iteration's scratch: a parent array, a broadcast's request
+// array and a BFT vote buffer for a zone of size ranks, then the reset.
+// The note times the same sequence through malloc and free.
+static double bench_scratch_alloc(int size, long* ops) {
+    const int iterations = 100000;
+    BlockPool requests, votes;
+    block_pool_init(&requests, size * sizeof(MPI_Request));
+    block_pool_init(&votes, size * sizeof(int));
+    Arena arena = { 0 };
+
+    double start = now_seconds();
+    for (int i = 0; i < iterations; i++) {
+        int* parents = (int*)arena_alloc(&arena, 2 * sizeof(int));
+        MPI_Request* reqs = (MPI_Request*)block_pool_get(&requests);
+        int* all_votes = (int*)block_pool_get(&votes);
+        parents[0] = all_votes[0] = i;
+        bench_sink += parents[0] + all_votes[0] + (reqs != NULL);
+        block_pool_put(&votes, all_votes);
+        block_pool_put(&requests, reqs);
+        arena_reset(&arena);
+    }
+    double elapsed = now_seconds() - start;
+
+    double heap_start = now_seconds();
+    for (int i = 0; i < iterations; i++) {
+        int* parents = (int*)malloc(2 * sizeof(int));
+        MPI_Request* reqs = (MPI_Request*)malloc(size * sizeof(MPI_Request));
+        int* all_votes = (int*)malloc(size * sizeof(int));
+        parents[0] = all_votes[0] = i;
+        bench_sink += parents[0] + all_votes[0] + ((uintptr_t)reqs & 1);
+        free(all_votes);
+        free(reqs);
+        free(parents);
+    }
+    double heap = now_seconds() - heap_start;
+    snprintf(bench_note, sizeof(bench_note), "malloc_free_ns=%.1f",
+             heap * 1e9 / iterations);
+
+    arena_free(&arena);
+    block_pool_free(&requests);
+    block_pool_free(&votes);
+    *ops = iterations;
+    return elapsed;
+}
+
+static double bench_kmeans_clustering(int size, long* ops) {
+    double* matrix = build_similarity_matrix(size);
+    int k = MIN(g_params.max_zones, size);
+    int* centroids = (int*)malloc(k * sizeof(int));
+    int* assignments = (int*)malloc(size * sizeof(int));
+    kmeans_plusplus_init(matrix, size, k, centroids);
+
+    double start = now_seconds();
+    kmeans_clustering(matrix, size, k, centroids, assignments, 100);
+    double elapsed = now_seconds() - start;
+
+    bench_sink += assignments[0];
+    free(assignments);
+    free(centroids);
+    free(matrix);
+    *ops = 1;
+    return elapsed;
+}
+
+static double bench_kmeans_plusplus_init(int size, long* ops) {
+    double* matrix = build_similarity_matrix(size);
+    int k = MIN(g_params.max_zones, size);
+    int* centroids = (int*)malloc(k * sizeof(int));
+
+    double start = now_seconds();
+    kmeans_plusplus_init(matrix, size, k, centroids);
+    double elapsed = now_seconds() - start;
+
+    bench_sink += centroids[0];
+    free(centroids);
+    free(matrix);
+    *ops = 1;
+    return elapsed;
+}
+
+// Cut of a zone layout as a share of all edge weight, and how far the
+// largest zone is over an even share
+static void note_layout(const ZoneGraph* graph, const int* part, int k) {
+    long total = 0;
+    for (int e = 0; e < graph->xadj[graph->n]; e++) total += graph->ewgt[e];
+    int* sizes = (int*)calloc(k, sizeof(int));
+    int largest = 0;
+    for (int v = 0; v < graph->n; v++) sizes[part[v]]++;
+    for (int z = 0; z < k; z++) largest = MAX(largest, sizes[z]);
+    snprintf(bench_note, sizeof(bench_note), "cut=%.2f%% imbalance=%.3f",
+             100.0 * graph_edge_cut(graph, part) / MAX(total / 2, 1),
+             (double)largest * k / graph->n - 1.0);
+    free(sizes);
+}
+
+// Multilevel engine on the k-NN graph of `size` clustered nodes
+static double bench_partition_multilevel(int size, long* ops) {
+    double* xs = (double*)malloc(size * sizeof(double));
+    double* ys = (double*)malloc(size * sizeof(double));
+    place_clusters(size, xs, ys);
+    ZoneGraph* graph = build_knn_fixture(size, xs, ys);
+    int k = MIN(g_params.max_zones, size);
+    int* part = (int*)malloc(size * sizeof(int));
+
+    double start = now_seconds();
+    partition_graph(graph, k, g_params.zone_imbalance, rng_next(RNG_SYSTEM), part);
+    double elapsed = now_seconds() - start;
+
+    note_layout(graph, part, k);
+    bench_sink += part[0];
+    free(part);
+    destroy_zone_graph(graph);
+    free(xs);
+    free(ys);
+    *ops = 1;
+    return elapsed;
+}
+
+// k-means engine on the dense matrix of the same nodes (seeding included),
+// scored on the k-NN graph so the cut compares with the multilevel case
+static double bench_partition_kmeans(int size, long* ops) {
+    double* xs = (double*)malloc(size * sizeof(double));
+    double* ys = (double*)malloc(size * sizeof(double));
+    place_clusters(size, xs, ys);
+    ZoneGraph* graph = build_knn_fixture(size, xs, ys);
+    double* matrix = similarity_matrix_at(size, xs, ys);
+    int k = MIN(g_params.max_zones, size);
+    int* centroids = (int*)malloc(k * sizeof(int));
+    int* part = (int*)malloc(size * sizeof(int));
+
+    double start = now_seconds();
+    kmeans_plusplus_init(matrix, size, k, centroids);
+    kmeans_clustering(matrix, size, k, centroids, part, 100);
+    double elapsed = now_seconds() - start;
+
+    note_layout(graph, part, k);
+    bench_sink += part[0];
+    free(part);
+    free(centroids);
+    free(matrix);
+    destroy_zone_graph(graph);
+    free(xs);
+    free(ys);
+    *ops = 1;
+    return elapsed;
+}
+
+// Latency rows filled by shortest path from the pairs probe_degree
+// tournament rounds would measure among `size` ranks, with synthetic RTTs
+// from the clustered geography; one op per row
+#define PROBE_FILL_ROWS 64
+static double bench_probe_fill(int size, long* ops) {
+    double* xs = (double*)malloc(size * sizeof(double));
+    double* ys = (double*)malloc(size * sizeof(double));
+    place_clusters(size, xs, ys);
+    int degree = MIN(g_params.probe_degree, probe_round_count(size));
+    ProbeEdge* edges = (ProbeEdge*)malloc((size_t)degree * size * sizeof(ProbeEdge));
+    int n_edges = 0;
+    for (int i = 0; i < degree; i++) {
+        int round = rng_int(RNG_SYSTEM, probe_round_count(size));
+        for (int a = 0; a < size; a++) {
+            int b = probe_partner(a, size, round);
+            if (b <= a) continue;
+            double latency = calculate_latency(xs[a], ys[a], xs[b], ys[b]);
+            edges[n_edges++] = (ProbeEdge){ a, b, 2.0 * latency / 1000.0 };
+        }
+    }
+    double* row = (double*)malloc(size * sizeof(double));
+
+    double start = now_seconds();
+    for (int r = 0; r < PROBE_FILL_ROWS; r++) {
+        probe_fill_row(size, r % size, edges, n_edges, row);
+        bench_sink += (long)row[size - 1];
+    }
+    double elapsed = now_seconds() - start;
+    snprintf(bench_note, sizeof(bench_note), "measured=%d pairs (%.2f%%)", n_edges,
+             200.0 * n_edges / ((double)size * (size - 1)));
+
+    free(row);
+    free(edges);
+    free(xs);
+    free(ys);
+    *ops = PROBE_FILL_ROWS;
+    return elapsed;
+}
+
+// One DAG sync reconciliation: tables of two DAGs that share
+// IBLT_BENCH_SHARED digests and differ in `size`, subtracted and peeled,
+// doubling the table until it decodes as dag_sync() does; one op per
+// difference
+#define IBLT_BENCH_SHARED 100000
+static double bench_iblt_reconcile(int size, long* ops) {
+    Transaction* txs = build_sealed_transactions(IBLT_BENCH_SHARED + size);
+    int cells = iblt_cells_for(size);
+    int rounds = 0, found = -1;
+    long table_bytes = 0;
+
+    double start = now_seconds();
+    while (found < 0) {
+        Iblt* member = create_iblt(cells);
+        Iblt* reference = create_iblt(cells);
+        for (int i = 0; i < IBLT_BENCH_SHARED; i++) {
+            iblt_insert(member, txs[i].digest);
+        }
+        for (int i = 0; i < IBLT_BENCH_SHARED + size; i++) {
+            iblt_insert(reference, txs[i].digest);
+        }
+        iblt_subtract(reference, member);
+        uint8_t* keys = (uint8_t*)malloc((size_t)cells * HASH_DIGEST_BYTES);
+        int* signs = (int*)malloc(cells * sizeof(int));
+        found = iblt_decode(reference, keys, signs, cells);
+        bench_sink += keys[0];
+        free(keys);
+        free(signs);
+        destroy_iblt(member);
+        destroy_iblt(reference);
+        rounds++;
+        table_bytes += (long)cells * sizeof(IbltCell);
+        cells *= 2;
+    }
+    double elapsed = now_seconds() - start;
+    snprintf(bench_note, sizeof(bench_note), "rounds=%d table=%.1f B/diff", rounds,
+             (double)table_bytes / size);
+
+    free(txs);
+    *ops = size;
+    return elapsed;
+}
+
+static double bench_calculate_tps(int size, long* ops) {
+    SlidingWindow* window = create_window(size);
+    for (int i = 0; i < size; i++) {
+        add_timestamp(window, i * 0.01);
+    }
+    const int calls = 100;
+    double tps = 0.0;
+
+    double start = now_seconds();
+    for (int i = 0; i < calls; i++) {
+        tps += calculate_tps(window, size * 0.01);
+    }
+    double elapsed = now_seconds() - start;
+
+    bench_sink += (long)tps;
+    destroy_window(window);
+    *ops = calls;
+    return elapsed;
+}
+
+static double bench_get_consensus_algorithm(int size, long* ops) {
+    Node* node = create_node(0, size);
+    for (int i = 0; i < size; i++) {
+        node->latencies[i] = 1.0 + rng_int(RNG_SYSTEM, 300);
+    }
+    node->zone_id = 1;
+    node->zone_comm = MPI_COMM_SELF;
+
+    // First call pays for interpreter start-up; keep it out of the timing
+    bench_sink += get_consensus_algorithm(node, PHASE_NORMAL);
+
+    const int calls = 200;
+    long sum = 0;
+    double start = now_seconds();
+    for (int i = 0; i < calls; i++) {
+        sum += get_consensus_algorithm(node, i % 3);
+    }
+    double elapsed = now_seconds() - start;
+
+    bench_sink += sum;
+    node->zone_comm = MPI_COMM_NULL;  // Not ours to free
+    destroy_node(node);
+    *ops = calls;
+    return elapsed;
+}
+
+static const BenchCase bench_cases[] = {
+    {"update_weights",          bench_update_weights,          {1000, 4000, 16000}, {500, 2000}},
+    {"finality_tracker",        bench_finality_tracker,        {10000, 100000},     {10000}},
+    {"ghostdag_insert",         bench_ghostdag_insert,         {100000, 1000000},   {100000}},
+    {"reach_query",             bench_reach_query,             {100000, 1000000},   {100000}},
+    {"ghostdag_order",          bench_ghostdag_order,          {100000, 1000000},   {100000}},
+    {"add_transaction",         bench_add_transaction,         {10000, 100000},     {10000}},
+    {"dag_log_append",          bench_dag_log_append,          {100000, 1000000},   {100000}},
+    {"dag_log_recover",         bench_dag_log_recover,         {100000, 1000000},   {100000}},
+    {"transaction_verify",      bench_transaction_verify,      {10000, 100000},     {10000}},
+    {"transaction_verify_batch", bench_transaction_verify_batch, {10000, 100000},   {10000}},
+    {"bloom_check_insert",      bench_bloom_check_insert,      {10000, 100000},     {10000}},
+    {"dag_find",                bench_dag_find,                {10000, 100000},     {10000}},
+    {"timing_wheel",            bench_timing_wheel,            {10000, 100000, 1000000}, {10000}},
+    {"affinity_sketch",         bench_affinity_sketch,         {1000, 10000, 100000}, {1000}},
+    {"ledger_static_uniform",   bench_ledger_static_uniform,   {10000, 100000},     {10000}},
+    {"ledger_static_zipf",      bench_ledger_static_zipf,      {10000, 100000},     {10000}},
+    {"ledger_optimistic_uniform", bench_ledger_optimistic_uniform, {10000, 100000}, {10000}},
+    {"ledger_optimistic_zipf",  bench_ledger_optimistic_zipf,  {10000, 100000},     {10000}},
+    {"weighted_dag_lookup",     bench_weighted_dag_lookup,     {1000, 10000, 100000}, {1000, 10000}},
+    {"scratch_alloc",           bench_scratch_alloc,           {16, 100, 1000},     {16}},
+    {"kmeans_clustering",       bench_kmeans_clustering,       {64, 256, 1000},     {64, 256}},
+    {"kmeans_plusplus_init",    bench_kmeans_plusplus_init,    {64, 256, 1000},     {64, 256}},
+    {"partition_multilevel",    bench_partition_multilevel,    {1000, 10000, 50000}, {1000}},
+    {"partition_kmeans",        bench_partition_kmeans,        {1000, 2000},        {1000}},
+    {"probe_fill",              bench_probe_fill,              {1000, 10000, 100000}, {1000}},
+    {"iblt_reconcile",          bench_iblt_reconcile,          {10, 1000, 10000},   {10}},
+    {"calculate_tps",           bench_calculate_tps,           {600, 6000, 60000},  {600, 6000}},
+    {"get_consensus_algorithm", bench_get_consensus_algorithm, {16, 100, 1000},     {16}},
+};
+
+// ------------------------------------------------------------------
+// Harness
+// ------------------------------------------------------------------
+
+static int compare_doubles(const void* a, const void* b) {
+    double da = *(const double*)a;
+    double db = *(const double*)b;
+    return (da > db) - (da < db);
+}
+
+static int load_baseline(const char* path, BenchRow* rows, int max_rows) {
+    FILE* f = fopen(path, "r");
+    if (!f) {
+        fprintf(stderr, "Warning: cannot open baseline '%s'\n", path);
+        return 0;
+    }
+
+    char line[512];
+    int count = 0;
+    while (fgets(line, sizeof(line), f) && count < max_rows) {
+        BenchRow row;
+        // kernel,size,reps,ns_per_op,...
+        if (sscanf(line, "%63[^,],%d,%*d,%lf", row.kernel, &row.size, &row.ns_per_op) == 3) {
+            rows[count++] = row;
+        }
+    }
+    fclose(f);
+    return count;
+}
+
+static const BenchRow* find_baseline(const BenchRow* rows, int count,
+                                     const char* kernel, int size) {
+    for (int i = 0; i < count; i++) {
+        if (rows[i].size == size && strcmp(rows[i].kernel, kernel) == 0) {
+            return &rows[i];
+        }
+    }
+    return NULL;
+}
+
+static void usage(const char* prog) {
+    fprintf(stderr,
+            "Usage: %s [--quick] [--filter NAME] [--reps N] [--out FILE]\n"
+            "          [--baseline FILE] [--threshold PCT]\n", prog);
+}
+
+int main(int argc, char** argv) {
+    MPI_Init(&argc, &argv);
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    params_set_defaults(&g_params);
+    scratch_init(1);
+
+    int quick = 0;
+    int reps = 5;
+    double threshold = 10.0;
+    const char* filter = NULL;
+    const char* out_path = NULL;
+    const char* baseline_path = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--quick") == 0) {
+            quick = 1;
+        } else if (strcmp(argv[i], "--filter") == 0 && i + 1 < argc) {
+            filter = argv[++i];
+        } else if (strcmp(argv[i], "--reps") == 0 && i + 1 < argc) {
+            reps = atoi(argv[++i]);
+            if (reps < 1) reps = 1;
+        } else if (strcmp(argv[i], "--out") == 0 && i + 1 < argc) {
+            out_path = argv[++i];
+        } else if (strcmp(argv[i], "--baseline") == 0 && i + 1 < argc) {
+            baseline_path = argv[++i];
+        } else if (strcmp(argv[i], "--threshold") == 0 && i + 1 < argc) {
+            threshold = atof(argv[++i]);
+        } else {
+            if (rank == 0) usage(argv[0]);
+            MPI_Finalize();
+            return 2;
+        }
+    }
+
+    int regressions = 0;
+    if (rank == 0) {
+        rng_seed(42, 0);
+
+        FILE* out = stdout;
+        if (out_path) {
+            out = fopen(out_path, "w");
+            if (!out) {
+                perror(out_path);
+                MPI_Abort(MPI_COMM_WORLD, 1);
+            }
+        }
+
+        BenchRow baseline[BENCH_MAX_ROWS];
+        int baseline_count = 0;
+        if (baseline_path) {
+            baseline_count = load_baseline(baseline_path, baseline, BENCH_MAX_ROWS);
+        }
+
+        fprintf(out, "kernel,size,reps,ns_per_op,ns_per_op_min,ops_per_sec");
+        if (baseline_path) {
+            fprintf(out, ",baseline_ns_per_op,delta_pct,status");
+        }
+        fprintf(out, "\n");
+
+        int n_cases = sizeof(bench_cases) / sizeof(bench_cases[0]);
+        double* samples = (double*)malloc(reps * sizeof(double));
+
+        for (int c = 0; c < n_cases; c++) {
+            const BenchCase* bc = &bench_cases[c];
+            if (filter && strstr(bc->name, filter) == NULL) continue;
+
+            const int* sizes = quick ? bc->quick_sizes : bc->sizes;
+            for (int s = 0; s < BENCH_MAX_SIZES && sizes[s] > 0; s++) {
+                int size = sizes[s];
+                bench_note[0] = '\0';
+                for (int r = 0; r < reps; r++) {
+                    long ops = 1;
+                    double elapsed = bc->run(size, &ops);
+                    arena_reset(&g_scratch.iteration);
+                    arena_reset(&g_scratch.epoch);
+                    samples[r] = elapsed * 1e9 / MAX(ops, 1);
+                }
+                qsort(samples, reps, sizeof(double), compare_doubles);
+                double median = samples[reps / 2];
+                double best = samples[0];
+
+                fprintf(out, "%s,%d,%d,%.1f,%.1f,%.1f",
+                        bc->name, size, reps, median, best,
+                        median > 0.0 ? 1e9 / median : 0.0);
+
+                if (baseline_path) {
+                    const BenchRow* base = find_baseline(baseline, baseline_count,
+                                                         bc->name, size);
+                    if (base && base->ns_per_op > 0.0) {
+                        double delta = (median - base->ns_per_op) / base->ns_per_op * 100.0;
+                        const char* status = "ok";
+                        if (delta > threshold) {
+                            status = "regressed";
+                            regressions++;
+                        } else if (delta < -threshold) {
+                            status = "improved";
+                        }
+                        fprintf(out, ",%.1f,%.1f,%s", base->ns_per_op, delta, status);
+                    } else {
+                        fprintf(out, ",,,new");
+                    }
+                }
+                fprintf(out, "\n");
+                fflush(out);
+                if (bench_note[0] != '\0') {
+                    fprintf(stderr, "# %s %d: %s\n", bc->name, size, bench_note);
+                }
+            }
+        }
+
+        free(samples);
+        if (out != stdout) fclose(out);
+    }
+
+    MPI_Bcast(&regressions, 1, MPI_INT, 0, MPI_COMM_WORLD);
+    scratch_free();
+    MPI_Finalize();
+    return regressions > 0 ? 1 : 0;
+}
@@ -6,8 +6,21 @@
 // Zone Formation
 #define MAX_ZONES 4
 #define ZONE_REBALANCE_INTERVAL 300.0  // seconds
+#define ZONE_ASYNC 1                   // Rebalance in the background (0 = blocking)
+#define ZONE_ENGINE "kmeans"           // "kmeans" (dense similarity) or "multilevel" (sparse graph)
+#define ZONE_KNN 10                    // Nearest peers linked per rank (multilevel)
+#define ZONE_IMBALANCE 0.05            // Zone size slack over an even share (multilevel)
 #define LATENCY_WEIGHT 0.6
 #define AFFINITY_WEIGHT 0.4
+#define AFFINITY_SLOTS 64              // Traffic partners tracked per rank
+#define AFFINITY_TOP 16                // Partners each rank ships to zone formation
+#define AFFINITY_HALF_LIFE 60.0        // seconds (0 = no decay)
+
+// Latency Probing
+#define LATENCY_PROBE 0                // Measure RTTs instead of synthetic geography
+#define PROBE_DEGREE 16                // Ping-pong rounds, i.e. measured pairs per rank
+#define PROBE_REPEATS 5                // Timed ping-pongs per pair (median kept)
+#define PROBE_SCALE 1000.0             // Simulated ms per ms of measured latency (1 us -> 1 ms)
 
 // Phase Detection
 #define PHASE_LOW 0
@@ -32,16 +45,86 @@
 // Weighted DAG Parameters
 #define WD_MIN_WEIGHT 5
 #define WD_DECAY 0.1
+#define GHOSTDAG 0              // 1 = label every insert, 0 = on first query
+#define GHOSTDAG_K 18           // Max blues in a blue tx's anticone
 
 // BFT Parameters
 #define BFT_QUORUM 0.67         // 2/3 majority
 #define BFT_TIMEOUT 5.0         // seconds
+#define BFT_MODE "collective"   // "collective" or "pbft" (point-to-point, view changes)
+
+// Fault Injection (members per zone)
+#define FAULT_CRASH_COUNT 0             // Crash-stop members
+#define FAULT_BYZANTINE_COUNT 0         // Equivocating members
+#define FAULT_SLOW_COUNT 0              // Members whose consensus messages lag
+#define FAULT_CRASH_AT 1.0              // Seconds into the run a crash happens
+#define FAULT_DELAY 0.05                // Seconds a slow member's messages lag
+
+// Cross-Zone Witnesses
+#define WITNESS_MAX 5             // Witnesses per zone pair (0 = disabled)
+#define WITNESS_LATENCY_MS 50.0   // Max distance from a witness to either zone
+#define WITNESS_QUORUM 0.67       // Accepting fraction of the asked witnesses
+
+// Inter-Zone Relay
+#define RELAY_BATCH 32            // Txs per gateway batch (0 = relay disabled)
+#define RELAY_INTERVAL 0.01       // Max seconds a partial batch waits
+
+// Duplicate Suppression
+#define DEDUP_CAPACITY 65536      // Digests per Bloom generation (0 = disabled)
+#define DEDUP_FP_RATE 0.001       // Target false-positive rate per generation
+
+// Flow Control
+#define FLOW_CREDITS 64           // Messages in flight per zone peer (0 = disabled)
+#define FLOW_QUEUE 256            // Queued txs per peer before generation holds back
+#define FLOW_BATCH 32             // Max txs coalesced into one message
+
+// Link Emulation
+#define LINK_DELAY 0.0            // Multiplier on pairwise latencies (0 = disabled)
+#define LINK_TICK 0.0005          // Timing wheel tick (seconds)
 
 // Network
 #define MAX_NODES 1000
 #define MAX_TRANSACTIONS 100000
 #define TX_GENERATION_PROB 0.1  // 10% per iteration
 
+// Threading
+#define WORKER_THREADS 0        // Validator threads per rank (0 = single-threaded)
+
+// DAG Log
+#define DAG_LOG_COMMIT_EVERY 256        // Records per group commit (msync)
+#define DAG_LOG_COMMIT_INTERVAL 0.05    // Max seconds between commits
+
+// DAG Sync
+#define DAG_SYNC 1                      // Reconcile zone DAGs at run start (0 = disabled)
+#define DAG_SYNC_BATCH 256              // Txs per streamed catch-up message
+
+// Checkpoint
+#define CHECKPOINT_INTERVAL 0.0         // Seconds between --checkpoint cuts (0 = end of run only)
+
+// Telemetry
+#define TELEMETRY_FILE ""               // Time-series CSV/JSONL on rank 0 ("" = disabled)
+#define TELEMETRY_INTERVAL 1.0          // Seconds between samples
+
+// Host-Shared DAG
+#define SHARED_DAG 0                    // Co-located zone members share one DAG (0 = private)
+
+// Ledger
+#define LEDGER_BATCH 256                // Finalized txs per execution batch (0 = disabled)
+#define LEDGER_MODE "static"            // "static" (conflict waves) or "optimistic"
+#define LEDGER_THREADS 0                // Execution threads besides the MPI thread
+#define LEDGER_ACCOUNTS 1024            // Accounts per rank
+#define LEDGER_INITIAL_BALANCE 100000   // Cents per account
+
+// Receivers
+#define RECEIVER_DIST "uniform"         // "uniform", "zipf" or "zone"
+#define RECEIVER_ZIPF 1.0               // Zipf exponent
+
+// Discrete-Event Backend
+#define DES_NODES 0                     // Virtual nodes in one process (0 = MPI ranks)
+#define DES_THREADS 1                   // Shards advanced in parallel
+#define DES_ZONE_SIZE 64                // Target members per virtual zone
+#define DES_RATE 1.0                    // Poisson tx/s per virtual node
+
 // Experiment
 #define DEFAULT_EXPERIMENT_DURATION 10.0  // seconds
 
@@ -0,0 +1,50 @@
+// affinity.h - Decayed Space-Saving sketch of traffic partners
+//
+// Each rank tracks who it trades with in a fixed number of slots instead of
+// a dense per-rank counter array. A tx from a tracked peer adds to its slot.
+// A tx from an untracked peer takes over the lightest slot and inherits its
+// count, which becomes the new entry's overestimate bound (Space-Saving),
+// so the heaviest partners are always kept.
+//
+// Traffic decays with a half-life of affinity_half_life seconds. Rather
+// than aging every slot, each observation is weighted by
+// exp(rate * (now - landmark)) (forward decay), which preserves all ratios.
+// The landmark is moved up before the weights overflow.
+
+#ifndef AFFINITY_H
+#define AFFINITY_H
+
+#include "common.h"
+
+typedef struct {
+    int peer;
+    double count;                // Forward-decayed
+    double error;                // Overestimate inherited on takeover
+} AffinityEntry;
+
+// What zone formation ships per partner: -1 pads unused entries
+typedef struct {
+    int peer;
+    float share;                 // Fraction of this rank's recent traffic
+} AffinityShare;
+
+typedef struct AffinitySketch {
+    AffinityEntry* entries;
+    int used;
+    int capacity;
+    double total;                // All traffic, forward-decayed
+    double landmark;             // Time origin of the weights
+    double rate;                 // ln 2 / half-life, 0 = no decay
+    long evictions;
+} AffinitySketch;
+
+// Function declarations
+AffinitySketch* create_affinity_sketch(int capacity, double half_life);
+void destroy_affinity_sketch(AffinitySketch* sketch);
+void affinity_reset(AffinitySketch* sketch, double half_life);
+void affinity_observe(AffinitySketch* sketch, int peer, double now);
+void affinity_rebase(AffinitySketch* sketch, double now);
+double affinity_share(const AffinitySketch* sketch, int peer);
+int affinity_top(const AffinitySketch* sketch, AffinityShare* top, int k);
+
+#endif
@@ -0,0 +1,82 @@
+// arena.h - Scoped bump allocation and fixed-size block pools
+//
+// The main loop used to call malloc() and free() for every tx: the parent
+// array of get_latest_transactions(), the request array of a zone
+// broadcast and the vote buffer of a BFT round, and kmeans_plusplus_init()
+// once per centroid of every zone formation round. Scratch memory with a
+// known lifetime now comes from two arenas instead. The iteration arena is
+// reset at the top of every main-loop iteration. The epoch arena is reset
+// when a zone layout is applied and at the end of a run. An arena that
+// outgrows its chunk takes another one and folds them into one at the next
+// reset, so after warm-up neither touches the heap. Request arrays and
+// vote buffers, which the zone may size up to the whole world, come from
+// fixed-size block pools with a free list.
+//
+// Every heap allocation made by the simulator's own code is counted by
+// wrapping malloc, calloc and realloc at link time (see the makefile), so
+// the run can report allocations per loop iteration.
+
+#ifndef ARENA_H
+#define ARENA_H
+
+#include "common.h"
+#include "node.h"
+
+#define ARENA_CHUNK (64 * 1024)  // Bytes in an arena's first chunk
+#define ARENA_ALIGN 16
+#define BLOCK_POOL_SLAB 16       // Blocks a pool takes from the heap at once
+
+typedef struct ArenaChunk {
+    struct ArenaChunk* prev;
+    size_t size;
+    size_t used;
+} ArenaChunk;
+
+typedef struct {
+    ArenaChunk* head;            // Chunk allocations come from; NULL until first use
+    size_t in_use;               // Bytes handed out since the last reset
+    size_t peak;                 // Most bytes in use between two resets
+    long chunks;                 // Chunks taken from the heap
+} Arena;
+
+typedef struct PoolBlock {
+    struct PoolBlock* next;
+} PoolBlock;
+
+typedef struct PoolSlab {
+    struct PoolSlab* next;
+} PoolSlab;
+
+typedef struct {
+    size_t block_size;
+    PoolBlock* free_list;
+    PoolSlab* slabs;
+    int in_use;
+    int peak;
+    long slab_count;
+} BlockPool;
+
+// Main-thread scratch memory
+typedef struct {
+    Arena iteration;             // Reset at the top of every main-loop iteration
+    Arena epoch;                 // Reset when zones are re-formed
+    BlockPool requests;          // MPI_Request arrays, one entry per world rank
+    BlockPool votes;             // Vote buffers, one int per world rank
+} Scratch;
+
+extern Scratch g_scratch;
+
+// Function declarations
+void* arena_alloc(Arena* arena, size_t bytes);
+void arena_reset(Arena* arena);
+void arena_free(Arena* arena);
+void block_pool_init(BlockPool* pool, size_t block_size);
+void* block_pool_get(BlockPool* pool);
+void block_pool_put(BlockPool* pool, void* block);
+void block_pool_free(BlockPool* pool);
+void scratch_init(int world_size);
+void scratch_free(void);
+long heap_allocations(void);
+void scratch_report(Node* node, long iterations, long allocations, double busy);
+
+#endif
@@ -0,0 +1,32 @@
+// bloom.h - Rotating Bloom filter over transaction digests
+//
+// Two generations of equal size: inserts go to the current one, lookups
+// check both. When the current generation has taken `capacity` digests it
+// becomes the previous one and the old previous one is cleared, so the
+// filter remembers at least the last `capacity` digests at a bounded false
+// positive rate without ever growing.
+
+#ifndef BLOOM_H
+#define BLOOM_H
+
+#include <stdint.h>
+
+typedef struct {
+    uint64_t* bits[2];           // Current and previous generation
+    uint64_t mask;               // Bits per generation - 1 (power of two)
+    long words;
+    int hashes;
+    long capacity;               // Inserts per generation
+    long inserted;               // Into the current generation
+    int current;
+    long rotations;
+} BloomFilter;
+
+// Function declarations
+BloomFilter* create_bloom_filter(long capacity, double fp_rate);
+void destroy_bloom_filter(BloomFilter* filter);
+int bloom_contains(const BloomFilter* filter, const uint8_t* digest);
+void bloom_insert(BloomFilter* filter, const uint8_t* digest);
+int bloom_check_insert(BloomFilter* filter, const uint8_t* digest);
+
+#endif
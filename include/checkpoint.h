@@ -0,0 +1,60 @@
+// checkpoint.h - Coordinated node-state checkpoint/restore
+//
+// Every rank's state is written through MPI-IO to one shared file:
+//
+//   [CheckpointHeader][int zone_assignments[nranks]]
+//   [CheckpointIndex index[nranks]][rank 0 blob][rank 1 blob]...
+//
+// Blob offsets come from an exclusive prefix sum of blob sizes, so all
+// ranks write their part in a single collective call. A checkpoint is taken
+// at the end of a run, after the zone has drained to a consistent cut: no
+// transaction message is in flight. With checkpoint_interval the run also
+// stops at such a cut every interval, writes a checkpoint and carries on.
+// Weighted-DAG txs still waiting for weight are saved by DAG position;
+// point-to-point BFT instances still open at a cut are not.
+
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include "common.h"
+#include "node.h"
+#include "dag.h"
+#include "phases.h"
+#include "metrics.h"
+#include "ledger.h"
+#include "finality.h"
+#include <stdint.h>
+
+#define CHECKPOINT_MAGIC "ASTPCKP1"
+#define CHECKPOINT_VERSION 5
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    int32_t nranks;
+    uint64_t seed;
+    uint64_t transaction_size;   // sizeof(Transaction) at write time
+} CheckpointHeader;
+
+typedef struct {
+    uint64_t offset;
+    uint64_t length;
+} CheckpointIndex;
+
+// Per-rank run state carried across a checkpoint
+typedef struct {
+    DAG* dag;
+    SlidingWindow* window;
+    Metrics* metrics;
+    Ledger* ledger;              // NULL when execution is disabled
+    FinalityTracker* pending;    // Undecided weighted-DAG txs (NULL = none)
+    int tx_counter;              // Next local tx id
+    double elapsed;              // Seconds simulated so far
+} RunState;
+
+// Function declarations
+int checkpoint_write(const char* path, Node* node, const RunState* state);
+int checkpoint_read(const char* path, Node* node, RunState* state,
+                    unsigned long long* seed);
+
+#endif
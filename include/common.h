@@ -12,6 +12,8 @@
 #include <unistd.h>
 #include <mpi.h>
 #include "../config.h"
+#include "rng.h"
+#include "params.h"
 
 // Forward declarations only (no typedef yet)
 struct Node;
@@ -23,9 +25,9 @@ struct Metrics;
 #define MIN(a,b) ((a) < (b) ? (a) : (b))
 #define MAX(a,b) ((a) > (b) ? (a) : (b))
 
-// Random double in [0, 1)
+// Random double in [0, 1) from this rank's system stream
 static inline double rand_double() {
-    return (double)rand() / RAND_MAX;
+    return rng_uniform(RNG_SYSTEM);
 }
 
 #endif
\ No newline at end of file
@@ -16,5 +16,6 @@ int execute_consensus(Transaction* tx, Node* node, DAG* dag, int algorithm);
 int fast_voting_consensus(Transaction* tx, Node* node);
 int weighted_dag_consensus(Transaction* tx, Node* node, DAG* dag);
 int bft_consensus(Transaction* tx, Node* node);
+void bft_finish(Node* node);
 
 #endif
\ No newline at end of file
@@ -5,20 +5,63 @@
 
 #include "common.h"
 #include "transaction.h"
+#include "dag_log.h"
+#include "ghostdag.h"
+#include <stdatomic.h>
 
+// Head of a host-shared DAG segment; the ready flags, transactions and
+// weights follow it in the same shared window
 typedef struct {
-    Transaction* transactions;
+    atomic_int reserved;         // Slots handed out to appenders
+    int capacity;
+} SharedDagHeader;
+
+typedef struct {
+    Transaction* transactions;   // Heap array, or the mapped log records
     int* weights;                // Cumulative weights
     int count;
     int capacity;
+    DagLog* log;                 // NULL unless backed by a DAG log
+    
+    // Host-shared DAG: co-located zone members append into one
+    // MPI_Win_allocate_shared segment. A slot is reserved with a fetch-add
+    // and published by its ready flag; count is the ready prefix this rank
+    // has seen. NULL / MPI_WIN_NULL for a private DAG.
+    SharedDagHeader* shared;
+    atomic_uchar* ready;
+    MPI_Win win;
+    
+    // Digest -> position, open addressing with linear probing. Records
+    // host peers append to a shared DAG are indexed lazily on the next
+    // insert or lookup.
+    int* index;
+    uint32_t index_mask;
+    int indexed;
+    
+    // Positions whose weight the last update_weights() raised (a position
+    // may repeat; at most two entries per tx)
+    int* changed;
+    int n_changed;
+    
+    // Ancestor queries and GHOSTDAG ordering; NULL until the first query
+    // unless ghostdag is set, then caught up on the next insert or query
+    Reachability* reach;
 } DAG;
 
 // Function declarations
 DAG* create_dag(int capacity);
+DAG* create_logged_dag(const char* path, int capacity);
+DAG* create_shared_dag(MPI_Comm host_comm, int capacity);
+size_t shared_dag_bytes(int capacity);
+int dag_refresh(DAG* dag);
 void destroy_dag(DAG* dag);
 int add_transaction(DAG* dag, Transaction* tx);
+int dag_find(DAG* dag, const uint8_t* digest);
 int* get_latest_transactions(DAG* dag, int count);
 int get_weight(DAG* dag, int tx_id);
-void update_weights(DAG* dag);
+int update_weights(DAG* dag);
+int last_tx_id_from(DAG* dag, int sender);
+int dag_is_ancestor(DAG* dag, int a, int b);
+int dag_ghostdag_order(DAG* dag, int* order);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,70 @@
+// dag_log.h - Append-only memory-mapped transaction log behind the DAG
+//
+// Layout: one header page followed by fixed-size Transaction records. The
+// DAG's transaction array *is* the mapped record region, so the log itself
+// only validates the header and maps the file; no record is copied.
+// create_logged_dag() then reads every recovered record once to rebuild
+// the in-memory digest index (and the GHOSTDAG labels with ghostdag set),
+// which is not persisted.
+//
+// Records become durable in group commits: the dirty record pages are
+// msync'ed first, then the header's committed count is advanced. The header
+// page holds two checksummed slots written alternately, so a torn header
+// write falls back to the previous commit.
+
+#ifndef DAG_LOG_H
+#define DAG_LOG_H
+
+#include "common.h"
+#include "transaction.h"
+#include <stdint.h>
+
+#define DAG_LOG_MAGIC "ASTPDAG1"
+#define DAG_LOG_VERSION 1
+#define DAG_LOG_HEADER_BYTES 4096
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    uint32_t record_size;        // sizeof(Transaction) at write time
+    uint64_t capacity;           // Records the file has room for
+    uint64_t committed;          // Records durable as of this commit
+    uint64_t sequence;           // Commit number; the higher valid slot wins
+    uint32_t checksum;           // CRC-32 of the fields above
+    uint32_t reserved;
+} DagLogHeader;
+
+typedef struct DagLog {
+    int fd;
+    unsigned char* map;
+    size_t map_size;
+    size_t page_size;
+    DagLogHeader* slots;         // Two slots at the start of the header page
+    Transaction* records;
+
+    uint64_t capacity;
+    uint64_t committed;
+    uint64_t sequence;
+    uint64_t appended;           // Records written (>= committed)
+
+    int commit_every;            // Group size in records
+    double commit_interval;      // Max seconds between commits
+    double last_commit;
+
+    // Write amplification accounting
+    uint64_t payload_bytes;      // Record bytes committed
+    uint64_t synced_bytes;       // Page bytes handed to msync
+    uint64_t commits;
+
+    int failed;                  // An msync failed; appends are refused
+} DagLog;
+
+// Function declarations
+DagLog* dag_log_open(const char* path, uint64_t capacity, int commit_every,
+                     double commit_interval);
+int dag_log_appended(DagLog* log);
+int dag_log_commit(DagLog* log);
+void dag_log_close(DagLog* log);
+double dag_log_write_amplification(const DagLog* log);
+
+#endif
@@ -0,0 +1,41 @@
+// dag_sync.h - Zone DAG catch-up by set reconciliation
+//
+// Transactions only ever reach a DAG by broadcast as they are created, so
+// a rank whose DAG lacks what its zone already holds cannot catch up: one
+// restored into a zone it joined at the last rebalance, or one whose DAG
+// log is shorter than its peers'. At the start of a run every zone member
+// reconciles its DAG against the zone's reference, the member with the
+// most transactions. The member sends an IBLT of its digests sized for the
+// expected difference. The reference subtracts it from its own and peels
+// out the digests the member lacks. A table that does not peel is resent
+// at twice the size. The missing transactions are then streamed in DAG
+// order, dag_sync_batch per message, while the member inserts the previous
+// batch. Round trips and bytes grow with the difference, not the DAG.
+
+#ifndef DAG_SYNC_H
+#define DAG_SYNC_H
+
+#include "common.h"
+#include "node.h"
+#include "dag.h"
+
+#define DAG_SYNC_TAG_TABLE 14    // zone_comm: member -> reference, IBLT cells
+#define DAG_SYNC_TAG_REPLY 15    // zone_comm: reference -> member, outcome
+#define DAG_SYNC_TAG_TXS 16      // zone_comm: reference -> member, tx batches
+
+typedef struct {
+    int reference;               // 1 on the zone's reference rank
+    int rounds;                  // IBLTs sent (member) or decoded (reference)
+    long table_bytes;            // IBLT cells sent
+    long tx_bytes;               // Transactions received
+    int pulled;                  // Transactions received
+    int inserted;                // Of those, new to the DAG and intact
+    int surplus;                 // Transactions the reference lacks
+    double seconds;
+} DagSyncStats;
+
+// Function declarations
+void dag_sync(Node* node, DAG* dag, DagSyncStats* stats);
+void dag_sync_report(const DagSyncStats* stats, Node* node);
+
+#endif
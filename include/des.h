@@ -0,0 +1,54 @@
+// des.h - Discrete-event backend for large virtual networks
+//
+// With des_nodes > 0 the simulator does not map nodes to MPI ranks.
+// Instead one process runs des_nodes virtual nodes in virtual time. It uses
+// the same geography and latency model as the MPI run, and k-means zones
+// of about des_zone_size members. Each node sends Poisson arrivals of
+// des_rate tx/s. A tx is broadcast to its zone, and every member answers
+// the sender with a vote. The tx is final once a bft_quorum of the other
+// members has voted. A cross-zone tx also travels through the receiving
+// zone's gateway to its receiver. Every hop costs the pairwise link
+// latency.
+//
+// Nodes are sharded over des_threads threads, and each shard keeps a
+// binary-heap event queue. Shards advance in conservative time windows one
+// lookahead wide, where the lookahead is the minimum link latency: an
+// event handled inside a window can only cause events in a later window.
+// Events for another shard are buffered and handed over at the window
+// barrier.
+
+#ifndef DES_H
+#define DES_H
+
+#include "common.h"
+
+typedef enum {
+    DES_GENERATE = 0,            // Next arrival at node
+    DES_DELIVER,                 // Zone broadcast reaches node
+    DES_VOTE,                    // Vote reaches the sender (node)
+    DES_RELAY,                   // Cross-zone tx reaches the receiving gateway
+    DES_RECEIVE                  // Cross-zone tx reaches its receiver
+} DesEventType;
+
+typedef struct {
+    double time;                 // Virtual seconds
+    double created;              // Creation time of the tx concerned
+    int type;
+    int node;                    // Node the event happens at
+    int peer;                    // Sender of the tx
+    int tx;                      // Index in the sender's shard tx table
+} DesEvent;
+
+// Min-heap on time
+typedef struct {
+    DesEvent* events;
+    int count;
+    int capacity;
+} EventHeap;
+
+// Function declarations
+void heap_push(EventHeap* heap, const DesEvent* event);
+int heap_pop(EventHeap* heap, DesEvent* out);
+void run_des(unsigned long long seed);
+
+#endif
@@ -0,0 +1,45 @@
+// faults.h - Fault injection for zone consensus
+//
+// Gives zone members a failure role for the run, so BFT throughput and
+// latency can be measured as the number of faulty members f grows. In
+// every zone the members with the lowest zone ranks are faulty, which
+// makes the leader of the first view the first to fail:
+//   fault_crash      members that crash-stop fault_crash_at seconds into
+//                    the run: they stop generating and go silent in
+//                    consensus
+//   fault_byzantine  members that equivocate: conflicting votes to
+//                    different peers and, as leader, conflicting proposals
+//   fault_slow       members whose consensus messages all leave
+//                    fault_delay seconds late
+// A crashed rank still drains its zone and joins the simulator's own
+// collectives, so the job itself keeps running.
+
+#ifndef FAULTS_H
+#define FAULTS_H
+
+#include "common.h"
+#include "node.h"
+
+#define FAULT_NONE 0
+#define FAULT_CRASH 1
+#define FAULT_BYZANTINE 2
+#define FAULT_SLOW 3
+
+typedef struct {
+    int role;                    // FAULT_*
+    double crash_at;             // MPI_Wtime() of a crash-stop
+    double delay;                // Seconds added to a slow member's messages
+    long dropped;                // Messages a crashed member did not send
+    long delayed;
+    long equivocated;            // Messages sent with a conflicting value
+} FaultInjector;
+
+// Function declarations
+int faults_configured(void);
+FaultInjector* create_fault_injector(Node* node, double run_start);
+void destroy_fault_injector(FaultInjector* faults);
+int fault_crashed(const FaultInjector* faults, double now);
+int fault_equivocate(FaultInjector* faults, int dest);
+const char* fault_role_name(int role);
+
+#endif
@@ -0,0 +1,35 @@
+// finality.h - Pending weighted-DAG confirmations
+//
+// A tx decided by the weighted DAG is rarely heavy enough when it is
+// inserted. The tracker keeps the undecided ones in an indexed max-heap
+// keyed by their current DAG weight. After update_weights() only the
+// positions it raised are re-keyed, and since weights only grow a sift-up
+// is enough. Every tx that has crossed wd_min_weight is then at the top
+// of the heap and is handed out exactly once.
+
+#ifndef FINALITY_H
+#define FINALITY_H
+
+#include "common.h"
+#include "dag.h"
+
+typedef struct {
+    int* heap;                   // DAG positions, heaviest first
+    int count;
+    int capacity;
+    int* slot;                   // DAG position -> heap index, -1 if not pending
+    int n_slots;
+
+    long tracked;
+    long finalized;
+    long rekeyed;                // Sift-ups after weight changes
+} FinalityTracker;
+
+// Function declarations
+FinalityTracker* create_finality_tracker(int dag_capacity);
+void destroy_finality_tracker(FinalityTracker* tracker);
+void finality_track(FinalityTracker* tracker, const DAG* dag, int position);
+void finality_refresh(FinalityTracker* tracker, const DAG* dag, const int* changed, int n_changed);
+int finality_next(FinalityTracker* tracker, const DAG* dag, int* position);
+
+#endif
@@ -0,0 +1,87 @@
+// flow.h - Credit-based flow control on the zone broadcast
+//
+// Without it, generation has no coupling to receiver progress. A rank
+// stuck in update_weights() or a BFT collective keeps being sent txs,
+// which pile up as unexpected messages inside the MPI library. With
+// flow_credits > 0, a rank may have at most flow_credits unacknowledged
+// messages towards each zone peer. Receivers hand credits back every
+// half window of messages they drain. A tx for a peer without credit
+// waits in that peer's queue. When a credit returns, the queue goes out
+// coalesced, up to flow_batch txs per message. Once any queue holds
+// flow_queue txs, generation stops dispatching arrivals. They wait in the
+// load generator's backlog, which has its own limit, and memory stays
+// bounded. A rank waiting in a BFT collective keeps draining through
+// flow_service(), so that peers held back by it can still reach the
+// collective.
+
+#ifndef FLOW_H
+#define FLOW_H
+
+#include "common.h"
+#include "node.h"
+#include "transaction.h"
+
+#define FLOW_TAG_CREDIT 13       // zone_comm: receiver -> sender, credits returned
+
+typedef struct {
+    int world_rank;
+    int credits;                 // Messages this rank may still send the peer
+    Transaction* queue;          // Txs waiting for a credit, oldest first
+    int queued;
+    int queue_capacity;
+    int max_queued;
+    double stalled_since;        // When the queue last became non-empty
+    double stall_time;           // Seconds with txs queued
+
+    int consumed;                // Messages drained from the peer, not yet credited
+    int credit_out;              // Payload of the credit message in flight
+    MPI_Request credit_request;
+} FlowPeer;
+
+typedef struct {
+    MPI_Request request;
+    Transaction* buffer;
+} FlowSend;
+
+typedef struct FlowControl {
+    MPI_Comm comm;               // zone_comm the flow was created for
+    int rank;
+    int size;
+    int window;                  // Credits per peer
+    int queue_limit;
+    int batch;
+    FlowPeer* peers;             // Indexed by zone_comm rank
+    int* targets;                // Zone ranks a broadcast goes to
+    int n_targets;
+
+    FlowSend* sends;             // Coalesced sends in flight
+    int send_count;
+    int send_capacity;
+
+    Transaction* message;        // Receive buffer for one message
+    int message_capacity;
+    Transaction* inbound;        // Received txs not yet handed out, oldest first
+    int inbound_capacity;
+    int inbound_count;
+    int inbound_next;
+
+    int blocked;                 // Some queue is full: generation holds back
+    double blocked_since;
+    double blocked_time;
+    long credit_sent;            // Credit messages
+    long credit_received;
+    long coalesced_txs;          // Txs sent in a message of more than one
+    long batches;
+} FlowControl;
+
+// Function declarations
+FlowControl* create_flow_control(Node* node);
+void destroy_flow_control(FlowControl* flow);
+void flow_broadcast(FlowControl* flow, Node* node, const Transaction* tx, double now);
+int flow_receive(FlowControl* flow, Transaction* tx);
+void flow_poll(FlowControl* flow, double now);
+void flow_service(FlowControl* flow);
+void flow_finish(FlowControl* flow, double now);
+void flow_report(FlowControl* flow, Node* node, double duration);
+
+#endif
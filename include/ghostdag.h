@@ -0,0 +1,80 @@
+// ghostdag.h - Reachability index and GHOSTDAG ordering over the DAG
+//
+// Every tx picks as selected parent the parent with the highest blue
+// score. The selected parents form a forest (the reachability tree). Tree
+// ancestry is answered with one skew-binary jump pointer per node, in
+// O(log depth). DAG edges outside the tree are covered by each node's
+// future covering set (FCS): the txs that have it in their mergeset, the
+// part of their past their selected parent does not reach. A is then an
+// ancestor of B iff A is a tree ancestor of B, or some member of FCS(A)
+// is B or a tree ancestor of B.
+//
+// GHOSTDAG colors each tx's mergeset with parameter k. A candidate is blue
+// if at most k blues lie in its anticone and no such blue already has k
+// blues in its own anticone. The blue score counts the blues in a tx's
+// past. The order places each chain block's mergeset (topologically)
+// before the block itself, walking the selected chain up from the root.
+
+#ifndef GHOSTDAG_H
+#define GHOSTDAG_H
+
+#include "transaction.h"
+
+#define GHOSTDAG_MAX_CHAIN_WALK 1024   // Deeper anticone checks colour a candidate red
+
+typedef struct Reachability {
+    int k;
+    int capacity;
+    int labeled;                 // Positions indexed so far
+
+    // Reachability tree
+    int* selected;               // Selected parent, -1 for a root
+    int* depth;
+    int* jump;                   // Skew-binary ancestor pointer
+
+    // Future covering sets, linked lists in one pool
+    int* fcs_head;
+    int* fcs_node;
+    int* fcs_next;
+    int fcs_used;
+    int fcs_capacity;
+
+    // GHOSTDAG: mergeset of every tx (selected parent excluded), sorted,
+    // and its blue anticone sizes, each a run in a shared pool
+    int* blue_score;
+    int* merge_start;
+    int* merge_count;
+    int* merge;
+    unsigned char* merge_blue;
+    int merge_used;
+    int merge_capacity;
+    int* anti_start;
+    int* anti_count;
+    int* anti_pos;
+    int* anti_size;
+    int anti_used;
+    int anti_capacity;
+
+    // Scratch for one insertion
+    int* stamp;
+    int epoch;
+    int* queue;
+    int* mergeset;
+    int* new_blues;
+    int* new_anti_pos;
+    int* new_anti_size;
+    int* cand_pos;
+    int* cand_size;
+
+    long blues;
+    long reds;
+} Reachability;
+
+// Function declarations
+Reachability* create_reachability(int capacity, int k);
+void destroy_reachability(Reachability* reach);
+void reach_add(Reachability* reach, const Transaction* txs, int position);
+int reach_is_ancestor(Reachability* reach, int a, int b);
+int ghostdag_order(Reachability* reach, int* order);
+
+#endif
@@ -0,0 +1,22 @@
+// hash.h - Transaction digests (BLAKE2s, self-contained)
+//
+// BLAKE2s works on 32-bit words, so four independent messages can be
+// hashed in lock-step with every state word held as a 4-lane array; the
+// inner loops then map directly onto 128-bit SIMD registers. The batch API
+// takes equal-length messages, which is what fixed-size transaction
+// encodings produce.
+
+#ifndef HASH_H
+#define HASH_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define HASH_DIGEST_BYTES 16     // 128-bit digests (BLAKE2s allows up to 32)
+#define HASH_LANES 4
+
+// Function declarations
+void hash_digest(const void* data, size_t len, uint8_t* out);
+void hash_digest_batch(const void* const* data, size_t len, uint8_t* const* out, int n);
+
+#endif
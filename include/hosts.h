@@ -0,0 +1,39 @@
+// hosts.h - Zone members that share a host
+//
+// With shared_dag enabled, the members of a zone that run on the same host
+// (MPI_COMM_TYPE_SHARED split of zone_comm) keep one DAG in a shared
+// window instead of one private replica each. A broadcast then only needs
+// to reach one rank per host: the host leader appends the tx and its
+// co-located peers see it in the shared DAG.
+
+#ifndef HOSTS_H
+#define HOSTS_H
+
+#include "common.h"
+#include "node.h"
+#include "transaction.h"
+#include "dag.h"
+
+// Host layout of the current zone
+typedef struct HostMap {
+    MPI_Comm host_comm;          // Zone members on this host
+    int host_rank;               // 0 = host leader
+    int host_size;
+    int host_id;                 // Lowest world rank on this host
+    int* leaders;                // zone_comm ranks of the other hosts' leaders
+    int n_leaders;
+
+    // Per run: tx broadcasts and the zone messages they cost
+    long broadcasts;
+    long deliveries;
+    long unshared_deliveries;    // What a full zone broadcast would have sent
+} HostMap;
+
+// Function declarations
+void map_hosts(Node* node);
+void destroy_host_map(HostMap* map);
+void host_broadcast(Node* node, Transaction* tx);
+void host_count_broadcast(Node* node);
+void hosts_report(Node* node, DAG* dag);
+
+#endif
@@ -0,0 +1,43 @@
+// iblt.h - Invertible Bloom lookup table over transaction digests
+//
+// Every digest goes into IBLT_HASHES cells, one in each equal slice of the
+// table. A cell keeps the number of digests in it, their XOR and the XOR
+// of a 32-bit check hash of each. Subtracting the table of one set from
+// the table of another, both of the same size, cancels every digest the
+// two sets share. What is left is recovered by peeling: a cell with count
+// +1 or -1 whose check matches its key holds exactly one digest, which is
+// then removed from its other cells. Peeling succeeds with high
+// probability once the table has about 1.5 cells per difference, however
+// large the sets are, so a table sized for the difference is all that
+// needs to cross the network.
+
+#ifndef IBLT_H
+#define IBLT_H
+
+#include <stdint.h>
+#include "hash.h"
+
+#define IBLT_HASHES 3
+#define IBLT_MIN_CELLS 30        // Floor for small differences
+
+typedef struct {
+    int32_t count;               // Digests added minus digests subtracted
+    uint32_t check;              // XOR of their check hashes
+    uint8_t key[HASH_DIGEST_BYTES];  // XOR of the digests
+} IbltCell;
+
+typedef struct {
+    IbltCell* cells;
+    int n_cells;                 // A multiple of IBLT_HASHES
+} Iblt;
+
+// Function declarations
+int iblt_cells_for(int differences);
+Iblt* create_iblt(int cells);
+void destroy_iblt(Iblt* table);
+void iblt_clear(Iblt* table);
+void iblt_insert(Iblt* table, const uint8_t* digest);
+void iblt_subtract(Iblt* table, const Iblt* other);
+int iblt_decode(Iblt* table, uint8_t* keys, int* signs, int max);
+
+#endif
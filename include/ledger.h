@@ -0,0 +1,93 @@
+// ledger.h - Account balances and batched execution of finalized txs
+//
+// Every rank owns `ledger_accounts` accounts; a tx moves `amount` from one
+// of the sender's accounts to one of the receiver's. Which accounts is a
+// pure function of the tx digest, so every rank would map a tx the same
+// way. Balances live in one flat array indexed by account id.
+//
+// Finalized txs are collected into batches and executed in DAG (creation)
+// order, with txs on disjoint accounts running in parallel:
+//
+//   static      Conflict partitioning. Each tx goes into the first wave
+//               after every earlier tx of the batch that touches one of
+//               its accounts; a wave has no shared accounts and runs in
+//               parallel, waves run one after another.
+//   optimistic  Block-STM style. All txs execute in parallel against the
+//               pre-batch balances, then commit in order; a tx that read
+//               an account written earlier in the batch is re-executed.
+//
+// Both produce exactly the balances of serial execution.
+
+#ifndef LEDGER_H
+#define LEDGER_H
+
+#include "common.h"
+#include "node.h"
+#include "transaction.h"
+#include <stdint.h>
+
+#define LEDGER_STATIC 0
+#define LEDGER_OPTIMISTIC 1
+
+// Receiver distributions (loadgen receivers and ledger account choice)
+#define RECEIVERS_UNIFORM 0
+#define RECEIVERS_ZIPF 1         // Skewed towards low ranks and accounts
+#define RECEIVERS_ZONE 2         // Receivers drawn from the sender's zone
+
+typedef struct LedgerPool LedgerPool;
+
+typedef struct Ledger {
+    int mode;
+    int accounts_per_rank;
+    int n_accounts;
+    int64_t* balances;           // Cents, [n_accounts]
+    double* zipf_cdf;            // [accounts_per_rank], RECEIVERS_ZIPF only
+
+    // Current batch
+    Transaction* pending;
+    int pending_count;
+    int batch;
+    int* from;                   // Accounts per pending tx
+    int* to;
+    int64_t* amount;
+
+    // Conflict tracking: stamp[account] == epoch if touched in this batch
+    uint32_t* stamp;
+    uint32_t epoch;
+    int* last_wave;              // LEDGER_STATIC: wave that last touched an account
+    int* order;                  // LEDGER_STATIC: batch positions grouped by wave
+    int* wave_start;             // [batch + 1]
+    int* wave;                   // LEDGER_STATIC: wave of each pending tx
+    int64_t* spec_from;          // LEDGER_OPTIMISTIC: speculative writes
+    int64_t* spec_to;
+    int* ok;                     // Per pending tx: had sufficient funds
+
+    // Fork-join threads; the calling thread takes part as well
+    int n_threads;
+    LedgerPool* pool;            // NULL when n_threads is 0
+
+    // Statistics
+    long executed;
+    long applied;                // Executed with sufficient funds
+    long conflicts;              // Txs touching an account used earlier in their batch
+    long reexecuted;
+    long waves;
+    long batches;
+    double seconds;              // Wall time spent executing batches
+} Ledger;
+
+// Function declarations
+int parse_receiver_dist(const char* text);
+int parse_ledger_mode(const char* text);
+double* create_zipf_cdf(int n, double exponent);
+int sample_zipf(const double* cdf, int n, double u);
+
+Ledger* create_ledger(int n_ranks, int accounts_per_rank, int mode, int n_threads, int batch);
+void destroy_ledger(Ledger* ledger);
+void ledger_accounts(const Ledger* ledger, const Transaction* tx, int* from, int* to);
+void ledger_submit(Ledger* ledger, const Transaction* tx);
+void ledger_flush(Ledger* ledger);
+int64_t ledger_total(const Ledger* ledger);
+void ledger_report(Ledger* ledger, Node* node);
+
+#endif
@@ -0,0 +1,70 @@
+// loadgen.h - Open-loop transaction load generator
+
+#ifndef LOADGEN_H
+#define LOADGEN_H
+
+#include "common.h"
+#include "trace.h"
+#include "node.h"
+
+// Arrival processes
+#define LOAD_LEGACY 0            // One Bernoulli(TX_GENERATION_PROB) draw per loop iteration
+#define LOAD_POISSON 1           // Exponential inter-arrival times
+#define LOAD_CONSTANT 2          // Fixed inter-arrival time
+#define LOAD_BURSTY 3            // Poisson during ON periods, silent during OFF
+#define LOAD_DIURNAL 4           // Sinusoidally modulated Poisson (thinning)
+#define LOAD_TRACE 5             // Arrival offsets taken from a recorded trace
+
+#define LOAD_BACKLOG_CAPACITY 65536
+#define LOAD_DISPATCH_BATCH 256  // Max arrivals dispatched per loop iteration
+
+// An arrival waiting to be turned into a transaction
+typedef struct {
+    double arrival;              // Offset (s since start) at which it arrived
+    int receiver;
+    double amount;
+} Arrival;
+
+typedef struct {
+    int process;
+    double rate;                 // Target mean tx/s for this rank
+    double on_period;            // LOAD_BURSTY: seconds ON
+    double off_period;           // LOAD_BURSTY: seconds OFF
+    double period;               // LOAD_DIURNAL: seconds per cycle
+    double amplitude;            // LOAD_DIURNAL: relative swing in [0, 1]
+} LoadSpec;
+
+typedef struct {
+    LoadSpec spec;
+    int network_size;
+    int receiver_dist;           // RECEIVERS_* (ledger.h)
+    double* zipf_cdf;            // RECEIVERS_ZIPF: over ranks
+    const int* zones;            // RECEIVERS_ZONE: zone of every rank (not owned)
+    int rank;
+    double next_arrival;         // Offset of the next arrival not yet queued
+    TraceReader* trace;          // LOAD_TRACE source (not owned)
+    TraceWriter* recorder;       // Optional arrival recorder (not owned)
+
+    // Backlog of arrivals not yet dispatched (ring buffer)
+    Arrival* backlog;
+    int head;
+    int count;
+    int capacity;
+    int max_backlog;
+
+    long offered;                // Arrivals produced by the process
+    long dispatched;
+    long dropped;                // Arrivals lost to a full backlog
+} LoadGenerator;
+
+// Function declarations
+int parse_load_spec(const char* text, LoadSpec* spec);
+int load_rank_rate(const char* path, int rank, double* rate);
+int load_rates_missing(const char* path, int ranks, int* first_missing);
+LoadGenerator* create_load_generator(const LoadSpec* spec, const Node* node,
+                                     TraceReader* trace, TraceWriter* recorder);
+void destroy_load_generator(LoadGenerator* lg);
+void loadgen_poll(LoadGenerator* lg, double offset);
+int loadgen_next(LoadGenerator* lg, Arrival* out);
+
+#endif
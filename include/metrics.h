@@ -14,14 +14,54 @@ typedef struct {
     double* latencies;
     int latency_count;
     int latency_capacity;
+    
+    // Open-loop load: time spent in the generator backlog before dispatch,
+    // kept apart from consensus latency
+    double queue_delay_sum;      // ms
+    double queue_delay_max;      // ms
+    int queued_transactions;
+    long offered_transactions;
+    long dropped_transactions;
+    
+    // Cross-zone txs finalized by witness quorum; their latency is kept
+    // out of `latencies`, which covers intra-zone consensus only
+    int cross_zone_finalized;
+    double cross_zone_latency_sum;   // ms
+    double cross_zone_latency_max;   // ms
+    
+    // Received txs rejected before reaching the DAG
+    long duplicates_dropped;
+    long corrupt_dropped;
 } Metrics;
 
+// Network-wide totals, valid on rank 0 after summarize_metrics()
+typedef struct {
+    double duration;
+    double total_tps;
+    int total_transactions;
+    int total_finalized;
+    double avg_latency_ms;
+    double offered_tps;
+    double offered;
+    double dropped;
+    double avg_queue_delay_ms;
+    double max_queue_delay_ms;
+    int cross_zone_finalized;
+    double avg_cross_zone_latency_ms;
+    double max_cross_zone_latency_ms;
+    double duplicates_dropped;
+    double corrupt_dropped;
+} MetricsSummary;
+
 // Function declarations
 Metrics* create_metrics();
 void destroy_metrics(Metrics* metrics);
 void record_transaction(Metrics* metrics);
 void record_finalization(Metrics* metrics, double creation_time);
+void record_cross_zone_finalization(Metrics* metrics, double creation_time);
+void record_queue_delay(Metrics* metrics, double arrival_time, double dispatch_time);
 void print_metrics(Metrics* metrics, Node* node);
+void summarize_metrics(Metrics* metrics, MetricsSummary* summary);
 void aggregate_metrics(Metrics* metrics, Node* node);
 
 #endif
\ No newline at end of file
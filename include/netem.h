@@ -0,0 +1,35 @@
+// netem.h - Emulated link latency on the receive path
+//
+// Ranks on one box see each other's messages within microseconds, whatever
+// distance exchange_latencies() assigned them. With link_delay > 0 a
+// received tx is held in a timing wheel until
+// timestamp + link_delay * latencies[sender], and only then is it accepted.
+// The witness protocol holds requests and votes the same way.
+
+#ifndef NETEM_H
+#define NETEM_H
+
+#include "common.h"
+#include "node.h"
+#include "transaction.h"
+#include "wheel.h"
+
+typedef struct {
+    TimingWheel* wheel;          // Held Transactions
+
+    // Per run
+    long delayed;                // Txs that arrived before their due time
+    double hold_sum;             // Seconds spent in the wheel
+    long delivered;
+    double delivery_sum;         // Seconds from creation to delivery
+} LinkEmulator;
+
+// Function declarations
+double link_latency(const Node* node, int peer);
+LinkEmulator* create_link_emulator(double now);
+void destroy_link_emulator(LinkEmulator* link);
+void link_hold(LinkEmulator* link, const Node* node, const Transaction* tx, double now);
+int link_next(LinkEmulator* link, double now, Transaction* tx);
+void link_report(LinkEmulator* link, Node* node);
+
+#endif
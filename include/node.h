@@ -9,6 +9,7 @@ typedef struct {
     int rank;                    // MPI rank
     int total_nodes;             // Total nodes in network
     int zone_id;                 // Current zone
+    int* zone_assignments;       // Zone of every rank from the last form_zones()
     int phase;                   // Current phase (LOW/NORMAL/HIGH)
     
     // Geographic location (simulated)
@@ -18,16 +19,26 @@ typedef struct {
     double* latencies;
     
     // Transaction tracking
-    int* affinity_counts;        // Transactions with each node
+    struct AffinitySketch* affinity;  // Recent traffic partners
     int total_tx_count;
     
     // Zone communicator
     MPI_Comm zone_comm;
+    
+    // Cross-zone witnesses and zone gateways for the current zone layout,
+    // and the zone's host groups when the DAG is shared (else NULL)
+    struct WitnessTable* witness_table;
+    struct GatewayMap* gateways;
+    struct HostMap* hosts;
+    
+    // Flow control of the run in progress (NULL between runs or if disabled)
+    struct FlowControl* flow;
 } Node;
 
 // Function declarations
 Node* create_node(int rank, int size);
 void destroy_node(Node* node);
+void reset_node_traffic(Node* node);
 void assign_geography(Node* node);
 void exchange_latencies(Node* node);
 double calculate_latency(double x1, double y1, double x2, double y2);
@@ -0,0 +1,143 @@
+// params.h - Runtime tuning parameters
+//
+// Every knob that used to be a compile-time constant in config.h lives in
+// g_params. config.h still supplies the defaults; values can be overridden
+// from a "key = value" file (--params), on the command line (--set) or per
+// configuration in a sweep (--sweep).
+
+#ifndef PARAMS_H
+#define PARAMS_H
+
+#include <stdint.h>
+
+#define PARAMS_STR_LEN 128
+
+typedef struct {
+    // Zone Formation
+    int max_zones;
+    double zone_rebalance_interval;
+    int zone_async;              // Rebalance in the background (0 = blocking)
+    char zone_engine[PARAMS_STR_LEN];    // "kmeans" or "multilevel"
+    int zone_knn;                // Nearest peers linked per rank (multilevel)
+    double zone_imbalance;       // Zone size slack over an even share (multilevel)
+    double latency_weight;
+    double affinity_weight;
+    int affinity_slots;          // Traffic partners tracked per rank
+    int affinity_top;            // Partners shipped to zone formation
+    double affinity_half_life;   // Seconds; 0 = no decay
+
+    // Latency probing (0 = latencies from synthetic geography)
+    int latency_probe;
+    int probe_degree;            // Tournament rounds run, i.e. pairs per rank
+    int probe_repeats;           // Timed ping-pongs per pair
+    double probe_scale;          // Simulated ms per ms of measured one-way latency
+
+    // Phase Detection
+    double tau_high;
+    double tau_low;
+    double hysteresis;
+    int window_size;
+    int consecutive_checks;
+
+    // Fast Voting
+    int fv_sample_size;
+    int fv_quorum;
+    int fv_consecutive_rounds;
+
+    // Weighted DAG
+    int wd_min_weight;
+    double wd_decay;
+    int ghostdag;                // Keep GHOSTDAG labels on every insert
+    int ghostdag_k;              // Anticone bound for GHOSTDAG coloring
+
+    // BFT
+    double bft_quorum;
+    double bft_timeout;
+    char bft_mode[PARAMS_STR_LEN];       // "collective" or "pbft"
+
+    // Fault injection, members per zone (see faults.h)
+    int fault_crash;
+    int fault_byzantine;
+    int fault_slow;
+    double fault_crash_at;
+    double fault_delay;
+
+    // Cross-zone witnesses (witness_max = 0 disables them)
+    int witness_max;
+    double witness_latency;
+    double witness_quorum;
+
+    // Inter-zone relay (relay_batch = 0 disables it)
+    int relay_batch;
+    double relay_interval;
+
+    // Duplicate suppression (dedup_capacity = 0 disables it)
+    int dedup_capacity;
+    double dedup_fp_rate;
+
+    // Zone broadcast flow control (flow_credits = 0 disables it)
+    int flow_credits;                    // Messages in flight per peer
+    int flow_queue;                      // Queued txs per peer before generation holds back
+    int flow_batch;                      // Max txs coalesced into one message
+
+    // Link emulation (link_delay = 0 delivers on arrival)
+    double link_delay;                   // Multiplier on node->latencies
+    double link_tick;                    // Timing wheel resolution (seconds)
+
+    // Network
+    int max_transactions;
+    double tx_generation_prob;
+
+    // Threading (0 = everything on the MPI thread)
+    int threads;
+
+    // DAG log ("" = in-memory DAG)
+    char dag_log[PARAMS_STR_LEN];        // Path prefix; one file per rank
+    int dag_log_commit_every;            // Records per group commit
+    double dag_log_commit_interval;      // Max seconds between commits
+
+    // Zone DAG catch-up at run start (dag_sync = 0 disables it)
+    int dag_sync;
+    int dag_sync_batch;                  // Txs per streamed message
+
+    // Seconds between --checkpoint cuts (0 = at the end of the run only)
+    double checkpoint_interval;
+
+    // In-run telemetry ("" = disabled)
+    char telemetry[PARAMS_STR_LEN];      // Rank 0's CSV, or JSONL if it ends in .jsonl
+    double telemetry_interval;           // Seconds between samples
+
+    // One DAG per zone and host in shared memory (0 = private DAGs)
+    int shared_dag;
+
+    // Ledger (ledger_batch = 0 disables execution)
+    int ledger_batch;
+    char ledger_mode[PARAMS_STR_LEN];    // "static" or "optimistic"
+    int ledger_threads;
+    int ledger_accounts;                 // Accounts per rank
+
+    // Discrete-event backend (des_nodes = 0 runs one node per MPI rank)
+    int des_nodes;
+    int des_threads;
+    int des_zone_size;                   // Target members per virtual zone
+    double des_rate;                     // Poisson tx/s per virtual node
+
+    // Experiment
+    double duration;
+    char load[PARAMS_STR_LEN];   // Load spec, see parse_load_spec()
+    char load_rates[PARAMS_STR_LEN];
+    char receiver_dist[PARAMS_STR_LEN];  // "uniform", "zipf" or "zone"
+    double receiver_zipf;                // Zipf exponent
+} Params;
+
+extern Params g_params;
+
+// Function declarations
+void params_set_defaults(Params* params);
+int params_set(Params* params, const char* key, const char* value);
+int params_load_file(Params* params, const char* path);
+int params_format(const Params* params, const char* key, char* buf, int len);
+int params_zones_differ(const Params* a, const Params* b);
+int params_check(Params* params, int verbose, int restore);
+
+#endif
@@ -0,0 +1,44 @@
+// partition.h - Sparse similarity graph and multilevel graph partitioner
+//
+// Alternative zone-formation engine (zone_engine = "multilevel"). Each rank
+// is linked to its zone_knn lowest-latency peers and to the traffic
+// partners it shipped. An edge is weighted by the pair's similarity, so a
+// low edge cut keeps close and busy pairs in one zone. The graph is split
+// into zones by recursive bisection. Each bisection is multilevel:
+// heavy-edge matching coarsens the graph until it is small, greedy graph
+// growing bisects the coarsest graph, and Fiduccia-Mattheyses passes
+// refine the cut at every level on the way back up. Every zone's vertex
+// weight stays within (1 + zone_imbalance) of an even share.
+
+#ifndef PARTITION_H
+#define PARTITION_H
+
+#include "common.h"
+#include "affinity.h"
+#include <stdint.h>
+
+#define PARTITION_COARSEST 64        // Stop coarsening at this many vertices
+#define PARTITION_INITIAL_TRIES 8    // Graph-growing seeds tried on the coarsest graph
+#define PARTITION_FM_PASSES 8
+#define PARTITION_WEIGHT_SCALE 1000  // Similarity to integer edge weight
+
+// Undirected graph in CSR form; every edge is stored in both directions
+typedef struct {
+    int n;
+    int* xadj;                   // n + 1
+    int* adj;
+    int* ewgt;
+    int* vwgt;
+} ZoneGraph;
+
+// Function declarations
+int similarity_edge_weight(double latency, double share);
+ZoneGraph* graph_from_edges(int n, int n_edges, const int* src, const int* dst, const int* weight);
+ZoneGraph* build_knn_graph(int n, const uint16_t* all_latencies,
+                           const AffinityShare* all_top, int top, int knn);
+void destroy_zone_graph(ZoneGraph* graph);
+long graph_edge_cut(const ZoneGraph* graph, const int* part);
+long partition_graph(const ZoneGraph* graph, int nparts, double imbalance,
+                     uint64_t seed, int* part);
+
+#endif
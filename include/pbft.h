@@ -0,0 +1,131 @@
+// pbft.h - Point-to-point BFT voting with view changes
+//
+// bft_consensus() gathers one vote from every zone member in a collective,
+// so a single crashed or slow member stalls the zone. With bft_mode=pbft
+// (or any fault configured) BFT txs go through a PBFT-style protocol on
+// point-to-point messages instead, and the loop never waits on it. The
+// origin sends its tx to every member. The leader of the current view
+// (zone rank view % n) proposes it, and members prepare and then commit
+// a vote once a quorum of ceil((n + f + 1) / 2) members agree, where
+// f = (n - 1) / 3 members may be faulty. Every member replies to the
+// origin, which finalizes the tx after f + 1 matching replies. A member
+// that sees a request wait bft_timeout seconds, or receives a proposal
+// that does not match its digest, asks for the next view. A quorum of
+// such requests installs it, and the new leader proposes every request
+// still open. Instances are keyed by digest rather than sequence number:
+// the DAG orders txs, so only the vote has to be agreed.
+
+#ifndef PBFT_H
+#define PBFT_H
+
+#include "common.h"
+#include "node.h"
+#include "transaction.h"
+#include "metrics.h"
+#include "ledger.h"
+#include "wheel.h"
+#include "faults.h"
+#include <stdint.h>
+
+#define PBFT_TAG 1                   // comm: every protocol message
+#define PBFT_SLOTS 4096              // Consensus instances kept per rank
+#define PBFT_PROBE 8                 // Slots probed for a digest
+#define PBFT_SEND_SLOTS 1024
+#define PBFT_CHECK_INTERVAL 0.01     // Seconds between leader timeout checks
+
+enum {
+    PBFT_REQUEST, PBFT_PRE_PREPARE, PBFT_PREPARE, PBFT_COMMIT, PBFT_REPLY,
+    PBFT_VIEW_CHANGE, PBFT_NEW_VIEW
+};
+
+typedef struct {
+    int type;                    // PBFT_*
+    int view;
+    int vote;                    // 1 accept, 0 reject
+    int origin;                  // Zone rank that submitted the tx
+    Transaction tx;              // Only the digest matters after the proposal
+} PbftMessage;
+
+typedef struct {
+    int used;
+    uint8_t digest[HASH_DIGEST_BYTES];
+    int has_tx;
+    Transaction tx;
+    int origin;
+    double since;                // When this rank learned of the request
+    int decided;                 // -1 while open, else the committed vote
+    int proposed;                // Last view this rank proposed it in as leader
+
+    // Progress in one view; reset when a later view's message arrives
+    int view;
+    int preprepared;
+    int sent_prepare;
+    int sent_commit;
+    int prepares[2];             // By vote
+    int commits[2];
+
+    // Origin only
+    int mine;
+    int replies[2];
+} PbftInstance;
+
+typedef struct {
+    MPI_Request request;
+    PbftMessage msg;
+} PbftSendSlot;
+
+// A slow member's message waiting out its delay
+typedef struct {
+    int dest;
+    PbftMessage msg;
+} PbftDelayed;
+
+typedef struct BftReplica {
+    MPI_Comm comm;               // Duplicate of zone_comm
+    int rank;                    // Zone rank
+    int size;
+    int f;                       // Faulty members tolerated
+    int quorum;
+    int view;                    // Leader is view % size
+    int requested_view;          // Above view while a view change is pending
+    double view_since;           // When view or requested_view last moved
+    int* asked;                  // Highest view each member has asked for
+    int* sorted;                 // Scratch copy of asked
+    PbftInstance* slots;
+    uint64_t* bits;              // Per slot: prepared, committed, replied member bitmaps
+    int words;                   // uint64_t words per bitmap
+    int open;                    // Undecided instances holding their tx
+    double last_check;
+    int draining;
+    FaultInjector* faults;       // NULL for a correct member
+    TimingWheel* delayed;        // Slow member only
+    Ledger* ledger;
+
+    PbftSendSlot sends[PBFT_SEND_SLOTS];
+    int send_used[PBFT_SEND_SLOTS];
+    int next_send;
+
+    long sent;
+    long received;
+    long submitted;
+    long finalized;              // Own txs accepted
+    long rejected;               // Own txs rejected
+    long committed;              // Instances this rank committed
+    long timeouts;               // Leader timeouts this rank raised
+    long suspicions;             // Proposals that did not match their digest
+    long view_changes;           // Views installed
+    long expired;                // Open instances evicted from a full table
+    double latency_sum;          // Own txs, submit to finalization
+} BftReplica;
+
+// Function declarations
+int pbft_enabled(void);
+BftReplica* create_bft_replica(Node* node, FaultInjector* faults, double now);
+void destroy_bft_replica(BftReplica* r);
+int bft_submit(BftReplica* r, Transaction* tx, double now);
+void bft_replica_poll(BftReplica* r, Metrics* metrics, double now);
+void bft_replica_finish(BftReplica* r, Metrics* metrics);
+void bft_replica_resume(BftReplica* r);
+void bft_replica_report(BftReplica* r, FaultInjector* faults, Node* node, double elapsed);
+
+#endif
@@ -0,0 +1,50 @@
+// probe.h - Measured RTT latency matrix
+//
+// exchange_latencies() derives latency from synthetic coordinates, so the
+// zones have nothing to do with the fabric the ranks actually run on. With
+// latency_probe = 1 the ranks ping-pong each other instead. Pairs are
+// scheduled as a round-robin tournament: in every round each rank is in at
+// most one pair, so no probe waits behind another. Only probe_degree of
+// the n - 1 rounds are run, which keeps the cost at O(n * probe_degree)
+// messages. Each pair is pinged probe_repeats times after one warm-up, and
+// the median RTT is kept.
+//
+// The measured pairs are shared with every rank. A rank fills its latency
+// row with shortest-path RTTs over the measured graph, an upper bound on
+// the direct RTT by the triangle inequality. The result is symmetric. The
+// one-way latency, RTT / 2, is scaled by probe_scale into simulated ms.
+
+#ifndef PROBE_H
+#define PROBE_H
+
+#include "common.h"
+#include "node.h"
+
+#define PROBE_TAG 30
+
+// A measured pair, a < b
+typedef struct {
+    int a;
+    int b;
+    double rtt;                  // Median, seconds
+} ProbeEdge;
+
+typedef struct {
+    int rounds;                  // Rounds run
+    int pairs;                   // Pairs this rank initiated
+    long messages;               // Messages sent by this rank
+    double seconds;              // This rank's wall time, gather included
+    int total_pairs;             // Measured pairs, all ranks
+    double median_rtt;           // Over all measured pairs, seconds
+    double min_rtt;
+    double max_rtt;
+} ProbeStats;
+
+// Function declarations
+int probe_round_count(int n);
+int probe_partner(int rank, int n, int round);
+void probe_fill_row(int n, int source, const ProbeEdge* edges, int n_edges, double* row);
+void probe_latencies(Node* node, ProbeStats* stats);
+void probe_report(const ProbeStats* stats, Node* node);
+
+#endif
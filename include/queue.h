@@ -0,0 +1,44 @@
+// queue.h - Lock-free bounded ring queues for inter-thread hand-off
+
+#ifndef QUEUE_H
+#define QUEUE_H
+
+#include <stdatomic.h>
+#include <stddef.h>
+
+#define QUEUE_CACHE_LINE 64
+
+// Single-producer / single-consumer ring. Head and tail sit on separate
+// cache lines so producer and consumer do not false-share.
+typedef struct {
+    _Alignas(QUEUE_CACHE_LINE) atomic_size_t head;   // Next slot to pop
+    _Alignas(QUEUE_CACHE_LINE) atomic_size_t tail;   // Next slot to push
+    _Alignas(QUEUE_CACHE_LINE) size_t mask;
+    size_t elem_size;
+    unsigned char* buffer;
+} SpscRing;
+
+// Multi-producer / single-consumer ring (bounded, per-cell sequence
+// numbers). Producers claim slots with a CAS on tail; the consumer owns head.
+typedef struct {
+    _Alignas(QUEUE_CACHE_LINE) atomic_size_t tail;
+    _Alignas(QUEUE_CACHE_LINE) size_t head;
+    _Alignas(QUEUE_CACHE_LINE) size_t mask;
+    size_t elem_size;
+    size_t stride;
+    unsigned char* cells;
+} MpscRing;
+
+// Function declarations (capacity is rounded up to a power of two)
+int spsc_init(SpscRing* ring, size_t capacity, size_t elem_size);
+void spsc_destroy(SpscRing* ring);
+int spsc_push(SpscRing* ring, const void* elem);
+int spsc_pop(SpscRing* ring, void* out);
+size_t spsc_size(SpscRing* ring);
+
+int mpsc_init(MpscRing* ring, size_t capacity, size_t elem_size);
+void mpsc_destroy(MpscRing* ring);
+int mpsc_push(MpscRing* ring, const void* elem);
+int mpsc_pop(MpscRing* ring, void* out);
+
+#endif
@@ -0,0 +1,80 @@
+// relay.h - Inter-zone transaction relay through zone gateways
+//
+// Transactions are broadcast over zone_comm only, so a tx whose receiver
+// lives in another zone never reaches that zone's DAG. The relay moves it
+// there: every zone elects a gateway (the member with the lowest average
+// latency to the rest of its zone), senders hand cross-zone txs to their
+// gateway, gateways aggregate them per destination zone into batches sent
+// over a gateway-only communicator, and the receiving gateway fans each
+// batch out to its zone as a single message per member.
+
+#ifndef RELAY_H
+#define RELAY_H
+
+#include "common.h"
+#include "node.h"
+#include "transaction.h"
+
+#define RELAY_TAG_OUTBOUND 10    // zone_comm: member -> own gateway
+#define RELAY_TAG_FANOUT 11      // zone_comm: gateway -> members (batch)
+#define RELAY_TAG_BATCH 12       // gateway_comm: gateway -> gateway (batch)
+
+// Gateway layout of the current zone formation
+typedef struct GatewayMap {
+    int n_zones;
+    int* gateways;               // World rank of each zone's gateway (-1 if empty)
+    int* gateway_comm_rank;      // Rank of each zone's gateway in gateway_comm
+    int local_gateway;           // zone_comm rank of this zone's gateway
+    int is_gateway;
+    MPI_Comm gateway_comm;       // Gateways only; MPI_COMM_NULL elsewhere
+} GatewayMap;
+
+typedef struct {
+    MPI_Request request;
+    Transaction* buffer;
+} RelaySend;
+
+// Per-run relay state
+typedef struct {
+    int n_zones;                 // Of the map the relay was created with
+
+    // Gateway: outbound batch per destination zone
+    Transaction** outbound;
+    int* outbound_count;
+    double last_flush;
+
+    // Delivered txs waiting for relay_next()
+    Transaction* inbound;
+    int inbound_head;
+    int inbound_count;
+    int inbound_capacity;
+
+    // Sends in flight
+    RelaySend* sends;
+    int send_count;
+    int send_capacity;
+
+    long sent;                   // Relay messages sent / received
+    long received;
+    long dropped;                // Txs for zones without a gateway
+    long corrupt;                // Batch entries failing digest verification
+
+    // Gateway: per source zone, txs fanned out and their added latency
+    long* pair_count;
+    double* pair_latency_sum;    // ms from creation to fan-out
+    long batches;
+} Relay;
+
+// Function declarations
+void elect_gateways(Node* node);
+void destroy_gateway_map(GatewayMap* map);
+
+Relay* create_relay(Node* node);
+void destroy_relay(Relay* relay);
+void relay_submit(Relay* relay, Node* node, Transaction* tx);
+void relay_poll(Relay* relay, Node* node, double now);
+int relay_next(Relay* relay, Transaction* tx);
+void relay_drain(Relay* relay, Node* node);
+void relay_report(Relay* relay, Node* node, double duration);
+
+#endif
@@ -0,0 +1,40 @@
+// rng.h - Deterministic per-rank random number streams
+
+#ifndef RNG_H
+#define RNG_H
+
+#include <stdint.h>
+
+// Independent streams so that replaying the workload from a trace does not
+// shift the draws seen by the rest of the system (k-means init, latency
+// noise, vote sampling).
+typedef enum {
+    RNG_SYSTEM = 0,              // Geography, latency noise, clustering, voting
+    RNG_WORKLOAD = 1,            // Tx generation, receivers, amounts
+    RNG_STREAMS
+} RngStream;
+
+// Counter-based generator: output i is a pure function of (key, i), so a
+// stream can be reproduced or skipped ahead without replaying history.
+typedef struct {
+    uint64_t key;
+    uint64_t counter;
+} Rng;
+
+// Function declarations
+void rng_init(Rng* rng, uint64_t seed, int rank, int stream);
+uint64_t rng_next_u64(Rng* rng);
+double rng_next_double(Rng* rng);
+
+// Per-rank global streams
+void rng_seed(uint64_t seed, int rank);
+uint64_t rng_seed_value(void);
+uint64_t rng_next(RngStream stream);
+double rng_uniform(RngStream stream);
+int rng_int(RngStream stream, int n);
+
+// Stream positions, for checkpoint/restore
+void rng_get_counters(uint64_t* counters);
+void rng_set_counters(const uint64_t* counters);
+
+#endif
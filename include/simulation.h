@@ -0,0 +1,24 @@
+// simulation.h - One simulation run over an initialized node
+
+#ifndef SIMULATION_H
+#define SIMULATION_H
+
+#include "common.h"
+#include "node.h"
+#include "metrics.h"
+#include "trace.h"
+#include "checkpoint.h"
+
+typedef struct {
+    double duration;             // Seconds
+    TraceReader* replay;         // Trace-driven arrivals (optional)
+    TraceWriter* recorder;       // Arrival recorder (optional)
+    RunState* resume;            // Restored state to continue from (optional)
+    const char* checkpoint;      // Checkpoint file written at the end and at
+                                 // each checkpoint_interval cut (optional)
+} SimOptions;
+
+// Function declarations
+Metrics* run_simulation(Node* node, const SimOptions* options);
+
+#endif
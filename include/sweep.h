@@ -0,0 +1,32 @@
+// sweep.h - In-job parameter sweeps
+
+#ifndef SWEEP_H
+#define SWEEP_H
+
+#include "common.h"
+#include "node.h"
+
+#define SWEEP_MAX_AXES 8
+#define SWEEP_MAX_VALUES 32
+
+// One swept parameter and the values it takes
+typedef struct {
+    char key[64];
+    char values[SWEEP_MAX_VALUES][PARAMS_STR_LEN];
+    int count;
+} SweepAxis;
+
+// Cartesian product of all axes; the last axis varies fastest
+typedef struct {
+    SweepAxis axes[SWEEP_MAX_AXES];
+    int axis_count;
+    int total;
+} SweepGrid;
+
+// Function declarations
+int sweep_load(SweepGrid* grid, const char* path);
+void sweep_apply(const SweepGrid* grid, int index, Params* params);
+void run_sweep(Node* node, const SweepGrid* grid, const Params* base,
+               const char* out_path, uint64_t seed);
+
+#endif
@@ -0,0 +1,86 @@
+// telemetry.h - Per-interval time series reduced to rank 0 during the run
+//
+// aggregate_metrics() only reports once the run is over. With telemetry
+// set to a path, every rank takes a sample each telemetry_interval
+// seconds: what it created, finalized, received and dropped since the last
+// sample, its latencies, backlog, flow-control queue, phase and the
+// consensus algorithms it ran. Samples are combined on rank 0 with a sum
+// and a max MPI_Ireduce on a private communicator, so the loop never
+// waits for them. A rank that sleeps through ticks sends them empty, so
+// the k-th reduction is tick k on every rank; at most TELEMETRY_SLOTS are
+// in flight per rank, and further ticks wait for a free slot. Rank 0
+// writes one row per sample as soon as its reduction completes, as CSV or,
+// for a path ending in ".jsonl", one JSON object per line, flushed so the
+// file can be tailed while the run is in progress.
+
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include "common.h"
+#include "node.h"
+#include "metrics.h"
+#include "loadgen.h"
+#include "flow.h"
+
+#define TELEMETRY_SLOTS 8
+
+// Summed over ranks
+enum {
+    TM_CREATED, TM_FINALIZED, TM_RATE, TM_RECEIVED, TM_DROPPED,
+    TM_LATENCY_SUM, TM_LATENCY_COUNT, TM_BACKLOG, TM_FLOW_QUEUED,
+    TM_PHASE_LOW, TM_PHASE_NORMAL, TM_PHASE_HIGH,
+    TM_FAST_VOTING, TM_WEIGHTED_DAG, TM_BFT,
+    TM_SUMS
+};
+
+// Maximum over ranks
+enum {
+    TM_TIME, TM_LATENCY_MAX, TM_BACKLOG_MAX, TM_FLOW_QUEUED_MAX,
+    TM_MAXES
+};
+
+typedef struct {
+    double sums[TM_SUMS];
+    double maxes[TM_MAXES];
+    double sums_out[TM_SUMS];    // Rank 0 only
+    double maxes_out[TM_MAXES];
+    MPI_Request requests[2];
+} TelemetrySlot;
+
+typedef struct Telemetry {
+    MPI_Comm comm;               // Duplicate of MPI_COMM_WORLD
+    int rank;
+    int run;                     // Runs in this process so far
+    double interval;
+    double start;                // metrics->start_time
+    int next_tick;               // Index of the next tick, at next_tick * interval
+    double last_sample;          // Elapsed seconds at the last sample
+    FILE* out;                   // Rank 0 only
+    int jsonl;
+
+    TelemetrySlot slots[TELEMETRY_SLOTS];
+    int oldest;
+    int in_flight;
+    int written;
+
+    // Counters at the last sample, and algorithm use since then
+    long created;
+    long finalized;
+    long received;
+    long dropped;
+    int latency_count;
+    int cross_zone_count;
+    double cross_zone_sum;
+    long algorithm_txs[3];       // Indexed by CONSENSUS_*
+} Telemetry;
+
+// Function declarations
+Telemetry* create_telemetry(Node* node, Metrics* metrics, double now);
+void destroy_telemetry(Telemetry* t);
+void telemetry_count_algorithm(Telemetry* t, int algorithm);
+void telemetry_poll(Telemetry* t, Node* node, Metrics* metrics, const LoadGenerator* lg,
+                    const FlowControl* flow, double now);
+void telemetry_finish(Telemetry* t, Node* node, Metrics* metrics, const FlowControl* flow,
+                      double now);
+
+#endif
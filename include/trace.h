@@ -0,0 +1,58 @@
+// trace.h - Workload record/replay
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include "common.h"
+#include <stdint.h>
+
+#define TRACE_MAGIC "ASTPTRC1"
+#define TRACE_VERSION 1
+
+// On-disk header, one file per rank: <prefix>.<rank>.trace
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    int32_t rank;
+    int32_t size;                // Network size at record time
+    uint32_t event_size;         // sizeof(TraceEvent)
+    uint64_t seed;               // RNG seed of the recorded run
+    double x, y;                 // Geography chosen by assign_geography()
+    uint64_t event_count;
+} TraceHeader;
+
+// One generated transaction
+typedef struct {
+    double offset;               // Seconds since simulation start
+    int32_t receiver;
+    int32_t reserved;
+    double amount;
+} TraceEvent;
+
+typedef struct {
+    FILE* file;
+    TraceHeader header;
+    int failed;                  // A write failed; later events are dropped
+} TraceWriter;
+
+typedef struct {
+    void* map;
+    size_t map_size;
+    const TraceHeader* header;
+    const TraceEvent* events;
+    uint64_t cursor;
+} TraceReader;
+
+// Function declarations
+void trace_path(char* buf, size_t len, const char* prefix, int rank);
+
+TraceWriter* trace_writer_open(const char* prefix, int rank, int size, uint64_t seed);
+void trace_write_geography(TraceWriter* writer, double x, double y);
+void trace_write_event(TraceWriter* writer, double offset, int receiver, double amount);
+void trace_writer_close(TraceWriter* writer);
+
+TraceReader* trace_reader_open(const char* prefix, int rank, int size);
+const TraceEvent* trace_next_due(TraceReader* reader, double offset);
+void trace_reader_close(TraceReader* reader);
+
+#endif
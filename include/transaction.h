@@ -4,6 +4,11 @@
 #define TRANSACTION_H
 
 #include "common.h"
+#include "hash.h"
+
+// Bytes of the canonical encoding that the digest covers (every field
+// except the digest itself, without struct padding)
+#define TX_ENCODED_BYTES 44
 
 typedef struct Transaction {
     int tx_id;
@@ -14,13 +19,22 @@ typedef struct Transaction {
     int zone_id;
     int phase;
     double timestamp;
+    uint8_t digest[HASH_DIGEST_BYTES];   // Content address, set by transaction_seal()
 } Transaction;
 
 // Function declarations
 Transaction create_transaction(int sender, int receiver, double amount, 
                                int* parents, int zone_id, int phase);
 int validate_transaction(Transaction* tx);
+void transaction_seal(Transaction* tx);
+int transaction_verify(const Transaction* tx);
+int transaction_verify_batch(const Transaction* txs, int n, int* ok);
 void broadcast_transaction(Transaction* tx, MPI_Comm comm);
+void broadcast_transaction_to(Transaction* tx, MPI_Comm comm, const int* ranks, int n);
+void send_transactions(const Transaction* txs, int n, int dest, MPI_Comm comm,
+                       MPI_Request* request);
+int receive_transactions(Transaction** buffer, int* capacity, MPI_Comm comm, int* source);
 int receive_transaction(Transaction* tx, MPI_Comm comm);
+void transaction_message_counts(long* sent, long* received);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,47 @@
+// wheel.h - Hierarchical timing wheel
+//
+// Fixed-size elements are scheduled for an absolute due time and handed
+// back once the wheel has been advanced past it. Time is cut into ticks.
+// Level 0 has one slot per tick for the next WHEEL_SLOTS ticks, and every
+// level above has slots WHEEL_SLOTS times as wide. An element goes into the
+// slot of the level its distance falls in. When a level wraps, the next
+// slot of the level above is cascaded down one level, so an element moves
+// at most WHEEL_LEVELS - 1 times: scheduling and expiry are O(1).
+
+#ifndef WHEEL_H
+#define WHEEL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define WHEEL_BITS 6
+#define WHEEL_SLOTS (1 << WHEEL_BITS)
+#define WHEEL_MASK (WHEEL_SLOTS - 1)
+#define WHEEL_LEVELS 4               // Spans 2^24 ticks; later dues are clamped
+
+typedef struct {
+    double tick;                 // Seconds per tick
+    uint64_t now;                // Current tick
+    size_t elem_size;
+    size_t stride;               // Node header plus payload
+    unsigned char* nodes;        // Node pool, linked by index
+    int capacity;
+    int free_list;               // -1 when the pool is exhausted
+    int slots[WHEEL_LEVELS][WHEEL_SLOTS];   // Slot heads, -1 = empty
+    int expired_head;            // Due elements in expiry order
+    int expired_tail;
+    int held;                    // Elements still in slots
+    int pending;                 // Held plus expired, not yet taken
+
+    long scheduled;
+    int max_pending;
+} TimingWheel;
+
+// Function declarations
+TimingWheel* create_timing_wheel(size_t elem_size, double tick, double now);
+void destroy_timing_wheel(TimingWheel* wheel);
+void wheel_schedule(TimingWheel* wheel, const void* elem, double due);
+void wheel_advance(TimingWheel* wheel, double now);
+int wheel_next(TimingWheel* wheel, void* out);
+
+#endif
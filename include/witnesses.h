@@ -0,0 +1,104 @@
+// witnesses.h - Cross-zone witness protocol
+//
+// A cross-zone transaction (receiver outside the sender's zone) is not
+// finalized by the zone's consensus. The sender asks a small set of witness
+// ranks that sit close to both zones to check it, and finalizes once a
+// quorum of them has voted to accept.
+//
+// The witness table maps each ordered zone pair to at most witness_max
+// ranks. It is rebuilt after every zone formation from a compact copy of
+// every rank's own latency row, so each candidate is judged by its own
+// distances. Requests and votes travel on a dedicated duplicate of
+// MPI_COMM_WORLD and are never waited on in the main loop.
+
+#ifndef WITNESSES_H
+#define WITNESSES_H
+
+#include "common.h"
+#include "node.h"
+#include "transaction.h"
+#include "metrics.h"
+#include "ledger.h"
+#include "wheel.h"
+#include <stdint.h>
+
+#define WITNESS_TAG_REQUEST 1
+#define WITNESS_TAG_VOTE 2
+#define WITNESS_LATENCY_SCALE 10.0   // Compact latencies are 0.1 ms units
+#define WITNESS_SEND_SLOTS 1024
+#define WITNESS_MAX_PENDING 4096
+
+typedef struct WitnessTable {
+    int n_zones;
+    int width;                   // Entries per zone pair (witness_max)
+    int* witnesses;              // [n_zones][n_zones][width], -1 padded
+    int* counts;                 // [n_zones][n_zones]
+    MPI_Comm comm;               // Witness traffic only
+} WitnessTable;
+
+typedef struct {
+    int tx_id;
+    int witness;
+    int accept;
+    int reserved;
+    double sent;                 // Witness clock when cast
+} WitnessVote;
+
+// A request held back by link emulation
+typedef struct {
+    Transaction tx;
+    int source;
+} HeldWitnessRequest;
+
+typedef struct {
+    int tx_id;                   // -1 when free
+    int needed;                  // Accepts required
+    int accepts;
+    int rejects;
+    int asked;
+    Transaction tx;              // The witnessed tx
+} PendingWitness;
+
+typedef struct {
+    MPI_Request request;
+    union {
+        Transaction tx;
+        WitnessVote vote;
+    } msg;
+} WitnessSendSlot;
+
+// Per-run client state: outstanding requests and in-flight sends
+typedef struct {
+    PendingWitness pending[WITNESS_MAX_PENDING];
+    WitnessSendSlot slots[WITNESS_SEND_SLOTS];
+    int slot_used[WITNESS_SEND_SLOTS];
+    int next_slot;
+    long sent;                   // Messages sent on the witness comm
+    long received;
+    long requests_served;        // Votes this rank cast as a witness
+    long expired;                // Pending entries overwritten unresolved
+    long rejected;
+    Ledger* ledger;              // Executes finalized txs; NULL if none (not owned)
+
+    // Link emulation: requests and votes wait out the sender's latency
+    // (NULL when link_delay is 0)
+    TimingWheel* held_requests;  // HeldWitnessRequest
+    TimingWheel* held_votes;     // WitnessVote
+} WitnessClient;
+
+// Function declarations
+void build_witness_table(Node* node);
+void build_witness_table_from(Node* node, const uint16_t* all);
+void witness_latency_row(Node* node, uint16_t* row);
+void destroy_witness_table(WitnessTable* table);
+const int* zone_pair_witnesses(const WitnessTable* table, int zone_a, int zone_b, int* count);
+int is_cross_zone(Node* node, Transaction* tx);
+int validate_cross_zone_transaction(Transaction* tx, Node* node);
+
+WitnessClient* create_witness_client(void);
+void destroy_witness_client(WitnessClient* client);
+int witness_submit(WitnessClient* client, Node* node, Transaction* tx, Metrics* metrics);
+void witness_poll(WitnessClient* client, Node* node, Metrics* metrics);
+void witness_drain(WitnessClient* client, Node* node, Metrics* metrics);
+
+#endif
@@ -0,0 +1,87 @@
+// workers.h - Threaded rank: MPI on the main thread, DAG work on workers
+//
+// With MPI_THREAD_FUNNELED only the main (communication) thread calls MPI.
+// Received transactions are handed round-robin to validator threads over
+// SPSC rings; validators pass accepted transactions to a single DAG thread
+// over an MPSC ring. The DAG thread owns the DAG (insertion, weight
+// maintenance and weighted-DAG decisions) and reports decisions back over
+// an SPSC ring, so a slow weight recompute never blocks message progress.
+
+#ifndef WORKERS_H
+#define WORKERS_H
+
+#include <pthread.h>
+#include "common.h"
+#include "node.h"
+#include "dag.h"
+#include "metrics.h"
+#include "queue.h"
+#include "ledger.h"
+#include "finality.h"
+
+#define WORKER_RING_CAPACITY 8192
+#define WORKER_WEIGHT_INTERVAL 0.1   // Seconds between update_weights() passes
+
+// Work handed to the DAG thread
+#define WORK_REMOTE 0                // Received from a zone peer
+#define WORK_LOCAL 1                 // Generated here
+#define WORK_LOCAL_DECIDE 2          // Generated here, weighted-DAG decision wanted
+
+typedef struct {
+    Transaction tx;
+    int kind;
+} WorkItem;
+
+typedef struct {
+    Transaction tx;                  // The decided tx
+    int accepted;
+} WorkResult;
+
+typedef struct WorkerPool WorkerPool;
+
+typedef struct {
+    WorkerPool* pool;
+    int index;
+    pthread_t thread;
+    SpscRing inbound;
+    long validated;
+    long rejected;
+} Validator;
+
+struct WorkerPool {
+    Node* node;
+    DAG* dag;                        // Owned by the DAG thread while running
+
+    int n_validators;
+    Validator* validators;
+    int next_validator;
+
+    pthread_t dag_thread;
+    MpscRing dag_queue;
+    SpscRing results;
+
+    atomic_int stop;
+    atomic_int validators_live;
+    atomic_int dag_live;             // Cleared by the DAG thread as it exits
+    atomic_int published_count;      // dag->count as last seen by the DAG thread
+    FinalityTracker* pending;        // DAG thread: undecided weighted-DAG txs
+
+    long inserted;                   // DAG thread
+    long weight_updates;             // DAG thread
+    long push_stalls;                // Main thread: retries on a full ring
+    Ledger* ledger;                  // Main thread: executes accepted decisions (not owned)
+};
+
+// Function declarations
+WorkerPool* create_worker_pool(Node* node, DAG* dag, int n_validators,
+                               FinalityTracker* pending);
+void workers_stop(WorkerPool* pool, Metrics* metrics);
+void workers_resume(WorkerPool* pool);
+void destroy_worker_pool(WorkerPool* pool);
+void workers_latest_parents(WorkerPool* pool, int* parents);
+void workers_submit_local(WorkerPool* pool, Transaction* tx, int decide, Metrics* metrics);
+void workers_submit_remote(WorkerPool* pool, Transaction* tx, Metrics* metrics);
+void workers_drain_results(WorkerPool* pool, Metrics* metrics);
+void workers_report(WorkerPool* pool);
+
+#endif
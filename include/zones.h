@@ -3,13 +3,86 @@
 #ifndef ZONES_H
 #define ZONES_H
 
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
 #include "common.h"
 #include "node.h"
+#include "affinity.h"
+
+#define ZONE_SWAP_MARGIN 0.05    // Seconds from agreeing on a layout to applying it
+
+// How rank 0 turns the gathered rows into a layout
+typedef enum {
+    ZONE_KMEANS = 0,             // Dense n x n similarity matrix and k-means
+    ZONE_MULTILEVEL              // Sparse k-NN graph and multilevel partitioning
+} ZoneEngine;
+
+typedef enum {
+    ZONE_IDLE = 0,
+    ZONE_GATHER,                 // Iallgather of top partners and latency rows
+    ZONE_CLUSTER,                // Rank 0: clustering on the helper thread
+    ZONE_AGREE,                  // Ibcast of the layout and its swap time
+    ZONE_STAGED                  // Waiting for the swap time
+} ZoneFormationState;
+
+// In-run rebalancing as a state machine. Round r starts on every rank once
+// r + 1 rebalance intervals of the run have passed, and all rounds run on
+// a private communicator, so they never interleave with other collectives.
+// The main loop only posts and tests requests. Rank 0 clusters on a helper
+// thread and broadcasts the layout with a swap time ZONE_SWAP_MARGIN ahead
+// on its run clock. Every rank keeps the old layout until then. With
+// zone_async = 0 a round is started and waited out inline instead.
+typedef struct {
+    int state;
+    MPI_Comm comm;
+    int n;
+    int k;
+    int engine;                  // ZoneEngine
+    uint64_t seed;               // Partitioner seed, drawn by the main thread
+
+    int top;                     // Partners shipped per rank
+    AffinityShare* shares;       // This rank's heaviest partners
+    AffinityShare* all_shares;   // n x top
+    double* all_similarities;    // n x n, rank 0 with k-means only
+    uint16_t* latency_row;
+    uint16_t* all_latencies;     // Witness-table input, n x n
+    int* centroids;
+    int* assignments;            // Layout of the round in flight
+    double swap_at;              // Run-relative seconds on rank 0's clock
+    MPI_Request requests[2];
+
+    pthread_t helper;
+    atomic_int clustered;
+
+    int rounds;                  // Rounds started
+    int applied;
+    double round_stall;          // Main-thread seconds spent on this round
+    double stall_sum;
+    double stall_max;
+    double started_at;           // Run-relative start of the round
+    double layout_sum;           // Start-to-swap seconds, summed
+} ZoneFormation;
 
 // Function declarations
+int parse_zone_engine(const char* text);
 int form_zones(Node* node, int k_zones);
 void create_zone_communicator(Node* node);
-int* identify_witnesses(Node* node, int* zone_assignments, int size, int* count);
 double compute_similarity(Node* node, int other_rank);
+void assemble_similarity_matrix(int n, const uint16_t* all_latencies,
+                                const AffinityShare* all_top, int top, double* matrix);
+
+// Clustering kernels (operate on a dense n_nodes x n_nodes similarity matrix)
+double compute_distance(double* vec1, double* vec2, int dim);
+void kmeans_clustering(double* similarity_matrix, int n_nodes, int k,
+                       int* initial_centroids, int* assignments, int max_iterations);
+void kmeans_plusplus_init(double* similarity_matrix, int n_nodes, int k, int* centroids);
+
+// Background rebalancing (create, finish and report are collective)
+ZoneFormation* create_zone_formation(Node* node);
+void zone_formation_poll(ZoneFormation* zf, Node* node, double elapsed);
+void zone_formation_finish(ZoneFormation* zf, Node* node, double elapsed);
+void zone_formation_report(ZoneFormation* zf, Node* node);
+void destroy_zone_formation(ZoneFormation* zf);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,105 @@
+// affinity.c - Decayed Space-Saving sketch of traffic partners
+
+#include "affinity.h"
+
+#define AFFINITY_MAX_EXPONENT 64.0   // Rebase once weights reach e^64
+
+AffinitySketch* create_affinity_sketch(int capacity, double half_life) {
+    AffinitySketch* sketch = (AffinitySketch*)calloc(1, sizeof(AffinitySketch));
+    sketch->capacity = MAX(capacity, 1);
+    sketch->entries = (AffinityEntry*)malloc(sketch->capacity * sizeof(AffinityEntry));
+    affinity_reset(sketch, half_life);
+    return sketch;
+}
+
+void destroy_affinity_sketch(AffinitySketch* sketch) {
+    if (!sketch) return;
+    free(sketch->entries);
+    free(sketch);
+}
+
+// Forgets all traffic; the capacity is kept
+void affinity_reset(AffinitySketch* sketch, double half_life) {
+    sketch->used = 0;
+    sketch->total = 0.0;
+    sketch->landmark = 0.0;
+    sketch->rate = half_life > 0.0 ? log(2.0) / half_life : 0.0;
+    sketch->evictions = 0;
+}
+
+// Moves the landmark to `now`, scaling every weight down to match
+void affinity_rebase(AffinitySketch* sketch, double now) {
+    double scale = exp(-sketch->rate * (now - sketch->landmark));
+    for (int i = 0; i < sketch->used; i++) {
+        sketch->entries[i].count *= scale;
+        sketch->entries[i].error *= scale;
+    }
+    sketch->total *= scale;
+    sketch->landmark = now;
+}
+
+// Counts one tx exchanged with `peer` at time `now`. A negative peer
+// counts towards the total only (the rank's own txs).
+void affinity_observe(AffinitySketch* sketch, int peer, double now) {
+    if (sketch->total == 0.0) {
+        sketch->landmark = now;
+    } else if (sketch->rate * (now - sketch->landmark) > AFFINITY_MAX_EXPONENT) {
+        affinity_rebase(sketch, now);
+    }
+    double weight = exp(sketch->rate * (now - sketch->landmark));
+    sketch->total += weight;
+    if (peer < 0) return;
+
+    int lightest = 0;
+    for (int i = 0; i < sketch->used; i++) {
+        AffinityEntry* entry = &sketch->entries[i];
+        if (entry->peer == peer) {
+            entry->count += weight;
+            return;
+        }
+        if (entry->count < sketch->entries[lightest].count) lightest = i;
+    }
+    if (sketch->used < sketch->capacity) {
+        sketch->entries[sketch->used++] = (AffinityEntry){ peer, weight, 0.0 };
+        return;
+    }
+    AffinityEntry* entry = &sketch->entries[lightest];
+    entry->peer = peer;
+    entry->error = entry->count;
+    entry->count += weight;
+    sketch->evictions++;
+}
+
+// Fraction of recent traffic exchanged with peer (0 if untracked)
+double affinity_share(const AffinitySketch* sketch, int peer) {
+    if (sketch->total <= 0.0) return 0.0;
+    for (int i = 0; i < sketch->used; i++) {
+        if (sketch->entries[i].peer == peer) {
+            return sketch->entries[i].count / sketch->total;
+        }
+    }
+    return 0.0;
+}
+
+static int compare_shares(const void* a, const void* b) {
+    float x = ((const AffinityShare*)a)->share, y = ((const AffinityShare*)b)->share;
+    return (x < y) - (x > y);
+}
+
+// Fills top[0..k) with the k heaviest partners, heaviest first, and pads
+// with peer -1. Returns the number of partners filled in.
+int affinity_top(const AffinitySketch* sketch, AffinityShare* top, int k) {
+    AffinityShare* all = (AffinityShare*)malloc(MAX(sketch->used, 1) * sizeof(AffinityShare));
+    for (int i = 0; i < sketch->used; i++) {
+        all[i].peer = sketch->entries[i].peer;
+        all[i].share = (float)(sketch->entries[i].count / sketch->total);
+    }
+    qsort(all, sketch->used, sizeof(AffinityShare), compare_shares);
+
+    int n = MIN(k, sketch->used);
+    for (int i = 0; i < k; i++) {
+        top[i] = (i < n) ? all[i] : (AffinityShare){ -1, 0.0f };
+    }
+    free(all);
+    return n;
+}
@@ -0,0 +1,182 @@
+// arena.c - Scoped bump allocation and fixed-size block pools
+
+#include "arena.h"
+#include <stdatomic.h>
+#include <stddef.h>
+
+Scratch g_scratch;
+
+// Heap allocations by the simulator's objects, on any thread
+static atomic_long allocations;
+
+void* __real_malloc(size_t size);
+void* __real_calloc(size_t n, size_t size);
+void* __real_realloc(void* ptr, size_t size);
+
+void* __wrap_malloc(size_t size) {
+    atomic_fetch_add_explicit(&allocations, 1, memory_order_relaxed);
+    return __real_malloc(size);
+}
+
+void* __wrap_calloc(size_t n, size_t size) {
+    atomic_fetch_add_explicit(&allocations, 1, memory_order_relaxed);
+    return __real_calloc(n, size);
+}
+
+void* __wrap_realloc(void* ptr, size_t size) {
+    atomic_fetch_add_explicit(&allocations, 1, memory_order_relaxed);
+    return __real_realloc(ptr, size);
+}
+
+long heap_allocations(void) {
+    return atomic_load_explicit(&allocations, memory_order_relaxed);
+}
+
+// Chunk data starts after the header, rounded up to ARENA_ALIGN
+#define CHUNK_HEADER ((sizeof(ArenaChunk) + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1))
+
+static ArenaChunk* new_chunk(ArenaChunk* prev, size_t size) {
+    ArenaChunk* chunk = (ArenaChunk*)malloc(CHUNK_HEADER + size);
+    chunk->prev = prev;
+    chunk->size = size;
+    chunk->used = 0;
+    return chunk;
+}
+
+// ARENA_ALIGN-aligned and valid until the arena is reset; never fails
+void* arena_alloc(Arena* arena, size_t bytes) {
+    bytes = (bytes + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+    ArenaChunk* chunk = arena->head;
+    if (!chunk || chunk->size - chunk->used < bytes) {
+        size_t size = chunk ? 2 * chunk->size : ARENA_CHUNK;
+        while (size < bytes) size *= 2;
+        chunk = arena->head = new_chunk(chunk, size);
+        arena->chunks++;
+    }
+    void* p = (char*)chunk + CHUNK_HEADER + chunk->used;
+    chunk->used += bytes;
+    arena->in_use += bytes;
+    arena->peak = MAX(arena->peak, arena->in_use);
+    return p;
+}
+
+// Frees everything at once. An arena that grew past one chunk replaces
+// them with a single chunk holding their total, so the next cycle of the
+// same size fits without a heap allocation.
+void arena_reset(Arena* arena) {
+    ArenaChunk* chunk = arena->head;
+    if (chunk && chunk->prev) {
+        size_t total = 0;
+        while (chunk) {
+            ArenaChunk* prev = chunk->prev;
+            total += chunk->size;
+            free(chunk);
+            chunk = prev;
+        }
+        arena->head = new_chunk(NULL, total);
+        arena->chunks++;
+    } else if (chunk) {
+        chunk->used = 0;
+    }
+    arena->in_use = 0;
+}
+
+void arena_free(Arena* arena) {
+    ArenaChunk* chunk = arena->head;
+    while (chunk) {
+        ArenaChunk* prev = chunk->prev;
+        free(chunk);
+        chunk = prev;
+    }
+    arena->head = NULL;
+    arena->in_use = 0;
+}
+
+void block_pool_init(BlockPool* pool, size_t block_size) {
+    memset(pool, 0, sizeof(*pool));
+    block_size = MAX(block_size, sizeof(PoolBlock));
+    pool->block_size = (block_size + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+}
+
+// A block of block_size bytes; the pool takes a slab of BLOCK_POOL_SLAB
+// blocks from the heap when its free list is empty
+void* block_pool_get(BlockPool* pool) {
+    if (!pool->free_list) {
+        size_t header = (sizeof(PoolSlab) + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+        PoolSlab* slab = (PoolSlab*)malloc(header + BLOCK_POOL_SLAB * pool->block_size);
+        slab->next = pool->slabs;
+        pool->slabs = slab;
+        pool->slab_count++;
+        for (int i = BLOCK_POOL_SLAB - 1; i >= 0; i--) {
+            PoolBlock* block = (PoolBlock*)((char*)slab + header + i * pool->block_size);
+            block->next = pool->free_list;
+            pool->free_list = block;
+        }
+    }
+    PoolBlock* block = pool->free_list;
+    pool->free_list = block->next;
+    pool->in_use++;
+    pool->peak = MAX(pool->peak, pool->in_use);
+    return block;
+}
+
+void block_pool_put(BlockPool* pool, void* block) {
+    PoolBlock* b = (PoolBlock*)block;
+    b->next = pool->free_list;
+    pool->free_list = b;
+    pool->in_use--;
+}
+
+void block_pool_free(BlockPool* pool) {
+    PoolSlab* slab = pool->slabs;
+    while (slab) {
+        PoolSlab* next = slab->next;
+        free(slab);
+        slab = next;
+    }
+    pool->slabs = NULL;
+    pool->free_list = NULL;
+    pool->in_use = 0;
+}
+
+// Sizes the pools for zones as large as the world
+void scratch_init(int world_size) {
+    memset(&g_scratch, 0, sizeof(g_scratch));
+    block_pool_init(&g_scratch.requests, world_size * sizeof(MPI_Request));
+    block_pool_init(&g_scratch.votes, world_size * sizeof(int));
+}
+
+void scratch_free(void) {
+    arena_free(&g_scratch.iteration);
+    arena_free(&g_scratch.epoch);
+    block_pool_free(&g_scratch.requests);
+    block_pool_free(&g_scratch.votes);
+}
+
+// Collective over MPI_COMM_WORLD. allocations counts every thread of the
+// rank; busy is the loop time outside its 1 ms sleep.
+void scratch_report(Node* node, long iterations, long allocations, double busy) {
+    long local[2] = { iterations, allocations };
+    long totals[2];
+    MPI_Reduce(local, totals, 2, MPI_LONG, MPI_SUM, 0, MPI_COMM_WORLD);
+    double busy_total = 0.0;
+    MPI_Reduce(&busy, &busy_total, 1, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
+    long peaks[5] = { (long)g_scratch.iteration.peak, (long)g_scratch.epoch.peak,
+                      g_scratch.iteration.chunks + g_scratch.epoch.chunks,
+                      g_scratch.requests.peak, g_scratch.votes.peak };
+    long worst[5];
+    MPI_Reduce(peaks, worst, 5, MPI_LONG, MPI_MAX, 0, MPI_COMM_WORLD);
+
+    if (node->rank == 0 && totals[0] > 0) {
+        printf("\n=== ALLOCATION ===\n");
+        printf("Main loop: %ld iterations, %.3f ms busy per iteration\n",
+               totals[0], busy_total * 1000.0 / totals[0]);
+        printf("Heap allocations in the loop: %ld (%.2f per iteration)\n",
+               totals[1], (double)totals[1] / totals[0]);
+        printf("Arena peak: %.1f KB per iteration, %.1f KB per epoch, %ld chunks max\n",
+               worst[0] / 1024.0, worst[1] / 1024.0, worst[2]);
+        printf("Pool blocks in use: %ld request arrays, %ld vote buffers max\n",
+               worst[3], worst[4]);
+        printf("========================\n");
+    }
+}
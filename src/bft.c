@@ -1,6 +1,11 @@
 // bft.c - Byzantine Fault Tolerance consensus (simplified PBFT)
 
 #include "consensus.h"
+#include "flow.h"
+#include "arena.h"
+
+// Vote sent by a member that has finished its run (see bft_finish)
+#define BFT_VOTE_DONE -1
 
 int bft_consensus(Transaction* tx, Node* node) {
     int zone_rank, zone_size;
@@ -20,28 +25,73 @@ int bft_consensus(Transaction* tx, Node* node) {
     
     // Gather all votes using Allgather
     // NOTE: This requires all zone members to participate
-    // The caller must ensure this is only called when all ranks are active
-    int* all_votes = (int*)malloc(zone_size * sizeof(int));
-    MPI_Allgather(&my_vote, 1, MPI_INT,
-                  all_votes, 1, MPI_INT,
-                  node->zone_comm);
+    // The caller must ensure this is only called when all ranks are active.
+    // Under flow control a member may be holding back generation until this
+    // rank drains its messages, so the wait keeps servicing the flow.
+    int* all_votes = (int*)block_pool_get(&g_scratch.votes);
+    MPI_Request request;
+    MPI_Iallgather(&my_vote, 1, MPI_INT,
+                   all_votes, 1, MPI_INT,
+                   node->zone_comm, &request);
+    int done = 0;
+    MPI_Test(&request, &done, MPI_STATUS_IGNORE);
+    while (!done) {
+        flow_service(node->flow);
+        MPI_Test(&request, &done, MPI_STATUS_IGNORE);
+    }
     
-    // Count accepts
+    // Count accepts among members that are still running
     int accept_count = 0;
+    int voting = 0;
     for (int i = 0; i < zone_size; i++) {
+        if (all_votes[i] == BFT_VOTE_DONE) continue;
+        voting++;
         if (all_votes[i] == 1) {
             accept_count++;
         }
     }
     
-    free(all_votes);
+    block_pool_put(&g_scratch.votes, all_votes);
     
     // Check if quorum reached
-    double acceptance_ratio = (double)accept_count / zone_size;
+    double acceptance_ratio = (double)accept_count / voting;
     
-    if (acceptance_ratio >= BFT_QUORUM) {
+    if (acceptance_ratio >= g_params.bft_quorum) {
         return 1;  // Accept
     }
     
     return 0;  // Reject
-}
\ No newline at end of file
+}
+
+// Called once by every zone member at the end of a run. Members issue
+// different numbers of vote collectives, so a member can be left waiting in
+// bft_consensus() for peers that have already stopped. Finished members keep
+// answering with BFT_VOTE_DONE until one round shows the whole zone done;
+// every member sees the same gathered round, so all leave together.
+void bft_finish(Node* node) {
+    int zone_size;
+    MPI_Comm_size(node->zone_comm, &zone_size);
+    if (zone_size <= 2) {
+        return;  // bft_consensus() uses no collectives for these zones
+    }
+    
+    int my_vote = BFT_VOTE_DONE;
+    int* all_votes = (int*)block_pool_get(&g_scratch.votes);
+    int all_done = 0;
+    while (!all_done) {
+        // Non-blocking, to match the rounds of bft_consensus()
+        MPI_Request request;
+        MPI_Iallgather(&my_vote, 1, MPI_INT,
+                       all_votes, 1, MPI_INT,
+                       node->zone_comm, &request);
+        MPI_Wait(&request, MPI_STATUS_IGNORE);
+        all_done = 1;
+        for (int i = 0; i < zone_size; i++) {
+            if (all_votes[i] != BFT_VOTE_DONE) {
+                all_done = 0;
+                break;
+            }
+        }
+    }
+    block_pool_put(&g_scratch.votes, all_votes);
+}
@@ -0,0 +1,90 @@
+// bloom.c - Two-generation Bloom filter keyed by 128-bit digests
+
+#include "bloom.h"
+#include "hash.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+BloomFilter* create_bloom_filter(long capacity, double fp_rate) {
+    if (capacity < 1) capacity = 1;
+    if (fp_rate <= 0.0 || fp_rate >= 1.0) fp_rate = 0.001;
+
+    // Optimal size and probe count, size rounded up to a power of two
+    double ln2 = log(2.0);
+    double optimal_bits = -(double)capacity * log(fp_rate) / (ln2 * ln2);
+    uint64_t bits = 64;
+    while ((double)bits < optimal_bits) bits <<= 1;
+    int hashes = (int)lround((double)bits / capacity * ln2);
+    if (hashes < 1) hashes = 1;
+    if (hashes > 16) hashes = 16;
+
+    BloomFilter* filter = (BloomFilter*)malloc(sizeof(BloomFilter));
+    filter->words = (long)(bits / 64);
+    filter->bits[0] = (uint64_t*)calloc(filter->words, sizeof(uint64_t));
+    filter->bits[1] = (uint64_t*)calloc(filter->words, sizeof(uint64_t));
+    filter->mask = bits - 1;
+    filter->hashes = hashes;
+    filter->capacity = capacity;
+    filter->inserted = 0;
+    filter->current = 0;
+    filter->rotations = 0;
+    return filter;
+}
+
+void destroy_bloom_filter(BloomFilter* filter) {
+    if (!filter) return;
+    free(filter->bits[0]);
+    free(filter->bits[1]);
+    free(filter);
+}
+
+// Digests are already uniform, so the two halves serve directly as the
+// base hashes for double hashing: probe i = h1 + i * h2
+static void probe_bases(const uint8_t* digest, uint64_t* h1, uint64_t* h2) {
+    memcpy(h1, digest, sizeof(uint64_t));
+    memcpy(h2, digest + sizeof(uint64_t), sizeof(uint64_t));
+    *h2 |= 1;  // Odd stride visits distinct bits in a power-of-two table
+}
+
+static int generation_contains(const BloomFilter* filter, const uint64_t* bits,
+                               uint64_t h1, uint64_t h2) {
+    for (int i = 0; i < filter->hashes; i++) {
+        uint64_t bit = (h1 + (uint64_t)i * h2) & filter->mask;
+        if (!(bits[bit >> 6] & (1ULL << (bit & 63)))) return 0;
+    }
+    return 1;
+}
+
+int bloom_contains(const BloomFilter* filter, const uint8_t* digest) {
+    uint64_t h1, h2;
+    probe_bases(digest, &h1, &h2);
+    return generation_contains(filter, filter->bits[filter->current], h1, h2) ||
+           generation_contains(filter, filter->bits[1 - filter->current], h1, h2);
+}
+
+void bloom_insert(BloomFilter* filter, const uint8_t* digest) {
+    if (filter->inserted >= filter->capacity) {
+        filter->current = 1 - filter->current;
+        memset(filter->bits[filter->current], 0, filter->words * sizeof(uint64_t));
+        filter->inserted = 0;
+        filter->rotations++;
+    }
+
+    uint64_t h1, h2;
+    probe_bases(digest, &h1, &h2);
+    uint64_t* bits = filter->bits[filter->current];
+    for (int i = 0; i < filter->hashes; i++) {
+        uint64_t bit = (h1 + (uint64_t)i * h2) & filter->mask;
+        bits[bit >> 6] |= 1ULL << (bit & 63);
+    }
+    filter->inserted++;
+}
+
+// Returns 1 if the digest may have been seen before (it is not inserted
+// again), 0 if it is certainly new (it is inserted)
+int bloom_check_insert(BloomFilter* filter, const uint8_t* digest) {
+    if (bloom_contains(filter, digest)) return 1;
+    bloom_insert(filter, digest);
+    return 0;
+}
@@ -0,0 +1,370 @@
+// checkpoint.c - Shared-file checkpoint of node, window, metrics, ledger and DAG
+
+#include "checkpoint.h"
+#include "affinity.h"
+#include <stddef.h>
+
+// Fixed-size part of a rank's blob; the arrays follow in declaration order
+typedef struct {
+    int32_t rank;
+    int32_t zone_id;
+    int32_t phase;
+    int32_t total_tx_count;
+    double x, y;
+    double elapsed;
+    int32_t tx_counter;
+    int32_t window_count;        // Timestamps, stored as ages in seconds
+    int32_t window_capacity;
+    int32_t latency_count;
+    int32_t dag_count;
+    int32_t dag_capacity;
+    int32_t total_transactions;
+    int32_t finalized_transactions;
+    int32_t queued_transactions;
+    int32_t pending_count;       // Weighted-DAG txs awaiting weight
+    double queue_delay_sum;
+    double queue_delay_max;
+    int64_t offered_transactions;
+    int64_t dropped_transactions;
+    int32_t cross_zone_finalized;
+    int32_t reserved2;
+    double cross_zone_latency_sum;
+    double cross_zone_latency_max;
+    int64_t duplicates_dropped;
+    int64_t corrupt_dropped;
+    int32_t ledger_accounts;     // 0 without a ledger
+    int32_t ledger_accounts_per_rank;
+    int32_t affinity_count;      // Sketch entries, heaviest first
+    int32_t reserved3;
+    double affinity_total;       // Decayed to the time of writing
+    uint64_t rng_counters[RNG_STREAMS];
+} RankRecord;
+
+static void put(unsigned char** p, const void* src, size_t len) {
+    memcpy(*p, src, len);
+    *p += len;
+}
+
+static void get(const unsigned char** p, void* dst, size_t len) {
+    memcpy(dst, *p, len);
+    *p += len;
+}
+
+static int heavier_first(const void* a, const void* b) {
+    double x = ((const AffinityEntry*)a)->count, y = ((const AffinityEntry*)b)->count;
+    return (x < y) - (x > y);
+}
+
+static size_t blob_size(const RankRecord* r, int nranks) {
+    return sizeof(RankRecord) +
+           nranks * sizeof(double) +                          // latencies
+           r->affinity_count * sizeof(AffinityEntry) +
+           r->window_count * sizeof(double) +
+           r->latency_count * sizeof(double) +
+           (size_t)r->ledger_accounts * sizeof(int64_t) +
+           (size_t)r->dag_count * sizeof(Transaction) +
+           (size_t)r->pending_count * sizeof(int32_t);
+}
+
+static MPI_Offset index_offset(int nranks) {
+    return sizeof(CheckpointHeader) + nranks * sizeof(int);
+}
+
+// MPI counts are ints, so a blob moves as whole CHECKPOINT_BLOCK-byte
+// blocks and then the remainder. Both calls are made on every rank, as the
+// collectives require. Returns 1 if both succeeded.
+#define CHECKPOINT_BLOCK ((size_t)1 << 30)
+
+static int blob_io_all(MPI_File fh, MPI_Offset offset, unsigned char* data, size_t len,
+                       int write) {
+    MPI_Datatype block;
+    MPI_Type_contiguous((int)CHECKPOINT_BLOCK, MPI_BYTE, &block);
+    MPI_Type_commit(&block);
+    int blocks = (int)(len / CHECKPOINT_BLOCK);
+    int rest = (int)(len % CHECKPOINT_BLOCK);
+    size_t done = (size_t)blocks * CHECKPOINT_BLOCK;
+    int rc[2];
+    if (write) {
+        rc[0] = MPI_File_write_at_all(fh, offset, data, blocks, block, MPI_STATUS_IGNORE);
+        rc[1] = MPI_File_write_at_all(fh, offset + done, data + done, rest, MPI_BYTE,
+                                      MPI_STATUS_IGNORE);
+    } else {
+        rc[0] = MPI_File_read_at_all(fh, offset, data, blocks, block, MPI_STATUS_IGNORE);
+        rc[1] = MPI_File_read_at_all(fh, offset + done, data + done, rest, MPI_BYTE,
+                                     MPI_STATUS_IGNORE);
+    }
+    MPI_Type_free(&block);
+    return rc[0] == MPI_SUCCESS && rc[1] == MPI_SUCCESS;
+}
+
+// 1 on every rank if ok is set on all of them
+static int all_ranks(int ok) {
+    int all_ok = 0;
+    MPI_Allreduce(&ok, &all_ok, 1, MPI_INT, MPI_LAND, MPI_COMM_WORLD);
+    return all_ok;
+}
+
+// Collective over MPI_COMM_WORLD. Returns 1 on success on every rank.
+int checkpoint_write(const char* path, Node* node, const RunState* state) {
+    int nranks = node->total_nodes;
+    double now = MPI_Wtime();
+    SlidingWindow* window = state->window;
+    Metrics* metrics = state->metrics;
+
+    RankRecord r;
+    memset(&r, 0, sizeof(r));
+    r.rank = node->rank;
+    r.zone_id = node->zone_id;
+    r.phase = node->phase;
+    r.total_tx_count = node->total_tx_count;
+    r.x = node->x;
+    r.y = node->y;
+    r.elapsed = state->elapsed;
+    r.tx_counter = state->tx_counter;
+    r.window_count = window->count;
+    r.window_capacity = window->capacity;
+    r.latency_count = metrics->latency_count;
+    r.dag_count = state->dag->count;
+    r.dag_capacity = state->dag->capacity;
+    r.total_transactions = metrics->total_transactions;
+    r.finalized_transactions = metrics->finalized_transactions;
+    r.queued_transactions = metrics->queued_transactions;
+    r.pending_count = state->pending ? state->pending->count : 0;
+    r.queue_delay_sum = metrics->queue_delay_sum;
+    r.queue_delay_max = metrics->queue_delay_max;
+    r.offered_transactions = metrics->offered_transactions;
+    r.dropped_transactions = metrics->dropped_transactions;
+    r.cross_zone_finalized = metrics->cross_zone_finalized;
+    r.cross_zone_latency_sum = metrics->cross_zone_latency_sum;
+    r.cross_zone_latency_max = metrics->cross_zone_latency_max;
+    r.duplicates_dropped = metrics->duplicates_dropped;
+    r.corrupt_dropped = metrics->corrupt_dropped;
+    if (state->ledger) {
+        ledger_flush(state->ledger);
+        r.ledger_accounts = state->ledger->n_accounts;
+        r.ledger_accounts_per_rank = state->ledger->accounts_per_rank;
+    }
+    affinity_rebase(node->affinity, now);
+    qsort(node->affinity->entries, node->affinity->used, sizeof(AffinityEntry), heavier_first);
+    r.affinity_count = node->affinity->used;
+    r.affinity_total = node->affinity->total;
+    rng_get_counters(r.rng_counters);
+
+    // Serialize the blob. Window entries are written oldest first.
+    size_t size = blob_size(&r, nranks);
+    unsigned char* blob = (unsigned char*)malloc(size);
+    unsigned char* p = blob;
+    put(&p, &r, sizeof(r));
+    put(&p, node->latencies, nranks * sizeof(double));
+    put(&p, node->affinity->entries, r.affinity_count * sizeof(AffinityEntry));
+    int oldest = (window->head - window->count + window->capacity) % window->capacity;
+    for (int i = 0; i < window->count; i++) {
+        double age = now - window->timestamps[(oldest + i) % window->capacity];
+        put(&p, &age, sizeof(double));
+    }
+    put(&p, metrics->latencies, metrics->latency_count * sizeof(double));
+    if (state->ledger) {
+        put(&p, state->ledger->balances, (size_t)r.ledger_accounts * sizeof(int64_t));
+    }
+    put(&p, state->dag->transactions, (size_t)state->dag->count * sizeof(Transaction));
+    for (int i = 0; i < r.pending_count; i++) {
+        int32_t position = state->pending->heap[i];
+        put(&p, &position, sizeof(position));
+    }
+
+    // Blobs are laid out in rank order after the index
+    unsigned long long my_size = size, before = 0;
+    MPI_Exscan(&my_size, &before, 1, MPI_UNSIGNED_LONG_LONG, MPI_SUM, MPI_COMM_WORLD);
+    if (node->rank == 0) before = 0;  // Exscan leaves rank 0 undefined
+
+    CheckpointIndex entry;
+    entry.offset = index_offset(nranks) + nranks * sizeof(CheckpointIndex) + before;
+    entry.length = size;
+
+    MPI_File fh;
+    int rc = MPI_File_open(MPI_COMM_WORLD, path, MPI_MODE_CREATE | MPI_MODE_WRONLY,
+                           MPI_INFO_NULL, &fh);
+    if (rc != MPI_SUCCESS) {
+        if (node->rank == 0) fprintf(stderr, "Error: cannot create checkpoint '%s'\n", path);
+        free(blob);
+        return 0;
+    }
+    int ok = (MPI_File_set_size(fh, 0) == MPI_SUCCESS);
+
+    if (node->rank == 0) {
+        CheckpointHeader h;
+        memset(&h, 0, sizeof(h));
+        memcpy(h.magic, CHECKPOINT_MAGIC, 8);
+        h.version = CHECKPOINT_VERSION;
+        h.nranks = nranks;
+        h.seed = rng_seed_value();
+        h.transaction_size = sizeof(Transaction);
+        ok = ok &&
+             MPI_File_write_at(fh, 0, &h, sizeof(h), MPI_BYTE, MPI_STATUS_IGNORE) == MPI_SUCCESS &&
+             MPI_File_write_at(fh, sizeof(h), node->zone_assignments, nranks, MPI_INT,
+                               MPI_STATUS_IGNORE) == MPI_SUCCESS;
+    }
+    ok = (MPI_File_write_at_all(fh, index_offset(nranks) + node->rank * sizeof(CheckpointIndex),
+                                &entry, sizeof(entry), MPI_BYTE, MPI_STATUS_IGNORE) ==
+          MPI_SUCCESS) && ok;
+    ok = blob_io_all(fh, entry.offset, blob, size, 1) && ok;
+    ok = (MPI_File_close(&fh) == MPI_SUCCESS) && ok;
+    free(blob);
+
+    if (!all_ranks(ok)) {
+        if (node->rank == 0) fprintf(stderr, "Error: writing checkpoint '%s' failed\n", path);
+        return 0;
+    }
+    return 1;
+}
+
+// Collective over MPI_COMM_WORLD. Restores the node's geography, latencies,
+// traffic history and zone layout (zone_comm is left for the caller to
+// rebuild) and allocates the run state. Returns 1 on success on every rank.
+int checkpoint_read(const char* path, Node* node, RunState* state,
+                    unsigned long long* seed) {
+    int nranks = node->total_nodes;
+
+    MPI_File fh;
+    if (MPI_File_open(MPI_COMM_WORLD, path, MPI_MODE_RDONLY, MPI_INFO_NULL, &fh) != MPI_SUCCESS) {
+        if (node->rank == 0) fprintf(stderr, "Error: cannot open checkpoint '%s'\n", path);
+        return 0;
+    }
+
+    CheckpointHeader h;
+    MPI_Offset file_size = 0;
+    int ok = (MPI_File_get_size(fh, &file_size) == MPI_SUCCESS) &&
+             file_size >= (MPI_Offset)sizeof(h) &&
+             MPI_File_read_at_all(fh, 0, &h, sizeof(h), MPI_BYTE, MPI_STATUS_IGNORE) ==
+             MPI_SUCCESS;
+    if (!all_ranks(ok)) {
+        if (node->rank == 0) fprintf(stderr, "Error: cannot read checkpoint '%s'\n", path);
+        MPI_File_close(&fh);
+        return 0;
+    }
+    if (memcmp(h.magic, CHECKPOINT_MAGIC, 8) != 0 || h.version != CHECKPOINT_VERSION ||
+        h.transaction_size != sizeof(Transaction)) {
+        if (node->rank == 0) fprintf(stderr, "Error: '%s' is not a compatible checkpoint\n", path);
+        MPI_File_close(&fh);
+        return 0;
+    }
+    if (h.nranks != nranks) {
+        if (node->rank == 0) {
+            fprintf(stderr, "Error: checkpoint '%s' has %d ranks, job has %d\n",
+                    path, h.nranks, nranks);
+        }
+        MPI_File_close(&fh);
+        return 0;
+    }
+
+    // A truncated file or bad index entry fails here rather than in a read
+    CheckpointIndex entry;
+    memset(&entry, 0, sizeof(entry));
+    ok = MPI_File_read_at_all(fh, sizeof(h), node->zone_assignments, nranks, MPI_INT,
+                              MPI_STATUS_IGNORE) == MPI_SUCCESS;
+    ok = (MPI_File_read_at_all(fh, index_offset(nranks) + node->rank * sizeof(CheckpointIndex),
+                               &entry, sizeof(entry), MPI_BYTE, MPI_STATUS_IGNORE) ==
+          MPI_SUCCESS) && ok;
+    ok = ok && entry.length >= sizeof(RankRecord) && entry.offset <= (uint64_t)file_size &&
+         entry.length <= (uint64_t)file_size - entry.offset;
+
+    unsigned char* blob = (unsigned char*)malloc(ok ? entry.length : 1);
+    ok = blob_io_all(fh, ok ? entry.offset : 0, blob, ok ? entry.length : 0, 0) && ok;
+    ok = (MPI_File_close(&fh) == MPI_SUCCESS) && ok;
+
+    const unsigned char* p = blob;
+    RankRecord r;
+    if (ok) {
+        get(&p, &r, sizeof(r));
+        ok = (r.rank == node->rank && blob_size(&r, nranks) == entry.length);
+    }
+    if (!all_ranks(ok)) {
+        if (node->rank == 0) fprintf(stderr, "Error: checkpoint '%s' is corrupt\n", path);
+        free(blob);
+        return 0;
+    }
+
+    node->zone_id = r.zone_id;
+    node->phase = r.phase;
+    node->total_tx_count = r.total_tx_count;
+    node->x = r.x;
+    node->y = r.y;
+    get(&p, node->latencies, nranks * sizeof(double));
+
+    // The sketch resumes from the restore time; entries beyond its
+    // capacity (a smaller affinity_slots) are dropped
+    double now = MPI_Wtime();
+    AffinitySketch* affinity = node->affinity;
+    affinity_reset(affinity, g_params.affinity_half_life);
+    for (int i = 0; i < r.affinity_count; i++) {
+        AffinityEntry entry;
+        get(&p, &entry, sizeof(entry));
+        if (affinity->used < affinity->capacity) affinity->entries[affinity->used++] = entry;
+    }
+    affinity->total = r.affinity_total;
+    affinity->landmark = now;
+    state->window = create_window(r.window_capacity);
+    for (int i = 0; i < r.window_count; i++) {
+        double age;
+        get(&p, &age, sizeof(double));
+        add_timestamp(state->window, now - age);
+    }
+
+    Metrics* metrics = create_metrics();
+    if (r.latency_count > metrics->latency_capacity) {
+        metrics->latency_capacity = r.latency_count;
+        metrics->latencies = (double*)realloc(metrics->latencies,
+                                              (size_t)r.latency_count * sizeof(double));
+    }
+    metrics->latency_count = r.latency_count;
+    get(&p, metrics->latencies, (size_t)r.latency_count * sizeof(double));
+    metrics->total_transactions = r.total_transactions;
+    metrics->finalized_transactions = r.finalized_transactions;
+    metrics->queued_transactions = r.queued_transactions;
+    metrics->queue_delay_sum = r.queue_delay_sum;
+    metrics->queue_delay_max = r.queue_delay_max;
+    metrics->offered_transactions = r.offered_transactions;
+    metrics->dropped_transactions = r.dropped_transactions;
+    metrics->cross_zone_finalized = r.cross_zone_finalized;
+    metrics->cross_zone_latency_sum = r.cross_zone_latency_sum;
+    metrics->cross_zone_latency_max = r.cross_zone_latency_max;
+    metrics->duplicates_dropped = r.duplicates_dropped;
+    metrics->corrupt_dropped = r.corrupt_dropped;
+    state->metrics = metrics;
+
+    // Balances are skipped if this run has execution disabled
+    state->ledger = NULL;
+    if (r.ledger_accounts > 0 && g_params.ledger_batch > 0) {
+        Ledger* ledger = create_ledger(nranks, r.ledger_accounts_per_rank,
+                                       MAX(parse_ledger_mode(g_params.ledger_mode), LEDGER_STATIC),
+                                       g_params.ledger_threads, g_params.ledger_batch);
+        get(&p, ledger->balances, (size_t)r.ledger_accounts * sizeof(int64_t));
+        state->ledger = ledger;
+    } else {
+        p += (size_t)r.ledger_accounts * sizeof(int64_t);
+    }
+
+    state->dag = create_dag(MAX(r.dag_capacity, r.dag_count));
+    get(&p, state->dag->transactions, (size_t)r.dag_count * sizeof(Transaction));
+    state->dag->count = r.dag_count;
+    for (int i = 0; i < r.dag_count; i++) {
+        state->dag->weights[i] = 1;
+    }
+
+    // Keyed again by the weights the first update_weights() pass rebuilds
+    state->pending = create_finality_tracker(state->dag->capacity);
+    for (int i = 0; i < r.pending_count; i++) {
+        int32_t position;
+        get(&p, &position, sizeof(position));
+        finality_track(state->pending, state->dag, position);
+    }
+
+    state->tx_counter = r.tx_counter;
+    state->elapsed = r.elapsed;
+    *seed = h.seed;
+    rng_seed(h.seed, node->rank);
+    rng_set_counters(r.rng_counters);
+
+    free(blob);
+    return 1;
+}
@@ -1,5 +1,6 @@
-#include "consensus.h"
+// Python.h must come first: it sets feature-test macros for the whole unit
 #include <Python.h>
+#include "consensus.h"
 #include <string.h>
 
 // ------------------------------------------------------------------
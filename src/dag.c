@@ -1,6 +1,51 @@
 // dag.c - DAG implementation
 
 #include "dag.h"
+#include "arena.h"
+
+// Sizes the digest index at twice the capacity, rounded up to a power of
+// two, and the changed-weight list. The reachability index is only kept
+// up to date with ghostdag set; otherwise the first query builds it.
+static void create_index(DAG* dag) {
+    uint32_t slots = 16;
+    while (slots < 2u * (uint32_t)dag->capacity) slots <<= 1;
+    dag->index = (int*)malloc(slots * sizeof(int));
+    memset(dag->index, 0xff, slots * sizeof(int));  // All -1
+    dag->index_mask = slots - 1;
+    dag->indexed = 0;
+    dag->changed = (int*)malloc(2 * (size_t)dag->capacity * sizeof(int));
+    dag->n_changed = 0;
+    dag->reach = g_params.ghostdag ? create_reachability(dag->capacity, g_params.ghostdag_k)
+                                   : NULL;
+}
+
+static uint32_t index_slot(const DAG* dag, const uint8_t* digest) {
+    uint32_t h;
+    memcpy(&h, digest, sizeof(h));
+    return h & dag->index_mask;
+}
+
+static void index_insert(DAG* dag, int position) {
+    uint32_t slot = index_slot(dag, dag->transactions[position].digest);
+    while (dag->index[slot] >= 0) {
+        slot = (slot + 1) & dag->index_mask;
+    }
+    dag->index[slot] = position;
+}
+
+static void index_catch_up(DAG* dag) {
+    while (dag->indexed < dag->count) {
+        index_insert(dag, dag->indexed++);
+    }
+}
+
+// A no-op until the reachability index exists
+static void reach_catch_up(DAG* dag) {
+    if (!dag->reach) return;
+    while (dag->reach->labeled < dag->count) {
+        reach_add(dag->reach, dag->transactions, dag->reach->labeled);
+    }
+}
 
 DAG* create_dag(int capacity) {
     DAG* dag = (DAG*)malloc(sizeof(DAG));
@@ -8,26 +53,182 @@ DAG* create_dag(int capacity) {
     dag->weights = (int*)calloc(capacity, sizeof(int));
     dag->count = 0;
     dag->capacity = capacity;
+    dag->log = NULL;
+    dag->shared = NULL;
+    dag->ready = NULL;
+    dag->win = MPI_WIN_NULL;
+    create_index(dag);
+    return dag;
+}
+
+// DAG whose transactions live in a memory-mapped log. Committed records of
+// an existing log are adopted as-is and indexed here, so the digest index
+// (and GHOSTDAG labels, with ghostdag set) cost the recovery rather than
+// the first insert; weights are rebuilt by update_weights.
+DAG* create_logged_dag(const char* path, int capacity) {
+    DagLog* log = dag_log_open(path, capacity, g_params.dag_log_commit_every,
+                               g_params.dag_log_commit_interval);
+    if (!log) return NULL;
+
+    DAG* dag = (DAG*)malloc(sizeof(DAG));
+    dag->log = log;
+    dag->shared = NULL;
+    dag->ready = NULL;
+    dag->win = MPI_WIN_NULL;
+    dag->transactions = log->records;
+    dag->capacity = (int)log->capacity;
+    dag->count = (int)log->committed;
+    dag->weights = (int*)malloc(dag->capacity * sizeof(int));
+    for (int i = 0; i < dag->count; i++) {
+        dag->weights[i] = 1;
+    }
+    create_index(dag);
+    index_catch_up(dag);
+    reach_catch_up(dag);
     return dag;
 }
 
+// Segment layout: header, ready flags, transactions, weights; each part
+// starts on a 64-byte boundary
+static size_t shared_align(size_t bytes) {
+    return (bytes + 63) & ~(size_t)63;
+}
+
+size_t shared_dag_bytes(int capacity) {
+    return shared_align(sizeof(SharedDagHeader)) +
+           shared_align(capacity) +
+           shared_align((size_t)capacity * sizeof(Transaction)) +
+           (size_t)capacity * sizeof(int);
+}
+
+// Collective over host_comm (ranks that can load/store each other's memory).
+// Host rank 0 allocates and initializes the segment; the others map it.
+DAG* create_shared_dag(MPI_Comm host_comm, int capacity) {
+    int host_rank;
+    MPI_Comm_rank(host_comm, &host_rank);
+
+    char* base;
+    MPI_Aint size = host_rank == 0 ? (MPI_Aint)shared_dag_bytes(capacity) : 0;
+    DAG* dag = (DAG*)malloc(sizeof(DAG));
+    MPI_Win_allocate_shared(size, 1, MPI_INFO_NULL, host_comm, &base, &dag->win);
+    if (host_rank != 0) {
+        MPI_Aint owner_size;
+        int disp_unit;
+        MPI_Win_shared_query(dag->win, 0, &owner_size, &disp_unit, &base);
+    }
+    MPI_Win_lock_all(MPI_MODE_NOCHECK, dag->win);
+
+    size_t offset = 0;
+    dag->shared = (SharedDagHeader*)(base + offset);
+    offset += shared_align(sizeof(SharedDagHeader));
+    dag->ready = (atomic_uchar*)(base + offset);
+    offset += shared_align(capacity);
+    dag->transactions = (Transaction*)(base + offset);
+    offset += shared_align((size_t)capacity * sizeof(Transaction));
+    dag->weights = (int*)(base + offset);
+
+    if (host_rank == 0) {
+        atomic_init(&dag->shared->reserved, 0);
+        dag->shared->capacity = capacity;
+        for (int i = 0; i < capacity; i++) {
+            atomic_init(&dag->ready[i], 0);
+        }
+    }
+    MPI_Win_sync(dag->win);
+    MPI_Barrier(host_comm);
+    MPI_Win_sync(dag->win);
+
+    dag->count = 0;
+    dag->capacity = capacity;
+    dag->log = NULL;
+    create_index(dag);
+    return dag;
+}
+
+// Advances count over slots other ranks have published since the last
+// call. Returns the new count; a no-op for a private DAG.
+int dag_refresh(DAG* dag) {
+    if (!dag->shared) return dag->count;
+    while (dag->count < dag->capacity &&
+           atomic_load_explicit(&dag->ready[dag->count], memory_order_acquire)) {
+        dag->count++;
+    }
+    return dag->count;
+}
+
+// Lock-free append: reserve a slot, fill it, then publish it
+static int shared_append(DAG* dag, Transaction* tx) {
+    int slot = atomic_fetch_add_explicit(&dag->shared->reserved, 1, memory_order_relaxed);
+    if (slot >= dag->capacity) return 0;
+    dag->transactions[slot] = *tx;
+    dag->weights[slot] = 1;
+    atomic_store_explicit(&dag->ready[slot], 1, memory_order_release);
+    dag_refresh(dag);
+    return 1;
+}
+
 void destroy_dag(DAG* dag) {
-    free(dag->transactions);
+    if (dag->win != MPI_WIN_NULL) {
+        // Collective over the host communicator; frees the shared segment
+        MPI_Win_unlock_all(dag->win);
+        MPI_Win_free(&dag->win);
+        free(dag->index);
+        free(dag->changed);
+        destroy_reachability(dag->reach);
+        free(dag);
+        return;
+    }
+    if (dag->log) {
+        dag_log_close(dag->log);
+    } else {
+        free(dag->transactions);
+    }
     free(dag->weights);
+    free(dag->index);
+    free(dag->changed);
+    destroy_reachability(dag->reach);
     free(dag);
 }
 
+// Returns 0 if the DAG is full, already holds a tx with this digest or its
+// log failed to commit. A tx whose own commit fails stays in memory.
 int add_transaction(DAG* dag, Transaction* tx) {
     if (dag->count >= dag->capacity) return 0;
+    if (dag->log && dag->log->failed) return 0;
+    if (dag_find(dag, tx->digest) >= 0) return 0;
+    if (dag->shared) {
+        if (!shared_append(dag, tx)) return 0;
+        reach_catch_up(dag);
+        return 1;
+    }
     
     dag->transactions[dag->count] = *tx;
     dag->weights[dag->count] = 1;  // Initial weight
+    index_insert(dag, dag->count);
     dag->count++;
+    dag->indexed = dag->count;
+    reach_catch_up(dag);
+    if (dag->log) dag_log_appended(dag->log);
     return 1;
 }
 
+// Position of the tx with this digest, or -1
+int dag_find(DAG* dag, const uint8_t* digest) {
+    index_catch_up(dag);
+    uint32_t slot = index_slot(dag, digest);
+    while (dag->index[slot] >= 0) {
+        int position = dag->index[slot];
+        if (memcmp(dag->transactions[position].digest, digest, HASH_DIGEST_BYTES) == 0) {
+            return position;
+        }
+        slot = (slot + 1) & dag->index_mask;
+    }
+    return -1;
+}
+
+// From the iteration arena: valid until the main loop's next iteration
 int* get_latest_transactions(DAG* dag, int count) {
-    int* parents = (int*)malloc(count * sizeof(int));
+    int* parents = (int*)arena_alloc(&g_scratch.iteration, MAX(count, 2) * sizeof(int));
     
     if (dag->count == 0) {
         parents[0] = -1;
@@ -49,22 +250,54 @@ int get_weight(DAG* dag, int tx_id) {
     return dag->weights[tx_id];
 }
 
-void update_weights(DAG* dag) {
-    // Reset weights
-    for (int i = 0; i < dag->count; i++) {
-        dag->weights[i] = 1;
+// A tx's weight is 1 plus its heaviest approver's weight, decayed by
+// wd_decay per hop and rounded, so it saturates near 1 / wd_decay. Parents
+// always precede their children (a parent index that does not is ignored),
+// so one newest-to-oldest pass pushes every weight to its parents after
+// all its children have pushed theirs. Weights never decrease as the DAG
+// grows, which lets each pass raise them in place. Returns the number of
+// entries in dag->changed.
+int update_weights(DAG* dag) {
+    double keep = 1.0 - g_params.wd_decay;
+    dag->n_changed = 0;
+    for (int i = dag->count - 1; i > 0; i--) {
+        Transaction* tx = &dag->transactions[i];
+        int pushed = 1 + (int)lround(dag->weights[i] * keep);
+        for (int k = 0; k < 2; k++) {
+            int p = tx->parents[k];
+            if (p < 0 || p >= i || dag->weights[p] >= pushed) continue;
+            dag->weights[p] = pushed;
+            dag->changed[dag->n_changed++] = p;
+        }
     }
-    
-    // Compute cumulative weights (bottom-up)
+    return dag->n_changed;
+}
+
+// Highest tx_id issued by sender, scanning back from the newest record.
+// Lets a restarted rank continue its id sequence after recovery.
+int last_tx_id_from(DAG* dag, int sender) {
     for (int i = dag->count - 1; i >= 0; i--) {
-        Transaction* tx = &dag->transactions[i];
-        
-        // Add weight from children (transactions referencing this one)
-        for (int j = i + 1; j < dag->count; j++) {
-            Transaction* child = &dag->transactions[j];
-            if (child->parents[0] == i || child->parents[1] == i) {
-                dag->weights[i] += (int)(dag->weights[j] * WD_DECAY);
-            }
+        if (dag->transactions[i].sender == sender) {
+            return dag->transactions[i].tx_id;
         }
     }
-}
\ No newline at end of file
+    return -1;
+}
+
+// Creates the reachability index on first use and labels every tx
+static void dag_reach(DAG* dag) {
+    if (!dag->reach) dag->reach = create_reachability(dag->capacity, g_params.ghostdag_k);
+    reach_catch_up(dag);
+}
+
+// 1 if the tx at position a is in the past of the tx at position b
+int dag_is_ancestor(DAG* dag, int a, int b) {
+    dag_reach(dag);
+    return reach_is_ancestor(dag->reach, a, b);
+}
+
+// Writes every position in GHOSTDAG order; returns the count
+int dag_ghostdag_order(DAG* dag, int* order) {
+    dag_reach(dag);
+    return ghostdag_order(dag->reach, order);
+}
@@ -0,0 +1,199 @@
+// dag_log.c - Memory-mapped DAG log with group commit and fast recovery
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "dag_log.h"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// Bitwise CRC-32 (IEEE); the header is a few dozen bytes
+static uint32_t crc32(const void* data, size_t len) {
+    const unsigned char* p = (const unsigned char*)data;
+    uint32_t crc = 0xFFFFFFFFu;
+    for (size_t i = 0; i < len; i++) {
+        crc ^= p[i];
+        for (int b = 0; b < 8; b++) {
+            crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1u)));
+        }
+    }
+    return ~crc;
+}
+
+static uint32_t header_checksum(const DagLogHeader* h) {
+    return crc32(h, offsetof(DagLogHeader, checksum));
+}
+
+static int header_valid(const DagLogHeader* h) {
+    return memcmp(h->magic, DAG_LOG_MAGIC, 8) == 0 &&
+           h->version == DAG_LOG_VERSION &&
+           h->record_size == sizeof(Transaction) &&
+           h->committed <= h->capacity &&
+           h->checksum == header_checksum(h);
+}
+
+// msync the pages covering [offset, offset + len) of the mapping. Returns 0
+// if they could not be made durable.
+static int sync_range(DagLog* log, size_t offset, size_t len) {
+    size_t start = offset & ~(log->page_size - 1);
+    size_t end = offset + len;
+    if (msync(log->map + start, end - start, MS_SYNC) != 0) return 0;
+    log->synced_bytes += ((end - start + log->page_size - 1) / log->page_size) * log->page_size;
+    return 1;
+}
+
+static int write_header(DagLog* log) {
+    DagLogHeader h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, DAG_LOG_MAGIC, 8);
+    h.version = DAG_LOG_VERSION;
+    h.record_size = sizeof(Transaction);
+    h.capacity = log->capacity;
+    h.committed = log->committed;
+    h.sequence = log->sequence;
+    h.checksum = header_checksum(&h);
+
+    log->slots[log->sequence % 2] = h;
+    return sync_range(log, 0, DAG_LOG_HEADER_BYTES);
+}
+
+// Opens or creates the log. An existing valid log is recovered: its
+// committed records become visible through log->records immediately.
+DagLog* dag_log_open(const char* path, uint64_t capacity, int commit_every,
+                     double commit_interval) {
+    int fd = open(path, O_RDWR | O_CREAT, 0644);
+    if (fd < 0) {
+        perror(path);
+        return NULL;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        perror(path);
+        close(fd);
+        return NULL;
+    }
+
+    // Recover from whichever header slot holds the newest valid commit
+    DagLogHeader slots[2];
+    const DagLogHeader* best = NULL;
+    if ((size_t)st.st_size >= DAG_LOG_HEADER_BYTES &&
+        pread(fd, slots, sizeof(slots), 0) == (ssize_t)sizeof(slots)) {
+        for (int i = 0; i < 2; i++) {
+            if (header_valid(&slots[i]) && (!best || slots[i].sequence > best->sequence)) {
+                best = &slots[i];
+            }
+        }
+    }
+    if (!best && st.st_size > 0) {
+        fprintf(stderr, "Warning: '%s' has no valid header; starting a new log\n", path);
+    }
+
+    if (best && best->capacity > capacity) {
+        capacity = best->capacity;
+    }
+    size_t map_size = DAG_LOG_HEADER_BYTES + capacity * sizeof(Transaction);
+    if ((size_t)st.st_size < map_size && ftruncate(fd, map_size) != 0) {
+        perror(path);
+        close(fd);
+        return NULL;
+    }
+
+    void* map = mmap(NULL, map_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (map == MAP_FAILED) {
+        perror(path);
+        close(fd);
+        return NULL;
+    }
+
+    DagLog* log = (DagLog*)calloc(1, sizeof(DagLog));
+    log->fd = fd;
+    log->map = (unsigned char*)map;
+    log->map_size = map_size;
+    log->page_size = (size_t)sysconf(_SC_PAGESIZE);
+    log->slots = (DagLogHeader*)map;
+    log->records = (Transaction*)(log->map + DAG_LOG_HEADER_BYTES);
+    log->capacity = capacity;
+    log->commit_every = MAX(commit_every, 1);
+    log->commit_interval = commit_interval;
+    log->last_commit = now_seconds();
+
+    if (best) {
+        log->committed = best->committed;
+        log->sequence = best->sequence;
+        log->appended = best->committed;  // Anything past the commit is torn
+    }
+    if (!best || best->capacity != capacity) {
+        log->sequence++;
+        if (!write_header(log)) {
+            perror(path);
+            munmap(map, map_size);
+            close(fd);
+            free(log);
+            return NULL;
+        }
+    }
+    return log;
+}
+
+// Called after a record was written at records[appended]. Returns 0 if
+// a commit it triggered failed.
+int dag_log_appended(DagLog* log) {
+    log->appended++;
+    if (log->appended - log->committed >= (uint64_t)log->commit_every) {
+        return dag_log_commit(log);
+    } else if (now_seconds() - log->last_commit >= log->commit_interval) {
+        return dag_log_commit(log);
+    }
+    return 1;
+}
+
+// Group commit: make records durable, then publish the new count. Returns
+// 0 and marks the log failed if either msync fails; the records past the
+// last good commit are then not durable and later appends are refused.
+int dag_log_commit(DagLog* log) {
+    log->last_commit = now_seconds();
+    if (log->failed) return 0;
+    if (log->appended == log->committed) return 1;
+
+    uint64_t first = log->committed;
+    uint64_t count = log->appended - log->committed;
+    if (!sync_range(log, DAG_LOG_HEADER_BYTES + first * sizeof(Transaction),
+                    count * sizeof(Transaction))) {
+        perror("dag_log: msync records");
+        log->failed = 1;
+        return 0;
+    }
+
+    log->committed = log->appended;
+    log->sequence++;
+    if (!write_header(log)) {
+        perror("dag_log: msync header");
+        log->failed = 1;
+        return 0;
+    }
+
+    log->payload_bytes += count * sizeof(Transaction);
+    log->commits++;
+    return 1;
+}
+
+void dag_log_close(DagLog* log) {
+    if (!log) return;
+    dag_log_commit(log);
+    munmap(log->map, log->map_size);
+    close(log->fd);
+    free(log);
+}
+
+// Bytes written to storage per byte of record payload
+double dag_log_write_amplification(const DagLog* log) {
+    if (log->payload_bytes == 0) return 0.0;
+    return (double)log->synced_bytes / log->payload_bytes;
+}
@@ -0,0 +1,224 @@
+// dag_sync.c - Zone DAG catch-up by set reconciliation
+
+#include "dag_sync.h"
+#include "iblt.h"
+#include <limits.h>
+
+static Iblt* build_table(DAG* dag, int cells) {
+    Iblt* table = create_iblt(cells);
+    for (int i = 0; i < dag->count; i++) {
+        iblt_insert(table, dag->transactions[i].digest);
+    }
+    return table;
+}
+
+static int compare_ints(const void* a, const void* b) {
+    int x = *(const int*)a, y = *(const int*)b;
+    return (x > y) - (x < y);
+}
+
+// Streams the txs at the given positions to dest, double-buffered so that
+// one batch is filled while the previous one is in flight
+static void send_batches(DAG* dag, const int* positions, int n, int dest, MPI_Comm comm,
+                         int batch, Transaction** buffers, MPI_Request* requests) {
+    for (int start = 0, k = 0; start < n; start += batch, k ^= 1) {
+        MPI_Wait(&requests[k], MPI_STATUS_IGNORE);
+        int count = MIN(batch, n - start);
+        for (int i = 0; i < count; i++) {
+            buffers[k][i] = dag->transactions[positions[start + i]];
+        }
+        MPI_Isend(buffers[k], count * (int)sizeof(Transaction), MPI_BYTE, dest,
+                  DAG_SYNC_TAG_TXS, comm, &requests[k]);
+    }
+}
+
+// Reference side: decodes each member's table against its own DAG until
+// every member has been sent what it lacks
+static void serve_members(Node* node, DAG* dag, DagSyncStats* stats) {
+    MPI_Comm comm = node->zone_comm;
+    int zone_size;
+    MPI_Comm_size(comm, &zone_size);
+    int batch = MAX(g_params.dag_sync_batch, 1);
+    Transaction* buffers[2];
+    buffers[0] = (Transaction*)malloc(batch * sizeof(Transaction));
+    buffers[1] = (Transaction*)malloc(batch * sizeof(Transaction));
+    MPI_Request requests[2] = { MPI_REQUEST_NULL, MPI_REQUEST_NULL };
+    int* positions = (int*)malloc(MAX(dag->count, 1) * sizeof(int));
+    Iblt* own = NULL;
+
+    int served = 0;
+    while (served < zone_size - 1) {
+        MPI_Status status;
+        int bytes;
+        MPI_Probe(MPI_ANY_SOURCE, DAG_SYNC_TAG_TABLE, comm, &status);
+        MPI_Get_count(&status, MPI_BYTE, &bytes);
+        int member = status.MPI_SOURCE;
+        int cells = bytes / (int)sizeof(IbltCell);
+        Iblt* table = create_iblt(cells);
+        MPI_Recv(table->cells, bytes, MPI_BYTE, member, DAG_SYNC_TAG_TABLE, comm,
+                 MPI_STATUS_IGNORE);
+        stats->rounds++;
+
+        // Every member digest sits in IBLT_HASHES cells
+        long member_count = 0;
+        for (int c = 0; c < cells; c++) member_count += table->cells[c].count;
+        member_count /= IBLT_HASHES;
+
+        // own - member: +1 only here, -1 only on the member
+        if (!own || own->n_cells != cells) {
+            destroy_iblt(own);
+            own = build_table(dag, cells);
+        }
+        Iblt* diff = create_iblt(cells);
+        memcpy(diff->cells, own->cells, cells * sizeof(IbltCell));
+        iblt_subtract(diff, table);
+        destroy_iblt(table);
+        uint8_t* keys = (uint8_t*)malloc((size_t)cells * HASH_DIGEST_BYTES);
+        int* signs = (int*)malloc(cells * sizeof(int));
+        int found = iblt_decode(diff, keys, signs, cells);
+        destroy_iblt(diff);
+
+        // The difference cannot exceed both sets together; a table sized for
+        // that which still fails is answered with the whole DAG
+        int cap = iblt_cells_for((int)MIN(member_count + dag->count, INT_MAX / 4));
+        int reply[2];
+        int n = 0;
+        if (found < 0 && cells < cap) {
+            reply[0] = -1;
+            reply[1] = MIN(2 * cells, cap);
+            MPI_Send(reply, 2, MPI_INT, member, DAG_SYNC_TAG_REPLY, comm);
+        } else {
+            int surplus = 0;
+            if (found < 0) {
+                for (int i = 0; i < dag->count; i++) positions[n++] = i;
+            } else {
+                for (int i = 0; i < found; i++) {
+                    if (signs[i] < 0) {
+                        surplus++;
+                        continue;
+                    }
+                    int position = dag_find(dag, keys + (size_t)i * HASH_DIGEST_BYTES);
+                    if (position >= 0) positions[n++] = position;
+                }
+                // DAG order keeps parents ahead of their children
+                qsort(positions, n, sizeof(int), compare_ints);
+            }
+            reply[0] = n;
+            reply[1] = surplus;
+            MPI_Send(reply, 2, MPI_INT, member, DAG_SYNC_TAG_REPLY, comm);
+            send_batches(dag, positions, n, member, comm, batch, buffers, requests);
+            stats->surplus += surplus;
+            served++;
+        }
+        free(keys);
+        free(signs);
+    }
+
+    MPI_Waitall(2, requests, MPI_STATUSES_IGNORE);
+    destroy_iblt(own);
+    free(positions);
+    free(buffers[0]);
+    free(buffers[1]);
+}
+
+// Member side: receives n txs in batches, inserting one while the next
+// arrives. Corrupt and already known txs are skipped.
+static void receive_batches(DAG* dag, int reference, int n, MPI_Comm comm, DagSyncStats* stats) {
+    int batch = MAX(g_params.dag_sync_batch, 1);
+    int n_batches = (n + batch - 1) / batch;
+    if (n_batches == 0) return;
+    Transaction* buffers[2];
+    buffers[0] = (Transaction*)malloc(batch * sizeof(Transaction));
+    buffers[1] = (Transaction*)malloc(batch * sizeof(Transaction));
+    int* ok = (int*)malloc(batch * sizeof(int));
+    MPI_Request requests[2];
+
+    MPI_Irecv(buffers[0], MIN(batch, n) * (int)sizeof(Transaction), MPI_BYTE, reference,
+              DAG_SYNC_TAG_TXS, comm, &requests[0]);
+    for (int b = 0; b < n_batches; b++) {
+        int k = b & 1;
+        int count = MIN(batch, n - b * batch);
+        MPI_Wait(&requests[k], MPI_STATUS_IGNORE);
+        if (b + 1 < n_batches) {
+            int next = MIN(batch, n - (b + 1) * batch);
+            MPI_Irecv(buffers[k ^ 1], next * (int)sizeof(Transaction), MPI_BYTE, reference,
+                      DAG_SYNC_TAG_TXS, comm, &requests[k ^ 1]);
+        }
+        transaction_verify_batch(buffers[k], count, ok);
+        for (int i = 0; i < count; i++) {
+            if (ok[i] && add_transaction(dag, &buffers[k][i])) stats->inserted++;
+        }
+        stats->pulled += count;
+        stats->tx_bytes += (long)count * sizeof(Transaction);
+    }
+    free(ok);
+    free(buffers[0]);
+    free(buffers[1]);
+}
+
+// Member side: sends tables until one decodes, then takes the stream
+static void pull_missing(Node* node, DAG* dag, int reference, int estimate,
+                         DagSyncStats* stats) {
+    MPI_Comm comm = node->zone_comm;
+    int cells = iblt_cells_for(estimate);
+    int reply[2] = { -1, 0 };
+    while (reply[0] < 0) {
+        Iblt* table = build_table(dag, cells);
+        MPI_Send(table->cells, table->n_cells * (int)sizeof(IbltCell), MPI_BYTE, reference,
+                 DAG_SYNC_TAG_TABLE, comm);
+        stats->rounds++;
+        stats->table_bytes += (long)table->n_cells * sizeof(IbltCell);
+        destroy_iblt(table);
+        MPI_Recv(reply, 2, MPI_INT, reference, DAG_SYNC_TAG_REPLY, comm, MPI_STATUS_IGNORE);
+        if (reply[0] < 0) cells = reply[1];
+    }
+    stats->surplus = reply[1];
+    receive_batches(dag, reference, reply[0], comm, stats);
+}
+
+// Collective over the zone. Every member ends up with the reference's
+// transactions; what only a member holds stays where it is.
+void dag_sync(Node* node, DAG* dag, DagSyncStats* stats) {
+    memset(stats, 0, sizeof(*stats));
+    if (node->zone_comm == MPI_COMM_NULL) return;
+    double t0 = MPI_Wtime();
+
+    int zone_rank, zone_size;
+    MPI_Comm_rank(node->zone_comm, &zone_rank);
+    MPI_Comm_size(node->zone_comm, &zone_size);
+    struct { int count; int rank; } mine = { dag->count, zone_rank }, largest;
+    MPI_Allreduce(&mine, &largest, 1, MPI_2INT, MPI_MAXLOC, node->zone_comm);
+    if (zone_size < 2 || largest.count == 0) return;
+
+    if (zone_rank == largest.rank) {
+        stats->reference = 1;
+        serve_members(node, dag, stats);
+    } else {
+        pull_missing(node, dag, largest.rank, largest.count - dag->count, stats);
+    }
+    stats->seconds = MPI_Wtime() - t0;
+}
+
+// Collective over MPI_COMM_WORLD; silent if no zone had anything to sync
+void dag_sync_report(const DagSyncStats* stats, Node* node) {
+    int member = !stats->reference && stats->rounds > 0;
+    long local[7] = { member, member && stats->inserted > 0, stats->pulled, stats->inserted,
+                      stats->table_bytes, stats->tx_bytes, member ? stats->surplus : 0 };
+    long totals[7];
+    MPI_Reduce(local, totals, 7, MPI_LONG, MPI_SUM, 0, MPI_COMM_WORLD);
+    double local_max[2] = { member ? (double)stats->rounds : 0.0, stats->seconds };
+    double worst[2];
+    MPI_Reduce(local_max, worst, 2, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+
+    if (node->rank == 0 && totals[0] > 0) {
+        printf("\n=== DAG SYNC ===\n");
+        printf("Members reconciled: %ld, %ld of them behind their zone\n", totals[0], totals[1]);
+        printf("Pulled: %ld txs (%ld new), %.1f KB in batches of %d\n",
+               totals[2], totals[3], totals[5] / 1024.0, MAX(g_params.dag_sync_batch, 1));
+        printf("IBLT cells sent: %.1f KB, max %.0f rounds per member\n",
+               totals[4] / 1024.0, worst[0]);
+        printf("Txs only on members (kept): %ld\n", totals[6]);
+        printf("Time: max %.2f ms\n", worst[1] * 1000.0);
+        printf("========================\n");
+    }
+}
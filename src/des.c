@@ -0,0 +1,460 @@
+// des.c - Discrete-event backend for large virtual networks
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "des.h"
+#include <pthread.h>
+
+#define DES_LOOKAHEAD 0.001          // calculate_latency() never goes below 1 ms
+#define DES_KMEANS_ITERATIONS 10
+#define DES_INITIAL_EVENTS 1024
+
+// ------------------------------------------------------------------
+// Event heap
+// ------------------------------------------------------------------
+
+void heap_push(EventHeap* heap, const DesEvent* event) {
+    if (heap->count == heap->capacity) {
+        heap->capacity = heap->capacity > 0 ? 2 * heap->capacity : DES_INITIAL_EVENTS;
+        heap->events = (DesEvent*)realloc(heap->events, heap->capacity * sizeof(DesEvent));
+    }
+    int i = heap->count++;
+    while (i > 0) {
+        int parent = (i - 1) / 2;
+        if (heap->events[parent].time <= event->time) break;
+        heap->events[i] = heap->events[parent];
+        i = parent;
+    }
+    heap->events[i] = *event;
+}
+
+// Returns 0 if the heap is empty
+int heap_pop(EventHeap* heap, DesEvent* out) {
+    if (heap->count == 0) return 0;
+    *out = heap->events[0];
+    DesEvent last = heap->events[--heap->count];
+    int i = 0;
+    while (1) {
+        int child = 2 * i + 1;
+        if (child >= heap->count) break;
+        if (child + 1 < heap->count &&
+            heap->events[child + 1].time < heap->events[child].time) {
+            child++;
+        }
+        if (last.time <= heap->events[child].time) break;
+        heap->events[i] = heap->events[child];
+        i = child;
+    }
+    if (heap->count > 0) heap->events[i] = last;
+    return 1;
+}
+
+// ------------------------------------------------------------------
+// Virtual network
+// ------------------------------------------------------------------
+
+// Consensus state of a tx, owned by its sender's shard
+typedef struct {
+    double created;
+    int votes;
+    int needed;
+    int final;
+} DesTx;
+
+typedef struct {
+    int id;
+    int first, last;             // Nodes [first, last)
+    EventHeap heap;
+    DesTx* txs;
+    int n_txs;
+    int tx_capacity;
+    DesEvent** outbox;           // Events for each other shard, this window
+    int* out_count;
+    int* out_capacity;
+
+    long events;
+    long created;
+    long finalized;
+    double finality_sum;         // Seconds
+    double finality_max;
+    long relayed;
+    double relay_sum;
+    double relay_max;
+} DesShard;
+
+typedef struct {
+    int n;
+    int n_zones;
+    int n_shards;
+    uint64_t seed;
+    double duration;
+    double rate;
+    double* x;
+    double* y;
+    int* zone;                   // Zone of every node
+    int* zone_start;             // Members of zone z: members[zone_start[z] .. zone_start[z + 1])
+    int* members;
+    int* gateway;                // Member nearest the zone centroid
+    Rng* rng;                    // Workload stream of every node
+    DesShard* shards;
+    pthread_barrier_t window;
+} DesWorld;
+
+// Same model as calculate_latency(); the noise is a pure function of the
+// ordered pair, so no n x n table is kept. Seconds.
+static double des_latency(const DesWorld* world, int a, int b) {
+    double dx = world->x[a] - world->x[b];
+    double dy = world->y[a] - world->y[b];
+    Rng pair;
+    rng_init(&pair, world->seed, a, b);
+    double noise = (double)(rng_next_u64(&pair) % 20) - 10.0;
+    return MAX(sqrt(dx * dx + dy * dy) * 0.5 + noise, 1.0) / 1000.0;
+}
+
+// Three geographic clusters as in assign_geography()
+static void place_nodes(DesWorld* world) {
+    double centers[3][2] = { {100.0, 100.0}, {300.0, 100.0}, {500.0, 100.0} };
+    int cluster_size = MAX(world->n / 3, 1);
+    for (int i = 0; i < world->n; i++) {
+        int cluster = MIN(i / cluster_size, 2);
+        Rng rng;
+        rng_init(&rng, world->seed, i, RNG_SYSTEM);
+        world->x[i] = centers[cluster][0] + (double)(rng_next_u64(&rng) % 50) - 25.0;
+        world->y[i] = centers[cluster][1] + (double)(rng_next_u64(&rng) % 50) - 25.0;
+    }
+}
+
+// Lloyd's k-means on coordinates (the dense similarity matrix of
+// form_zones() does not fit at this scale), then the CSR member lists
+static void form_virtual_zones(DesWorld* world) {
+    int n = world->n, k = world->n_zones;
+    double* cx = (double*)malloc(k * sizeof(double));
+    double* cy = (double*)malloc(k * sizeof(double));
+    double* sx = (double*)malloc(k * sizeof(double));
+    double* sy = (double*)malloc(k * sizeof(double));
+    int* counts = (int*)calloc(k + 1, sizeof(int));
+
+    for (int z = 0; z < k; z++) {
+        int seed_node = (int)((long)z * n / k);
+        cx[z] = world->x[seed_node];
+        cy[z] = world->y[seed_node];
+    }
+    for (int iter = 0; iter < DES_KMEANS_ITERATIONS; iter++) {
+        memset(sx, 0, k * sizeof(double));
+        memset(sy, 0, k * sizeof(double));
+        memset(counts, 0, k * sizeof(int));
+        for (int i = 0; i < n; i++) {
+            int best = 0;
+            double best_d = INFINITY;
+            for (int z = 0; z < k; z++) {
+                double dx = world->x[i] - cx[z], dy = world->y[i] - cy[z];
+                double d = dx * dx + dy * dy;
+                if (d < best_d) {
+                    best_d = d;
+                    best = z;
+                }
+            }
+            world->zone[i] = best;
+            sx[best] += world->x[i];
+            sy[best] += world->y[i];
+            counts[best]++;
+        }
+        for (int z = 0; z < k; z++) {
+            if (counts[z] > 0) {
+                cx[z] = sx[z] / counts[z];
+                cy[z] = sy[z] / counts[z];
+            }
+        }
+    }
+
+    world->zone_start[0] = 0;
+    for (int z = 0; z < k; z++) {
+        world->zone_start[z + 1] = world->zone_start[z] + counts[z];
+    }
+    memset(counts, 0, k * sizeof(int));
+    double* gateway_d = sx;
+    for (int z = 0; z < k; z++) {
+        world->gateway[z] = -1;
+        gateway_d[z] = INFINITY;
+    }
+    for (int i = 0; i < n; i++) {
+        int z = world->zone[i];
+        world->members[world->zone_start[z] + counts[z]++] = i;
+        double dx = world->x[i] - cx[z], dy = world->y[i] - cy[z];
+        if (dx * dx + dy * dy < gateway_d[z]) {
+            gateway_d[z] = dx * dx + dy * dy;
+            world->gateway[z] = i;
+        }
+    }
+
+    free(cx);
+    free(cy);
+    free(sx);
+    free(sy);
+    free(counts);
+}
+
+static int shard_of(const DesWorld* world, int node) {
+    return (int)((long)node * world->n_shards / world->n);
+}
+
+// Same-shard events go straight into the heap; the rest wait for the
+// window barrier
+static void emit(DesWorld* world, DesShard* shard, const DesEvent* event) {
+    int dest = shard_of(world, event->node);
+    if (dest == shard->id) {
+        heap_push(&shard->heap, event);
+        return;
+    }
+    if (shard->out_count[dest] == shard->out_capacity[dest]) {
+        shard->out_capacity[dest] = MAX(2 * shard->out_capacity[dest], DES_INITIAL_EVENTS);
+        shard->outbox[dest] = (DesEvent*)realloc(shard->outbox[dest],
+                                                 shard->out_capacity[dest] * sizeof(DesEvent));
+    }
+    shard->outbox[dest][shard->out_count[dest]++] = *event;
+}
+
+static double next_arrival(DesWorld* world, int node) {
+    double u = rng_next_double(&world->rng[node]);
+    return -log(1.0 - u) / world->rate;
+}
+
+static void finalize(DesShard* shard, DesTx* tx, double now) {
+    double latency = now - tx->created;
+    tx->final = 1;
+    shard->finalized++;
+    shard->finality_sum += latency;
+    if (latency > shard->finality_max) shard->finality_max = latency;
+}
+
+static void record_relayed(DesShard* shard, double created, double now) {
+    double latency = now - created;
+    shard->relayed++;
+    shard->relay_sum += latency;
+    if (latency > shard->relay_max) shard->relay_max = latency;
+}
+
+// A new tx at `sender`: broadcast to its zone, relay if cross-zone
+static void generate(DesWorld* world, DesShard* shard, const DesEvent* event) {
+    int sender = event->node;
+    double now = event->time;
+    int zone = world->zone[sender];
+    const int* members = &world->members[world->zone_start[zone]];
+    int n_members = world->zone_start[zone + 1] - world->zone_start[zone];
+
+    int receiver;
+    if (strcmp(g_params.receiver_dist, "zone") == 0) {
+        receiver = members[rng_next_u64(&world->rng[sender]) % n_members];
+    } else {
+        receiver = (int)(rng_next_u64(&world->rng[sender]) % world->n);
+    }
+
+    if (shard->n_txs == shard->tx_capacity) {
+        shard->tx_capacity = MAX(2 * shard->tx_capacity, DES_INITIAL_EVENTS);
+        shard->txs = (DesTx*)realloc(shard->txs, shard->tx_capacity * sizeof(DesTx));
+    }
+    int index = shard->n_txs++;
+    DesTx* tx = &shard->txs[index];
+    tx->created = now;
+    tx->votes = 0;
+    tx->needed = n_members > 1 ? MAX(1, (int)ceil(g_params.bft_quorum * (n_members - 1))) : 0;
+    tx->final = 0;
+    shard->created++;
+    if (tx->needed == 0) finalize(shard, tx, now);
+
+    for (int m = 0; m < n_members; m++) {
+        if (members[m] == sender) continue;
+        DesEvent deliver = { now + des_latency(world, sender, members[m]), now,
+                             DES_DELIVER, members[m], sender, index };
+        emit(world, shard, &deliver);
+    }
+    if (world->zone[receiver] != zone) {
+        int gateway = world->gateway[world->zone[receiver]];
+        DesEvent relay = { now + des_latency(world, sender, gateway), now,
+                           DES_RELAY, gateway, receiver, index };
+        emit(world, shard, &relay);
+    }
+
+    DesEvent next = { now + next_arrival(world, sender), 0.0, DES_GENERATE, sender, sender, -1 };
+    heap_push(&shard->heap, &next);
+}
+
+static void handle(DesWorld* world, DesShard* shard, const DesEvent* event) {
+    double now = event->time;
+    switch (event->type) {
+        case DES_GENERATE:
+            generate(world, shard, event);
+            break;
+        case DES_DELIVER: {
+            DesEvent vote = { now + des_latency(world, event->node, event->peer), event->created,
+                              DES_VOTE, event->peer, event->node, event->tx };
+            emit(world, shard, &vote);
+            break;
+        }
+        case DES_VOTE: {
+            DesTx* tx = &shard->txs[event->tx];
+            if (!tx->final && ++tx->votes >= tx->needed) finalize(shard, tx, now);
+            break;
+        }
+        case DES_RELAY:
+            // peer is the receiver here
+            if (event->peer == event->node) {
+                record_relayed(shard, event->created, now);
+            } else {
+                DesEvent receive = { now + des_latency(world, event->node, event->peer),
+                                     event->created, DES_RECEIVE, event->peer, event->peer,
+                                     event->tx };
+                emit(world, shard, &receive);
+            }
+            break;
+        case DES_RECEIVE:
+            record_relayed(shard, event->created, now);
+            break;
+    }
+}
+
+// Conservative windows: every shard handles its events before the window
+// end, then takes the events other shards produced for it. Nothing handled
+// in a window lands in the same window, since every hop costs at least
+// the lookahead.
+static void run_shard(DesWorld* world, DesShard* shard) {
+    long windows = (long)ceil(world->duration / DES_LOOKAHEAD);
+    for (long w = 1; w <= windows; w++) {
+        double end = MIN(w * DES_LOOKAHEAD, world->duration);
+        DesEvent event;
+        while (shard->heap.count > 0 && shard->heap.events[0].time < end) {
+            heap_pop(&shard->heap, &event);
+            handle(world, shard, &event);
+            shard->events++;
+        }
+        pthread_barrier_wait(&world->window);
+
+        for (int s = 0; s < world->n_shards; s++) {
+            DesShard* from = &world->shards[s];
+            for (int i = 0; i < from->out_count[shard->id]; i++) {
+                heap_push(&shard->heap, &from->outbox[shard->id][i]);
+            }
+            from->out_count[shard->id] = 0;
+        }
+        pthread_barrier_wait(&world->window);
+    }
+}
+
+typedef struct {
+    DesWorld* world;
+    DesShard* shard;
+} ShardArgs;
+
+static void* shard_main(void* arg) {
+    ShardArgs* args = (ShardArgs*)arg;
+    run_shard(args->world, args->shard);
+    return NULL;
+}
+
+static void print_report(DesWorld* world, double setup, double wall) {
+    long events = 0, created = 0, finalized = 0, relayed = 0;
+    double finality_sum = 0.0, finality_max = 0.0, relay_sum = 0.0, relay_max = 0.0;
+    for (int s = 0; s < world->n_shards; s++) {
+        DesShard* shard = &world->shards[s];
+        events += shard->events;
+        created += shard->created;
+        finalized += shard->finalized;
+        finality_sum += shard->finality_sum;
+        finality_max = MAX(finality_max, shard->finality_max);
+        relayed += shard->relayed;
+        relay_sum += shard->relay_sum;
+        relay_max = MAX(relay_max, shard->relay_max);
+    }
+
+    printf("\n=== DISCRETE-EVENT SIMULATION ===\n");
+    printf("Virtual nodes: %d in %d zones (avg %.1f members), %d threads, %.2f ms windows\n",
+           world->n, world->n_zones, (double)world->n / world->n_zones, world->n_shards,
+           DES_LOOKAHEAD * 1000.0);
+    printf("Setup: %.2f s (geography and k-means)\n", setup);
+    printf("Events: %ld in %.2f s wall (%.2f M events/s) over %.2f s virtual\n",
+           events, wall, wall > 0 ? events / wall / 1e6 : 0.0, world->duration);
+    printf("Created: %ld txs (%.2f tx/s), Finalized: %ld (%.2f tx/s)\n",
+           created, created / world->duration, finalized, finalized / world->duration);
+    printf("Intra-Zone Latency: avg %.2f ms, max %.2f ms\n",
+           finalized > 0 ? finality_sum * 1000.0 / finalized : 0.0, finality_max * 1000.0);
+    printf("Cross-Zone Latency: avg %.2f ms, max %.2f ms (%ld relayed txs)\n",
+           relayed > 0 ? relay_sum * 1000.0 / relayed : 0.0, relay_max * 1000.0, relayed);
+    printf("========================\n");
+}
+
+// Runs the whole virtual network in this process for g_params.duration
+// virtual seconds and prints its report
+void run_des(unsigned long long seed) {
+    double t0 = MPI_Wtime();
+    DesWorld world;
+    world.n = g_params.des_nodes;
+    world.n_zones = MAX(1, (world.n + g_params.des_zone_size - 1) / MAX(g_params.des_zone_size, 1));
+    world.n_shards = MIN(MAX(g_params.des_threads, 1), world.n);
+    world.seed = seed;
+    world.duration = g_params.duration;
+    world.rate = g_params.des_rate;
+    world.x = (double*)malloc(world.n * sizeof(double));
+    world.y = (double*)malloc(world.n * sizeof(double));
+    world.zone = (int*)malloc(world.n * sizeof(int));
+    world.zone_start = (int*)malloc((world.n_zones + 1) * sizeof(int));
+    world.members = (int*)malloc(world.n * sizeof(int));
+    world.gateway = (int*)malloc(world.n_zones * sizeof(int));
+    world.rng = (Rng*)malloc(world.n * sizeof(Rng));
+
+    place_nodes(&world);
+    form_virtual_zones(&world);
+
+    world.shards = (DesShard*)calloc(world.n_shards, sizeof(DesShard));
+    for (int s = 0; s < world.n_shards; s++) {
+        DesShard* shard = &world.shards[s];
+        shard->id = s;
+        shard->first = (int)(((long)s * world.n + world.n_shards - 1) / world.n_shards);
+        shard->last = (int)(((long)(s + 1) * world.n + world.n_shards - 1) / world.n_shards);
+        shard->outbox = (DesEvent**)calloc(world.n_shards, sizeof(DesEvent*));
+        shard->out_count = (int*)calloc(world.n_shards, sizeof(int));
+        shard->out_capacity = (int*)calloc(world.n_shards, sizeof(int));
+        for (int i = shard->first; i < shard->last; i++) {
+            rng_init(&world.rng[i], seed, i, RNG_WORKLOAD);
+            DesEvent first = { next_arrival(&world, i), 0.0, DES_GENERATE, i, i, -1 };
+            heap_push(&shard->heap, &first);
+        }
+    }
+    double setup = MPI_Wtime() - t0;
+
+    // The calling thread runs shard 0
+    double t1 = MPI_Wtime();
+    pthread_barrier_init(&world.window, NULL, world.n_shards);
+    pthread_t* threads = (pthread_t*)malloc(world.n_shards * sizeof(pthread_t));
+    ShardArgs* args = (ShardArgs*)malloc(world.n_shards * sizeof(ShardArgs));
+    for (int s = 1; s < world.n_shards; s++) {
+        args[s].world = &world;
+        args[s].shard = &world.shards[s];
+        pthread_create(&threads[s], NULL, shard_main, &args[s]);
+    }
+    run_shard(&world, &world.shards[0]);
+    for (int s = 1; s < world.n_shards; s++) {
+        pthread_join(threads[s], NULL);
+    }
+    pthread_barrier_destroy(&world.window);
+    print_report(&world, setup, MPI_Wtime() - t1);
+
+    for (int s = 0; s < world.n_shards; s++) {
+        DesShard* shard = &world.shards[s];
+        free(shard->heap.events);
+        free(shard->txs);
+        for (int d = 0; d < world.n_shards; d++) free(shard->outbox[d]);
+        free(shard->outbox);
+        free(shard->out_count);
+        free(shard->out_capacity);
+    }
+    free(args);
+    free(threads);
+    free(world.shards);
+    free(world.rng);
+    free(world.gateway);
+    free(world.members);
+    free(world.zone_start);
+    free(world.zone);
+    free(world.y);
+    free(world.x);
+}
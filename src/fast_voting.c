@@ -8,20 +8,20 @@ int fast_voting_consensus(Transaction* tx, Node* node) {
     MPI_Comm_size(node->zone_comm, &zone_size);
     
     // If zone too small, accept immediately
-    if (zone_size < FV_SAMPLE_SIZE) {
+    if (zone_size < g_params.fv_sample_size) {
         return 1;
     }
     
     int preference = -1;  // -1=undecided, 0=reject, 1=accept
     int consecutive = 0;
     
-    for (int round = 0; round < FV_CONSECUTIVE_ROUNDS + 10; round++) {
+    for (int round = 0; round < g_params.fv_consecutive_rounds + 10; round++) {
         // Sample random nodes from zone
         int accept_count = 0;
         int reject_count = 0;
         
-        for (int i = 0; i < FV_SAMPLE_SIZE; i++) {
-            int sample_rank = rand() % zone_size;
+        for (int i = 0; i < g_params.fv_sample_size; i++) {
+            int sample_rank = rng_int(RNG_SYSTEM, zone_size);
             
             // Simulate vote (in real implementation, would query node)
             // Simple heuristic: accept if tx is valid
@@ -36,9 +36,9 @@ int fast_voting_consensus(Transaction* tx, Node* node) {
         
         // Determine new preference
         int new_preference = preference;
-        if (accept_count >= FV_QUORUM) {
+        if (accept_count >= g_params.fv_quorum) {
             new_preference = 1;  // Accept
-        } else if (reject_count >= FV_QUORUM) {
+        } else if (reject_count >= g_params.fv_quorum) {
             new_preference = 0;  // Reject
         } else {
             consecutive = 0;
@@ -54,7 +54,7 @@ int fast_voting_consensus(Transaction* tx, Node* node) {
         }
         
         // Check if decision reached
-        if (consecutive >= FV_CONSECUTIVE_ROUNDS) {
+        if (consecutive >= g_params.fv_consecutive_rounds) {
             return preference;
         }
     }
@@ -0,0 +1,59 @@
+// faults.c - Fault injection for zone consensus
+
+#include "faults.h"
+
+int faults_configured(void) {
+    return g_params.fault_crash > 0 || g_params.fault_byzantine > 0 || g_params.fault_slow > 0;
+}
+
+// Roles go to zone ranks in order: crashed members first, then Byzantine,
+// then slow ones. NULL if no fault is configured or the rank is correct.
+FaultInjector* create_fault_injector(Node* node, double run_start) {
+    if (!faults_configured() || node->zone_comm == MPI_COMM_NULL) return NULL;
+
+    int zone_rank;
+    MPI_Comm_rank(node->zone_comm, &zone_rank);
+    int role = FAULT_NONE;
+    int crash = MAX(g_params.fault_crash, 0);
+    int byzantine = MAX(g_params.fault_byzantine, 0);
+    int slow = MAX(g_params.fault_slow, 0);
+    if (zone_rank < crash) {
+        role = FAULT_CRASH;
+    } else if (zone_rank < crash + byzantine) {
+        role = FAULT_BYZANTINE;
+    } else if (zone_rank < crash + byzantine + slow) {
+        role = FAULT_SLOW;
+    }
+    if (role == FAULT_NONE) return NULL;
+
+    FaultInjector* faults = (FaultInjector*)calloc(1, sizeof(FaultInjector));
+    faults->role = role;
+    faults->crash_at = run_start + MAX(g_params.fault_crash_at, 0.0);
+    faults->delay = MAX(g_params.fault_delay, 0.0);
+    return faults;
+}
+
+void destroy_fault_injector(FaultInjector* faults) {
+    free(faults);
+}
+
+int fault_crashed(const FaultInjector* faults, double now) {
+    return faults && faults->role == FAULT_CRASH && now >= faults->crash_at;
+}
+
+// Whether a Byzantine member's message to dest carries the conflicting
+// value: the zone is split in two halves that are told different things
+int fault_equivocate(FaultInjector* faults, int dest) {
+    if (!faults || faults->role != FAULT_BYZANTINE || dest % 2 == 0) return 0;
+    faults->equivocated++;
+    return 1;
+}
+
+const char* fault_role_name(int role) {
+    switch (role) {
+        case FAULT_CRASH: return "crash";
+        case FAULT_BYZANTINE: return "byzantine";
+        case FAULT_SLOW: return "slow";
+        default: return "correct";
+    }
+}
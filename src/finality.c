@@ -0,0 +1,102 @@
+// finality.c - Indexed max-heap of pending weighted-DAG confirmations
+
+#include "finality.h"
+
+FinalityTracker* create_finality_tracker(int dag_capacity) {
+    FinalityTracker* tracker = (FinalityTracker*)calloc(1, sizeof(FinalityTracker));
+    tracker->capacity = 64;
+    tracker->heap = (int*)malloc(tracker->capacity * sizeof(int));
+    tracker->n_slots = dag_capacity;
+    tracker->slot = (int*)malloc(dag_capacity * sizeof(int));
+    memset(tracker->slot, 0xff, dag_capacity * sizeof(int));  // All -1
+    return tracker;
+}
+
+void destroy_finality_tracker(FinalityTracker* tracker) {
+    if (!tracker) return;
+    free(tracker->heap);
+    free(tracker->slot);
+    free(tracker);
+}
+
+static void place(FinalityTracker* tracker, int index, int position) {
+    tracker->heap[index] = position;
+    tracker->slot[position] = index;
+}
+
+static void sift_up(FinalityTracker* tracker, const DAG* dag, int index) {
+    int position = tracker->heap[index];
+    int weight = dag->weights[position];
+    while (index > 0) {
+        int parent = (index - 1) / 2;
+        if (dag->weights[tracker->heap[parent]] >= weight) break;
+        place(tracker, index, tracker->heap[parent]);
+        index = parent;
+    }
+    place(tracker, index, position);
+}
+
+static void sift_down(FinalityTracker* tracker, const DAG* dag, int index) {
+    int position = tracker->heap[index];
+    int weight = dag->weights[position];
+    while (1) {
+        int child = 2 * index + 1;
+        if (child >= tracker->count) break;
+        if (child + 1 < tracker->count &&
+            dag->weights[tracker->heap[child + 1]] > dag->weights[tracker->heap[child]]) {
+            child++;
+        }
+        if (dag->weights[tracker->heap[child]] <= weight) break;
+        place(tracker, index, tracker->heap[child]);
+        index = child;
+    }
+    place(tracker, index, position);
+}
+
+// Starts waiting for the tx at this DAG position to become heavy enough
+void finality_track(FinalityTracker* tracker, const DAG* dag, int position) {
+    if (position < 0 || position >= tracker->n_slots || tracker->slot[position] >= 0) return;
+    if (tracker->count == tracker->capacity) {
+        tracker->capacity *= 2;
+        tracker->heap = (int*)realloc(tracker->heap, tracker->capacity * sizeof(int));
+    }
+    tracker->heap[tracker->count] = position;
+    sift_up(tracker, dag, tracker->count++);
+    tracker->tracked++;
+}
+
+// Re-keys the pending positions among `changed`. Without a change list
+// (a host-shared DAG whose weights another rank maintains) the whole heap
+// is rebuilt.
+void finality_refresh(FinalityTracker* tracker, const DAG* dag, const int* changed, int n_changed) {
+    if (!changed) {
+        for (int i = tracker->count / 2 - 1; i >= 0; i--) {
+            sift_down(tracker, dag, i);
+        }
+        return;
+    }
+    for (int i = 0; i < n_changed; i++) {
+        int position = changed[i];
+        if (position < tracker->n_slots && tracker->slot[position] >= 0) {
+            sift_up(tracker, dag, tracker->slot[position]);
+            tracker->rekeyed++;
+        }
+    }
+}
+
+// Takes the heaviest pending tx if it has reached wd_min_weight. Returns 0
+// when none has.
+int finality_next(FinalityTracker* tracker, const DAG* dag, int* position) {
+    if (tracker->count == 0) return 0;
+    int top = tracker->heap[0];
+    if (dag->weights[top] < g_params.wd_min_weight) return 0;
+
+    tracker->slot[top] = -1;
+    if (--tracker->count > 0) {
+        tracker->heap[0] = tracker->heap[tracker->count];
+        sift_down(tracker, dag, 0);
+    }
+    tracker->finalized++;
+    *position = top;
+    return 1;
+}
@@ -0,0 +1,334 @@
+// flow.c - Credit-based flow control on the zone broadcast
+
+#define _DEFAULT_SOURCE
+
+#include "flow.h"
+#include "hosts.h"
+#include "arena.h"
+
+// NULL when flow control is disabled
+FlowControl* create_flow_control(Node* node) {
+    if (g_params.flow_credits <= 0 || node->zone_comm == MPI_COMM_NULL) return NULL;
+
+    FlowControl* flow = (FlowControl*)calloc(1, sizeof(FlowControl));
+    flow->comm = node->zone_comm;
+    MPI_Comm_rank(flow->comm, &flow->rank);
+    MPI_Comm_size(flow->comm, &flow->size);
+    flow->window = g_params.flow_credits;
+    flow->queue_limit = MAX(g_params.flow_queue, 1);
+    flow->batch = MAX(g_params.flow_batch, 1);
+
+    // World ranks, for the report
+    int* zone_ranks = (int*)malloc(flow->size * sizeof(int));
+    int* world_ranks = (int*)malloc(flow->size * sizeof(int));
+    for (int p = 0; p < flow->size; p++) zone_ranks[p] = p;
+    MPI_Group zone_group, world_group;
+    MPI_Comm_group(flow->comm, &zone_group);
+    MPI_Comm_group(MPI_COMM_WORLD, &world_group);
+    MPI_Group_translate_ranks(zone_group, flow->size, zone_ranks, world_group, world_ranks);
+    MPI_Group_free(&zone_group);
+    MPI_Group_free(&world_group);
+
+    flow->peers = (FlowPeer*)calloc(flow->size, sizeof(FlowPeer));
+    for (int p = 0; p < flow->size; p++) {
+        flow->peers[p].world_rank = world_ranks[p];
+        flow->peers[p].credits = flow->window;
+        flow->peers[p].credit_request = MPI_REQUEST_NULL;
+    }
+    free(zone_ranks);
+    free(world_ranks);
+
+    // With a shared DAG a broadcast reaches one rank per other host, as in
+    // host_broadcast()
+    flow->targets = (int*)malloc(MAX(flow->size, 1) * sizeof(int));
+    if (node->hosts) {
+        flow->n_targets = node->hosts->n_leaders;
+        memcpy(flow->targets, node->hosts->leaders, flow->n_targets * sizeof(int));
+    } else {
+        for (int p = 0; p < flow->size; p++) {
+            if (p != flow->rank) flow->targets[flow->n_targets++] = p;
+        }
+    }
+    return flow;
+}
+
+void destroy_flow_control(FlowControl* flow) {
+    if (!flow) return;
+    for (int i = 0; i < flow->send_count; i++) {
+        MPI_Wait(&flow->sends[i].request, MPI_STATUS_IGNORE);
+        free(flow->sends[i].buffer);
+    }
+    for (int p = 0; p < flow->size; p++) {
+        MPI_Wait(&flow->peers[p].credit_request, MPI_STATUS_IGNORE);
+        free(flow->peers[p].queue);
+    }
+    free(flow->sends);
+    free(flow->message);
+    free(flow->inbound);
+    free(flow->targets);
+    free(flow->peers);
+    free(flow);
+}
+
+static void update_blocked(FlowControl* flow, double now) {
+    int full = 0;
+    for (int t = 0; t < flow->n_targets && !full; t++) {
+        full = (flow->peers[flow->targets[t]].queued >= flow->queue_limit);
+    }
+    if (full && !flow->blocked) {
+        flow->blocked = 1;
+        flow->blocked_since = now;
+    } else if (!full && flow->blocked) {
+        flow->blocked = 0;
+        flow->blocked_time += now - flow->blocked_since;
+    }
+}
+
+static void enqueue(FlowPeer* peer, const Transaction* tx, double now) {
+    if (peer->queued == peer->queue_capacity) {
+        peer->queue_capacity = peer->queue_capacity ? 2 * peer->queue_capacity : 64;
+        peer->queue = (Transaction*)realloc(peer->queue,
+                                            peer->queue_capacity * sizeof(Transaction));
+    }
+    if (peer->queued == 0) peer->stalled_since = now;
+    peer->queue[peer->queued++] = *tx;
+    peer->max_queued = MAX(peer->max_queued, peer->queued);
+}
+
+// Sends the head of a peer's queue as one message, spending one credit
+static void send_batch(FlowControl* flow, int p, double now) {
+    FlowPeer* peer = &flow->peers[p];
+    int n = MIN(peer->queued, flow->batch);
+    if (flow->send_count == flow->send_capacity) {
+        flow->send_capacity = flow->send_capacity ? 2 * flow->send_capacity : 64;
+        flow->sends = (FlowSend*)realloc(flow->sends, flow->send_capacity * sizeof(FlowSend));
+    }
+    FlowSend* send = &flow->sends[flow->send_count++];
+    send->buffer = (Transaction*)malloc(n * sizeof(Transaction));
+    memcpy(send->buffer, peer->queue, n * sizeof(Transaction));
+    send_transactions(send->buffer, n, p, flow->comm, &send->request);
+    peer->credits--;
+
+    peer->queued -= n;
+    memmove(peer->queue, peer->queue + n, peer->queued * sizeof(Transaction));
+    if (peer->queued == 0) peer->stall_time += now - peer->stalled_since;
+    if (n > 1) {
+        flow->coalesced_txs += n;
+        flow->batches++;
+    }
+}
+
+// Zone broadcast under flow control: peers with credit and nothing queued
+// get the tx at once, the rest queue it
+void flow_broadcast(FlowControl* flow, Node* node, const Transaction* tx, double now) {
+    MPI_Request* requests = (MPI_Request*)block_pool_get(&g_scratch.requests);
+    int req_count = 0;
+    for (int t = 0; t < flow->n_targets; t++) {
+        int p = flow->targets[t];
+        FlowPeer* peer = &flow->peers[p];
+        if (peer->queued == 0 && peer->credits > 0) {
+            send_transactions(tx, 1, p, flow->comm, &requests[req_count++]);
+            peer->credits--;
+        } else {
+            enqueue(peer, tx, now);
+        }
+    }
+    if (req_count > 0) {
+        MPI_Waitall(req_count, requests, MPI_STATUSES_IGNORE);
+    }
+    block_pool_put(&g_scratch.requests, requests);
+    if (node->hosts) {
+        host_count_broadcast(node);
+    }
+    update_blocked(flow, now);
+}
+
+// Hands a peer its credits back once half a window has been drained, and
+// retries later if the previous credit message is still in flight
+static void return_credits(FlowControl* flow, int p) {
+    FlowPeer* peer = &flow->peers[p];
+    if (peer->consumed < MAX(flow->window / 2, 1)) return;
+    if (peer->credit_request != MPI_REQUEST_NULL) {
+        int done;
+        MPI_Test(&peer->credit_request, &done, MPI_STATUS_IGNORE);
+        if (!done) return;
+    }
+    peer->credit_out = peer->consumed;
+    peer->consumed = 0;
+    MPI_Isend(&peer->credit_out, 1, MPI_INT, p, FLOW_TAG_CREDIT, flow->comm,
+              &peer->credit_request);
+    flow->credit_sent++;
+}
+
+// Moves one pending message into the inbound queue and counts it towards
+// its sender's credits. Returns 0 if none was pending.
+static int pull_message(FlowControl* flow) {
+    int source;
+    int n = receive_transactions(&flow->message, &flow->message_capacity, flow->comm, &source);
+    if (n == 0) return 0;
+
+    if (flow->inbound_next == flow->inbound_count) {
+        flow->inbound_next = flow->inbound_count = 0;
+    }
+    if (flow->inbound_count + n > flow->inbound_capacity) {
+        flow->inbound_capacity = MAX(2 * flow->inbound_capacity, flow->inbound_count + n);
+        flow->inbound = (Transaction*)realloc(flow->inbound,
+                                              flow->inbound_capacity * sizeof(Transaction));
+    }
+    memcpy(flow->inbound + flow->inbound_count, flow->message, n * sizeof(Transaction));
+    flow->inbound_count += n;
+    flow->peers[source].consumed++;
+    return_credits(flow, source);
+    return 1;
+}
+
+// receive_transaction() that also returns credits for drained messages
+int flow_receive(FlowControl* flow, Transaction* tx) {
+    if (flow->inbound_next == flow->inbound_count && !pull_message(flow)) return 0;
+    *tx = flow->inbound[flow->inbound_next++];
+    return 1;
+}
+
+static void receive_credits(FlowControl* flow) {
+    int flag, credits;
+    MPI_Status status;
+    for (;;) {
+        MPI_Iprobe(MPI_ANY_SOURCE, FLOW_TAG_CREDIT, flow->comm, &flag, &status);
+        if (!flag) return;
+        MPI_Recv(&credits, 1, MPI_INT, status.MPI_SOURCE, FLOW_TAG_CREDIT, flow->comm,
+                 MPI_STATUS_IGNORE);
+        flow->peers[status.MPI_SOURCE].credits += credits;
+        flow->credit_received++;
+    }
+}
+
+static void progress_sends(FlowControl* flow) {
+    int i = 0;
+    while (i < flow->send_count) {
+        int done;
+        MPI_Test(&flow->sends[i].request, &done, MPI_STATUS_IGNORE);
+        if (done) {
+            free(flow->sends[i].buffer);
+            flow->sends[i] = flow->sends[--flow->send_count];
+        } else {
+            i++;
+        }
+    }
+}
+
+// Takes returned credits, sends queued txs as far as they reach and
+// retries deferred credit returns. Never blocks.
+void flow_poll(FlowControl* flow, double now) {
+    progress_sends(flow);
+    receive_credits(flow);
+    for (int p = 0; p < flow->size; p++) {
+        FlowPeer* peer = &flow->peers[p];
+        while (peer->queued > 0 && peer->credits > 0) {
+            send_batch(flow, p, now);
+        }
+        return_credits(flow, p);
+    }
+    update_blocked(flow, now);
+}
+
+// Called while this rank waits in a zone collective: drains pending
+// messages into the inbound queue and returns their credits, so a peer
+// held back by this rank can generate the tx that joins the collective.
+// The queue is bounded by what peers send before they get there.
+void flow_service(FlowControl* flow) {
+    if (!flow) return;
+    progress_sends(flow);
+    receive_credits(flow);
+    while (pull_message(flow)) {
+    }
+}
+
+// Collective over the zone at the end of a run. Queued txs go out
+// regardless of credits, for drain_zone() to receive, and every credit
+// message in flight is received so that none is left for the next run.
+void flow_finish(FlowControl* flow, double now) {
+    for (int p = 0; p < flow->size; p++) {
+        while (flow->peers[p].queued > 0) {
+            send_batch(flow, p, now);
+        }
+    }
+    update_blocked(flow, now);
+
+    while (1) {
+        receive_credits(flow);
+        long outstanding = flow->credit_sent - flow->credit_received;
+        long zone_outstanding = 0;
+        MPI_Allreduce(&outstanding, &zone_outstanding, 1, MPI_LONG, MPI_SUM, flow->comm);
+        if (zone_outstanding == 0) break;
+        usleep(100);
+    }
+}
+
+static int compare_links(const void* a, const void* b) {
+    double x = ((const double*)a)[0], y = ((const double*)b)[0];
+    return (x < y) - (x > y);
+}
+
+#define FLOW_REPORT_LINKS 5
+#define FLOW_RANK_FIELDS 8
+
+// Collective over MPI_COMM_WORLD: credit traffic, coalescing and time
+// spent throttled, and the links with the longest stalls
+void flow_report(FlowControl* flow, Node* node, double duration) {
+    // This rank's link with the longest stall
+    int worst = -1;
+    for (int p = 0; p < flow->size; p++) {
+        if (worst < 0 || flow->peers[p].stall_time > flow->peers[worst].stall_time) worst = p;
+    }
+    int max_queued = 0;
+    for (int p = 0; p < flow->size; p++) max_queued = MAX(max_queued, flow->peers[p].max_queued);
+    double mine[FLOW_RANK_FIELDS] = {
+        worst >= 0 ? flow->peers[worst].stall_time : 0.0,
+        (double)node->rank,
+        worst >= 0 ? (double)flow->peers[worst].world_rank : -1.0,
+        worst >= 0 ? (double)flow->peers[worst].max_queued : 0.0,
+        (double)max_queued,
+        flow->blocked_time,
+        (double)flow->credit_sent,
+        (double)flow->batches,
+    };
+    long coalesced = 0;
+    MPI_Reduce(&flow->coalesced_txs, &coalesced, 1, MPI_LONG, MPI_SUM, 0, MPI_COMM_WORLD);
+    int n = node->total_nodes;
+    double* all = node->rank == 0 ? (double*)malloc(n * FLOW_RANK_FIELDS * sizeof(double)) : NULL;
+    MPI_Gather(mine, FLOW_RANK_FIELDS, MPI_DOUBLE, all, FLOW_RANK_FIELDS, MPI_DOUBLE,
+               0, MPI_COMM_WORLD);
+
+    if (node->rank == 0) {
+        double blocked_sum = 0.0, blocked_max = 0.0, credits = 0.0, batches = 0.0;
+        int deepest = 0, blocked_rank = 0;
+        for (int r = 0; r < n; r++) {
+            double* row = &all[r * FLOW_RANK_FIELDS];
+            blocked_sum += row[5];
+            if (row[5] > blocked_max) {
+                blocked_max = row[5];
+                blocked_rank = r;
+            }
+            deepest = MAX(deepest, (int)row[4]);
+            credits += row[6];
+            batches += row[7];
+        }
+        qsort(all, n, FLOW_RANK_FIELDS * sizeof(double), compare_links);
+
+        printf("\n=== FLOW CONTROL ===\n");
+        printf("Window: %d messages per peer, queues up to %d txs, batches up to %d txs\n",
+               flow->window, flow->queue_limit, flow->batch);
+        printf("Credit messages: %.0f, coalesced: %ld txs in %.0f messages\n",
+               credits, coalesced, batches);
+        printf("Generation held back: avg %.1f%% of the run, max %.2f s (rank %d)\n",
+               duration > 0 ? 100.0 * blocked_sum / n / duration : 0.0, blocked_max, blocked_rank);
+        printf("Deepest peer queue: %d txs\n", deepest);
+        for (int i = 0; i < MIN(n, FLOW_REPORT_LINKS) && all[i * FLOW_RANK_FIELDS] > 0.0; i++) {
+            double* row = &all[i * FLOW_RANK_FIELDS];
+            printf("  Stalled link %d -> %d: %.2f ms with txs queued, max depth %.0f\n",
+                   (int)row[1], (int)row[2], row[0] * 1000.0, row[3]);
+        }
+        printf("========================\n");
+        free(all);
+    }
+}
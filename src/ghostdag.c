@@ -0,0 +1,337 @@
+// ghostdag.c - Reachability index and GHOSTDAG ordering over the DAG
+
+#include "ghostdag.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define GHOSTDAG_INITIAL_POOL 1024
+
+Reachability* create_reachability(int capacity, int k) {
+    Reachability* reach = (Reachability*)calloc(1, sizeof(Reachability));
+    reach->k = k < 0 ? 0 : k;
+    reach->capacity = capacity;
+
+    size_t bytes = (size_t)capacity * sizeof(int);
+    reach->selected = (int*)malloc(bytes);
+    reach->depth = (int*)malloc(bytes);
+    reach->jump = (int*)malloc(bytes);
+    reach->fcs_head = (int*)malloc(bytes);
+    reach->blue_score = (int*)malloc(bytes);
+    reach->merge_start = (int*)malloc(bytes);
+    reach->merge_count = (int*)malloc(bytes);
+    reach->anti_start = (int*)malloc(bytes);
+    reach->anti_count = (int*)malloc(bytes);
+    reach->stamp = (int*)calloc(capacity, sizeof(int));
+    reach->queue = (int*)malloc(bytes);
+    reach->mergeset = (int*)malloc(bytes);
+    reach->new_blues = (int*)malloc(bytes);
+    reach->new_anti_pos = (int*)malloc(bytes);
+    reach->new_anti_size = (int*)malloc(bytes);
+    reach->cand_pos = (int*)malloc((reach->k + 2) * sizeof(int));
+    reach->cand_size = (int*)malloc((reach->k + 2) * sizeof(int));
+    return reach;
+}
+
+void destroy_reachability(Reachability* reach) {
+    if (!reach) return;
+    free(reach->selected);
+    free(reach->depth);
+    free(reach->jump);
+    free(reach->fcs_head);
+    free(reach->fcs_node);
+    free(reach->fcs_next);
+    free(reach->blue_score);
+    free(reach->merge_start);
+    free(reach->merge_count);
+    free(reach->merge);
+    free(reach->merge_blue);
+    free(reach->anti_start);
+    free(reach->anti_count);
+    free(reach->anti_pos);
+    free(reach->anti_size);
+    free(reach->stamp);
+    free(reach->queue);
+    free(reach->mergeset);
+    free(reach->new_blues);
+    free(reach->new_anti_pos);
+    free(reach->new_anti_size);
+    free(reach->cand_pos);
+    free(reach->cand_size);
+    free(reach);
+}
+
+// ------------------------------------------------------------------
+// Reachability
+// ------------------------------------------------------------------
+
+// Ancestor of x at depth d in x's tree
+static int level_ancestor(const Reachability* reach, int x, int d) {
+    while (reach->depth[x] > d) {
+        int jump = reach->jump[x];
+        x = (reach->depth[jump] >= d) ? jump : reach->selected[x];
+    }
+    return x;
+}
+
+// a == b or a is an ancestor of b in the reachability tree
+static int tree_ancestor_or_self(const Reachability* reach, int a, int b) {
+    if (reach->depth[a] > reach->depth[b]) return 0;
+    return level_ancestor(reach, b, reach->depth[a]) == a;
+}
+
+// Strict: 1 if a is in the past of b. Parents precede their children, so
+// nothing at or after b's position can be.
+int reach_is_ancestor(Reachability* reach, int a, int b) {
+    if (a < 0 || a >= b || b >= reach->labeled) return 0;
+    if (tree_ancestor_or_self(reach, a, b)) return 1;
+    for (int e = reach->fcs_head[a]; e >= 0; e = reach->fcs_next[e]) {
+        int c = reach->fcs_node[e];
+        if (c <= b && tree_ancestor_or_self(reach, c, b)) return 1;
+    }
+    return 0;
+}
+
+static void tree_insert(Reachability* reach, int x, int parent) {
+    reach->selected[x] = parent;
+    reach->fcs_head[x] = -1;
+    if (parent < 0) {
+        reach->depth[x] = 0;
+        reach->jump[x] = x;
+        return;
+    }
+    reach->depth[x] = reach->depth[parent] + 1;
+    int j = reach->jump[parent];
+    if (reach->depth[parent] - reach->depth[j] ==
+        reach->depth[j] - reach->depth[reach->jump[j]]) {
+        reach->jump[x] = reach->jump[j];
+    } else {
+        reach->jump[x] = parent;
+    }
+}
+
+static void fcs_add(Reachability* reach, int x, int future) {
+    if (reach->fcs_used == reach->fcs_capacity) {
+        reach->fcs_capacity = reach->fcs_capacity ? 2 * reach->fcs_capacity : GHOSTDAG_INITIAL_POOL;
+        reach->fcs_node = (int*)realloc(reach->fcs_node, reach->fcs_capacity * sizeof(int));
+        reach->fcs_next = (int*)realloc(reach->fcs_next, reach->fcs_capacity * sizeof(int));
+    }
+    int e = reach->fcs_used++;
+    reach->fcs_node[e] = future;
+    reach->fcs_next[e] = reach->fcs_head[x];
+    reach->fcs_head[x] = e;
+}
+
+// ------------------------------------------------------------------
+// GHOSTDAG
+// ------------------------------------------------------------------
+
+static int compare_ints(const void* a, const void* b) {
+    int x = *(const int*)a, y = *(const int*)b;
+    return (x > y) - (x < y);
+}
+
+// Blue anticone size of blue y as seen by the tx being inserted: its own
+// entries first, then those of each block down the selected chain
+static int blue_anticone_size(const Reachability* reach, int n_new, int chain, int y) {
+    for (int i = 0; i < n_new; i++) {
+        if (reach->new_anti_pos[i] == y) return reach->new_anti_size[i];
+    }
+    for (int c = chain; c >= 0; c = reach->selected[c]) {
+        const int* pos = &reach->anti_pos[reach->anti_start[c]];
+        for (int i = 0; i < reach->anti_count[c]; i++) {
+            if (pos[i] == y) return reach->anti_size[reach->anti_start[c] + i];
+        }
+    }
+    return 0;
+}
+
+static void set_new_anticone(Reachability* reach, int* n_new, int y, int size) {
+    for (int i = 0; i < *n_new; i++) {
+        if (reach->new_anti_pos[i] == y) {
+            reach->new_anti_size[i] = size;
+            return;
+        }
+    }
+    reach->new_anti_pos[*n_new] = y;
+    reach->new_anti_size[*n_new] = size;
+    (*n_new)++;
+}
+
+// Counts blue y against candidate x if y is in x's anticone. Returns 0 once
+// x can no longer be blue.
+static int check_blue(Reachability* reach, int sp, int n_new, int x, int y,
+                      int* anticone, int* recorded) {
+    if (y < 0 || reach_is_ancestor(reach, y, x)) return 1;
+    int size = blue_anticone_size(reach, n_new, sp, y);
+    if (++*anticone > reach->k || size >= reach->k) return 0;
+    reach->cand_pos[*recorded] = y;
+    reach->cand_size[(*recorded)++] = size;
+    return 1;
+}
+
+// Colors candidate x for the tx whose selected parent is sp. Returns 1 if
+// blue, recording the anticone sizes the new blue changes.
+static int color_candidate(Reachability* reach, int sp, int n_blues, int* n_new, int x) {
+    int anticone = 0, recorded = 0;
+
+    // The blues of the tx being inserted so far, then those of each chain
+    // block (its selected parent and mergeset blues) until one is in x's past
+    for (int i = 0; i < n_blues; i++) {
+        if (!check_blue(reach, sp, *n_new, x, reach->new_blues[i], &anticone, &recorded)) return 0;
+    }
+    int walked = 0;
+    for (int c = sp; c >= 0 && !reach_is_ancestor(reach, c, x); c = reach->selected[c]) {
+        if (++walked > GHOSTDAG_MAX_CHAIN_WALK) return 0;
+        if (!check_blue(reach, sp, *n_new, x, reach->selected[c], &anticone, &recorded)) return 0;
+        const int* merge = &reach->merge[reach->merge_start[c]];
+        const unsigned char* blue = &reach->merge_blue[reach->merge_start[c]];
+        for (int m = 0; m < reach->merge_count[c]; m++) {
+            if (!blue[m]) continue;
+            if (!check_blue(reach, sp, *n_new, x, merge[m], &anticone, &recorded)) return 0;
+        }
+    }
+
+    set_new_anticone(reach, n_new, x, anticone);
+    for (int i = 0; i < recorded; i++) {
+        set_new_anticone(reach, n_new, reach->cand_pos[i], reach->cand_size[i] + 1);
+    }
+    return 1;
+}
+
+static void reserve_pools(Reachability* reach, int merge, int anti) {
+    if (reach->merge_used + merge > reach->merge_capacity) {
+        while (reach->merge_used + merge > reach->merge_capacity) {
+            reach->merge_capacity = reach->merge_capacity ? 2 * reach->merge_capacity
+                                                          : GHOSTDAG_INITIAL_POOL;
+        }
+        reach->merge = (int*)realloc(reach->merge, reach->merge_capacity * sizeof(int));
+        reach->merge_blue = (unsigned char*)realloc(reach->merge_blue, reach->merge_capacity);
+    }
+    if (reach->anti_used + anti > reach->anti_capacity) {
+        while (reach->anti_used + anti > reach->anti_capacity) {
+            reach->anti_capacity = reach->anti_capacity ? 2 * reach->anti_capacity
+                                                        : GHOSTDAG_INITIAL_POOL;
+        }
+        reach->anti_pos = (int*)realloc(reach->anti_pos, reach->anti_capacity * sizeof(int));
+        reach->anti_size = (int*)realloc(reach->anti_size, reach->anti_capacity * sizeof(int));
+    }
+}
+
+// Indexes txs[position], whose parents are all indexed. Parent indices
+// that do not precede the tx are ignored.
+void reach_add(Reachability* reach, const Transaction* txs, int position) {
+    int parents[2], n_parents = 0;
+    for (int i = 0; i < 2; i++) {
+        int p = txs[position].parents[i];
+        if (p >= 0 && p < position && (n_parents == 0 || parents[0] != p)) {
+            parents[n_parents++] = p;
+        }
+    }
+
+    // Selected parent: highest blue score, then the newest
+    int sp = -1;
+    for (int i = 0; i < n_parents; i++) {
+        int p = parents[i];
+        if (sp < 0 || reach->blue_score[p] > reach->blue_score[sp] ||
+            (reach->blue_score[p] == reach->blue_score[sp] && p > sp)) {
+            sp = p;
+        }
+    }
+
+    // Mergeset: the past of the other parents that sp does not reach
+    int n_merge = 0, head = 0, tail = 0;
+    reach->epoch++;
+    for (int i = 0; i < n_parents; i++) {
+        if (parents[i] != sp) {
+            reach->stamp[parents[i]] = reach->epoch;
+            reach->queue[tail++] = parents[i];
+        }
+    }
+    while (head < tail) {
+        int x = reach->queue[head++];
+        if (reach_is_ancestor(reach, x, sp)) continue;
+        reach->mergeset[n_merge++] = x;
+        for (int i = 0; i < 2; i++) {
+            int p = txs[x].parents[i];
+            if (p >= 0 && p < x && p != sp && reach->stamp[p] != reach->epoch) {
+                reach->stamp[p] = reach->epoch;
+                reach->queue[tail++] = p;
+            }
+        }
+    }
+    qsort(reach->mergeset, n_merge, sizeof(int), compare_ints);
+
+    // Color the mergeset in topological order
+    int n_blues = 0, n_new = 0;
+    reserve_pools(reach, n_merge, 0);
+    int start = reach->merge_used;
+    if (sp >= 0) {
+        reach->new_blues[n_blues++] = sp;
+        set_new_anticone(reach, &n_new, sp, 0);
+    }
+    for (int i = 0; i < n_merge; i++) {
+        int x = reach->mergeset[i];
+        int blue = color_candidate(reach, sp, n_blues, &n_new, x);
+        if (blue) reach->new_blues[n_blues++] = x;
+        reach->merge[start + i] = x;
+        reach->merge_blue[start + i] = (unsigned char)blue;
+    }
+    reach->merge_used += n_merge;
+    reach->merge_start[position] = start;
+    reach->merge_count[position] = n_merge;
+    reach->blue_score[position] = sp >= 0 ? reach->blue_score[sp] + n_blues : 0;
+    reach->blues += n_blues;
+    reach->reds += n_merge - (n_blues - (sp >= 0));
+
+    reserve_pools(reach, 0, n_new);
+    reach->anti_start[position] = reach->anti_used;
+    reach->anti_count[position] = n_new;
+    memcpy(&reach->anti_pos[reach->anti_used], reach->new_anti_pos, n_new * sizeof(int));
+    memcpy(&reach->anti_size[reach->anti_used], reach->new_anti_size, n_new * sizeof(int));
+    reach->anti_used += n_new;
+
+    // Reachability: hang the tx under sp and cover the rest of its past
+    tree_insert(reach, position, sp);
+    for (int i = 0; i < n_merge; i++) {
+        fcs_add(reach, reach->mergeset[i], position);
+    }
+    reach->labeled = position + 1;
+}
+
+// Writes the GHOSTDAG order of every indexed tx into `order`, returning
+// the count. The tip with the highest blue score is the virtual selected
+// parent. Each block of its selected chain follows its mergeset, from the
+// root up; txs outside the tip's past come last.
+int ghostdag_order(Reachability* reach, int* order) {
+    int count = reach->labeled;
+    if (count == 0) return 0;
+
+    int tip = 0;
+    for (int i = 1; i < count; i++) {
+        if (reach->blue_score[i] >= reach->blue_score[tip]) tip = i;
+    }
+
+    // Selected chain, root first (reuses the queue scratch)
+    int n_chain = 0;
+    for (int c = tip; c >= 0; c = reach->selected[c]) {
+        reach->queue[n_chain++] = c;
+    }
+
+    int n = 0;
+    reach->epoch++;
+    for (int i = n_chain - 1; i >= 0; i--) {
+        int c = reach->queue[i];
+        const int* merge = &reach->merge[reach->merge_start[c]];
+        for (int m = 0; m < reach->merge_count[c]; m++) {
+            if (reach->stamp[merge[m]] == reach->epoch) continue;
+            reach->stamp[merge[m]] = reach->epoch;
+            order[n++] = merge[m];
+        }
+        reach->stamp[c] = reach->epoch;
+        order[n++] = c;
+    }
+    for (int i = 0; i < count; i++) {
+        if (reach->stamp[i] != reach->epoch) order[n++] = i;
+    }
+    return n;
+}
@@ -0,0 +1,133 @@
+// hash.c - BLAKE2s (RFC 7693) with a 4-lane batch path
+
+#include "hash.h"
+#include <string.h>
+
+#define BLAKE2S_BLOCK 64
+
+static const uint32_t blake2s_iv[8] = {
+    0x6A09E667u, 0xBB67AE85u, 0x3C6EF372u, 0xA54FF53Au,
+    0x510E527Fu, 0x9B05688Cu, 0x1F83D9ABu, 0x5BE0CD19u
+};
+
+static const uint8_t blake2s_sigma[10][16] = {
+    {  0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14, 15 },
+    { 14, 10,  4,  8,  9, 15, 13,  6,  1, 12,  0,  2, 11,  7,  5,  3 },
+    { 11,  8, 12,  0,  5,  2, 15, 13, 10, 14,  3,  6,  7,  1,  9,  4 },
+    {  7,  9,  3,  1, 13, 12, 11, 14,  2,  6,  5, 10,  4,  0, 15,  8 },
+    {  9,  0,  5,  7,  2,  4, 10, 15, 14,  1, 11, 12,  6,  8,  3, 13 },
+    {  2, 12,  6, 10,  0, 11,  8,  3,  4, 13,  7,  5, 15, 14,  1,  9 },
+    { 12,  5,  1, 15, 14, 13,  4, 10,  0,  7,  6,  3,  9,  2,  8, 11 },
+    { 13, 11,  7, 14, 12,  1,  3,  9,  5,  0, 15,  4,  8,  6,  2, 10 },
+    {  6, 15, 14,  9, 11,  3,  0,  8, 12,  2, 13,  7,  1,  4, 10,  5 },
+    { 10,  2,  8,  4,  7,  6,  1,  5, 15, 11,  9, 14,  3, 12, 13,  0 }
+};
+
+#define ROTR32(x, n) (((x) >> (n)) | ((x) << (32 - (n))))
+
+static uint32_t load32(const uint8_t* p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) |
+           ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+// Mixing function G applied to every lane of v
+#define G(v, a, b, c, d, x, y, lanes)                                   \
+    for (int l = 0; l < (lanes); l++) {                                 \
+        v[a][l] = v[a][l] + v[b][l] + x[l];                             \
+        v[d][l] = ROTR32(v[d][l] ^ v[a][l], 16);                        \
+        v[c][l] = v[c][l] + v[d][l];                                    \
+        v[b][l] = ROTR32(v[b][l] ^ v[c][l], 12);                        \
+        v[a][l] = v[a][l] + v[b][l] + y[l];                             \
+        v[d][l] = ROTR32(v[d][l] ^ v[a][l], 8);                         \
+        v[c][l] = v[c][l] + v[d][l];                                    \
+        v[b][l] = ROTR32(v[b][l] ^ v[c][l], 7);                         \
+    }
+
+// One compression over `lanes` messages; state and message words are
+// stored word-major ([word][lane]) so each G step is a vector operation
+#define DEFINE_COMPRESS(name, lanes)                                    \
+static void name(uint32_t h[8][lanes], const uint32_t m[16][lanes],     \
+                 uint32_t counter, int last) {                          \
+    uint32_t v[16][lanes];                                              \
+    for (int i = 0; i < 8; i++) {                                       \
+        for (int l = 0; l < (lanes); l++) {                             \
+            v[i][l] = h[i][l];                                          \
+            v[i + 8][l] = blake2s_iv[i];                                \
+        }                                                               \
+    }                                                                   \
+    for (int l = 0; l < (lanes); l++) {                                 \
+        v[12][l] ^= counter;                                            \
+        if (last) v[14][l] = ~v[14][l];                                 \
+    }                                                                   \
+    for (int r = 0; r < 10; r++) {                                      \
+        const uint8_t* s = blake2s_sigma[r];                            \
+        G(v, 0, 4,  8, 12, m[s[0]],  m[s[1]],  lanes);                  \
+        G(v, 1, 5,  9, 13, m[s[2]],  m[s[3]],  lanes);                  \
+        G(v, 2, 6, 10, 14, m[s[4]],  m[s[5]],  lanes);                  \
+        G(v, 3, 7, 11, 15, m[s[6]],  m[s[7]],  lanes);                  \
+        G(v, 0, 5, 10, 15, m[s[8]],  m[s[9]],  lanes);                  \
+        G(v, 1, 6, 11, 12, m[s[10]], m[s[11]], lanes);                  \
+        G(v, 2, 7,  8, 13, m[s[12]], m[s[13]], lanes);                  \
+        G(v, 3, 4,  9, 14, m[s[14]], m[s[15]], lanes);                  \
+    }                                                                   \
+    for (int i = 0; i < 8; i++) {                                       \
+        for (int l = 0; l < (lanes); l++) {                             \
+            h[i][l] ^= v[i][l] ^ v[i + 8][l];                           \
+        }                                                               \
+    }                                                                   \
+}
+
+DEFINE_COMPRESS(compress1, 1)
+DEFINE_COMPRESS(compress4, HASH_LANES)
+
+// Hashes `lanes` equal-length messages. Counter and final-block flag are
+// shared because the lengths are equal; the message length must fit the
+// 32-bit low counter word, which a transaction always does.
+#define DEFINE_HASH_LANES(name, compress, lanes)                        \
+static void name(const uint8_t* const* data, size_t len, uint8_t* const* out) { \
+    uint32_t h[8][lanes];                                               \
+    uint32_t m[16][lanes];                                              \
+    for (int i = 0; i < 8; i++) {                                       \
+        for (int l = 0; l < (lanes); l++) h[i][l] = blake2s_iv[i];      \
+    }                                                                   \
+    for (int l = 0; l < (lanes); l++) {                                 \
+        h[0][l] ^= 0x01010000u ^ HASH_DIGEST_BYTES;                     \
+    }                                                                   \
+    size_t offset = 0;                                                  \
+    do {                                                                \
+        size_t take = len - offset;                                     \
+        int last = (take <= BLAKE2S_BLOCK);                             \
+        if (!last) take = BLAKE2S_BLOCK;                                \
+        for (int l = 0; l < (lanes); l++) {                             \
+            uint8_t block[BLAKE2S_BLOCK] = { 0 };                       \
+            memcpy(block, data[l] + offset, take);                      \
+            for (int w = 0; w < 16; w++) m[w][l] = load32(block + 4 * w); \
+        }                                                               \
+        offset += take;                                                 \
+        compress(h, m, (uint32_t)offset, last);                         \
+    } while (offset < len);                                             \
+    for (int l = 0; l < (lanes); l++) {                                 \
+        for (int b = 0; b < HASH_DIGEST_BYTES; b++) {                   \
+            out[l][b] = (uint8_t)(h[b / 4][l] >> (8 * (b % 4)));        \
+        }                                                               \
+    }                                                                   \
+}
+
+DEFINE_HASH_LANES(hash_lanes1, compress1, 1)
+DEFINE_HASH_LANES(hash_lanes4, compress4, HASH_LANES)
+
+void hash_digest(const void* data, size_t len, uint8_t* out) {
+    const uint8_t* in = (const uint8_t*)data;
+    hash_lanes1(&in, len, &out);
+}
+
+// Hashes n messages of len bytes each, four at a time
+void hash_digest_batch(const void* const* data, size_t len, uint8_t* const* out, int n) {
+    int i = 0;
+    for (; i + HASH_LANES <= n; i += HASH_LANES) {
+        hash_lanes4((const uint8_t* const*)&data[i], len, &out[i]);
+    }
+    for (; i < n; i++) {
+        hash_digest(data[i], len, out[i]);
+    }
+}
@@ -0,0 +1,114 @@
+// hosts.c - Host grouping of zone members and host-level broadcast
+
+#include "hosts.h"
+
+// Collective over MPI_COMM_WORLD; call after zone_comm has been created.
+// Splits the zone by shared-memory domain, then every zone member learns
+// the zone_comm rank of each host leader.
+void map_hosts(Node* node) {
+    HostMap* map = node->hosts;
+    if (map) {
+        free(map->leaders);
+        if (map->host_comm != MPI_COMM_NULL) MPI_Comm_free(&map->host_comm);
+    } else {
+        map = (HostMap*)calloc(1, sizeof(HostMap));
+        node->hosts = map;
+    }
+
+    // Host identity across zones: the lowest world rank on the host
+    MPI_Comm world_host;
+    MPI_Comm_split_type(MPI_COMM_WORLD, MPI_COMM_TYPE_SHARED, node->rank,
+                        MPI_INFO_NULL, &world_host);
+    MPI_Allreduce(&node->rank, &map->host_id, 1, MPI_INT, MPI_MIN, world_host);
+    MPI_Comm_free(&world_host);
+
+    int zone_rank, zone_size;
+    MPI_Comm_rank(node->zone_comm, &zone_rank);
+    MPI_Comm_size(node->zone_comm, &zone_size);
+    MPI_Comm_split_type(node->zone_comm, MPI_COMM_TYPE_SHARED, zone_rank,
+                        MPI_INFO_NULL, &map->host_comm);
+    MPI_Comm_rank(map->host_comm, &map->host_rank);
+    MPI_Comm_size(map->host_comm, &map->host_size);
+
+    // Members report their host leader's zone rank; the distinct values
+    // other than our own are the broadcast targets
+    int leader = zone_rank;
+    MPI_Bcast(&leader, 1, MPI_INT, 0, map->host_comm);
+    int* leaders = (int*)malloc(zone_size * sizeof(int));
+    MPI_Allgather(&leader, 1, MPI_INT, leaders, 1, MPI_INT, node->zone_comm);
+
+    map->leaders = (int*)malloc(zone_size * sizeof(int));
+    map->n_leaders = 0;
+    for (int i = 0; i < zone_size; i++) {
+        if (leaders[i] == i && i != leader) {
+            map->leaders[map->n_leaders++] = i;
+        }
+    }
+    free(leaders);
+}
+
+void destroy_host_map(HostMap* map) {
+    if (!map) return;
+    free(map->leaders);
+    if (map->host_comm != MPI_COMM_NULL) MPI_Comm_free(&map->host_comm);
+    free(map);
+}
+
+// Counts one zone broadcast against what full broadcasts would deliver
+void host_count_broadcast(Node* node) {
+    HostMap* map = node->hosts;
+    int zone_size;
+    MPI_Comm_size(node->zone_comm, &zone_size);
+    map->broadcasts++;
+    map->deliveries += map->n_leaders;
+    map->unshared_deliveries += zone_size - 1;
+}
+
+// Zone broadcast that reaches one rank per other host; the sender's own
+// host sees the tx through the shared DAG
+void host_broadcast(Node* node, Transaction* tx) {
+    HostMap* map = node->hosts;
+    broadcast_transaction_to(tx, node->zone_comm, map->leaders, map->n_leaders);
+    host_count_broadcast(node);
+}
+
+// Collective over MPI_COMM_WORLD: rank 0 prints DAG memory per host, shared
+// against one private replica per rank, and the inbound zone messages saved
+void hosts_report(Node* node, DAG* dag) {
+    HostMap* map = node->hosts;
+    int n = node->total_nodes;
+
+    // Host leaders speak for their (zone, host) group
+    double mine[3] = { map->host_rank == 0 ? (double)map->host_id : -1.0,
+                       map->host_rank == 0 ? (double)shared_dag_bytes(dag->capacity) : 0.0,
+                       map->host_rank == 0 ? (double)map->host_size : 0.0 };
+    double* groups = node->rank == 0 ? (double*)malloc(3 * n * sizeof(double)) : NULL;
+    MPI_Gather(mine, 3, MPI_DOUBLE, groups, 3, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+
+    long counts[2] = { map->deliveries, map->unshared_deliveries }, totals[2];
+    MPI_Reduce(counts, totals, 2, MPI_LONG, MPI_SUM, 0, MPI_COMM_WORLD);
+
+    if (node->rank == 0) {
+        double private_bytes = (double)dag->capacity * (sizeof(Transaction) + sizeof(int));
+        printf("\n=== HOST-SHARED DAG ===\n");
+        for (int host = 0; host < n; host++) {
+            int zones = 0, ranks = 0;
+            double shared = 0.0;
+            for (int i = 0; i < n; i++) {
+                if ((int)groups[3 * i] != host) continue;
+                zones++;
+                shared += groups[3 * i + 1];
+                ranks += (int)groups[3 * i + 2];
+            }
+            if (zones == 0) continue;
+            printf("Host %d: %d ranks in %d zone groups, DAG memory %.1f MB shared "
+                   "(%.1f MB as private replicas)\n",
+                   host, ranks, zones, shared / 1048576.0, ranks * private_bytes / 1048576.0);
+        }
+        double saved = totals[1] > 0 ? 100.0 * (totals[1] - totals[0]) / totals[1] : 0.0;
+        printf("Inbound zone messages: %ld (%ld with full zone broadcasts, -%.1f%%)\n",
+               totals[0], totals[1], saved);
+        printf("========================\n");
+        free(groups);
+    }
+}
@@ -0,0 +1,146 @@
+// iblt.c - Invertible Bloom lookup table over 128-bit digests
+
+#include "iblt.h"
+#include <stdlib.h>
+#include <string.h>
+
+static uint64_t mix64(uint64_t z) {
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+// Cells for a table expected to decode the given number of differences
+int iblt_cells_for(int differences) {
+    int cells = differences + differences / 2 + IBLT_MIN_CELLS;
+    return (cells + IBLT_HASHES - 1) / IBLT_HASHES * IBLT_HASHES;
+}
+
+Iblt* create_iblt(int cells) {
+    Iblt* table = (Iblt*)malloc(sizeof(Iblt));
+    cells = (cells < IBLT_HASHES) ? IBLT_HASHES : cells;
+    table->n_cells = cells / IBLT_HASHES * IBLT_HASHES;
+    table->cells = (IbltCell*)calloc(table->n_cells, sizeof(IbltCell));
+    return table;
+}
+
+void destroy_iblt(Iblt* table) {
+    if (!table) return;
+    free(table->cells);
+    free(table);
+}
+
+void iblt_clear(Iblt* table) {
+    memset(table->cells, 0, table->n_cells * sizeof(IbltCell));
+}
+
+// The digest's cell in each slice and its check hash. Digests are uniform
+// already; the mixing only decorrelates the slices from each other.
+static void cell_positions(const Iblt* table, const uint8_t* digest, int* cells,
+                           uint32_t* check) {
+    uint64_t h1, h2;
+    memcpy(&h1, digest, sizeof(uint64_t));
+    memcpy(&h2, digest + sizeof(uint64_t), sizeof(uint64_t));
+    uint64_t slice = table->n_cells / IBLT_HASHES;
+    for (int i = 0; i < IBLT_HASHES; i++) {
+        cells[i] = (int)(i * slice + mix64(h1 + (uint64_t)(i + 1) * h2) % slice);
+    }
+    *check = (uint32_t)(mix64(h2 ^ mix64(h1)) >> 32);
+}
+
+static void toggle(IbltCell* cell, const uint8_t* digest, uint32_t check, int sign) {
+    cell->count += sign;
+    cell->check ^= check;
+    for (int b = 0; b < HASH_DIGEST_BYTES; b++) {
+        cell->key[b] ^= digest[b];
+    }
+}
+
+void iblt_insert(Iblt* table, const uint8_t* digest) {
+    int cells[IBLT_HASHES];
+    uint32_t check;
+    cell_positions(table, digest, cells, &check);
+    for (int i = 0; i < IBLT_HASHES; i++) {
+        toggle(&table->cells[cells[i]], digest, check, 1);
+    }
+}
+
+// table -= other; both must have the same number of cells
+void iblt_subtract(Iblt* table, const Iblt* other) {
+    for (int c = 0; c < table->n_cells; c++) {
+        IbltCell* cell = &table->cells[c];
+        const IbltCell* minus = &other->cells[c];
+        cell->count -= minus->count;
+        cell->check ^= minus->check;
+        for (int b = 0; b < HASH_DIGEST_BYTES; b++) {
+            cell->key[b] ^= minus->key[b];
+        }
+    }
+}
+
+// A cell holding exactly one digest, added (+1) or subtracted (-1)
+static int pure_sign(const Iblt* table, int c) {
+    const IbltCell* cell = &table->cells[c];
+    if (cell->count != 1 && cell->count != -1) return 0;
+    int cells[IBLT_HASHES];
+    uint32_t check;
+    cell_positions(table, cell->key, cells, &check);
+    if (check != cell->check) return 0;
+    // A real digest maps back to this cell
+    for (int i = 0; i < IBLT_HASHES; i++) {
+        if (cells[i] == c) return cell->count;
+    }
+    return 0;
+}
+
+// Peels a subtracted table, consuming it. Writes each recovered digest to
+// keys (HASH_DIGEST_BYTES apart) with its sign: +1 for a digest only in the
+// table subtracted from, -1 for one only in the subtracted table. Returns
+// the number recovered, or -1 if the table did not peel completely or held
+// more than max.
+int iblt_decode(Iblt* table, uint8_t* keys, int* signs, int max) {
+    int capacity = table->n_cells + IBLT_HASHES * (max + 1);
+    int* stack = (int*)malloc(capacity * sizeof(int));
+    int top = 0;
+    for (int c = 0; c < table->n_cells; c++) {
+        if (pure_sign(table, c)) stack[top++] = c;
+    }
+
+    int found = 0;
+    while (top > 0 && found <= max) {
+        int c = stack[--top];
+        int sign = pure_sign(table, c);
+        if (!sign) continue;  // Emptied since it was pushed
+        if (found == max) {
+            found++;
+            break;
+        }
+
+        uint8_t digest[HASH_DIGEST_BYTES];
+        memcpy(digest, table->cells[c].key, HASH_DIGEST_BYTES);
+        memcpy(keys + (size_t)found * HASH_DIGEST_BYTES, digest, HASH_DIGEST_BYTES);
+        signs[found++] = sign;
+
+        int cells[IBLT_HASHES];
+        uint32_t check;
+        cell_positions(table, digest, cells, &check);
+        for (int i = 0; i < IBLT_HASHES; i++) {
+            toggle(&table->cells[cells[i]], digest, check, -sign);
+            if (cells[i] != c && top < capacity && pure_sign(table, cells[i])) {
+                stack[top++] = cells[i];
+            }
+        }
+    }
+    free(stack);
+    if (found > max) return -1;
+
+    // Anything left means some digests could not be separated
+    for (int c = 0; c < table->n_cells; c++) {
+        const IbltCell* cell = &table->cells[c];
+        if (cell->count != 0 || cell->check != 0) return -1;
+        for (int b = 0; b < HASH_DIGEST_BYTES; b++) {
+            if (cell->key[b]) return -1;
+        }
+    }
+    return found;
+}
@@ -0,0 +1,382 @@
+// ledger.c - Account balances and batched execution of finalized txs
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "ledger.h"
+#include <pthread.h>
+
+#define LEDGER_JOB_WAVE 0        // Execute order[begin, end) in place
+#define LEDGER_JOB_SPECULATE 1   // Speculate pending[begin, end)
+
+struct LedgerPool {
+    Ledger* ledger;
+    pthread_t* threads;
+    pthread_barrier_t start;
+    pthread_barrier_t done;
+    int job;
+    int begin;
+    int end;
+    int stop;
+};
+
+typedef struct {
+    LedgerPool* pool;
+    int index;
+} LedgerThreadArg;
+
+int parse_receiver_dist(const char* text) {
+    if (strcmp(text, "uniform") == 0) return RECEIVERS_UNIFORM;
+    if (strcmp(text, "zipf") == 0) return RECEIVERS_ZIPF;
+    if (strcmp(text, "zone") == 0) return RECEIVERS_ZONE;
+    return -1;
+}
+
+int parse_ledger_mode(const char* text) {
+    if (strcmp(text, "static") == 0) return LEDGER_STATIC;
+    if (strcmp(text, "optimistic") == 0) return LEDGER_OPTIMISTIC;
+    return -1;
+}
+
+// Cumulative distribution of P(i) ~ 1 / (i + 1)^exponent over n items
+double* create_zipf_cdf(int n, double exponent) {
+    double* cdf = (double*)malloc(n * sizeof(double));
+    double total = 0.0;
+    for (int i = 0; i < n; i++) {
+        total += 1.0 / pow(i + 1, exponent);
+        cdf[i] = total;
+    }
+    for (int i = 0; i < n; i++) {
+        cdf[i] /= total;
+    }
+    return cdf;
+}
+
+// Item for a uniform draw u in [0, 1)
+int sample_zipf(const double* cdf, int n, double u) {
+    int lo = 0, hi = n - 1;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (cdf[mid] > u) {
+            hi = mid;
+        } else {
+            lo = mid + 1;
+        }
+    }
+    return lo;
+}
+
+// ------------------------------------------------------------------
+// Execution kernels
+// ------------------------------------------------------------------
+
+static int execute(int64_t* balances, int from, int to, int64_t amount) {
+    if (balances[from] < amount) return 0;
+    balances[from] -= amount;
+    balances[to] += amount;
+    return 1;
+}
+
+// Reads only: the writes a tx would make against the pre-batch balances
+static void speculate(Ledger* ledger, int i) {
+    int64_t from_balance = ledger->balances[ledger->from[i]];
+    int64_t to_balance = ledger->balances[ledger->to[i]];
+    ledger->ok[i] = (from_balance >= ledger->amount[i]);
+    if (ledger->from[i] == ledger->to[i]) {
+        ledger->spec_from[i] = from_balance;
+        ledger->spec_to[i] = from_balance;
+    } else {
+        ledger->spec_from[i] = from_balance - ledger->amount[i];
+        ledger->spec_to[i] = to_balance + ledger->amount[i];
+    }
+}
+
+// One participant's contiguous share of [begin, end)
+static void run_share(Ledger* ledger, int job, int begin, int end, int index, int participants) {
+    int n = end - begin;
+    int first = begin + (int)((long)n * index / participants);
+    int last = begin + (int)((long)n * (index + 1) / participants);
+    for (int k = first; k < last; k++) {
+        if (job == LEDGER_JOB_WAVE) {
+            int i = ledger->order[k];
+            ledger->ok[i] = execute(ledger->balances, ledger->from[i], ledger->to[i],
+                                    ledger->amount[i]);
+        } else {
+            speculate(ledger, k);
+        }
+    }
+}
+
+static void* ledger_thread_main(void* arg) {
+    LedgerThreadArg* self = (LedgerThreadArg*)arg;
+    LedgerPool* pool = self->pool;
+    int index = self->index;
+    free(self);
+
+    for (;;) {
+        pthread_barrier_wait(&pool->start);
+        if (pool->stop) break;
+        run_share(pool->ledger, pool->job, pool->begin, pool->end, index,
+                  pool->ledger->n_threads + 1);
+        pthread_barrier_wait(&pool->done);
+    }
+    return NULL;
+}
+
+// Runs a job across the pool and the calling thread; returns when done.
+// Small ranges are not worth two barrier crossings and stay on the caller.
+static void run_job(Ledger* ledger, int job, int begin, int end) {
+    LedgerPool* pool = ledger->pool;
+    if (!pool || end - begin < 2 * (ledger->n_threads + 1)) {
+        run_share(ledger, job, begin, end, 0, 1);
+        return;
+    }
+    pool->job = job;
+    pool->begin = begin;
+    pool->end = end;
+    pthread_barrier_wait(&pool->start);
+    run_share(ledger, job, begin, end, 0, ledger->n_threads + 1);
+    pthread_barrier_wait(&pool->done);
+}
+
+// ------------------------------------------------------------------
+// Ledger
+// ------------------------------------------------------------------
+
+Ledger* create_ledger(int n_ranks, int accounts_per_rank, int mode, int n_threads, int batch) {
+    Ledger* ledger = (Ledger*)calloc(1, sizeof(Ledger));
+    ledger->mode = mode;
+    ledger->accounts_per_rank = MAX(accounts_per_rank, 1);
+    ledger->n_accounts = n_ranks * ledger->accounts_per_rank;
+    ledger->balances = (int64_t*)malloc(ledger->n_accounts * sizeof(int64_t));
+    for (int a = 0; a < ledger->n_accounts; a++) {
+        ledger->balances[a] = LEDGER_INITIAL_BALANCE;
+    }
+    if (parse_receiver_dist(g_params.receiver_dist) == RECEIVERS_ZIPF) {
+        ledger->zipf_cdf = create_zipf_cdf(ledger->accounts_per_rank, g_params.receiver_zipf);
+    }
+
+    ledger->batch = MAX(batch, 1);
+    ledger->pending = (Transaction*)malloc(ledger->batch * sizeof(Transaction));
+    ledger->from = (int*)malloc(ledger->batch * sizeof(int));
+    ledger->to = (int*)malloc(ledger->batch * sizeof(int));
+    ledger->amount = (int64_t*)malloc(ledger->batch * sizeof(int64_t));
+    ledger->ok = (int*)malloc(ledger->batch * sizeof(int));
+    ledger->stamp = (uint32_t*)calloc(ledger->n_accounts, sizeof(uint32_t));
+    if (mode == LEDGER_STATIC) {
+        ledger->last_wave = (int*)malloc(ledger->n_accounts * sizeof(int));
+        ledger->wave = (int*)malloc(ledger->batch * sizeof(int));
+        ledger->order = (int*)malloc(ledger->batch * sizeof(int));
+        ledger->wave_start = (int*)malloc((ledger->batch + 1) * sizeof(int));
+    } else {
+        ledger->spec_from = (int64_t*)malloc(ledger->batch * sizeof(int64_t));
+        ledger->spec_to = (int64_t*)malloc(ledger->batch * sizeof(int64_t));
+    }
+
+    ledger->n_threads = MAX(n_threads, 0);
+    if (ledger->n_threads > 0) {
+        LedgerPool* pool = (LedgerPool*)calloc(1, sizeof(LedgerPool));
+        pool->ledger = ledger;
+        pool->threads = (pthread_t*)malloc(ledger->n_threads * sizeof(pthread_t));
+        pthread_barrier_init(&pool->start, NULL, ledger->n_threads + 1);
+        pthread_barrier_init(&pool->done, NULL, ledger->n_threads + 1);
+        for (int t = 0; t < ledger->n_threads; t++) {
+            LedgerThreadArg* arg = (LedgerThreadArg*)malloc(sizeof(LedgerThreadArg));
+            arg->pool = pool;
+            arg->index = t + 1;
+            pthread_create(&pool->threads[t], NULL, ledger_thread_main, arg);
+        }
+        ledger->pool = pool;
+    }
+    return ledger;
+}
+
+void destroy_ledger(Ledger* ledger) {
+    if (!ledger) return;
+    LedgerPool* pool = ledger->pool;
+    if (pool) {
+        pool->stop = 1;
+        pthread_barrier_wait(&pool->start);
+        for (int t = 0; t < ledger->n_threads; t++) {
+            pthread_join(pool->threads[t], NULL);
+        }
+        pthread_barrier_destroy(&pool->start);
+        pthread_barrier_destroy(&pool->done);
+        free(pool->threads);
+        free(pool);
+    }
+    free(ledger->balances);
+    free(ledger->zipf_cdf);
+    free(ledger->pending);
+    free(ledger->from);
+    free(ledger->to);
+    free(ledger->amount);
+    free(ledger->ok);
+    free(ledger->stamp);
+    free(ledger->last_wave);
+    free(ledger->wave);
+    free(ledger->order);
+    free(ledger->wave_start);
+    free(ledger->spec_from);
+    free(ledger->spec_to);
+    free(ledger);
+}
+
+// Debits one of the sender's accounts and credits one of the receiver's,
+// both picked by digest bits. Under RECEIVERS_ZIPF the credited account is
+// skewed the same way receivers are.
+void ledger_accounts(const Ledger* ledger, const Transaction* tx, int* from, int* to) {
+    int per = ledger->accounts_per_rank;
+    int n_ranks = ledger->n_accounts / per;
+    uint32_t bits[2];
+    memcpy(bits, tx->digest, sizeof(bits));
+
+    int sender = ((tx->sender % n_ranks) + n_ranks) % n_ranks;
+    int receiver = ((tx->receiver % n_ranks) + n_ranks) % n_ranks;
+    int credited = (int)(bits[1] % per);
+    if (ledger->zipf_cdf) {
+        credited = sample_zipf(ledger->zipf_cdf, per, (bits[1] >> 8) / 16777216.0);
+    }
+    *from = sender * per + (int)(bits[0] % per);
+    *to = receiver * per + credited;
+}
+
+static int compare_tx_ids(const void* a, const void* b) {
+    int x = ((const Transaction*)a)->tx_id;
+    int y = ((const Transaction*)b)->tx_id;
+    return (x > y) - (x < y);
+}
+
+// Conflict partitioning: waves of txs with pairwise disjoint accounts,
+// txs sharing an account kept in batch order across waves
+static void execute_static(Ledger* ledger, int n) {
+    int n_waves = 0;
+    for (int i = 0; i < n; i++) {
+        int from = ledger->from[i], to = ledger->to[i];
+        int wave = 0;
+        if (ledger->stamp[from] == ledger->epoch) wave = ledger->last_wave[from] + 1;
+        if (ledger->stamp[to] == ledger->epoch) wave = MAX(wave, ledger->last_wave[to] + 1);
+        if (wave > 0) ledger->conflicts++;
+
+        ledger->wave[i] = wave;
+        ledger->stamp[from] = ledger->stamp[to] = ledger->epoch;
+        ledger->last_wave[from] = ledger->last_wave[to] = wave;
+        n_waves = MAX(n_waves, wave + 1);
+    }
+
+    // Counting sort by wave; stable, so batch order holds within a wave
+    memset(ledger->wave_start, 0, (n_waves + 1) * sizeof(int));
+    for (int i = 0; i < n; i++) ledger->wave_start[ledger->wave[i] + 1]++;
+    for (int w = 0; w < n_waves; w++) ledger->wave_start[w + 1] += ledger->wave_start[w];
+    for (int i = 0; i < n; i++) ledger->order[ledger->wave_start[ledger->wave[i]]++] = i;
+    for (int w = n_waves; w > 0; w--) ledger->wave_start[w] = ledger->wave_start[w - 1];
+    ledger->wave_start[0] = 0;
+
+    for (int w = 0; w < n_waves; w++) {
+        run_job(ledger, LEDGER_JOB_WAVE, ledger->wave_start[w], ledger->wave_start[w + 1]);
+    }
+    ledger->waves += n_waves;
+}
+
+// Speculate everything in parallel, then commit in order. A tx that read an
+// account already written in this batch saw a stale value and re-executes.
+static void execute_optimistic(Ledger* ledger, int n) {
+    run_job(ledger, LEDGER_JOB_SPECULATE, 0, n);
+
+    for (int i = 0; i < n; i++) {
+        int from = ledger->from[i], to = ledger->to[i];
+        if (ledger->stamp[from] == ledger->epoch || ledger->stamp[to] == ledger->epoch) {
+            ledger->conflicts++;
+            ledger->reexecuted++;
+            ledger->ok[i] = execute(ledger->balances, from, to, ledger->amount[i]);
+        } else if (ledger->ok[i]) {
+            ledger->balances[from] = ledger->spec_from[i];
+            ledger->balances[to] = ledger->spec_to[i];
+        }
+        if (ledger->ok[i]) {
+            ledger->stamp[from] = ledger->stamp[to] = ledger->epoch;
+        }
+    }
+    ledger->waves++;
+}
+
+// Executes the pending batch in DAG order
+void ledger_flush(Ledger* ledger) {
+    int n = ledger->pending_count;
+    if (n == 0) return;
+    double start = MPI_Wtime();
+
+    qsort(ledger->pending, n, sizeof(Transaction), compare_tx_ids);
+    for (int i = 0; i < n; i++) {
+        ledger_accounts(ledger, &ledger->pending[i], &ledger->from[i], &ledger->to[i]);
+        ledger->amount[i] = llround(ledger->pending[i].amount * 100.0);
+    }
+    if (++ledger->epoch == 0) {
+        memset(ledger->stamp, 0, ledger->n_accounts * sizeof(uint32_t));
+        ledger->epoch = 1;
+    }
+
+    if (ledger->mode == LEDGER_OPTIMISTIC) {
+        execute_optimistic(ledger, n);
+    } else {
+        execute_static(ledger, n);
+    }
+
+    for (int i = 0; i < n; i++) ledger->applied += ledger->ok[i];
+    ledger->executed += n;
+    ledger->batches++;
+    ledger->pending_count = 0;
+    ledger->seconds += MPI_Wtime() - start;
+}
+
+// Queues a finalized tx; a full batch executes right away
+void ledger_submit(Ledger* ledger, const Transaction* tx) {
+    ledger->pending[ledger->pending_count++] = *tx;
+    if (ledger->pending_count == ledger->batch) {
+        ledger_flush(ledger);
+    }
+}
+
+int64_t ledger_total(const Ledger* ledger) {
+    int64_t total = 0;
+    for (int a = 0; a < ledger->n_accounts; a++) {
+        total += ledger->balances[a];
+    }
+    return total;
+}
+
+// Collective over MPI_COMM_WORLD: executes what is pending, then rank 0
+// prints execution throughput and conflict rates
+void ledger_report(Ledger* ledger, Node* node) {
+    ledger_flush(ledger);
+
+    double local[7] = {
+        (double)ledger->executed,
+        (double)ledger->applied,
+        (double)ledger->conflicts,
+        (double)ledger->reexecuted,
+        (double)ledger->waves,
+        (double)ledger->batches,
+        ledger->seconds
+    };
+    double totals[7];
+    int conserved = (ledger_total(ledger) == (int64_t)ledger->n_accounts * LEDGER_INITIAL_BALANCE);
+    int all_conserved = 0;
+    MPI_Reduce(local, totals, 7, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
+    MPI_Reduce(&conserved, &all_conserved, 1, MPI_INT, MPI_LAND, 0, MPI_COMM_WORLD);
+
+    if (node->rank == 0) {
+        double executed = MAX(totals[0], 1.0);
+        double batches = MAX(totals[5], 1.0);
+        printf("\n=== LEDGER (%s, %s receivers, %d threads) ===\n",
+               g_params.ledger_mode, g_params.receiver_dist, ledger->n_threads);
+        printf("Executed: %.0f txs in %.0f batches (%.0f applied, %.0f insufficient funds)\n",
+               totals[0], totals[5], totals[1], totals[0] - totals[1]);
+        printf("Execution: %.0f tx/s per rank, %.1f us per batch\n",
+               totals[6] > 0 ? totals[0] / totals[6] : 0.0, totals[6] / batches * 1e6);
+        printf("Conflicts: %.2f%%, re-executed: %.2f%%, %.2f waves per batch\n",
+               100.0 * totals[2] / executed, 100.0 * totals[3] / executed,
+               totals[4] / batches);
+        printf("Balances conserved: %s\n", all_conserved ? "yes" : "no");
+        printf("========================\n");
+    }
+}
@@ -0,0 +1,299 @@
+// loadgen.c - Arrival processes and backlog for open-loop load
+
+#include "loadgen.h"
+#include "ledger.h"
+
+#define LOAD_TWO_PI 6.283185307179586
+
+// Parses "legacy", "poisson:R", "constant:R", "bursty:R:ON:OFF",
+// "diurnal:R:PERIOD:AMPLITUDE" or "trace". R is the mean rate in tx/s.
+int parse_load_spec(const char* text, LoadSpec* spec) {
+    char name[32] = {0};
+    double a = 0.0, b = 0.0, c = 0.0;
+    int fields = sscanf(text, "%31[^:]:%lf:%lf:%lf", name, &a, &b, &c);
+    if (fields < 1) return 0;
+
+    memset(spec, 0, sizeof(LoadSpec));
+    spec->rate = a;
+    if (strcmp(name, "legacy") == 0) {
+        spec->process = LOAD_LEGACY;
+        return 1;
+    }
+    if (strcmp(name, "trace") == 0) {
+        spec->process = LOAD_TRACE;
+        return 1;
+    }
+    if (fields < 2 || a <= 0.0) return 0;
+
+    if (strcmp(name, "poisson") == 0) {
+        spec->process = LOAD_POISSON;
+    } else if (strcmp(name, "constant") == 0) {
+        spec->process = LOAD_CONSTANT;
+    } else if (strcmp(name, "bursty") == 0) {
+        spec->process = LOAD_BURSTY;
+        spec->on_period = (fields >= 3) ? b : 1.0;
+        spec->off_period = (fields >= 4) ? c : 1.0;
+        if (spec->on_period <= 0.0 || spec->off_period < 0.0) return 0;
+    } else if (strcmp(name, "diurnal") == 0) {
+        spec->process = LOAD_DIURNAL;
+        spec->period = (fields >= 3) ? b : 60.0;
+        spec->amplitude = (fields >= 4) ? c : 0.5;
+        if (spec->period <= 0.0) return 0;
+        spec->amplitude = MIN(MAX(spec->amplitude, 0.0), 1.0);
+    } else {
+        return 0;
+    }
+    return 1;
+}
+
+// Reads a "rank rate" file (blank lines and '#' comments allowed) and
+// calls visit for each entry. Returns -1 if the file cannot be read or a
+// line is not a rank with a positive rate, else 0.
+static int read_rank_rates(const char* path, void (*visit)(int, double, void*), void* arg) {
+    FILE* f = fopen(path, "r");
+    if (!f) {
+        perror(path);
+        return -1;
+    }
+
+    char line[256];
+    int number = 0;
+    while (fgets(line, sizeof(line), f)) {
+        int r;
+        double value;
+        char extra;
+        number++;
+        char* text = line + strspn(line, " \t");
+        if (*text == '#' || *text == '\n' || *text == '\0') continue;
+        if (sscanf(text, "%d %lf %c", &r, &value, &extra) != 2 || r < 0 || value <= 0.0) {
+            fprintf(stderr, "%s:%d: expected 'rank rate' with a positive rate\n", path, number);
+            fclose(f);
+            return -1;
+        }
+        visit(r, value, arg);
+    }
+    fclose(f);
+    return 0;
+}
+
+typedef struct {
+    int rank;
+    double* rate;
+    int found;
+} RateLookup;
+
+static void match_rank(int rank, double rate, void* arg) {
+    RateLookup* lookup = (RateLookup*)arg;
+    if (rank == lookup->rank) {
+        *lookup->rate = rate;
+        lookup->found = 1;
+    }
+}
+
+// Looks up this rank's rate in a "rank rate" file; returns 1 if found, 0
+// if the rank has no entry and -1 if the file is unreadable or malformed
+int load_rank_rate(const char* path, int rank, double* rate) {
+    RateLookup lookup = { rank, rate, 0 };
+    if (read_rank_rates(path, match_rank, &lookup) < 0) return -1;
+    return lookup.found;
+}
+
+typedef struct {
+    int ranks;
+    unsigned char* listed;
+} RateCoverage;
+
+static void mark_rank(int rank, double rate, void* arg) {
+    RateCoverage* coverage = (RateCoverage*)arg;
+    (void)rate;
+    if (rank < coverage->ranks) coverage->listed[rank] = 1;
+}
+
+// Ranks in [0, ranks) without an entry, -1 if the file is unreadable or
+// malformed. The lowest such rank goes to *first_missing.
+int load_rates_missing(const char* path, int ranks, int* first_missing) {
+    RateCoverage coverage = { ranks, (unsigned char*)calloc(ranks, 1) };
+    int missing = read_rank_rates(path, mark_rank, &coverage);
+    if (missing == 0) {
+        *first_missing = -1;
+        for (int r = ranks - 1; r >= 0; r--) {
+            if (!coverage.listed[r]) {
+                missing++;
+                *first_missing = r;
+            }
+        }
+    }
+    free(coverage.listed);
+    return missing;
+}
+
+static double exponential(double rate) {
+    return -log(1.0 - rng_uniform(RNG_WORKLOAD)) / rate;
+}
+
+static double diurnal_rate(const LoadSpec* spec, double t) {
+    return spec->rate * (1.0 + spec->amplitude * sin(LOAD_TWO_PI * t / spec->period));
+}
+
+// Offset of the first arrival strictly after 'now' for the configured process
+static double next_arrival_after(LoadGenerator* lg, double now) {
+    const LoadSpec* spec = &lg->spec;
+
+    switch (spec->process) {
+        case LOAD_CONSTANT:
+            return now + 1.0 / spec->rate;
+
+        case LOAD_BURSTY: {
+            // Mean rate is preserved: ON periods run at rate * cycle / on
+            double cycle = spec->on_period + spec->off_period;
+            double on_rate = spec->rate * cycle / spec->on_period;
+            double t = now + exponential(on_rate);
+            double phase = fmod(t, cycle);
+            if (phase >= spec->on_period) {
+                // Landed in an OFF period: restart at the next ON edge
+                double next_on = t - phase + cycle;
+                return next_on + exponential(on_rate);
+            }
+            return t;
+        }
+
+        case LOAD_DIURNAL: {
+            double peak = spec->rate * (1.0 + spec->amplitude);
+            double t = now;
+            for (;;) {
+                t += exponential(peak);
+                if (rng_uniform(RNG_WORKLOAD) * peak <= diurnal_rate(spec, t)) {
+                    return t;
+                }
+            }
+        }
+
+        case LOAD_POISSON:
+        default:
+            return now + exponential(spec->rate);
+    }
+}
+
+LoadGenerator* create_load_generator(const LoadSpec* spec, const Node* node,
+                                     TraceReader* trace, TraceWriter* recorder) {
+    LoadGenerator* lg = (LoadGenerator*)malloc(sizeof(LoadGenerator));
+    lg->spec = *spec;
+    lg->network_size = node->total_nodes;
+    lg->receiver_dist = MAX(parse_receiver_dist(g_params.receiver_dist), RECEIVERS_UNIFORM);
+    lg->zipf_cdf = NULL;
+    if (lg->receiver_dist == RECEIVERS_ZIPF) {
+        lg->zipf_cdf = create_zipf_cdf(lg->network_size, g_params.receiver_zipf);
+    }
+    lg->zones = node->zone_assignments;
+    lg->rank = node->rank;
+    lg->trace = trace;
+    lg->recorder = recorder;
+    lg->capacity = LOAD_BACKLOG_CAPACITY;
+    lg->backlog = (Arrival*)malloc(lg->capacity * sizeof(Arrival));
+    lg->head = 0;
+    lg->count = 0;
+    lg->max_backlog = 0;
+    lg->offered = 0;
+    lg->dispatched = 0;
+    lg->dropped = 0;
+    lg->next_arrival = 0.0;
+    if (spec->process != LOAD_LEGACY && spec->process != LOAD_TRACE) {
+        lg->next_arrival = next_arrival_after(lg, 0.0);
+    }
+    return lg;
+}
+
+void destroy_load_generator(LoadGenerator* lg) {
+    if (!lg) return;
+    free(lg->zipf_cdf);
+    free(lg->backlog);
+    free(lg);
+}
+
+static void enqueue_arrival(LoadGenerator* lg, double arrival, int receiver, double amount) {
+    lg->offered++;
+    if (lg->recorder) {
+        trace_write_event(lg->recorder, arrival, receiver, amount);
+    }
+    if (lg->count >= lg->capacity) {
+        lg->dropped++;
+        return;
+    }
+    Arrival* slot = &lg->backlog[(lg->head + lg->count) % lg->capacity];
+    slot->arrival = arrival;
+    slot->receiver = receiver;
+    slot->amount = amount;
+    lg->count++;
+    if (lg->count > lg->max_backlog) {
+        lg->max_backlog = lg->count;
+    }
+}
+
+// Uniform over all ranks, Zipf-skewed towards low ranks, or uniform over
+// the ranks currently in this rank's zone
+static int draw_receiver(LoadGenerator* lg) {
+    switch (lg->receiver_dist) {
+        case RECEIVERS_ZIPF:
+            return sample_zipf(lg->zipf_cdf, lg->network_size, rng_uniform(RNG_WORKLOAD));
+
+        case RECEIVERS_ZONE: {
+            int zone = lg->zones[lg->rank];
+            int members = 0;
+            for (int r = 0; r < lg->network_size; r++) {
+                members += (lg->zones[r] == zone);
+            }
+            int pick = rng_int(RNG_WORKLOAD, members);
+            for (int r = 0; r < lg->network_size; r++) {
+                if (lg->zones[r] == zone && pick-- == 0) return r;
+            }
+            return lg->rank;
+        }
+
+        default:
+            return rng_int(RNG_WORKLOAD, lg->network_size);
+    }
+}
+
+static void enqueue_random(LoadGenerator* lg, double arrival) {
+    int receiver = draw_receiver(lg);
+    double amount = rng_uniform(RNG_WORKLOAD) * 100.0;
+    enqueue_arrival(lg, arrival, receiver, amount);
+}
+
+// Moves every arrival up to 'offset' into the backlog. Arrivals are
+// generated against the clock, not the loop, so a slow consumer shows
+// up as backlog growth and queueing delay instead of a lower offered rate.
+void loadgen_poll(LoadGenerator* lg, double offset) {
+    switch (lg->spec.process) {
+        case LOAD_LEGACY:
+            if (rng_uniform(RNG_WORKLOAD) < g_params.tx_generation_prob) {
+                enqueue_random(lg, offset);
+            }
+            break;
+
+        case LOAD_TRACE: {
+            const TraceEvent* ev;
+            while (lg->trace && (ev = trace_next_due(lg->trace, offset)) != NULL) {
+                enqueue_arrival(lg, ev->offset, ev->receiver, ev->amount);
+            }
+            break;
+        }
+
+        default:
+            while (lg->next_arrival <= offset) {
+                enqueue_random(lg, lg->next_arrival);
+                lg->next_arrival = next_arrival_after(lg, lg->next_arrival);
+            }
+            break;
+    }
+}
+
+// Pops the oldest pending arrival; returns 0 when the backlog is empty
+int loadgen_next(LoadGenerator* lg, Arrival* out) {
+    if (lg->count == 0) return 0;
+    *out = lg->backlog[lg->head];
+    lg->head = (lg->head + 1) % lg->capacity;
+    lg->count--;
+    lg->dispatched++;
+    return 1;
+}
@@ -2,219 +2,291 @@
 
 #include "common.h"
 #include "node.h"
-#include "transaction.h"
-#include "dag.h"
 #include "zones.h"
-#include "phases.h"
-#include "consensus.h"
 #include "metrics.h"
+#include "trace.h"
+#include "simulation.h"
+#include "sweep.h"
+#include "loadgen.h"
+#include "checkpoint.h"
+#include "witnesses.h"
+#include "des.h"
+#include "probe.h"
+#include "arena.h"
+#include "pbft.h"
+
+static void print_usage(const char* prog) {
+    fprintf(stderr,
+            "Usage: %s [duration] [--seed N] [--record PREFIX] [--replay PREFIX]\n"
+            "          [--load SPEC] [--load-rates FILE]\n"
+            "          [--params FILE] [--set KEY=VALUE] [--sweep FILE] [--sweep-out FILE]\n"
+            "          [--checkpoint FILE] [--restore FILE]\n"
+            "  SPEC: legacy | poisson:R | constant:R | bursty:R:ON:OFF |\n"
+            "        diurnal:R:PERIOD:AMPLITUDE  (R = mean tx/s per rank)\n", prog);
+}
+
+static void usage_error(int rank, const char* prog) {
+    if (rank == 0) print_usage(prog);
+    MPI_Abort(MPI_COMM_WORLD, 2);
+}
 
 int main(int argc, char** argv) {
     int rank, size;
     
-    // Initialize MPI
-    MPI_Init(&argc, &argv);
+    // Initialize MPI; worker threads never call MPI, so FUNNELED is enough
+    int thread_support;
+    MPI_Init_thread(&argc, &argv, MPI_THREAD_FUNNELED, &thread_support);
     MPI_Comm_rank(MPI_COMM_WORLD, &rank);
     MPI_Comm_size(MPI_COMM_WORLD, &size);
+    scratch_init(size);
     
-    // Seed random number generator
-    srand(time(NULL) + rank);
+    int explicit_seed = 0;
+    unsigned long long seed = 0;
+    const char* record_prefix = NULL;
+    const char* replay_prefix = NULL;
+    const char* sweep_path = NULL;
+    const char* sweep_out = "sweep_results.csv";
+    const char* checkpoint_path = NULL;
+    const char* restore_path = NULL;
     
-    // Create node
-    Node* node = create_node(rank, size);
+    // Parameters: config.h defaults, then --params file, then the rest of
+    // the command line in order
+    params_set_defaults(&g_params);
+    for (int i = 1; i + 1 < argc; i++) {
+        if (strcmp(argv[i], "--params") == 0 && !params_load_file(&g_params, argv[i + 1])) {
+            MPI_Abort(MPI_COMM_WORLD, 2);
+        }
+    }
     
-    double experiment_duration = DEFAULT_EXPERIMENT_DURATION;
-    if (rank == 0 && argc > 1) {
-        char* endptr = NULL;
-        double cli_duration = strtod(argv[1], &endptr);
-        if (endptr != argv[1] && cli_duration > 0.0) {
-            experiment_duration = cli_duration;
+    for (int i = 1; i < argc; i++) {
+        int has_value = (i + 1 < argc);
+        if (strcmp(argv[i], "--params") == 0 && has_value) {
+            i++;  // Already loaded
+        } else if (strcmp(argv[i], "--seed") == 0 && has_value) {
+            seed = strtoull(argv[++i], NULL, 10);
+            explicit_seed = 1;
+        } else if (strcmp(argv[i], "--record") == 0 && has_value) {
+            record_prefix = argv[++i];
+        } else if (strcmp(argv[i], "--replay") == 0 && has_value) {
+            replay_prefix = argv[++i];
+        } else if (strcmp(argv[i], "--load") == 0 && has_value) {
+            params_set(&g_params, "load", argv[++i]);
+        } else if (strcmp(argv[i], "--load-rates") == 0 && has_value) {
+            params_set(&g_params, "load_rates", argv[++i]);
+        } else if (strcmp(argv[i], "--set") == 0 && has_value) {
+            char assignment[256];
+            snprintf(assignment, sizeof(assignment), "%s", argv[++i]);
+            char* eq = strchr(assignment, '=');
+            if (!eq) usage_error(rank, argv[0]);
+            *eq = '\0';
+            if (!params_set(&g_params, assignment, eq + 1)) {
+                if (rank == 0) fprintf(stderr, "Error: bad parameter '%s'\n", argv[i]);
+                MPI_Abort(MPI_COMM_WORLD, 2);
+            }
+        } else if (strcmp(argv[i], "--sweep") == 0 && has_value) {
+            sweep_path = argv[++i];
+        } else if (strcmp(argv[i], "--sweep-out") == 0 && has_value) {
+            sweep_out = argv[++i];
+        } else if (strcmp(argv[i], "--checkpoint") == 0 && has_value) {
+            checkpoint_path = argv[++i];
+        } else if (strcmp(argv[i], "--restore") == 0 && has_value) {
+            restore_path = argv[++i];
+        } else if (argv[i][0] == '-' && argv[i][1] == '-') {
+            usage_error(rank, argv[0]);
         } else {
-            fprintf(stderr,
-                    "Warning: invalid duration input '%s'. Using default %.2f seconds.\n",
-                    argv[1], experiment_duration);
+            char* endptr = NULL;
+            double cli_duration = strtod(argv[i], &endptr);
+            if (endptr != argv[i] && cli_duration > 0.0) {
+                g_params.duration = cli_duration;
+            } else if (rank == 0) {
+                fprintf(stderr,
+                        "Warning: invalid duration input '%s'. Using default %.2f seconds.\n",
+                        argv[i], g_params.duration);
+            }
         }
     }
-    MPI_Bcast(&experiment_duration, 1, MPI_DOUBLE, 0, MPI_COMM_WORLD);
+    MPI_Bcast(&g_params.duration, 1, MPI_DOUBLE, 0, MPI_COMM_WORLD);
     
-    if (rank == 0) {
-        printf("=== ASTP Blockchain Simulator ===\n");
-        printf("Nodes: %d\n", size);
-        printf("Duration: %.0f seconds\n", experiment_duration);
-        printf("==================================\n\n");
+    // Sweeps repeat these for every configuration
+    if (!params_check(&g_params, rank == 0, restore_path != NULL)) {
+        usage_error(rank, argv[0]);
     }
     
-    // Assign geography and exchange latencies
-    assign_geography(node);
-    exchange_latencies(node);
-    
-    // Form zones
-    form_zones(node, MAX_ZONES);
-    create_zone_communicator(node);
-    
-    // Synchronize to ensure all zone info is printed before continuing
-    MPI_Barrier(MPI_COMM_WORLD);
-    
-    // Create local DAG
-    DAG* dag = create_dag(MAX_TRANSACTIONS);
-    
-    // Create sliding window for phase detection
-    SlidingWindow* window = create_window(WINDOW_SIZE * 100);
-    
-    // Create metrics tracker
-    Metrics* metrics = create_metrics();
-    metrics->start_time = MPI_Wtime();
-    
-    if (rank == 0) {
-        printf("Initialization complete. Starting simulation...\n\n");
+    // Each rank reads its own rate in run_simulation(); rank 0 checks the
+    // whole file first so a bad one fails the run instead of skewing it
+    if (g_params.load_rates[0] != '\0' && g_params.des_nodes <= 0) {
+        int result[2] = { 0, -1 };
+        if (rank == 0) {
+            result[0] = load_rates_missing(g_params.load_rates, size, &result[1]);
+        }
+        MPI_Bcast(result, 2, MPI_INT, 0, MPI_COMM_WORLD);
+        if (result[0] < 0) {
+            if (rank == 0) fprintf(stderr, "Error: cannot use --load-rates '%s'\n", g_params.load_rates);
+            usage_error(rank, argv[0]);
+        }
+        if (result[0] > 0 && rank == 0) {
+            fprintf(stderr, "Warning: %d ranks (first: %d) have no entry in '%s'; they run at "
+                            "the global rate\n", result[0], result[1], g_params.load_rates);
+        }
     }
     
-    // Main simulation loop
-    double end_time = metrics->start_time + experiment_duration;
-    double shutdown_time = end_time - 0.3; // Stop generating new txs 300ms before end
-    double process_time = end_time - 0.1; // Stop processing received txs 100ms before end
-    int tx_counter = 0;
+    if (sweep_path && (record_prefix || replay_prefix)) {
+        if (rank == 0) fprintf(stderr, "Error: --sweep cannot be combined with --record/--replay\n");
+        MPI_Abort(MPI_COMM_WORLD, 2);
+    }
+    if (sweep_path && (checkpoint_path || restore_path)) {
+        if (rank == 0) fprintf(stderr, "Error: --sweep cannot be combined with --checkpoint/--restore\n");
+        MPI_Abort(MPI_COMM_WORLD, 2);
+    }
+    if (restore_path && replay_prefix) {
+        if (rank == 0) fprintf(stderr, "Error: --restore cannot be combined with --replay\n");
+        MPI_Abort(MPI_COMM_WORLD, 2);
+    }
     
-    while (MPI_Wtime() < end_time) {
-        double current_time = MPI_Wtime();
-        int can_generate = (current_time < shutdown_time);
-        int can_process = (current_time < process_time);
-        
-        // Detect phase
-        int old_phase = node->phase;
-        node->phase = detect_phase(node, window, current_time);
-        if (node->phase != old_phase && rank == 0) {
-            printf("[%.2fs] Phase transition: %d -> %d\n", 
-                   current_time - metrics->start_time, old_phase, node->phase);
-        }
-        
-        // Generate transaction probabilistically (stop before shutdown_time)
-        if (can_generate && rand_double() < TX_GENERATION_PROB) {
-            int* parents = get_latest_transactions(dag, 2);
-            
-            Transaction tx = create_transaction(
-                rank,
-                rand() % size,
-                rand_double() * 100.0,
-                parents,
-                node->zone_id,
-                node->phase
-            );
-            
-            tx.tx_id = tx_counter++;
-            tx.timestamp = current_time;
-            
-            free(parents);
-            
-            // Broadcast to zone
-            broadcast_transaction(&tx, node->zone_comm);
-            
-            // Add to local DAG
-            add_transaction(dag, &tx);
-            add_timestamp(window, current_time);
-            node->total_tx_count++;
-            
-            // Execute consensus (only if we're still processing)
-            if (can_process) {
-                int algorithm = get_consensus_algorithm(node, node->phase);
-                int result = execute_consensus(&tx, node, dag, algorithm);
-                
-                // Record metrics
-                record_transaction(metrics);
-                if (result) {
-                    record_finalization(metrics, tx.timestamp);
-                }
-            } else {
-                // Just record the transaction without consensus
-                record_transaction(metrics);
-            }
-        }
-        
-        // Receive transactions from others (only process if can_process)
-        Transaction received_tx;
-        while (receive_transaction(&received_tx, node->zone_comm)) {
-            if (can_process) {
-                add_transaction(dag, &received_tx);
-                add_timestamp(window, current_time);
-                node->affinity_counts[received_tx.sender]++;
-                node->total_tx_count++;
-            }
-            // If can't process, just drain the message
+    SweepGrid* grid = NULL;
+    if (sweep_path) {
+        grid = (SweepGrid*)malloc(sizeof(SweepGrid));
+        if (!sweep_load(grid, sweep_path)) {
+            MPI_Abort(MPI_COMM_WORLD, 2);
         }
-
-        
-        // Update DAG weights periodically
-        if ((int)(current_time * 10) % 10 == 0) {
-            update_weights(dag);
+    }
+    
+    // Open the replay trace first: it carries the seed of the recorded run
+    TraceReader* replay = NULL;
+    if (replay_prefix) {
+        replay = trace_reader_open(replay_prefix, rank, size);
+        if (!replay) {
+            MPI_Abort(MPI_COMM_WORLD, 1);
         }
-        
-        // Zone rebalancing (every 300 seconds)
-        static double last_rebalance = 0;
-        if (current_time - last_rebalance > ZONE_REBALANCE_INTERVAL) {
-            form_zones(node, MAX_ZONES);
-            last_rebalance = current_time;
+        seed = replay->header->seed;
+    } else if (!explicit_seed) {
+        seed = (unsigned long long)time(NULL);
+    }
+    // All ranks must agree on the base seed; streams are split per rank
+    MPI_Bcast(&seed, 1, MPI_UNSIGNED_LONG_LONG, 0, MPI_COMM_WORLD);
+    rng_seed(seed, rank);
+    
+    // Discrete-event backend: the whole network runs virtually on rank 0
+    if (g_params.des_nodes > 0) {
+        if (record_prefix || replay || grid || checkpoint_path || restore_path) {
             if (rank == 0) {
-                printf("[%.2fs] Zone rebalancing complete\n", 
-                       current_time - metrics->start_time);
+                fprintf(stderr, "Error: des_nodes cannot be combined with --record/--replay/"
+                                "--sweep/--checkpoint/--restore\n");
             }
+            MPI_Abort(MPI_COMM_WORLD, 2);
         }
-        
-        // Small sleep to prevent busy-waiting
-        usleep(1000);  // 1ms
+        if (rank == 0) {
+            printf("=== ASTP Blockchain Simulator (discrete-event) ===\n");
+            printf("Virtual nodes: %d\n", g_params.des_nodes);
+            printf("Duration: %.0f virtual seconds\n", g_params.duration);
+            printf("Seed: %llu%s\n", seed, explicit_seed ? "" : " (time)");
+            if (size > 1) printf("Note: ranks 1-%d stay idle\n", size - 1);
+            printf("==================================\n");
+            run_des(seed);
+        }
+        scratch_free();
+        MPI_Finalize();
+        return 0;
     }
     
-    metrics->end_time = MPI_Wtime();
-    
-    // Wait a moment to let any in-flight consensus operations (MPI_Allgather) complete
-    // We stopped starting new ones 100ms before end, so give them time to finish
-    usleep(200000); // 200ms - enough time for any in-flight collectives to complete
-    
-    // Drain all pending messages to avoid deadlock from blocking sends
-    // Continue receiving until no more messages arrive for a period
-    Transaction received_tx;
-    int consecutive_empty = 0;
-    const int max_empty_iterations = 100; // Stop after 100 empty checks
+    TraceWriter* recorder = NULL;
+    if (record_prefix) {
+        recorder = trace_writer_open(record_prefix, rank, size, seed);
+        if (!recorder) {
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+    }
     
-    for (int i = 0; i < max_empty_iterations; i++) {
-        if (receive_transaction(&received_tx, node->zone_comm)) {
-            consecutive_empty = 0; // Reset counter if we got a message
-        } else {
-            consecutive_empty++;
-            if (consecutive_empty > 10) {
-                // If we've had 10 consecutive empty checks, likely done
-                break;
-            }
-            usleep(100); // Small sleep between checks
+    // Create node; a restore brings back its geography, latencies, traffic
+    // history, zone layout and RNG positions along with the run state
+    Node* node = create_node(rank, size);
+    RunState restored;
+    double restore_ms = 0.0;
+    if (restore_path) {
+        double t0 = MPI_Wtime();
+        if (!checkpoint_read(restore_path, node, &restored, &seed)) {
+            MPI_Abort(MPI_COMM_WORLD, 1);
         }
+        restore_ms = (MPI_Wtime() - t0) * 1000.0;
     }
     
-    // Final aggressive pass - keep receiving until truly empty
-    while (receive_transaction(&received_tx, node->zone_comm)) {
-        // Just drain, don't process
+    if (rank == 0) {
+        printf("=== ASTP Blockchain Simulator ===\n");
+        printf("Nodes: %d\n", size);
+        printf("Duration: %.0f seconds\n", g_params.duration);
+        printf("Seed: %llu%s\n", seed,
+               restore_path ? " (restored)" :
+               replay ? " (replay)" : (explicit_seed ? "" : " (time)"));
+        printf("==================================\n\n");
     }
     
-    // Synchronize within zone first to ensure all zone communication completes
-    // This barrier will ensure all sends/receives in the zone are done
-    if (node->zone_comm != MPI_COMM_NULL) {
-        MPI_Barrier(node->zone_comm);
+    if (restore_path) {
+        // Skip geography, the latency Allgather and k-means entirely
+        build_witness_table(node);
+        create_zone_communicator(node);
+        if (rank == 0) {
+            printf("Restored %s at t=%.2fs in %.2f ms\n",
+                   restore_path, restored.elapsed, restore_ms);
+        }
+        if (recorder) {
+            trace_write_geography(recorder, node->x, node->y);
+        }
+    } else {
+        // Assign geography and exchange latencies
+        assign_geography(node);
+        if (replay) {
+            node->x = replay->header->x;
+            node->y = replay->header->y;
+        }
+        if (recorder) {
+            trace_write_geography(recorder, node->x, node->y);
+        }
+        exchange_latencies(node);
+        if (g_params.latency_probe) {
+            ProbeStats probe;
+            probe_latencies(node, &probe);
+            probe_report(&probe, node);
+        }
+        
+        // Form zones
+        form_zones(node, g_params.max_zones);
+        create_zone_communicator(node);
     }
     
-    // Then synchronize all ranks globally before printing results
+    // Synchronize to ensure all zone info is printed before continuing
     MPI_Barrier(MPI_COMM_WORLD);
     
     if (rank == 0) {
-        printf("\n=== Simulation Complete ===\n");
+        printf("Initialization complete. Starting simulation...\n\n");
     }
     
-    print_metrics(metrics, node);
-    aggregate_metrics(metrics, node);
+    if (grid) {
+        Params base = g_params;
+        run_sweep(node, grid, &base, sweep_out, seed);
+        if (rank == 0) {
+            printf("\n=== Sweep Complete ===\n");
+        }
+        free(grid);
+    } else {
+        SimOptions options = { g_params.duration, replay, recorder,
+                               restore_path ? &restored : NULL, checkpoint_path };
+        Metrics* metrics = run_simulation(node, &options);
+        
+        if (rank == 0) {
+            printf("\n=== Simulation Complete ===\n");
+        }
+        
+        print_metrics(metrics, node);
+        aggregate_metrics(metrics, node);
+        destroy_metrics(metrics);
+    }
     
     // Cleanup
-    destroy_metrics(metrics);
-    destroy_window(window);
-    destroy_dag(dag);
+    trace_writer_close(recorder);
+    trace_reader_close(replay);
     destroy_node(node);
+    scratch_free();
     
     MPI_Finalize();
     return 0;
-}
\ No newline at end of file
+}
@@ -9,6 +9,16 @@ Metrics* create_metrics() {
     metrics->latency_capacity = 10000;
     metrics->latencies = (double*)malloc(metrics->latency_capacity * sizeof(double));
     metrics->latency_count = 0;
+    metrics->queue_delay_sum = 0.0;
+    metrics->queue_delay_max = 0.0;
+    metrics->queued_transactions = 0;
+    metrics->offered_transactions = 0;
+    metrics->dropped_transactions = 0;
+    metrics->cross_zone_finalized = 0;
+    metrics->cross_zone_latency_sum = 0.0;
+    metrics->cross_zone_latency_max = 0.0;
+    metrics->duplicates_dropped = 0;
+    metrics->corrupt_dropped = 0;
     return metrics;
 }
 
@@ -31,6 +41,28 @@ void record_finalization(Metrics* metrics, double creation_time) {
     }
 }
 
+void record_cross_zone_finalization(Metrics* metrics, double creation_time) {
+    metrics->finalized_transactions++;
+    
+    double latency = (MPI_Wtime() - creation_time) * 1000.0;  // Convert to ms
+    metrics->cross_zone_finalized++;
+    metrics->cross_zone_latency_sum += latency;
+    if (latency > metrics->cross_zone_latency_max) {
+        metrics->cross_zone_latency_max = latency;
+    }
+}
+
+void record_queue_delay(Metrics* metrics, double arrival_time, double dispatch_time) {
+    double delay = (dispatch_time - arrival_time) * 1000.0;  // Convert to ms
+    if (delay < 0.0) delay = 0.0;
+    
+    metrics->queued_transactions++;
+    metrics->queue_delay_sum += delay;
+    if (delay > metrics->queue_delay_max) {
+        metrics->queue_delay_max = delay;
+    }
+}
+
 void print_metrics(Metrics* metrics, Node* node) {
     double duration = metrics->end_time - metrics->start_time;
     double tps = (double)metrics->finalized_transactions / duration;
@@ -44,27 +76,90 @@ void print_metrics(Metrics* metrics, Node* node) {
         avg_latency /= metrics->latency_count;
     }
     
-    printf("Node %d: Created %d txs, Finalized %d txs, TPS=%.2f, Avg Latency=%.2f ms\n",
+    printf("Node %d: Created %d txs, Finalized %d txs, TPS=%.2f, Avg Latency=%.2f ms",
            node->rank, metrics->total_transactions, metrics->finalized_transactions,
            tps, avg_latency);
+    if (metrics->cross_zone_finalized > 0) {
+        printf(", Cross-Zone=%d (avg %.2f ms)", metrics->cross_zone_finalized,
+               metrics->cross_zone_latency_sum / metrics->cross_zone_finalized);
+    }
+    if (metrics->duplicates_dropped > 0 || metrics->corrupt_dropped > 0) {
+        printf(", Dropped %ld duplicate/%ld corrupt", metrics->duplicates_dropped,
+               metrics->corrupt_dropped);
+    }
+    printf("\n");
 }
 
-void aggregate_metrics(Metrics* metrics, Node* node) {
-    // Aggregate results to rank 0
-    double my_tps = (double)metrics->finalized_transactions / 
-                    (metrics->end_time - metrics->start_time);
+// Collective over MPI_COMM_WORLD; the result is only meaningful on rank 0
+void summarize_metrics(Metrics* metrics, MetricsSummary* summary) {
+    double duration = metrics->end_time - metrics->start_time;
+    double my_tps = (double)metrics->finalized_transactions / duration;
     
-    double total_tps;
-    int total_finalized;
+    double latency_sum = 0.0;
+    for (int i = 0; i < metrics->latency_count; i++) {
+        latency_sum += metrics->latencies[i];
+    }
+    
+    double sums[12] = {
+        my_tps,
+        (double)metrics->total_transactions,
+        (double)metrics->finalized_transactions,
+        latency_sum,
+        (double)metrics->latency_count,
+        (double)metrics->offered_transactions,
+        (double)metrics->dropped_transactions,
+        metrics->queue_delay_sum,
+        (double)metrics->cross_zone_finalized,
+        metrics->cross_zone_latency_sum,
+        (double)metrics->duplicates_dropped,
+        (double)metrics->corrupt_dropped
+    };
+    double totals[12];
+    double queued = (double)metrics->queued_transactions;
+    double total_queued = 0.0;
     
-    MPI_Reduce(&my_tps, &total_tps, 1, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
-    MPI_Reduce(&metrics->finalized_transactions, &total_finalized, 1, MPI_INT, 
-               MPI_SUM, 0, MPI_COMM_WORLD);
+    double maxima[2] = { metrics->queue_delay_max, metrics->cross_zone_latency_max };
+    double max_totals[2];
+    MPI_Reduce(sums, totals, 12, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
+    MPI_Reduce(&queued, &total_queued, 1, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
+    MPI_Reduce(maxima, max_totals, 2, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+    
+    summary->duration = duration;
+    summary->total_tps = totals[0];
+    summary->total_transactions = (int)totals[1];
+    summary->total_finalized = (int)totals[2];
+    summary->avg_latency_ms = totals[4] > 0 ? totals[3] / totals[4] : 0.0;
+    summary->offered = totals[5];
+    summary->offered_tps = totals[5] / duration;
+    summary->dropped = totals[6];
+    summary->avg_queue_delay_ms = total_queued > 0 ? totals[7] / total_queued : 0.0;
+    summary->max_queue_delay_ms = max_totals[0];
+    summary->cross_zone_finalized = (int)totals[8];
+    summary->avg_cross_zone_latency_ms = totals[8] > 0 ? totals[9] / totals[8] : 0.0;
+    summary->max_cross_zone_latency_ms = max_totals[1];
+    summary->duplicates_dropped = totals[10];
+    summary->corrupt_dropped = totals[11];
+}
+
+void aggregate_metrics(Metrics* metrics, Node* node) {
+    // Aggregate results to rank 0
+    MetricsSummary summary;
+    summarize_metrics(metrics, &summary);
     
     if (node->rank == 0) {
         printf("\n=== AGGREGATE RESULTS ===\n");
-        printf("Total Network TPS: %.2f\n", total_tps);
-        printf("Total Finalized Transactions: %d\n", total_finalized);
+        printf("Total Network TPS: %.2f\n", summary.total_tps);
+        printf("Total Finalized Transactions: %d\n", summary.total_finalized);
+        printf("Offered Load: %.2f tx/s (%.0f arrivals, %.0f dropped)\n",
+               summary.offered_tps, summary.offered, summary.dropped);
+        printf("Queue Delay: avg %.2f ms, max %.2f ms\n",
+               summary.avg_queue_delay_ms, summary.max_queue_delay_ms);
+        printf("Intra-Zone Latency: avg %.2f ms\n", summary.avg_latency_ms);
+        printf("Cross-Zone Latency: avg %.2f ms, max %.2f ms (%d witnessed txs)\n",
+               summary.avg_cross_zone_latency_ms, summary.max_cross_zone_latency_ms,
+               summary.cross_zone_finalized);
+        printf("Received Drops: %.0f duplicate, %.0f corrupt\n",
+               summary.duplicates_dropped, summary.corrupt_dropped);
         printf("========================\n");
     }
-}
\ No newline at end of file
+}
@@ -0,0 +1,67 @@
+// netem.c - Emulated link latency on the receive path
+
+#include "netem.h"
+
+// One-way delay to emulate between this rank and peer, in seconds
+double link_latency(const Node* node, int peer) {
+    if (peer < 0 || peer >= node->total_nodes || peer == node->rank) return 0.0;
+    return g_params.link_delay * node->latencies[peer] / 1000.0;
+}
+
+// NULL when link emulation is disabled
+LinkEmulator* create_link_emulator(double now) {
+    if (g_params.link_delay <= 0.0) return NULL;
+    LinkEmulator* link = (LinkEmulator*)calloc(1, sizeof(LinkEmulator));
+    link->wheel = create_timing_wheel(sizeof(Transaction), g_params.link_tick, now);
+    return link;
+}
+
+void destroy_link_emulator(LinkEmulator* link) {
+    if (!link) return;
+    destroy_timing_wheel(link->wheel);
+    free(link);
+}
+
+// Holds tx until its sender's latency has elapsed since it was created.
+// A tx the transport already delivered late enough comes out on the next
+// link_next().
+void link_hold(LinkEmulator* link, const Node* node, const Transaction* tx, double now) {
+    double due = tx->timestamp + link_latency(node, tx->sender);
+    if (due > now) {
+        link->delayed++;
+        link->hold_sum += due - now;
+    }
+    wheel_schedule(link->wheel, tx, due);
+}
+
+// Next held tx that is due by now. Returns 0 if none is.
+int link_next(LinkEmulator* link, double now, Transaction* tx) {
+    wheel_advance(link->wheel, now);
+    if (!wheel_next(link->wheel, tx)) return 0;
+    link->delivered++;
+    link->delivery_sum += now - tx->timestamp;
+    return 1;
+}
+
+// Collective over MPI_COMM_WORLD: rank 0 prints how long received txs were
+// held and the creation-to-delivery latency they ended up with
+void link_report(LinkEmulator* link, Node* node) {
+    double local[5] = { (double)link->wheel->scheduled, (double)link->delayed,
+                        link->hold_sum, (double)link->delivered, link->delivery_sum };
+    double totals[5];
+    int backlog = link->wheel->max_pending, max_backlog = 0;
+    MPI_Reduce(local, totals, 5, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
+    MPI_Reduce(&backlog, &max_backlog, 1, MPI_INT, MPI_MAX, 0, MPI_COMM_WORLD);
+
+    if (node->rank == 0) {
+        printf("\n=== LINK EMULATION ===\n");
+        printf("Link delay: %.2fx latencies, %.2f ms ticks\n",
+               g_params.link_delay, g_params.link_tick * 1000.0);
+        printf("Received: %.0f txs, %.0f held (avg hold %.2f ms), max %d in flight per rank\n",
+               totals[0], totals[1], totals[1] > 0 ? totals[2] * 1000.0 / totals[1] : 0.0,
+               max_backlog);
+        printf("Delivery latency: avg %.2f ms over %.0f txs\n",
+               totals[3] > 0 ? totals[4] * 1000.0 / totals[3] : 0.0, totals[3]);
+        printf("========================\n");
+    }
+}
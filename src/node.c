@@ -1,30 +1,49 @@
 #include "node.h"
-#include "node.h"
+#include "witnesses.h"
+#include "relay.h"
+#include "hosts.h"
+#include "affinity.h"
 
 Node* create_node(int rank, int size) {
     Node* node = (Node*)malloc(sizeof(Node));
     node->rank = rank;
     node->total_nodes = size;
     node->zone_id = 0;
+    node->zone_assignments = (int*)calloc(size, sizeof(int));
     node->phase = PHASE_NORMAL;
     node->x = 0.0;
     node->y = 0.0;
     node->latencies = (double*)calloc(size, sizeof(double));
-    node->affinity_counts = (int*)calloc(size, sizeof(int));
+    node->affinity = create_affinity_sketch(g_params.affinity_slots, g_params.affinity_half_life);
     node->total_tx_count = 0;
     node->zone_comm = MPI_COMM_NULL;
+    node->witness_table = NULL;
+    node->gateways = NULL;
+    node->hosts = NULL;
+    node->flow = NULL;
     return node;
 }
 
 void destroy_node(Node* node) {
     free(node->latencies);
-    free(node->affinity_counts);
+    destroy_affinity_sketch(node->affinity);
+    free(node->zone_assignments);
     if (node->zone_comm != MPI_COMM_NULL) {
         MPI_Comm_free(&node->zone_comm);
     }
+    destroy_witness_table(node->witness_table);
+    destroy_gateway_map(node->gateways);
+    destroy_host_map(node->hosts);
     free(node);
 }
 
+// Clears per-run traffic state; geography, latencies and zones are kept
+void reset_node_traffic(Node* node) {
+    node->phase = PHASE_NORMAL;
+    node->total_tx_count = 0;
+    affinity_reset(node->affinity, g_params.affinity_half_life);
+}
+
 void assign_geography(Node* node) {
     // Divide nodes into 3 geographic clusters (Asia, Europe, Americas)
     int cluster_size = node->total_nodes / 3;
@@ -39,8 +58,8 @@ void assign_geography(Node* node) {
     if (my_cluster >= 3) my_cluster = 2;
     
     // Add some randomness
-    node->x = centers[my_cluster][0] + (rand() % 50) - 25;
-    node->y = centers[my_cluster][1] + (rand() % 50) - 25;
+    node->x = centers[my_cluster][0] + rng_int(RNG_SYSTEM, 50) - 25;
+    node->y = centers[my_cluster][1] + rng_int(RNG_SYSTEM, 50) - 25;
 }
 
 double calculate_latency(double x1, double y1, double x2, double y2) {
@@ -50,7 +69,7 @@ double calculate_latency(double x1, double y1, double x2, double y2) {
     
     // Convert distance to latency (ms)
     double base_latency = distance * 0.5;
-    double noise = (rand() % 20) - 10;  // ±10ms
+    double noise = rng_int(RNG_SYSTEM, 20) - 10;  // ±10ms
     
     return MAX(base_latency + noise, 1.0);  // Minimum 1ms
 }
@@ -0,0 +1,331 @@
+// params.c - Runtime parameter table and "key = value" loader
+
+#include "common.h"
+#include "params.h"
+#include "loadgen.h"
+#include <ctype.h>
+#include <errno.h>
+#include <float.h>
+#include <limits.h>
+#include <stddef.h>
+
+Params g_params;
+
+typedef enum { PARAM_INT, PARAM_DOUBLE, PARAM_STRING } ParamType;
+
+// Numeric values must lie in [min, max]
+typedef struct {
+    const char* key;
+    ParamType type;
+    size_t offset;
+    double min;
+    double max;
+} ParamField;
+
+#define PARAM_RANGE(name, type, lo, hi) { #name, type, offsetof(Params, name), lo, hi }
+#define PARAM(name, type) PARAM_RANGE(name, type, 0, DBL_MAX)
+
+static const ParamField param_fields[] = {
+    PARAM_RANGE(max_zones, PARAM_INT, 1, DBL_MAX),
+    PARAM(zone_rebalance_interval, PARAM_DOUBLE),
+    PARAM_RANGE(zone_async, PARAM_INT, 0, 1),
+    PARAM(zone_engine, PARAM_STRING),
+    PARAM(zone_knn, PARAM_INT),
+    PARAM(zone_imbalance, PARAM_DOUBLE),
+    PARAM(latency_weight, PARAM_DOUBLE),
+    PARAM(affinity_weight, PARAM_DOUBLE),
+    PARAM(affinity_slots, PARAM_INT),
+    PARAM(affinity_top, PARAM_INT),
+    PARAM(affinity_half_life, PARAM_DOUBLE),
+    PARAM_RANGE(latency_probe, PARAM_INT, 0, 1),
+    PARAM(probe_degree, PARAM_INT),
+    PARAM(probe_repeats, PARAM_INT),
+    PARAM(probe_scale, PARAM_DOUBLE),
+    PARAM(tau_high, PARAM_DOUBLE),
+    PARAM(tau_low, PARAM_DOUBLE),
+    PARAM(hysteresis, PARAM_DOUBLE),
+    PARAM_RANGE(window_size, PARAM_INT, 1, DBL_MAX),
+    PARAM(consecutive_checks, PARAM_INT),
+    PARAM(fv_sample_size, PARAM_INT),
+    PARAM(fv_quorum, PARAM_INT),
+    PARAM(fv_consecutive_rounds, PARAM_INT),
+    PARAM(wd_min_weight, PARAM_INT),
+    PARAM(wd_decay, PARAM_DOUBLE),
+    PARAM_RANGE(ghostdag, PARAM_INT, 0, 1),
+    PARAM(ghostdag_k, PARAM_INT),
+    PARAM_RANGE(bft_quorum, PARAM_DOUBLE, 0, 1),
+    PARAM(bft_timeout, PARAM_DOUBLE),
+    PARAM(bft_mode, PARAM_STRING),
+    PARAM(fault_crash, PARAM_INT),
+    PARAM(fault_byzantine, PARAM_INT),
+    PARAM(fault_slow, PARAM_INT),
+    PARAM(fault_crash_at, PARAM_DOUBLE),
+    PARAM(fault_delay, PARAM_DOUBLE),
+    PARAM(witness_max, PARAM_INT),
+    PARAM(witness_latency, PARAM_DOUBLE),
+    PARAM_RANGE(witness_quorum, PARAM_DOUBLE, 0, 1),
+    PARAM(relay_batch, PARAM_INT),
+    PARAM(relay_interval, PARAM_DOUBLE),
+    PARAM(dedup_capacity, PARAM_INT),
+    PARAM_RANGE(dedup_fp_rate, PARAM_DOUBLE, 1e-9, 1),
+    PARAM(flow_credits, PARAM_INT),
+    PARAM(flow_queue, PARAM_INT),
+    PARAM(flow_batch, PARAM_INT),
+    PARAM(link_delay, PARAM_DOUBLE),
+    PARAM(link_tick, PARAM_DOUBLE),
+    PARAM(max_transactions, PARAM_INT),
+    PARAM_RANGE(tx_generation_prob, PARAM_DOUBLE, 0, 1),
+    PARAM(threads, PARAM_INT),
+    PARAM(dag_log, PARAM_STRING),
+    PARAM(dag_log_commit_every, PARAM_INT),
+    PARAM(dag_log_commit_interval, PARAM_DOUBLE),
+    PARAM(dag_sync, PARAM_INT),
+    PARAM(dag_sync_batch, PARAM_INT),
+    PARAM(checkpoint_interval, PARAM_DOUBLE),
+    PARAM(telemetry, PARAM_STRING),
+    PARAM(telemetry_interval, PARAM_DOUBLE),
+    PARAM_RANGE(shared_dag, PARAM_INT, 0, 1),
+    PARAM(ledger_batch, PARAM_INT),
+    PARAM(ledger_mode, PARAM_STRING),
+    PARAM(ledger_threads, PARAM_INT),
+    PARAM(ledger_accounts, PARAM_INT),
+    PARAM(des_nodes, PARAM_INT),
+    PARAM(des_threads, PARAM_INT),
+    PARAM(des_zone_size, PARAM_INT),
+    PARAM(des_rate, PARAM_DOUBLE),
+    PARAM(duration, PARAM_DOUBLE),
+    PARAM(load, PARAM_STRING),
+    PARAM(load_rates, PARAM_STRING),
+    PARAM(receiver_dist, PARAM_STRING),
+    PARAM(receiver_zipf, PARAM_DOUBLE),
+};
+
+#define PARAM_FIELD_COUNT (int)(sizeof(param_fields) / sizeof(param_fields[0]))
+
+void params_set_defaults(Params* params) {
+    memset(params, 0, sizeof(Params));
+    params->max_zones = MAX_ZONES;
+    params->zone_rebalance_interval = ZONE_REBALANCE_INTERVAL;
+    params->zone_async = ZONE_ASYNC;
+    strcpy(params->zone_engine, ZONE_ENGINE);
+    params->zone_knn = ZONE_KNN;
+    params->zone_imbalance = ZONE_IMBALANCE;
+    params->latency_weight = LATENCY_WEIGHT;
+    params->affinity_weight = AFFINITY_WEIGHT;
+    params->affinity_slots = AFFINITY_SLOTS;
+    params->affinity_top = AFFINITY_TOP;
+    params->affinity_half_life = AFFINITY_HALF_LIFE;
+    params->latency_probe = LATENCY_PROBE;
+    params->probe_degree = PROBE_DEGREE;
+    params->probe_repeats = PROBE_REPEATS;
+    params->probe_scale = PROBE_SCALE;
+    params->tau_high = TAU_HIGH;
+    params->tau_low = TAU_LOW;
+    params->hysteresis = HYSTERESIS;
+    params->window_size = WINDOW_SIZE;
+    params->consecutive_checks = CONSECUTIVE_CHECKS;
+    params->fv_sample_size = FV_SAMPLE_SIZE;
+    params->fv_quorum = FV_QUORUM;
+    params->fv_consecutive_rounds = FV_CONSECUTIVE_ROUNDS;
+    params->wd_min_weight = WD_MIN_WEIGHT;
+    params->wd_decay = WD_DECAY;
+    params->ghostdag = GHOSTDAG;
+    params->ghostdag_k = GHOSTDAG_K;
+    params->bft_quorum = BFT_QUORUM;
+    params->bft_timeout = BFT_TIMEOUT;
+    strcpy(params->bft_mode, BFT_MODE);
+    params->fault_crash = FAULT_CRASH_COUNT;
+    params->fault_byzantine = FAULT_BYZANTINE_COUNT;
+    params->fault_slow = FAULT_SLOW_COUNT;
+    params->fault_crash_at = FAULT_CRASH_AT;
+    params->fault_delay = FAULT_DELAY;
+    params->witness_max = WITNESS_MAX;
+    params->witness_latency = WITNESS_LATENCY_MS;
+    params->witness_quorum = WITNESS_QUORUM;
+    params->relay_batch = RELAY_BATCH;
+    params->relay_interval = RELAY_INTERVAL;
+    params->dedup_capacity = DEDUP_CAPACITY;
+    params->dedup_fp_rate = DEDUP_FP_RATE;
+    params->flow_credits = FLOW_CREDITS;
+    params->flow_queue = FLOW_QUEUE;
+    params->flow_batch = FLOW_BATCH;
+    params->link_delay = LINK_DELAY;
+    params->link_tick = LINK_TICK;
+    params->max_transactions = MAX_TRANSACTIONS;
+    params->tx_generation_prob = TX_GENERATION_PROB;
+    params->threads = WORKER_THREADS;
+    params->dag_log_commit_every = DAG_LOG_COMMIT_EVERY;
+    params->dag_log_commit_interval = DAG_LOG_COMMIT_INTERVAL;
+    params->dag_sync = DAG_SYNC;
+    params->dag_sync_batch = DAG_SYNC_BATCH;
+    strcpy(params->telemetry, TELEMETRY_FILE);
+    params->telemetry_interval = TELEMETRY_INTERVAL;
+    params->checkpoint_interval = CHECKPOINT_INTERVAL;
+    params->shared_dag = SHARED_DAG;
+    params->ledger_batch = LEDGER_BATCH;
+    strcpy(params->ledger_mode, LEDGER_MODE);
+    params->ledger_threads = LEDGER_THREADS;
+    params->ledger_accounts = LEDGER_ACCOUNTS;
+    params->des_nodes = DES_NODES;
+    params->des_threads = DES_THREADS;
+    params->des_zone_size = DES_ZONE_SIZE;
+    params->des_rate = DES_RATE;
+    params->duration = DEFAULT_EXPERIMENT_DURATION;
+    strcpy(params->load, "legacy");
+    strcpy(params->receiver_dist, RECEIVER_DIST);
+    params->receiver_zipf = RECEIVER_ZIPF;
+}
+
+static const ParamField* find_field(const char* key) {
+    for (int i = 0; i < PARAM_FIELD_COUNT; i++) {
+        if (strcmp(param_fields[i].key, key) == 0) {
+            return &param_fields[i];
+        }
+    }
+    return NULL;
+}
+
+// Returns 1 on success, 0 for an unknown key, a malformed value (anything
+// but a whole number or decimal) or one outside the field's range
+int params_set(Params* params, const char* key, const char* value) {
+    const ParamField* field = find_field(key);
+    if (!field) return 0;
+
+    char* base = (char*)params + field->offset;
+    char* endptr = NULL;
+    errno = 0;
+    switch (field->type) {
+        case PARAM_INT: {
+            long v = strtol(value, &endptr, 10);
+            if (endptr == value || *endptr != '\0' || errno == ERANGE) return 0;
+            if (v < field->min || v > field->max || v > INT_MAX) return 0;
+            *(int*)base = (int)v;
+            break;
+        }
+        case PARAM_DOUBLE: {
+            double v = strtod(value, &endptr);
+            if (endptr == value || *endptr != '\0' || errno == ERANGE || !isfinite(v)) return 0;
+            if (v < field->min || v > field->max) return 0;
+            *(double*)base = v;
+            break;
+        }
+        case PARAM_STRING:
+            snprintf(base, PARAMS_STR_LEN, "%s", value);
+            break;
+    }
+    return 1;
+}
+
+static char* trim(char* s) {
+    while (isspace((unsigned char)*s)) s++;
+    char* end = s + strlen(s);
+    while (end > s && isspace((unsigned char)end[-1])) end--;
+    *end = '\0';
+    return s;
+}
+
+// Loads "key = value" lines; '#' starts a comment. Returns 0 on error.
+int params_load_file(Params* params, const char* path) {
+    FILE* f = fopen(path, "r");
+    if (!f) {
+        perror(path);
+        return 0;
+    }
+
+    char line[512];
+    int line_no = 0;
+    int ok = 1;
+    while (fgets(line, sizeof(line), f)) {
+        line_no++;
+        char* hash = strchr(line, '#');
+        if (hash) *hash = '\0';
+        char* text = trim(line);
+        if (*text == '\0') continue;
+
+        char* eq = strchr(text, '=');
+        if (!eq) {
+            fprintf(stderr, "%s:%d: expected 'key = value'\n", path, line_no);
+            ok = 0;
+            continue;
+        }
+        *eq = '\0';
+        char* key = trim(text);
+        char* value = trim(eq + 1);
+        if (!params_set(params, key, value)) {
+            fprintf(stderr, "%s:%d: bad parameter '%s = %s'\n", path, line_no, key, value);
+            ok = 0;
+        }
+    }
+    fclose(f);
+    return ok;
+}
+
+// Formats one parameter's current value; returns 0 for an unknown key
+int params_format(const Params* params, const char* key, char* buf, int len) {
+    const ParamField* field = find_field(key);
+    if (!field) return 0;
+
+    const char* base = (const char*)params + field->offset;
+    switch (field->type) {
+        case PARAM_INT:
+            snprintf(buf, len, "%d", *(const int*)base);
+            break;
+        case PARAM_DOUBLE:
+            snprintf(buf, len, "%g", *(const double*)base);
+            break;
+        case PARAM_STRING:
+            snprintf(buf, len, "%s", base);
+            break;
+    }
+    return 1;
+}
+
+// True if switching from a to b requires forming zones again
+int params_zones_differ(const Params* a, const Params* b) {
+    return a->max_zones != b->max_zones ||
+           a->latency_weight != b->latency_weight ||
+           a->affinity_weight != b->affinity_weight ||
+           strcmp(a->zone_engine, b->zone_engine) != 0 ||
+           a->zone_knn != b->zone_knn ||
+           a->zone_imbalance != b->zone_imbalance;
+}
+
+// Consistency checks between parameters, run by main() and for every sweep
+// configuration. Combinations that cannot run together are downgraded with a
+// warning; an unknown mode or load spec returns 0. Messages are printed only
+// with verbose set, so one rank can speak for all.
+int params_check(Params* params, int verbose, int restore) {
+    int thread_support;
+    MPI_Query_thread(&thread_support);
+    if (params->threads > 0 && thread_support < MPI_THREAD_FUNNELED) {
+        if (verbose) {
+            fprintf(stderr, "Warning: MPI lacks MPI_THREAD_FUNNELED; running single-threaded\n");
+        }
+        params->threads = 0;
+    }
+
+    if (params->shared_dag && (params->threads > 0 || params->dag_log[0] != '\0' || restore)) {
+        if (verbose) {
+            fprintf(stderr, "Warning: shared_dag needs a single-threaded, in-memory DAG "
+                            "without --restore; using private DAGs\n");
+        }
+        params->shared_dag = 0;
+    }
+
+    if (strcmp(params->bft_mode, "collective") != 0 && strcmp(params->bft_mode, "pbft") != 0) {
+        if (verbose) fprintf(stderr, "Error: unknown bft_mode '%s'\n", params->bft_mode);
+        return 0;
+    }
+    int faults = params->fault_crash > 0 || params->fault_byzantine > 0 || params->fault_slow > 0;
+    if (faults && strcmp(params->bft_mode, "pbft") != 0) {
+        if (verbose) fprintf(stderr, "Warning: fault injection needs bft_mode=pbft; using it\n");
+        strcpy(params->bft_mode, "pbft");
+    }
+
+    LoadSpec load;
+    if (!parse_load_spec(params->load, &load)) {
+        if (verbose) fprintf(stderr, "Error: invalid load spec '%s'\n", params->load);
+        return 0;
+    }
+    return 1;
+}
@@ -0,0 +1,589 @@
+// partition.c - Sparse similarity graph and multilevel graph partitioner
+
+#include "partition.h"
+#include "witnesses.h"
+
+typedef struct {
+    int v;
+    int w;
+} GraphEdge;
+
+static ZoneGraph* alloc_graph(int n, int m) {
+    ZoneGraph* graph = (ZoneGraph*)malloc(sizeof(ZoneGraph));
+    graph->n = n;
+    graph->xadj = (int*)calloc(n + 1, sizeof(int));
+    graph->adj = (int*)malloc(MAX(m, 1) * sizeof(int));
+    graph->ewgt = (int*)malloc(MAX(m, 1) * sizeof(int));
+    graph->vwgt = (int*)malloc(MAX(n, 1) * sizeof(int));
+    return graph;
+}
+
+void destroy_zone_graph(ZoneGraph* graph) {
+    if (!graph) return;
+    free(graph->xadj);
+    free(graph->adj);
+    free(graph->ewgt);
+    free(graph->vwgt);
+    free(graph);
+}
+
+static int compare_edges(const void* a, const void* b) {
+    const GraphEdge* x = (const GraphEdge*)a;
+    const GraphEdge* y = (const GraphEdge*)b;
+    return (x->v > y->v) - (x->v < y->v);
+}
+
+// Undirected graph of n unit-weight vertices from an edge list. Each edge
+// is added in both directions; of repeated edges the heaviest is kept.
+// Self loops and out-of-range endpoints are ignored.
+ZoneGraph* graph_from_edges(int n, int n_edges, const int* src, const int* dst, const int* weight) {
+    int* start = (int*)calloc(n + 1, sizeof(int));
+    for (int e = 0; e < n_edges; e++) {
+        int s = src[e], d = dst[e];
+        if (s == d || s < 0 || d < 0 || s >= n || d >= n) continue;
+        start[s + 1]++;
+        start[d + 1]++;
+    }
+    for (int v = 0; v < n; v++) start[v + 1] += start[v];
+
+    GraphEdge* edges = (GraphEdge*)malloc(MAX(start[n], 1) * sizeof(GraphEdge));
+    int* cursor = (int*)malloc(MAX(n, 1) * sizeof(int));
+    memcpy(cursor, start, n * sizeof(int));
+    for (int e = 0; e < n_edges; e++) {
+        int s = src[e], d = dst[e];
+        if (s == d || s < 0 || d < 0 || s >= n || d >= n) continue;
+        edges[cursor[s]++] = (GraphEdge){ d, weight[e] };
+        edges[cursor[d]++] = (GraphEdge){ s, weight[e] };
+    }
+
+    ZoneGraph* graph = alloc_graph(n, start[n]);
+    int m = 0;
+    for (int v = 0; v < n; v++) {
+        GraphEdge* row = &edges[start[v]];
+        int len = start[v + 1] - start[v];
+        qsort(row, len, sizeof(GraphEdge), compare_edges);
+        graph->xadj[v] = m;
+        for (int i = 0; i < len; i++) {
+            if (m > graph->xadj[v] && graph->adj[m - 1] == row[i].v) {
+                graph->ewgt[m - 1] = MAX(graph->ewgt[m - 1], row[i].w);
+                continue;
+            }
+            graph->adj[m] = row[i].v;
+            graph->ewgt[m] = row[i].w;
+            m++;
+        }
+        graph->vwgt[v] = 1;
+    }
+    graph->xadj[n] = m;
+
+    free(edges);
+    free(cursor);
+    free(start);
+    return graph;
+}
+
+// Similarity of a pair (latency in ms, traffic share) as an integer edge
+// weight of at least 1
+int similarity_edge_weight(double latency, double share) {
+    double norm_latency = MIN(latency / 300.0, 1.0);
+    double similarity = g_params.latency_weight * (1.0 - norm_latency) +
+                        g_params.affinity_weight * share;
+    return 1 + (int)lround(PARTITION_WEIGHT_SCALE * similarity);
+}
+
+// k-NN graph over the gathered compact latency rows, plus an edge from
+// every rank to each traffic partner it shipped
+ZoneGraph* build_knn_graph(int n, const uint16_t* all_latencies,
+                           const AffinityShare* all_top, int top, int knn) {
+    knn = MAX(MIN(knn, n - 1), 0);
+    size_t capacity = (size_t)n * (knn + top);
+    int* src = (int*)malloc(MAX(capacity, 1) * sizeof(int));
+    int* dst = (int*)malloc(MAX(capacity, 1) * sizeof(int));
+    int* weight = (int*)malloc(MAX(capacity, 1) * sizeof(int));
+    int* nearest = (int*)malloc(MAX(knn, 1) * sizeof(int));
+    int n_edges = 0;
+
+    for (int i = 0; i < n; i++) {
+        const uint16_t* lat = &all_latencies[(size_t)i * n];
+
+        // Insertion into a short sorted list; most peers fail the first test
+        int count = 0;
+        for (int j = 0; j < n && knn > 0; j++) {
+            if (j == i || (count == knn && lat[j] >= lat[nearest[count - 1]])) continue;
+            int pos = (count < knn) ? count++ : count - 1;
+            while (pos > 0 && lat[nearest[pos - 1]] > lat[j]) {
+                nearest[pos] = nearest[pos - 1];
+                pos--;
+            }
+            nearest[pos] = j;
+        }
+        for (int t = 0; t < count; t++) {
+            src[n_edges] = i;
+            dst[n_edges] = nearest[t];
+            weight[n_edges++] = similarity_edge_weight(lat[nearest[t]] / WITNESS_LATENCY_SCALE, 0.0);
+        }
+
+        for (int t = 0; t < top; t++) {
+            const AffinityShare* share = &all_top[(size_t)i * top + t];
+            if (share->peer < 0 || share->peer >= n || share->peer == i) continue;
+            src[n_edges] = i;
+            dst[n_edges] = share->peer;
+            weight[n_edges++] = similarity_edge_weight(lat[share->peer] / WITNESS_LATENCY_SCALE,
+                                                       share->share);
+        }
+    }
+
+    ZoneGraph* graph = graph_from_edges(n, n_edges, src, dst, weight);
+    free(src);
+    free(dst);
+    free(weight);
+    free(nearest);
+    return graph;
+}
+
+long graph_edge_cut(const ZoneGraph* graph, const int* part) {
+    long cut = 0;
+    for (int v = 0; v < graph->n; v++) {
+        for (int e = graph->xadj[v]; e < graph->xadj[v + 1]; e++) {
+            if (part[v] != part[graph->adj[e]]) cut += graph->ewgt[e];
+        }
+    }
+    return cut / 2;
+}
+
+// ------------------------------------------------------------------
+// Coarsening
+// ------------------------------------------------------------------
+
+static int random_below(Rng* rng, int n) {
+    return (int)(rng_next_u64(rng) % (uint64_t)n);
+}
+
+// Heavy-edge matching in random order: each vertex pairs with the
+// unmatched neighbor it shares its heaviest edge with, unless the pair
+// would outweigh max_vwgt. cmap[v] receives v's coarse vertex.
+static ZoneGraph* coarsen(const ZoneGraph* graph, Rng* rng, int max_vwgt, int* cmap) {
+    int n = graph->n;
+    int* match = (int*)malloc(n * sizeof(int));
+    int* order = (int*)malloc(n * sizeof(int));
+    for (int v = 0; v < n; v++) {
+        match[v] = -1;
+        order[v] = v;
+    }
+    for (int i = n - 1; i > 0; i--) {
+        int j = random_below(rng, i + 1);
+        int tmp = order[i];
+        order[i] = order[j];
+        order[j] = tmp;
+    }
+
+    for (int k = 0; k < n; k++) {
+        int v = order[k];
+        if (match[v] >= 0) continue;
+        int best = -1, best_weight = 0;
+        for (int e = graph->xadj[v]; e < graph->xadj[v + 1]; e++) {
+            int u = graph->adj[e];
+            if (match[u] < 0 && graph->ewgt[e] > best_weight &&
+                graph->vwgt[v] + graph->vwgt[u] <= max_vwgt) {
+                best = u;
+                best_weight = graph->ewgt[e];
+            }
+        }
+        match[v] = (best >= 0) ? best : v;
+        if (best >= 0) match[best] = v;
+    }
+
+    int nc = 0;
+    int* first = order;  // Reused: first fine member of each coarse vertex
+    for (int v = 0; v < n; v++) cmap[v] = -1;
+    for (int v = 0; v < n; v++) {
+        if (cmap[v] >= 0) continue;
+        cmap[v] = cmap[match[v]] = nc;
+        first[nc++] = v;
+    }
+
+    // Edges to the same coarse neighbor are summed through slot[]
+    ZoneGraph* coarse = alloc_graph(nc, graph->xadj[n]);
+    int* slot = (int*)malloc(MAX(nc, 1) * sizeof(int));
+    for (int c = 0; c < nc; c++) slot[c] = -1;
+    int m = 0;
+    for (int c = 0; c < nc; c++) {
+        int members[2] = { first[c], match[first[c]] };
+        int n_members = (members[0] == members[1]) ? 1 : 2;
+        coarse->xadj[c] = m;
+        coarse->vwgt[c] = 0;
+        for (int i = 0; i < n_members; i++) {
+            int v = members[i];
+            coarse->vwgt[c] += graph->vwgt[v];
+            for (int e = graph->xadj[v]; e < graph->xadj[v + 1]; e++) {
+                int w = cmap[graph->adj[e]];
+                if (w == c) continue;
+                if (slot[w] < 0) {
+                    slot[w] = m;
+                    coarse->adj[m] = w;
+                    coarse->ewgt[m++] = graph->ewgt[e];
+                } else {
+                    coarse->ewgt[slot[w]] += graph->ewgt[e];
+                }
+            }
+        }
+        for (int e = coarse->xadj[c]; e < m; e++) slot[coarse->adj[e]] = -1;
+    }
+    coarse->xadj[nc] = m;
+
+    free(slot);
+    free(match);
+    free(order);
+    return coarse;
+}
+
+// ------------------------------------------------------------------
+// Bisection refinement
+// ------------------------------------------------------------------
+
+typedef struct {
+    int gain;
+    int v;
+} GainEntry;
+
+// Max-heap of move gains. Entries are not updated in place: a changed
+// gain is pushed again and stale entries are skipped when they surface.
+typedef struct {
+    GainEntry* items;
+    int count;
+    int capacity;
+} GainHeap;
+
+static void gain_push(GainHeap* heap, int gain, int v) {
+    if (heap->count == heap->capacity) {
+        heap->capacity = heap->capacity ? 2 * heap->capacity : 64;
+        heap->items = (GainEntry*)realloc(heap->items, heap->capacity * sizeof(GainEntry));
+    }
+    int i = heap->count++;
+    while (i > 0 && heap->items[(i - 1) / 2].gain < gain) {
+        heap->items[i] = heap->items[(i - 1) / 2];
+        i = (i - 1) / 2;
+    }
+    heap->items[i] = (GainEntry){ gain, v };
+}
+
+static void gain_pop(GainHeap* heap) {
+    GainEntry last = heap->items[--heap->count];
+    int i = 0;
+    for (;;) {
+        int child = 2 * i + 1;
+        if (child >= heap->count) break;
+        if (child + 1 < heap->count && heap->items[child + 1].gain > heap->items[child].gain) child++;
+        if (heap->items[child].gain <= last.gain) break;
+        heap->items[i] = heap->items[child];
+        i = child;
+    }
+    if (heap->count > 0) heap->items[i] = last;
+}
+
+// Per-bisection scratch, sized for the finest graph
+typedef struct {
+    int* gain;                   // Cut reduction if the vertex changes side
+    unsigned char* locked;
+    int* moves;
+    GainHeap heaps[2];
+} Workspace;
+
+// Valid top of a side's heap: a vertex still on that side, unlocked, with
+// the gain it was pushed with. Returns -1 if the heap runs dry.
+static int gain_top(GainHeap* heap, const Workspace* ws, const int* part, int side) {
+    while (heap->count > 0) {
+        GainEntry top = heap->items[0];
+        if (part[top.v] == side && !ws->locked[top.v] && ws->gain[top.v] == top.gain) return top.v;
+        gain_pop(heap);
+    }
+    return -1;
+}
+
+static long compute_gains(const ZoneGraph* graph, const int* part, Workspace* ws) {
+    long cut = 0;
+    for (int v = 0; v < graph->n; v++) {
+        int gain = 0;
+        for (int e = graph->xadj[v]; e < graph->xadj[v + 1]; e++) {
+            gain += (part[graph->adj[e]] != part[v]) ? graph->ewgt[e] : -graph->ewgt[e];
+            if (part[graph->adj[e]] != part[v]) cut += graph->ewgt[e];
+        }
+        ws->gain[v] = gain;
+    }
+    return cut / 2;
+}
+
+static long excess_weight(const long* weight, const long* max_weight) {
+    return MAX(weight[0] - max_weight[0], 0) + MAX(weight[1] - max_weight[1], 0);
+}
+
+// Moves v to the other side and updates its neighbors' gains
+static void move_vertex(const ZoneGraph* graph, Workspace* ws, int* part, int v, int push) {
+    part[v] ^= 1;
+    ws->gain[v] = -ws->gain[v];
+    for (int e = graph->xadj[v]; e < graph->xadj[v + 1]; e++) {
+        int u = graph->adj[e];
+        ws->gain[u] += (part[u] == part[v]) ? -2 * graph->ewgt[e] : 2 * graph->ewgt[e];
+        if (push && !ws->locked[u]) gain_push(&ws->heaps[part[u]], ws->gain[u], u);
+    }
+}
+
+// Fiduccia-Mattheyses passes. Each pass moves boundary vertices one at a
+// time, highest gain first from a side that can give one up, locks them,
+// and then rolls back to the best prefix: least balance excess, then
+// least cut. Stops when a pass finds nothing better.
+static void fm_refine(const ZoneGraph* graph, int* part, const long* max_weight, Workspace* ws) {
+    int n = graph->n;
+    long weight[2] = { 0, 0 };
+    for (int v = 0; v < n; v++) weight[part[v]] += graph->vwgt[v];
+    int patience = MAX(32, n / 64);
+
+    for (int pass = 0; pass < PARTITION_FM_PASSES; pass++) {
+        long cut = compute_gains(graph, part, ws);
+        for (int s = 0; s < 2; s++) ws->heaps[s].count = 0;
+        for (int v = 0; v < n; v++) {
+            for (int e = graph->xadj[v]; e < graph->xadj[v + 1]; e++) {
+                if (part[graph->adj[e]] != part[v]) {
+                    gain_push(&ws->heaps[part[v]], ws->gain[v], v);
+                    break;
+                }
+            }
+        }
+
+        long best_cut = cut, best_excess = excess_weight(weight, max_weight);
+        int n_moves = 0, best_moves = 0, stalled = 0;
+        for (;;) {
+            int candidate[2];
+            for (int s = 0; s < 2; s++) candidate[s] = gain_top(&ws->heaps[s], ws, part, s);
+
+            // An overweight side must give; otherwise the better feasible move
+            int from = -1;
+            if (weight[0] > max_weight[0]) {
+                from = candidate[0] >= 0 ? 0 : -1;
+            } else if (weight[1] > max_weight[1]) {
+                from = candidate[1] >= 0 ? 1 : -1;
+            } else {
+                for (int s = 0; s < 2; s++) {
+                    int v = candidate[s];
+                    if (v < 0 || weight[s ^ 1] + graph->vwgt[v] > max_weight[s ^ 1]) continue;
+                    if (from < 0 || ws->gain[v] > ws->gain[candidate[from]]) from = s;
+                }
+            }
+            if (from < 0) break;
+
+            int v = candidate[from];
+            gain_pop(&ws->heaps[from]);
+            cut -= ws->gain[v];
+            weight[from] -= graph->vwgt[v];
+            weight[from ^ 1] += graph->vwgt[v];
+            ws->locked[v] = 1;
+            move_vertex(graph, ws, part, v, 1);
+            ws->moves[n_moves++] = v;
+
+            long excess = excess_weight(weight, max_weight);
+            if (excess < best_excess || (excess == best_excess && cut < best_cut)) {
+                best_cut = cut;
+                best_excess = excess;
+                best_moves = n_moves;
+                stalled = 0;
+            } else if (++stalled > patience) {
+                break;
+            }
+        }
+
+        for (int i = n_moves - 1; i >= best_moves; i--) {
+            int v = ws->moves[i];
+            weight[part[v]] -= graph->vwgt[v];
+            weight[part[v] ^ 1] += graph->vwgt[v];
+            part[v] ^= 1;
+        }
+        for (int i = 0; i < n_moves; i++) ws->locked[ws->moves[i]] = 0;
+        if (best_moves == 0) break;
+    }
+}
+
+// Greedy graph growing: side 0 starts from a random seed and absorbs the
+// boundary vertex that adds the least cut until it reaches target0
+static void grow_bisection(const ZoneGraph* graph, long target0, Rng* rng, int* part,
+                           Workspace* ws) {
+    int n = graph->n;
+    for (int v = 0; v < n; v++) part[v] = 1;
+    compute_gains(graph, part, ws);
+    GainHeap* frontier = &ws->heaps[1];
+    frontier->count = 0;
+
+    long weight0 = 0;
+    while (weight0 < target0) {
+        int v = gain_top(frontier, ws, part, 1);
+        if (v < 0) {
+            // Start a new region (first vertex, or a disconnected part)
+            int start = random_below(rng, n);
+            for (int i = 0; i < n && part[start] == 0; i++) start = (start + 1) % n;
+            if (part[start] == 0) break;
+            v = start;
+        } else {
+            gain_pop(frontier);
+        }
+        weight0 += graph->vwgt[v];
+        move_vertex(graph, ws, part, v, 0);
+        for (int e = graph->xadj[v]; e < graph->xadj[v + 1]; e++) {
+            int u = graph->adj[e];
+            if (part[u] == 1) gain_push(frontier, ws->gain[u], u);
+        }
+    }
+}
+
+static long total_vertex_weight(const ZoneGraph* graph) {
+    long total = 0;
+    for (int v = 0; v < graph->n; v++) total += graph->vwgt[v];
+    return total;
+}
+
+// Splits graph into side 0 of weight about target0 and side 1
+static void multilevel_bisect(const ZoneGraph* graph, long target0, const long* max_weight,
+                              Rng* rng, int* part, Workspace* ws) {
+    ZoneGraph* levels[64];
+    int* cmaps[64];
+    int depth = 0;
+    levels[0] = (ZoneGraph*)graph;
+    int max_vwgt = (int)MAX(1, 3 * total_vertex_weight(graph) / (2 * PARTITION_COARSEST));
+    while (levels[depth]->n > PARTITION_COARSEST && depth < 63) {
+        int* cmap = (int*)malloc(levels[depth]->n * sizeof(int));
+        ZoneGraph* coarse = coarsen(levels[depth], rng, max_vwgt, cmap);
+        if (coarse->n > levels[depth]->n * 95 / 100) {
+            destroy_zone_graph(coarse);
+            free(cmap);
+            break;
+        }
+        cmaps[depth] = cmap;
+        levels[++depth] = coarse;
+    }
+
+    // Best of several grown bisections of the coarsest graph
+    ZoneGraph* coarsest = levels[depth];
+    int* current = (int*)malloc(MAX(coarsest->n, 1) * sizeof(int));
+    int* trial = (int*)malloc(MAX(coarsest->n, 1) * sizeof(int));
+    long best_cut = -1, best_excess = 0;
+    for (int t = 0; t < PARTITION_INITIAL_TRIES; t++) {
+        grow_bisection(coarsest, target0, rng, trial, ws);
+        fm_refine(coarsest, trial, max_weight, ws);
+        long weight[2] = { 0, 0 };
+        for (int v = 0; v < coarsest->n; v++) weight[trial[v]] += coarsest->vwgt[v];
+        long excess = excess_weight(weight, max_weight);
+        long cut = graph_edge_cut(coarsest, trial);
+        if (best_cut < 0 || excess < best_excess || (excess == best_excess && cut < best_cut)) {
+            best_cut = cut;
+            best_excess = excess;
+            memcpy(current, trial, coarsest->n * sizeof(int));
+        }
+    }
+    free(trial);
+
+    // Project back up, refining at every level
+    for (int d = depth - 1; d >= 0; d--) {
+        int* finer = (int*)malloc(levels[d]->n * sizeof(int));
+        for (int v = 0; v < levels[d]->n; v++) finer[v] = current[cmaps[d][v]];
+        fm_refine(levels[d], finer, max_weight, ws);
+        free(current);
+        free(cmaps[d]);
+        destroy_zone_graph(levels[d + 1]);
+        current = finer;
+    }
+    memcpy(part, current, graph->n * sizeof(int));
+    free(current);
+}
+
+// Subgraph induced by the vertices on `side`; ids maps its vertices back
+static ZoneGraph* induced_subgraph(const ZoneGraph* graph, const int* part, int side,
+                                   const int* ids, int** sub_ids) {
+    int n = graph->n;
+    int* index = (int*)malloc(MAX(n, 1) * sizeof(int));
+    int count = 0, m = 0;
+    for (int v = 0; v < n; v++) {
+        index[v] = (part[v] == side) ? count++ : -1;
+    }
+    for (int v = 0; v < n; v++) {
+        if (part[v] != side) continue;
+        for (int e = graph->xadj[v]; e < graph->xadj[v + 1]; e++) {
+            if (part[graph->adj[e]] == side) m++;
+        }
+    }
+
+    ZoneGraph* sub = alloc_graph(count, m);
+    *sub_ids = (int*)malloc(MAX(count, 1) * sizeof(int));
+    m = 0;
+    for (int v = 0; v < n; v++) {
+        if (part[v] != side) continue;
+        int s = index[v];
+        sub->xadj[s] = m;
+        sub->vwgt[s] = graph->vwgt[v];
+        (*sub_ids)[s] = ids[v];
+        for (int e = graph->xadj[v]; e < graph->xadj[v + 1]; e++) {
+            int u = graph->adj[e];
+            if (part[u] != side) continue;
+            sub->adj[m] = index[u];
+            sub->ewgt[m++] = graph->ewgt[e];
+        }
+    }
+    sub->xadj[count] = m;
+    free(index);
+    return sub;
+}
+
+static void recursive_bisect(const ZoneGraph* graph, const int* ids, int nparts, int first_part,
+                             double eps, Rng* rng, int* out, Workspace* ws) {
+    if (nparts <= 1 || graph->n <= 1) {
+        for (int v = 0; v < graph->n; v++) out[ids[v]] = first_part;
+        return;
+    }
+
+    int parts0 = nparts / 2;
+    long total = total_vertex_weight(graph);
+    long target0 = total * parts0 / nparts;
+    long max_weight[2] = { MAX((long)floor(target0 * (1.0 + eps)), target0),
+                           MAX((long)floor((total - target0) * (1.0 + eps)), total - target0) };
+    int* side = (int*)malloc(graph->n * sizeof(int));
+    multilevel_bisect(graph, target0, max_weight, rng, side, ws);
+
+    for (int s = 0; s < 2; s++) {
+        int* sub_ids;
+        ZoneGraph* sub = induced_subgraph(graph, side, s, ids, &sub_ids);
+        recursive_bisect(sub, sub_ids, s == 0 ? parts0 : nparts - parts0,
+                         s == 0 ? first_part : first_part + parts0, eps, rng, out, ws);
+        destroy_zone_graph(sub);
+        free(sub_ids);
+    }
+    free(side);
+}
+
+// Assigns every vertex a part in [0, nparts) and returns the edge cut.
+// The imbalance budget is spread over the bisection levels.
+long partition_graph(const ZoneGraph* graph, int nparts, double imbalance,
+                     uint64_t seed, int* part) {
+    int n = graph->n;
+    nparts = MAX(nparts, 1);
+    Rng rng;
+    rng_init(&rng, seed, 0, 0);
+
+    int levels = 0;
+    while ((1 << levels) < nparts) levels++;
+    double eps = levels > 0 ? pow(1.0 + MAX(imbalance, 0.0), 1.0 / levels) - 1.0 : 0.0;
+
+    Workspace ws;
+    memset(&ws, 0, sizeof(ws));
+    ws.gain = (int*)malloc(MAX(n, 1) * sizeof(int));
+    ws.locked = (unsigned char*)calloc(MAX(n, 1), 1);
+    ws.moves = (int*)malloc(MAX(n, 1) * sizeof(int));
+    int* ids = (int*)malloc(MAX(n, 1) * sizeof(int));
+    for (int v = 0; v < n; v++) ids[v] = v;
+
+    recursive_bisect(graph, ids, nparts, 0, eps, &rng, part, &ws);
+
+    free(ids);
+    free(ws.gain);
+    free(ws.locked);
+    free(ws.moves);
+    free(ws.heaps[0].items);
+    free(ws.heaps[1].items);
+    return graph_edge_cut(graph, part);
+}
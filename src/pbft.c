@@ -0,0 +1,537 @@
+// pbft.c - Point-to-point BFT voting with view changes
+
+#define _DEFAULT_SOURCE
+
+#include "pbft.h"
+
+int pbft_enabled(void) {
+    return strcmp(g_params.bft_mode, "pbft") == 0 || faults_configured();
+}
+
+static int leader_of(const BftReplica* r, int view) {
+    return view % r->size;
+}
+
+static PbftMessage message(int type, int view, int vote, int origin, const Transaction* tx) {
+    PbftMessage msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.type = type;
+    msg.view = view;
+    msg.vote = vote;
+    msg.origin = origin;
+    if (tx) msg.tx = *tx;
+    return msg;
+}
+
+// ------------------------------------------------------------------
+// Replica state
+// ------------------------------------------------------------------
+
+// Collective over the zone (duplicates zone_comm). NULL unless the
+// point-to-point path is enabled.
+BftReplica* create_bft_replica(Node* node, FaultInjector* faults, double now) {
+    if (!pbft_enabled() || node->zone_comm == MPI_COMM_NULL) return NULL;
+
+    BftReplica* r = (BftReplica*)calloc(1, sizeof(BftReplica));
+    MPI_Comm_dup(node->zone_comm, &r->comm);
+    MPI_Comm_rank(r->comm, &r->rank);
+    MPI_Comm_size(r->comm, &r->size);
+    r->f = (r->size - 1) / 3;
+    r->quorum = (r->size + r->f + 2) / 2;
+    r->words = (r->size + 63) / 64;
+    r->asked = (int*)calloc(r->size, sizeof(int));
+    r->sorted = (int*)malloc(r->size * sizeof(int));
+    r->slots = (PbftInstance*)calloc(PBFT_SLOTS, sizeof(PbftInstance));
+    r->bits = (uint64_t*)calloc((size_t)PBFT_SLOTS * 3 * r->words, sizeof(uint64_t));
+    r->view_since = now;
+    r->last_check = now;
+    r->faults = faults;
+    if (faults && faults->role == FAULT_SLOW) {
+        r->delayed = create_timing_wheel(sizeof(PbftDelayed), g_params.link_tick, now);
+    }
+    return r;
+}
+
+void destroy_bft_replica(BftReplica* r) {
+    if (!r) return;
+    for (int i = 0; i < PBFT_SEND_SLOTS; i++) {
+        if (r->send_used[i]) {
+            MPI_Wait(&r->sends[i].request, MPI_STATUS_IGNORE);
+        }
+    }
+    destroy_timing_wheel(r->delayed);
+    MPI_Comm_free(&r->comm);
+    free(r->asked);
+    free(r->sorted);
+    free(r->slots);
+    free(r->bits);
+    free(r);
+}
+
+// Member bitmaps of an instance: 0 prepared, 1 committed, 2 replied
+static uint64_t* members(BftReplica* r, PbftInstance* inst, int which) {
+    return r->bits + ((size_t)(inst - r->slots) * 3 + which) * r->words;
+}
+
+// Sets the member's bit; 0 if it was set already
+static int mark(uint64_t* bits, int member) {
+    uint64_t bit = 1ULL << (member & 63);
+    if (bits[member >> 6] & bit) return 0;
+    bits[member >> 6] |= bit;
+    return 1;
+}
+
+static uint32_t digest_hash(const uint8_t* digest) {
+    uint32_t h;
+    memcpy(&h, digest, sizeof(h));
+    return h;
+}
+
+static PbftInstance* find(BftReplica* r, const uint8_t* digest) {
+    uint32_t h = digest_hash(digest);
+    for (int i = 0; i < PBFT_PROBE; i++) {
+        PbftInstance* inst = &r->slots[(h + i) & (PBFT_SLOTS - 1)];
+        if (inst->used && memcmp(inst->digest, digest, HASH_DIGEST_BYTES) == 0) return inst;
+    }
+    return NULL;
+}
+
+// Eviction order: free slots, then instances this rank is done with, then
+// the oldest of the rest
+static int eviction_class(const PbftInstance* inst) {
+    if (!inst->used) return 0;
+    return (inst->decided >= 0 && !inst->mine) ? 1 : 2;
+}
+
+// The digest's instance, taking a slot for it if it has none
+static PbftInstance* claim(BftReplica* r, const uint8_t* digest) {
+    PbftInstance* inst = find(r, digest);
+    if (inst) return inst;
+
+    uint32_t h = digest_hash(digest);
+    for (int i = 0; i < PBFT_PROBE; i++) {
+        PbftInstance* candidate = &r->slots[(h + i) & (PBFT_SLOTS - 1)];
+        int c = eviction_class(candidate);
+        if (!inst || c < eviction_class(inst) ||
+            (c == eviction_class(inst) && candidate->since < inst->since)) {
+            inst = candidate;
+        }
+    }
+    if (eviction_class(inst) == 2) {
+        r->expired++;
+        if (inst->decided < 0 && inst->has_tx) r->open--;
+    }
+
+    memset(inst, 0, sizeof(*inst));
+    memset(members(r, inst, 0), 0, 3 * r->words * sizeof(uint64_t));
+    inst->used = 1;
+    memcpy(inst->digest, digest, HASH_DIGEST_BYTES);
+    inst->decided = -1;
+    inst->proposed = -1;
+    inst->view = -1;
+    return inst;
+}
+
+static void hold_tx(BftReplica* r, PbftInstance* inst, const Transaction* tx, int origin,
+                    double now) {
+    if (inst->has_tx) return;
+    inst->has_tx = 1;
+    inst->tx = *tx;
+    inst->origin = origin;
+    inst->since = now;
+    if (inst->decided < 0) r->open++;
+}
+
+// Progress of an earlier view does not count towards a later one
+static void enter_view(BftReplica* r, PbftInstance* inst, int view) {
+    inst->view = view;
+    inst->preprepared = 0;
+    inst->sent_prepare = 0;
+    inst->sent_commit = 0;
+    inst->prepares[0] = inst->prepares[1] = 0;
+    inst->commits[0] = inst->commits[1] = 0;
+    memset(members(r, inst, 0), 0, 2 * r->words * sizeof(uint64_t));
+}
+
+// ------------------------------------------------------------------
+// Sending, with the injected faults
+// ------------------------------------------------------------------
+
+// Slots are reused round-robin, so the one waited on is the oldest send
+static void raw_send(BftReplica* r, int dest, const PbftMessage* msg) {
+    int index = r->next_send;
+    PbftSendSlot* slot = &r->sends[index];
+    if (r->send_used[index]) {
+        MPI_Wait(&slot->request, MPI_STATUS_IGNORE);
+    }
+    slot->msg = *msg;
+    MPI_Isend(&slot->msg, sizeof(PbftMessage), MPI_BYTE, dest, PBFT_TAG, r->comm, &slot->request);
+    r->send_used[index] = 1;
+    r->next_send = (index + 1) % PBFT_SEND_SLOTS;
+    r->sent++;
+}
+
+// A crashed member sends nothing. A Byzantine one tells half the zone the
+// opposite vote and, as leader, proposes them a tx that does not match its
+// digest. A slow one holds every message for its delay.
+static void send_to(BftReplica* r, int dest, const PbftMessage* msg, double now) {
+    FaultInjector* faults = r->faults;
+    if (fault_crashed(faults, now)) {
+        faults->dropped++;
+        return;
+    }
+
+    PbftMessage out = *msg;
+    if (out.type == PBFT_PRE_PREPARE || out.type == PBFT_PREPARE ||
+        out.type == PBFT_COMMIT || out.type == PBFT_REPLY) {
+        if (fault_equivocate(faults, dest)) {
+            if (out.type == PBFT_PRE_PREPARE) {
+                out.tx.amount = -out.tx.amount;
+            } else {
+                out.vote = !out.vote;
+            }
+        }
+    }
+
+    if (r->delayed && !r->draining) {
+        PbftDelayed held = { dest, out };
+        wheel_schedule(r->delayed, &held, now + faults->delay);
+        faults->delayed++;
+        return;
+    }
+    raw_send(r, dest, &out);
+}
+
+// To every member, this rank included
+static void broadcast(BftReplica* r, const PbftMessage* msg, double now) {
+    for (int dest = 0; dest < r->size; dest++) {
+        send_to(r, dest, msg, now);
+    }
+}
+
+// ------------------------------------------------------------------
+// Protocol
+// ------------------------------------------------------------------
+
+static void propose(BftReplica* r, PbftInstance* inst, double now) {
+    if (leader_of(r, r->view) != r->rank || r->requested_view != r->view) return;
+    if (!inst->has_tx || inst->decided >= 0 || inst->proposed == r->view) return;
+    inst->proposed = r->view;
+    PbftMessage msg = message(PBFT_PRE_PREPARE, r->view, 1, inst->origin, &inst->tx);
+    broadcast(r, &msg, now);
+}
+
+static void decide(BftReplica* r, PbftInstance* inst, int vote, double now) {
+    inst->decided = vote;
+    r->open--;
+    r->committed++;
+    PbftMessage msg = message(PBFT_REPLY, r->view, vote, inst->origin, &inst->tx);
+    send_to(r, inst->origin, &msg, now);
+}
+
+// Commits once a quorum prepared the same vote, and decides once a quorum
+// committed it, in the current view only
+static void progress(BftReplica* r, PbftInstance* inst, double now) {
+    if (inst->view != r->view || r->requested_view != r->view || !inst->preprepared) return;
+    if (!inst->sent_commit) {
+        for (int vote = 0; vote < 2; vote++) {
+            if (inst->prepares[vote] >= r->quorum) {
+                inst->sent_commit = 1;
+                PbftMessage msg = message(PBFT_COMMIT, r->view, vote, inst->origin, &inst->tx);
+                broadcast(r, &msg, now);
+                break;
+            }
+        }
+    }
+    if (inst->sent_commit && inst->decided < 0) {
+        for (int vote = 0; vote < 2; vote++) {
+            if (inst->commits[vote] >= r->quorum) {
+                decide(r, inst, vote, now);
+                break;
+            }
+        }
+    }
+}
+
+static void install_view(BftReplica* r, int view, double now) {
+    r->view = view;
+    r->requested_view = view;
+    r->view_since = now;
+    r->view_changes++;
+    if (leader_of(r, view) != r->rank) return;
+
+    PbftMessage msg = message(PBFT_NEW_VIEW, view, 0, r->rank, NULL);
+    broadcast(r, &msg, now);
+    for (int i = 0; i < PBFT_SLOTS; i++) {
+        if (r->slots[i].used) propose(r, &r->slots[i], now);
+    }
+}
+
+static int compare_descending(const void* a, const void* b) {
+    int x = *(const int*)a, y = *(const int*)b;
+    return (x < y) - (x > y);
+}
+
+static void request_view(BftReplica* r, int view, double now);
+
+// A view a quorum has asked for is installed; one that f + 1 members have
+// asked for has at least one correct member behind it, so this rank joins
+static void evaluate_views(BftReplica* r, double now) {
+    memcpy(r->sorted, r->asked, r->size * sizeof(int));
+    qsort(r->sorted, r->size, sizeof(int), compare_descending);
+    int installed = r->sorted[r->quorum - 1];
+    if (installed > r->view) {
+        install_view(r, installed, now);
+    }
+    int joined = r->sorted[r->f];
+    if (joined > r->requested_view) {
+        request_view(r, joined, now);
+    }
+}
+
+static void request_view(BftReplica* r, int view, double now) {
+    if (view <= r->requested_view) return;
+    r->requested_view = view;
+    r->view_since = now;
+    r->asked[r->rank] = MAX(r->asked[r->rank], view);
+    PbftMessage msg = message(PBFT_VIEW_CHANGE, view, 0, r->rank, NULL);
+    broadcast(r, &msg, now);
+    evaluate_views(r, now);
+}
+
+static void on_pre_prepare(BftReplica* r, const PbftMessage* msg, int source, double now) {
+    if (msg->view != r->view || r->requested_view != r->view ||
+        source != leader_of(r, msg->view)) {
+        return;
+    }
+    // A proposal must be the tx its digest names
+    if (!transaction_verify(&msg->tx)) {
+        r->suspicions++;
+        request_view(r, r->view + 1, now);
+        return;
+    }
+
+    PbftInstance* inst = claim(r, msg->tx.digest);
+    hold_tx(r, inst, &msg->tx, msg->origin, now);
+    if (inst->view < msg->view) enter_view(r, inst, msg->view);
+    if (inst->preprepared) return;
+    inst->preprepared = 1;
+    if (!inst->sent_prepare) {
+        inst->sent_prepare = 1;
+        Transaction tx = inst->tx;
+        PbftMessage out = message(PBFT_PREPARE, r->view, validate_transaction(&tx) ? 1 : 0,
+                                  inst->origin, &inst->tx);
+        broadcast(r, &out, now);
+    }
+    progress(r, inst, now);
+}
+
+static void on_vote(BftReplica* r, const PbftMessage* msg, int source, double now) {
+    if (msg->view < r->view) return;
+    PbftInstance* inst = claim(r, msg->tx.digest);
+    if (msg->view < inst->view) return;
+    if (msg->view > inst->view) enter_view(r, inst, msg->view);
+
+    int vote = msg->vote ? 1 : 0;
+    if (msg->type == PBFT_PREPARE) {
+        if (mark(members(r, inst, 0), source)) inst->prepares[vote]++;
+    } else {
+        if (mark(members(r, inst, 1), source)) inst->commits[vote]++;
+    }
+    progress(r, inst, now);
+}
+
+// Origin: f + 1 matching replies include one from a correct member
+static void on_reply(BftReplica* r, const PbftMessage* msg, int source, Metrics* metrics,
+                     double now) {
+    PbftInstance* inst = find(r, msg->tx.digest);
+    if (!inst || !inst->mine) return;
+    int vote = msg->vote ? 1 : 0;
+    if (!mark(members(r, inst, 2), source)) return;
+    if (++inst->replies[vote] < r->f + 1) return;
+
+    inst->mine = 0;
+    if (vote) {
+        r->finalized++;
+        r->latency_sum += now - inst->tx.timestamp;
+        record_finalization(metrics, inst->tx.timestamp);
+        if (r->ledger) ledger_submit(r->ledger, &inst->tx);
+    } else {
+        r->rejected++;
+    }
+}
+
+static void handle(BftReplica* r, const PbftMessage* msg, int source, Metrics* metrics,
+                   double now) {
+    if (fault_crashed(r->faults, now)) return;
+
+    PbftInstance* inst;
+    switch (msg->type) {
+    case PBFT_REQUEST:
+        if (!transaction_verify(&msg->tx)) return;
+        inst = claim(r, msg->tx.digest);
+        hold_tx(r, inst, &msg->tx, msg->origin, now);
+        propose(r, inst, now);
+        break;
+    case PBFT_PRE_PREPARE:
+        on_pre_prepare(r, msg, source, now);
+        break;
+    case PBFT_PREPARE:
+    case PBFT_COMMIT:
+        on_vote(r, msg, source, now);
+        break;
+    case PBFT_REPLY:
+        on_reply(r, msg, source, metrics, now);
+        break;
+    case PBFT_VIEW_CHANGE:
+        r->asked[source] = MAX(r->asked[source], msg->view);
+        evaluate_views(r, now);
+        break;
+    case PBFT_NEW_VIEW:
+        r->asked[source] = MAX(r->asked[source], msg->view);
+        if (source == leader_of(r, msg->view) && msg->view > r->view) {
+            install_view(r, msg->view, now);
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+// A request open for bft_timeout seconds in the current view suspects its
+// leader; a view change open that long moves on to the next view
+static void check_timeouts(BftReplica* r, double now) {
+    double timeout = g_params.bft_timeout;
+    if (r->requested_view != r->view) {
+        if (now - r->view_since > timeout) {
+            request_view(r, r->requested_view + 1, now);
+        }
+        return;
+    }
+    if (r->open == 0) return;
+    for (int i = 0; i < PBFT_SLOTS; i++) {
+        PbftInstance* inst = &r->slots[i];
+        if (inst->used && inst->has_tx && inst->decided < 0 &&
+            now - MAX(inst->since, r->view_since) > timeout) {
+            r->timeouts++;
+            request_view(r, r->view + 1, now);
+            return;
+        }
+    }
+}
+
+// ------------------------------------------------------------------
+// Main-loop interface
+// ------------------------------------------------------------------
+
+// Sends a local tx to the zone for agreement; its finalization is recorded
+// by bft_replica_poll(). Returns 0 if the point-to-point path is disabled.
+int bft_submit(BftReplica* r, Transaction* tx, double now) {
+    if (!r) return 0;
+    PbftInstance* inst = claim(r, tx->digest);
+    hold_tx(r, inst, tx, r->rank, now);
+    inst->mine = 1;
+    r->submitted++;
+    PbftMessage msg = message(PBFT_REQUEST, r->view, 1, r->rank, tx);
+    broadcast(r, &msg, now);
+    return 1;
+}
+
+// Handles every pending protocol message and releases a slow member's held
+// ones that are due. Never blocks on a receive.
+void bft_replica_poll(BftReplica* r, Metrics* metrics, double now) {
+    int flag;
+    MPI_Status status;
+    PbftMessage msg;
+    MPI_Iprobe(MPI_ANY_SOURCE, PBFT_TAG, r->comm, &flag, &status);
+    while (flag) {
+        MPI_Recv(&msg, sizeof(msg), MPI_BYTE, status.MPI_SOURCE, PBFT_TAG, r->comm,
+                 MPI_STATUS_IGNORE);
+        r->received++;
+        handle(r, &msg, status.MPI_SOURCE, metrics, now);
+        MPI_Iprobe(MPI_ANY_SOURCE, PBFT_TAG, r->comm, &flag, &status);
+    }
+
+    if (r->delayed) {
+        PbftDelayed held;
+        wheel_advance(r->delayed, r->draining ? now + r->faults->delay + 1.0 : now);
+        while (wheel_next(r->delayed, &held)) {
+            raw_send(r, held.dest, &held.msg);
+        }
+    }
+
+    if (!r->draining && !fault_crashed(r->faults, now) &&
+        now - r->last_check >= PBFT_CHECK_INTERVAL) {
+        r->last_check = now;
+        check_timeouts(r, now);
+    }
+}
+
+// Collective over the zone: serves until every protocol message sent in
+// it has been received. Held messages go out at once and no view change
+// starts. Own txs still short of replies stay unfinalized.
+void bft_replica_finish(BftReplica* r, Metrics* metrics) {
+    r->draining = 1;
+    while (1) {
+        bft_replica_poll(r, metrics, MPI_Wtime());
+        long outstanding = r->sent - r->received, total = 0;
+        if (r->delayed) outstanding += r->delayed->pending;
+        MPI_Allreduce(&outstanding, &total, 1, MPI_LONG, MPI_SUM, r->comm);
+        if (total == 0) break;
+        usleep(100);
+    }
+}
+
+// Ends a bft_replica_finish() in the middle of a run (a checkpoint cut):
+// messages are delayed and timeouts checked again
+void bft_replica_resume(BftReplica* r) {
+    r->draining = 0;
+}
+
+// Collective over MPI_COMM_WORLD; r is NULL on a rank without a zone
+void bft_replica_report(BftReplica* r, FaultInjector* faults, Node* node, double elapsed) {
+    long local[14] = { 0 };
+    if (r) {
+        long counts[10] = { r->submitted, r->finalized, r->rejected, r->committed, r->timeouts,
+                            r->suspicions, r->sent, r->expired, r->view_changes,
+                            (long)(r->latency_sum * 1e6) };
+        memcpy(local, counts, sizeof(counts));
+    }
+    if (faults) {
+        local[10] = faults->dropped;
+        local[11] = faults->delayed;
+        local[12] = faults->equivocated;
+        local[13] = 1;
+    }
+    long totals[14];
+    MPI_Reduce(local, totals, 14, MPI_LONG, MPI_SUM, 0, MPI_COMM_WORLD);
+
+    // Lowest tolerance and highest view of any zone
+    int local_ext[2] = { r ? -r->f : 0, r ? r->view : 0 };
+    int ext[2];
+    MPI_Reduce(local_ext, ext, 2, MPI_INT, MPI_MAX, 0, MPI_COMM_WORLD);
+
+    if (node->rank == 0) {
+        int faulty = MAX(g_params.fault_crash, 0) + MAX(g_params.fault_byzantine, 0) +
+                     MAX(g_params.fault_slow, 0);
+        printf("\n=== BFT (point-to-point) ===\n");
+        printf("Faulty members per zone: %d (crash %d at %.1fs, byzantine %d, slow %d by %.0f ms); "
+               "smallest zone tolerates f = %d\n",
+               faulty, g_params.fault_crash, g_params.fault_crash_at, g_params.fault_byzantine,
+               g_params.fault_slow, g_params.fault_delay * 1000.0, -ext[0]);
+        printf("Own txs: %ld submitted, %ld finalized, %ld rejected, %ld undecided\n",
+               totals[0], totals[1], totals[2], totals[0] - totals[1] - totals[2]);
+        printf("Finalized: %.2f TPS, avg latency %.2f ms\n",
+               elapsed > 0.0 ? totals[1] / elapsed : 0.0,
+               totals[1] > 0 ? totals[9] / 1e3 / totals[1] : 0.0);
+        printf("Views: up to %d (%ld installs across members), %ld leader timeouts, %ld bad proposals\n",
+               ext[1], totals[8], totals[4], totals[5]);
+        printf("Messages: %ld (%.1f per finalized tx), %ld instances evicted open\n",
+               totals[6], totals[1] > 0 ? (double)totals[6] / totals[1] : 0.0, totals[7]);
+        if (totals[13] > 0) {
+            printf("Faulty ranks: %ld; messages dropped %ld, delayed %ld, equivocated %ld\n",
+                   totals[13], totals[10], totals[11], totals[12]);
+        }
+        printf("========================\n");
+    }
+}
@@ -26,12 +26,12 @@ double calculate_tps(SlidingWindow* window, double current_time) {
     int valid_count = 0;
     
     for (int i = 0; i < window->count; i++) {
-        if (current_time - window->timestamps[i] < WINDOW_SIZE) {
+        if (current_time - window->timestamps[i] < g_params.window_size) {
             valid_count++;
         }
     }
     
-    return (double)valid_count / WINDOW_SIZE;
+    return (double)valid_count / g_params.window_size;
 }
 
 int detect_phase(Node* node, SlidingWindow* window, double current_time) {
@@ -40,18 +40,18 @@ int detect_phase(Node* node, SlidingWindow* window, double current_time) {
     int current_phase = node->phase;
     
     if (current_phase == PHASE_HIGH) {
-        if (tps < TAU_HIGH * (1.0 - HYSTERESIS)) {
-            return (tps > TAU_LOW) ? PHASE_NORMAL : PHASE_LOW;
+        if (tps < g_params.tau_high * (1.0 - g_params.hysteresis)) {
+            return (tps > g_params.tau_low) ? PHASE_NORMAL : PHASE_LOW;
         }
     } else if (current_phase == PHASE_NORMAL) {
-        if (tps > TAU_HIGH * (1.0 + HYSTERESIS)) {
+        if (tps > g_params.tau_high * (1.0 + g_params.hysteresis)) {
             return PHASE_HIGH;
-        } else if (tps < TAU_LOW * (1.0 - HYSTERESIS)) {
+        } else if (tps < g_params.tau_low * (1.0 - g_params.hysteresis)) {
             return PHASE_LOW;
         }
     } else { // PHASE_LOW
-        if (tps > TAU_LOW * (1.0 + HYSTERESIS)) {
-            return (tps > TAU_HIGH) ? PHASE_HIGH : PHASE_NORMAL;
+        if (tps > g_params.tau_low * (1.0 + g_params.hysteresis)) {
+            return (tps > g_params.tau_high) ? PHASE_HIGH : PHASE_NORMAL;
         }
     }
     
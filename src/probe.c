@@ -0,0 +1,235 @@
+// probe.c - Measured RTT latency matrix
+
+#include "probe.h"
+
+static int compare_doubles(const void* a, const void* b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+static double median(double* values, int n) {
+    qsort(values, n, sizeof(double), compare_doubles);
+    return (n % 2) ? values[n / 2] : 0.5 * (values[n / 2 - 1] + values[n / 2]);
+}
+
+// Rounds in a full round-robin tournament among n ranks
+int probe_round_count(int n) {
+    return (n % 2 == 0) ? n - 1 : n;
+}
+
+// Partner of rank in the given round (circle method), or -1 for a bye.
+// Over all rounds every rank meets every other exactly once.
+int probe_partner(int rank, int n, int round) {
+    int m = probe_round_count(n);
+    if (n < 2) return -1;
+    if (rank == m) {
+        // The fixed rank of an even tournament takes the one left over
+        return (int)((long)round * ((m + 1) / 2) % m);
+    }
+    int partner = ((round - rank) % m + m) % m;
+    if (partner == rank) return (n % 2 == 0) ? m : -1;
+    return partner;
+}
+
+// ------------------------------------------------------------------
+// Shortest-path fill
+// ------------------------------------------------------------------
+
+typedef struct {
+    double dist;
+    int v;
+} PathEntry;
+
+static void path_push(PathEntry* heap, int* count, double dist, int v) {
+    int i = (*count)++;
+    while (i > 0 && heap[(i - 1) / 2].dist > dist) {
+        heap[i] = heap[(i - 1) / 2];
+        i = (i - 1) / 2;
+    }
+    heap[i] = (PathEntry){ dist, v };
+}
+
+static PathEntry path_pop(PathEntry* heap, int* count) {
+    PathEntry top = heap[0];
+    PathEntry last = heap[--(*count)];
+    int i = 0;
+    for (;;) {
+        int child = 2 * i + 1;
+        if (child >= *count) break;
+        if (child + 1 < *count && heap[child + 1].dist < heap[child].dist) child++;
+        if (heap[child].dist >= last.dist) break;
+        heap[i] = heap[child];
+        i = child;
+    }
+    if (*count > 0) heap[i] = last;
+    return top;
+}
+
+// Dijkstra from source over the measured pairs; row[j] is the shortest-path
+// RTT to j. Ranks the measured graph does not reach get the largest
+// distance found, so they are never preferred.
+void probe_fill_row(int n, int source, const ProbeEdge* edges, int n_edges, double* row) {
+    int* start = (int*)calloc(n + 1, sizeof(int));
+    for (int e = 0; e < n_edges; e++) {
+        start[edges[e].a + 1]++;
+        start[edges[e].b + 1]++;
+    }
+    for (int v = 0; v < n; v++) start[v + 1] += start[v];
+    int* cursor = (int*)malloc(MAX(n, 1) * sizeof(int));
+    memcpy(cursor, start, n * sizeof(int));
+    int* adj = (int*)malloc(MAX(2 * n_edges, 1) * sizeof(int));
+    double* rtt = (double*)malloc(MAX(2 * n_edges, 1) * sizeof(double));
+    for (int e = 0; e < n_edges; e++) {
+        adj[cursor[edges[e].a]] = edges[e].b;
+        rtt[cursor[edges[e].a]++] = edges[e].rtt;
+        adj[cursor[edges[e].b]] = edges[e].a;
+        rtt[cursor[edges[e].b]++] = edges[e].rtt;
+    }
+
+    // Lazy deletion: a rank may be pushed once per incident edge
+    PathEntry* heap = (PathEntry*)malloc((2 * (size_t)n_edges + 1) * sizeof(PathEntry));
+    int count = 0;
+    for (int v = 0; v < n; v++) row[v] = -1.0;
+    row[source] = 0.0;
+    path_push(heap, &count, 0.0, source);
+    double farthest = 0.0;
+    while (count > 0) {
+        PathEntry top = path_pop(heap, &count);
+        if (top.dist > row[top.v]) continue;
+        farthest = MAX(farthest, top.dist);
+        for (int e = start[top.v]; e < start[top.v + 1]; e++) {
+            double dist = top.dist + rtt[e];
+            if (row[adj[e]] < 0.0 || dist < row[adj[e]]) {
+                row[adj[e]] = dist;
+                path_push(heap, &count, dist, adj[e]);
+            }
+        }
+    }
+    for (int v = 0; v < n; v++) {
+        if (row[v] < 0.0) row[v] = farthest;
+    }
+
+    free(heap);
+    free(rtt);
+    free(adj);
+    free(cursor);
+    free(start);
+}
+
+// ------------------------------------------------------------------
+// Probing
+// ------------------------------------------------------------------
+
+// Replaces node->latencies with measured ones (collective)
+void probe_latencies(Node* node, ProbeStats* stats) {
+    int n = node->total_nodes;
+    int m = probe_round_count(n);
+    int degree = MAX(MIN(g_params.probe_degree, m), 1);
+    int repeats = MAX(g_params.probe_repeats, 1);
+    memset(stats, 0, sizeof(ProbeStats));
+    double t0 = MPI_Wtime();
+
+    // The same rounds on every rank: a partial shuffle with a shared key,
+    // salted with a rank no process has
+    int* rounds = (int*)malloc(MAX(m, 1) * sizeof(int));
+    for (int r = 0; r < m; r++) rounds[r] = r;
+    Rng rng;
+    rng_init(&rng, rng_seed_value(), n, RNG_SYSTEM);
+    for (int i = 0; i < degree && i < m; i++) {
+        int j = i + (int)(rng_next_u64(&rng) % (uint64_t)(m - i));
+        int tmp = rounds[i];
+        rounds[i] = rounds[j];
+        rounds[j] = tmp;
+    }
+
+    MPI_Comm comm;
+    MPI_Comm_dup(MPI_COMM_WORLD, &comm);
+    ProbeEdge* mine = (ProbeEdge*)malloc(MAX(degree, 1) * sizeof(ProbeEdge));
+    double* samples = (double*)malloc(repeats * sizeof(double));
+    char ping = 0;
+    for (int i = 0; i < degree && n > 1; i++) {
+        int peer = probe_partner(node->rank, n, rounds[i]);
+        stats->rounds++;
+        if (peer < 0) continue;
+
+        // Rep -1 warms the connection up and is not timed
+        for (int rep = -1; rep < repeats; rep++) {
+            if (node->rank < peer) {
+                double sent = MPI_Wtime();
+                MPI_Send(&ping, 1, MPI_CHAR, peer, PROBE_TAG, comm);
+                MPI_Recv(&ping, 1, MPI_CHAR, peer, PROBE_TAG, comm, MPI_STATUS_IGNORE);
+                if (rep >= 0) samples[rep] = MPI_Wtime() - sent;
+            } else {
+                MPI_Recv(&ping, 1, MPI_CHAR, peer, PROBE_TAG, comm, MPI_STATUS_IGNORE);
+                MPI_Send(&ping, 1, MPI_CHAR, peer, PROBE_TAG, comm);
+            }
+            stats->messages++;
+        }
+        if (node->rank < peer) {
+            mine[stats->pairs++] = (ProbeEdge){ node->rank, peer, median(samples, repeats) };
+        }
+    }
+
+    // Every rank gets every measured pair
+    int* counts = (int*)malloc(n * sizeof(int));
+    int* displs = (int*)malloc(n * sizeof(int));
+    int bytes = stats->pairs * (int)sizeof(ProbeEdge);
+    MPI_Allgather(&bytes, 1, MPI_INT, counts, 1, MPI_INT, comm);
+    int total = 0;
+    for (int r = 0; r < n; r++) {
+        displs[r] = total;
+        total += counts[r];
+    }
+    ProbeEdge* edges = (ProbeEdge*)malloc(MAX(total, 1));
+    MPI_Allgatherv(mine, bytes, MPI_BYTE, edges, counts, displs, MPI_BYTE, comm);
+    int n_edges = total / (int)sizeof(ProbeEdge);
+
+    double* row = (double*)malloc(n * sizeof(double));
+    probe_fill_row(n, node->rank, edges, n_edges, row);
+    for (int j = 0; j < n; j++) {
+        node->latencies[j] = row[j] / 2.0 * 1000.0 * g_params.probe_scale;
+    }
+    stats->seconds = MPI_Wtime() - t0;
+
+    stats->total_pairs = n_edges;
+    if (n_edges > 0) {
+        double* rtts = (double*)malloc(n_edges * sizeof(double));
+        for (int e = 0; e < n_edges; e++) rtts[e] = edges[e].rtt;
+        stats->median_rtt = median(rtts, n_edges);
+        stats->min_rtt = rtts[0];
+        stats->max_rtt = rtts[n_edges - 1];
+        free(rtts);
+    }
+
+    MPI_Comm_free(&comm);
+    free(row);
+    free(edges);
+    free(displs);
+    free(counts);
+    free(samples);
+    free(mine);
+    free(rounds);
+}
+
+void probe_report(const ProbeStats* stats, Node* node) {
+    double seconds = 0.0;
+    long messages = 0;
+    MPI_Reduce(&stats->seconds, &seconds, 1, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+    MPI_Reduce(&stats->messages, &messages, 1, MPI_LONG, MPI_SUM, 0, MPI_COMM_WORLD);
+
+    if (node->rank == 0) {
+        int n = node->total_nodes;
+        long all_pairs = (long)n * (n - 1) / 2;
+        printf("\n=== LATENCY PROBE ===\n");
+        printf("Rounds: %d of %d, %d pings per pair after a warm-up\n",
+               stats->rounds, probe_round_count(n), MAX(g_params.probe_repeats, 1));
+        printf("Measured: %d of %ld pairs (%.1f%%), the rest by shortest path\n",
+               stats->total_pairs, all_pairs,
+               all_pairs > 0 ? 100.0 * stats->total_pairs / all_pairs : 0.0);
+        printf("Cost: %ld messages, %.2f ms (slowest rank)\n", messages, seconds * 1000.0);
+        printf("RTT: median %.1f us, min %.1f us, max %.1f us\n",
+               stats->median_rtt * 1e6, stats->min_rtt * 1e6, stats->max_rtt * 1e6);
+        printf("Simulated latency: 1 us one-way -> %.2f ms\n", g_params.probe_scale / 1000.0);
+        printf("========================\n\n");
+    }
+}
@@ -0,0 +1,126 @@
+// queue.c - SPSC and MPSC ring queues (C11 atomics)
+
+#include "queue.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+static size_t round_up_pow2(size_t n) {
+    size_t p = 1;
+    while (p < n) p <<= 1;
+    return p;
+}
+
+// ------------------------------------------------------------------
+// SPSC
+// ------------------------------------------------------------------
+
+int spsc_init(SpscRing* ring, size_t capacity, size_t elem_size) {
+    size_t cap = round_up_pow2(capacity < 2 ? 2 : capacity);
+    ring->buffer = (unsigned char*)malloc(cap * elem_size);
+    if (!ring->buffer) return 0;
+    ring->mask = cap - 1;
+    ring->elem_size = elem_size;
+    atomic_init(&ring->head, 0);
+    atomic_init(&ring->tail, 0);
+    return 1;
+}
+
+void spsc_destroy(SpscRing* ring) {
+    free(ring->buffer);
+    ring->buffer = NULL;
+}
+
+// Returns 0 if the ring is full
+int spsc_push(SpscRing* ring, const void* elem) {
+    size_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    size_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+    if (tail - head > ring->mask) return 0;
+
+    memcpy(ring->buffer + (tail & ring->mask) * ring->elem_size, elem, ring->elem_size);
+    atomic_store_explicit(&ring->tail, tail + 1, memory_order_release);
+    return 1;
+}
+
+// Returns 0 if the ring is empty
+int spsc_pop(SpscRing* ring, void* out) {
+    size_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    size_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+    if (head == tail) return 0;
+
+    memcpy(out, ring->buffer + (head & ring->mask) * ring->elem_size, ring->elem_size);
+    atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+    return 1;
+}
+
+size_t spsc_size(SpscRing* ring) {
+    return atomic_load_explicit(&ring->tail, memory_order_acquire) -
+           atomic_load_explicit(&ring->head, memory_order_acquire);
+}
+
+// ------------------------------------------------------------------
+// MPSC
+// ------------------------------------------------------------------
+
+// Each cell is a sequence number followed by the payload
+#define CELL_SEQ(ring, pos) ((atomic_size_t*)((ring)->cells + ((pos) & (ring)->mask) * (ring)->stride))
+#define CELL_DATA(ring, pos) ((ring)->cells + ((pos) & (ring)->mask) * (ring)->stride + sizeof(atomic_size_t))
+
+int mpsc_init(MpscRing* ring, size_t capacity, size_t elem_size) {
+    size_t cap = round_up_pow2(capacity < 2 ? 2 : capacity);
+    size_t stride = sizeof(atomic_size_t) + elem_size;
+    stride = (stride + 7) & ~(size_t)7;
+
+    ring->cells = (unsigned char*)malloc(cap * stride);
+    if (!ring->cells) return 0;
+    ring->mask = cap - 1;
+    ring->elem_size = elem_size;
+    ring->stride = stride;
+    ring->head = 0;
+    atomic_init(&ring->tail, 0);
+    for (size_t i = 0; i < cap; i++) {
+        atomic_init(CELL_SEQ(ring, i), i);
+    }
+    return 1;
+}
+
+void mpsc_destroy(MpscRing* ring) {
+    free(ring->cells);
+    ring->cells = NULL;
+}
+
+// Safe to call from any number of threads; returns 0 if the ring is full
+int mpsc_push(MpscRing* ring, const void* elem) {
+    size_t pos = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    for (;;) {
+        size_t seq = atomic_load_explicit(CELL_SEQ(ring, pos), memory_order_acquire);
+        intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+        if (diff == 0) {
+            if (atomic_compare_exchange_weak_explicit(&ring->tail, &pos, pos + 1,
+                                                      memory_order_relaxed,
+                                                      memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            return 0;  // Full
+        } else {
+            pos = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+        }
+    }
+
+    memcpy(CELL_DATA(ring, pos), elem, ring->elem_size);
+    atomic_store_explicit(CELL_SEQ(ring, pos), pos + 1, memory_order_release);
+    return 1;
+}
+
+// Single consumer only; returns 0 if the ring is empty
+int mpsc_pop(MpscRing* ring, void* out) {
+    size_t pos = ring->head;
+    size_t seq = atomic_load_explicit(CELL_SEQ(ring, pos), memory_order_acquire);
+    if ((intptr_t)seq - (intptr_t)(pos + 1) < 0) return 0;
+
+    memcpy(out, CELL_DATA(ring, pos), ring->elem_size);
+    atomic_store_explicit(CELL_SEQ(ring, pos), pos + ring->mask + 1, memory_order_release);
+    ring->head = pos + 1;
+    return 1;
+}
@@ -0,0 +1,373 @@
+// relay.c - Gateway election, cross-zone batching and fan-out
+
+#define _DEFAULT_SOURCE
+
+#include "relay.h"
+#include "hosts.h"
+
+// ------------------------------------------------------------------
+// Gateway election
+// ------------------------------------------------------------------
+
+// Collective over MPI_COMM_WORLD; call after zone_comm has been created.
+// Each zone picks the member with the lowest average latency to the rest
+// of the zone (MINLOC over zone_comm), then the gateways of all zones are
+// gathered and the gateways get a communicator of their own.
+void elect_gateways(Node* node) {
+    int n = node->total_nodes;
+
+    struct { double score; int rank; } mine, best;
+    double sum = 0.0;
+    int members = 0;
+    for (int j = 0; j < n; j++) {
+        if (j != node->rank && node->zone_assignments[j] == node->zone_id) {
+            sum += node->latencies[j];
+            members++;
+        }
+    }
+    mine.score = members > 0 ? sum / members : 0.0;
+    MPI_Comm_rank(node->zone_comm, &mine.rank);
+    MPI_Allreduce(&mine, &best, 1, MPI_DOUBLE_INT, MPI_MINLOC, node->zone_comm);
+
+    GatewayMap* map = node->gateways;
+    if (map) {
+        free(map->gateways);
+        free(map->gateway_comm_rank);
+        if (map->gateway_comm != MPI_COMM_NULL) MPI_Comm_free(&map->gateway_comm);
+    } else {
+        map = (GatewayMap*)malloc(sizeof(GatewayMap));
+        node->gateways = map;
+    }
+    map->local_gateway = best.rank;
+    map->is_gateway = (mine.rank == best.rank);
+
+    // Every rank reports (zone, is_gateway); gateways fill the zone table
+    int entry[2] = { node->zone_id, map->is_gateway };
+    int* entries = (int*)malloc(2 * n * sizeof(int));
+    MPI_Allgather(entry, 2, MPI_INT, entries, 2, MPI_INT, MPI_COMM_WORLD);
+
+    map->n_zones = 0;
+    for (int i = 0; i < n; i++) {
+        map->n_zones = MAX(map->n_zones, entries[2 * i] + 1);
+    }
+    map->gateways = (int*)malloc(map->n_zones * sizeof(int));
+    map->gateway_comm_rank = (int*)malloc(map->n_zones * sizeof(int));
+    for (int z = 0; z < map->n_zones; z++) {
+        map->gateways[z] = -1;
+        map->gateway_comm_rank[z] = -1;
+    }
+    for (int i = 0; i < n; i++) {
+        if (entries[2 * i + 1]) map->gateways[entries[2 * i]] = i;
+    }
+    free(entries);
+
+    // Gateways are keyed by zone id, so their gateway_comm ranks follow
+    // ascending zone order
+    MPI_Comm_split(MPI_COMM_WORLD, map->is_gateway ? 0 : MPI_UNDEFINED,
+                   node->zone_id, &map->gateway_comm);
+    int next = 0;
+    for (int z = 0; z < map->n_zones; z++) {
+        if (map->gateways[z] >= 0) map->gateway_comm_rank[z] = next++;
+    }
+
+    if (map->is_gateway) {
+        printf("Node %d: gateway of zone %d (avg intra-zone latency %.2f ms)\n",
+               node->rank, node->zone_id, mine.score);
+        fflush(stdout);
+    }
+}
+
+void destroy_gateway_map(GatewayMap* map) {
+    if (!map) return;
+    free(map->gateways);
+    free(map->gateway_comm_rank);
+    if (map->gateway_comm != MPI_COMM_NULL) MPI_Comm_free(&map->gateway_comm);
+    free(map);
+}
+
+// ------------------------------------------------------------------
+// Relay
+// ------------------------------------------------------------------
+
+Relay* create_relay(Node* node) {
+    int n_zones = node->gateways ? node->gateways->n_zones : 0;
+    Relay* relay = (Relay*)calloc(1, sizeof(Relay));
+    relay->n_zones = n_zones;
+    relay->outbound = (Transaction**)calloc(n_zones, sizeof(Transaction*));
+    relay->outbound_count = (int*)calloc(n_zones, sizeof(int));
+    relay->pair_count = (long*)calloc(n_zones, sizeof(long));
+    relay->pair_latency_sum = (double*)calloc(n_zones, sizeof(double));
+    relay->last_flush = MPI_Wtime();
+    return relay;
+}
+
+void destroy_relay(Relay* relay) {
+    for (int i = 0; i < relay->send_count; i++) {
+        MPI_Wait(&relay->sends[i].request, MPI_STATUS_IGNORE);
+        free(relay->sends[i].buffer);
+    }
+    free(relay->sends);
+    free(relay->inbound);
+    free(relay->pair_count);
+    free(relay->pair_latency_sum);
+    for (int z = 0; z < relay->n_zones; z++) {
+        free(relay->outbound[z]);
+    }
+    free(relay->outbound_count);
+    free(relay->outbound);
+    free(relay);
+}
+
+// Takes ownership of buffer until the send completes
+static void relay_isend(Relay* relay, Transaction* buffer, int count, int dest,
+                        int tag, MPI_Comm comm) {
+    if (relay->send_count == relay->send_capacity) {
+        relay->send_capacity = relay->send_capacity ? 2 * relay->send_capacity : 64;
+        relay->sends = (RelaySend*)realloc(relay->sends,
+                                           relay->send_capacity * sizeof(RelaySend));
+    }
+    RelaySend* send = &relay->sends[relay->send_count++];
+    send->buffer = buffer;
+    MPI_Isend(buffer, count * (int)sizeof(Transaction), MPI_BYTE, dest, tag, comm,
+              &send->request);
+    relay->sent++;
+}
+
+static void relay_progress_sends(Relay* relay) {
+    int i = 0;
+    while (i < relay->send_count) {
+        int done;
+        MPI_Test(&relay->sends[i].request, &done, MPI_STATUS_IGNORE);
+        if (done) {
+            free(relay->sends[i].buffer);
+            relay->sends[i] = relay->sends[--relay->send_count];
+        } else {
+            i++;
+        }
+    }
+}
+
+static void deliver(Relay* relay, const Transaction* tx) {
+    if (relay->inbound_count == relay->inbound_capacity) {
+        int old_capacity = relay->inbound_capacity;
+        int capacity = old_capacity ? 2 * old_capacity : 256;
+        Transaction* grown = (Transaction*)malloc(capacity * sizeof(Transaction));
+        for (int i = 0; i < relay->inbound_count; i++) {
+            grown[i] = relay->inbound[(relay->inbound_head + i) % old_capacity];
+        }
+        free(relay->inbound);
+        relay->inbound = grown;
+        relay->inbound_head = 0;
+        relay->inbound_capacity = capacity;
+    }
+    int tail = (relay->inbound_head + relay->inbound_count) % relay->inbound_capacity;
+    relay->inbound[tail] = *tx;
+    relay->inbound_count++;
+}
+
+static void flush_zone(Relay* relay, Node* node, int zone) {
+    GatewayMap* map = node->gateways;
+    int count = relay->outbound_count[zone];
+    if (count == 0) return;
+
+    relay_isend(relay, relay->outbound[zone], count, map->gateway_comm_rank[zone],
+                RELAY_TAG_BATCH, map->gateway_comm);
+    relay->outbound[zone] = NULL;
+    relay->outbound_count[zone] = 0;
+    relay->batches++;
+}
+
+// Gateway: queue a cross-zone tx for its destination zone's gateway
+static void enqueue_outbound(Relay* relay, Node* node, const Transaction* tx) {
+    GatewayMap* map = node->gateways;
+    int zone = node->zone_assignments[tx->receiver];
+    if (zone < 0 || zone >= relay->n_zones || map->gateways[zone] < 0 ||
+        zone == node->zone_id) {
+        relay->dropped++;
+        return;
+    }
+
+    int batch = MAX(g_params.relay_batch, 1);
+    if (!relay->outbound[zone]) {
+        relay->outbound[zone] = (Transaction*)malloc(batch * sizeof(Transaction));
+    }
+    relay->outbound[zone][relay->outbound_count[zone]++] = *tx;
+    if (relay->outbound_count[zone] >= batch) {
+        flush_zone(relay, node, zone);
+    }
+}
+
+// Gateway: a batch arrived from another zone. Entries whose digest does
+// not match are dropped here, once, before the zone sees them. The rest is
+// delivered locally and fanned out to every other zone member as one
+// message each.
+static void fan_out(Relay* relay, Node* node, Transaction* batch, int count) {
+    int* ok = (int*)malloc(count * sizeof(int));
+    transaction_verify_batch(batch, count, ok);
+    int kept = 0;
+    for (int i = 0; i < count; i++) {
+        if (ok[i]) batch[kept++] = batch[i];
+    }
+    relay->corrupt += count - kept;
+    free(ok);
+    count = kept;
+    if (count == 0) return;
+
+    double now = MPI_Wtime();
+    for (int i = 0; i < count; i++) {
+        int source = batch[i].zone_id;
+        if (source >= 0 && source < node->gateways->n_zones) {
+            relay->pair_count[source]++;
+            relay->pair_latency_sum[source] += (now - batch[i].timestamp) * 1000.0;
+        }
+        deliver(relay, &batch[i]);
+    }
+
+    // With a host-shared DAG one copy per other host is enough
+    if (node->hosts) {
+        for (int i = 0; i < node->hosts->n_leaders; i++) {
+            Transaction* copy = (Transaction*)malloc(count * sizeof(Transaction));
+            memcpy(copy, batch, count * sizeof(Transaction));
+            relay_isend(relay, copy, count, node->hosts->leaders[i], RELAY_TAG_FANOUT,
+                        node->zone_comm);
+        }
+        return;
+    }
+
+    int zone_rank, zone_size;
+    MPI_Comm_rank(node->zone_comm, &zone_rank);
+    MPI_Comm_size(node->zone_comm, &zone_size);
+    for (int r = 0; r < zone_size; r++) {
+        if (r == zone_rank) continue;
+        Transaction* copy = (Transaction*)malloc(count * sizeof(Transaction));
+        memcpy(copy, batch, count * sizeof(Transaction));
+        relay_isend(relay, copy, count, r, RELAY_TAG_FANOUT, node->zone_comm);
+    }
+}
+
+// Hands a cross-zone tx to this zone's gateway
+void relay_submit(Relay* relay, Node* node, Transaction* tx) {
+    GatewayMap* map = node->gateways;
+    if (!map || g_params.relay_batch <= 0) return;
+
+    if (map->is_gateway) {
+        enqueue_outbound(relay, node, tx);
+    } else {
+        Transaction* copy = (Transaction*)malloc(sizeof(Transaction));
+        *copy = *tx;
+        relay_isend(relay, copy, 1, map->local_gateway, RELAY_TAG_OUTBOUND, node->zone_comm);
+    }
+}
+
+// Receives one pending relay message on comm/tag, if any. Returns 1 if one
+// was received, storing the malloc'd buffer and its tx count (which may be 0).
+static int relay_try_recv(Relay* relay, MPI_Comm comm, int tag, Transaction** out, int* count) {
+    int flag, bytes;
+    MPI_Status status;
+    MPI_Iprobe(MPI_ANY_SOURCE, tag, comm, &flag, &status);
+    if (!flag) return 0;
+
+    MPI_Get_count(&status, MPI_BYTE, &bytes);
+    *count = bytes / (int)sizeof(Transaction);
+    Transaction* buffer = (Transaction*)malloc(MAX(*count, 1) * sizeof(Transaction));
+    MPI_Recv(buffer, bytes, MPI_BYTE, status.MPI_SOURCE, tag, comm, MPI_STATUS_IGNORE);
+    relay->received++;
+    *out = buffer;
+    return 1;
+}
+
+// Progresses sends, accepts relay traffic and flushes batches older than
+// relay_interval. Never blocks.
+void relay_poll(Relay* relay, Node* node, double now) {
+    GatewayMap* map = node->gateways;
+    if (!map || node->zone_comm == MPI_COMM_NULL) return;
+
+    relay_progress_sends(relay);
+
+    Transaction* buffer;
+    int count;
+    while (relay_try_recv(relay, node->zone_comm, RELAY_TAG_FANOUT, &buffer, &count)) {
+        for (int i = 0; i < count; i++) deliver(relay, &buffer[i]);
+        free(buffer);
+    }
+
+    if (!map->is_gateway) return;
+
+    while (relay_try_recv(relay, node->zone_comm, RELAY_TAG_OUTBOUND, &buffer, &count)) {
+        for (int i = 0; i < count; i++) enqueue_outbound(relay, node, &buffer[i]);
+        free(buffer);
+    }
+    while (relay_try_recv(relay, map->gateway_comm, RELAY_TAG_BATCH, &buffer, &count)) {
+        if (count > 0) fan_out(relay, node, buffer, count);
+        free(buffer);
+    }
+
+    if (now - relay->last_flush >= g_params.relay_interval) {
+        for (int z = 0; z < map->n_zones; z++) flush_zone(relay, node, z);
+        relay->last_flush = now;
+    }
+}
+
+int relay_next(Relay* relay, Transaction* tx) {
+    if (relay->inbound_count == 0) return 0;
+    *tx = relay->inbound[relay->inbound_head];
+    relay->inbound_head = (relay->inbound_head + 1) % relay->inbound_capacity;
+    relay->inbound_count--;
+    return 1;
+}
+
+// Collective over MPI_COMM_WORLD: flushes every batch and keeps relaying
+// until no relay message is in flight anywhere. Delivered txs stay queued
+// for relay_next().
+void relay_drain(Relay* relay, Node* node) {
+    if (!node->gateways) return;
+
+    while (1) {
+        relay_poll(relay, node, MPI_Wtime());
+        if (node->gateways->is_gateway) {
+            for (int z = 0; z < node->gateways->n_zones; z++) flush_zone(relay, node, z);
+        }
+        long outstanding = relay->sent - relay->received, total = 0;
+        MPI_Allreduce(&outstanding, &total, 1, MPI_LONG, MPI_SUM, MPI_COMM_WORLD);
+        if (total == 0) break;
+        usleep(100);
+    }
+}
+
+// Collective over MPI_COMM_WORLD: rank 0 prints throughput and added
+// latency for every zone pair that carried traffic
+void relay_report(Relay* relay, Node* node, double duration) {
+    GatewayMap* map = node->gateways;
+    if (!map) return;
+
+    int n_zones = map->n_zones;
+    int cells = n_zones * n_zones;
+    double* local = (double*)calloc(2 * cells, sizeof(double));
+    double* totals = (double*)calloc(2 * cells, sizeof(double));
+    if (map->is_gateway) {
+        for (int s = 0; s < n_zones; s++) {
+            local[s * n_zones + node->zone_id] = (double)relay->pair_count[s];
+            local[cells + s * n_zones + node->zone_id] = relay->pair_latency_sum[s];
+        }
+    }
+    long counters[3] = { relay->batches, relay->dropped, relay->corrupt }, counter_totals[3];
+    MPI_Reduce(local, totals, 2 * cells, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
+    MPI_Reduce(counters, counter_totals, 3, MPI_LONG, MPI_SUM, 0, MPI_COMM_WORLD);
+
+    if (node->rank == 0 && g_params.relay_batch > 0) {
+        printf("\n=== INTER-ZONE RELAY ===\n");
+        printf("Batches: %ld, dropped: %ld, corrupt: %ld\n",
+               counter_totals[0], counter_totals[1], counter_totals[2]);
+        for (int s = 0; s < n_zones; s++) {
+            for (int d = 0; d < n_zones; d++) {
+                double count = totals[s * n_zones + d];
+                if (count == 0.0) continue;
+                printf("Zone %d -> %d: %.0f txs, %.2f tx/s, avg added latency %.2f ms\n",
+                       s, d, count, count / duration, totals[cells + s * n_zones + d] / count);
+            }
+        }
+        printf("========================\n");
+    }
+    free(local);
+    free(totals);
+}
@@ -0,0 +1,65 @@
+// rng.c - Counter-based PRNG (SplitMix64 over a keyed counter)
+
+#include "rng.h"
+
+#define RNG_GOLDEN 0x9E3779B97F4A7C15ULL
+
+static Rng streams[RNG_STREAMS];
+static uint64_t global_seed = 0;
+
+static uint64_t mix64(uint64_t z) {
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+void rng_init(Rng* rng, uint64_t seed, int rank, int stream) {
+    uint64_t salt = mix64(((uint64_t)(uint32_t)rank << 32) ^ (uint64_t)(uint32_t)stream);
+    rng->key = mix64(seed ^ salt);
+    rng->counter = 0;
+}
+
+uint64_t rng_next_u64(Rng* rng) {
+    return mix64(rng->key + (++rng->counter) * RNG_GOLDEN);
+}
+
+double rng_next_double(Rng* rng) {
+    // 53 random bits -> [0, 1)
+    return (rng_next_u64(rng) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+void rng_seed(uint64_t seed, int rank) {
+    global_seed = seed;
+    for (int s = 0; s < RNG_STREAMS; s++) {
+        rng_init(&streams[s], seed, rank, s);
+    }
+}
+
+uint64_t rng_seed_value(void) {
+    return global_seed;
+}
+
+uint64_t rng_next(RngStream stream) {
+    return rng_next_u64(&streams[stream]);
+}
+
+double rng_uniform(RngStream stream) {
+    return rng_next_double(&streams[stream]);
+}
+
+int rng_int(RngStream stream, int n) {
+    if (n <= 1) return 0;
+    return (int)(rng_next(stream) % (uint64_t)n);
+}
+
+void rng_get_counters(uint64_t* counters) {
+    for (int s = 0; s < RNG_STREAMS; s++) {
+        counters[s] = streams[s].counter;
+    }
+}
+
+void rng_set_counters(const uint64_t* counters) {
+    for (int s = 0; s < RNG_STREAMS; s++) {
+        streams[s].counter = counters[s];
+    }
+}
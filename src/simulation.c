@@ -0,0 +1,718 @@
+// simulation.c - Main simulation loop
+
+#define _DEFAULT_SOURCE
+
+#include "simulation.h"
+#include "transaction.h"
+#include "dag.h"
+#include "zones.h"
+#include "phases.h"
+#include "consensus.h"
+#include "loadgen.h"
+#include "workers.h"
+#include "witnesses.h"
+#include "relay.h"
+#include "flow.h"
+#include "dag_sync.h"
+#include "telemetry.h"
+#include "bloom.h"
+#include "ledger.h"
+#include "hosts.h"
+#include "netem.h"
+#include "finality.h"
+#include "affinity.h"
+#include "arena.h"
+#include "faults.h"
+#include "pbft.h"
+
+// Per-run objects shared by the helpers below
+typedef struct {
+    Node* node;
+    DAG* dag;
+    WorkerPool* pool;            // NULL when single-threaded
+    WitnessClient* witnesses;
+    BftReplica* bft;             // NULL unless BFT runs point-to-point
+    Relay* relay;
+    FlowControl* flow;           // NULL if flow control is disabled
+    Telemetry* telemetry;        // NULL if telemetry is disabled
+    BloomFilter* seen;           // Recently seen digests; NULL if disabled
+    Ledger* ledger;              // NULL if execution is disabled
+    FinalityTracker* pending;    // Weighted-DAG txs awaiting weight; NULL with a pool
+    LinkEmulator* link;          // NULL if link emulation is disabled
+    SlidingWindow* window;
+    Metrics* metrics;
+    int scanned;                 // Shared DAG: entries already accounted for
+} RunContext;
+
+// Creates one local transaction, broadcasts it to the zone and runs consensus.
+// With a worker pool the DAG belongs to the DAG thread: the tx is queued for
+// insertion and a weighted-DAG decision comes back later as a result.
+// A cross-zone tx is finalized by its witnesses instead of zone consensus
+// and relayed to the receiver's zone through the gateways. With the
+// point-to-point BFT path a BFT tx is finalized later, in bft_replica_poll().
+static void generate_transaction(RunContext* ctx, int tx_id, int receiver, double amount,
+                                 double current_time, int can_process) {
+    Node* node = ctx->node;
+    DAG* dag = ctx->dag;
+    WorkerPool* pool = ctx->pool;
+    Metrics* metrics = ctx->metrics;
+    
+    int parents[2];
+    if (pool) {
+        workers_latest_parents(pool, parents);
+    } else {
+        int* latest = get_latest_transactions(dag, 2);
+        parents[0] = latest[0];
+        parents[1] = latest[1];
+    }
+    
+    Transaction tx = create_transaction(
+        node->rank,
+        receiver,
+        amount,
+        parents,
+        node->zone_id,
+        node->phase
+    );
+    
+    tx.tx_id = tx_id;
+    tx.timestamp = current_time;
+    transaction_seal(&tx);
+    if (ctx->seen) {
+        bloom_insert(ctx->seen, tx.digest);
+    }
+    
+    // Broadcast to zone (one rank per host with a shared DAG), under flow
+    // control if enabled; the relay carries it to the receiver's zone
+    if (ctx->flow) {
+        flow_broadcast(ctx->flow, node, &tx, current_time);
+    } else if (dag->shared) {
+        host_broadcast(node, &tx);
+    } else {
+        broadcast_transaction(&tx, node->zone_comm);
+    }
+    if (is_cross_zone(node, &tx)) {
+        relay_submit(ctx->relay, node, &tx);
+    }
+    
+    add_timestamp(ctx->window, current_time);
+    affinity_observe(node->affinity, -1, current_time);
+    node->total_tx_count++;
+    
+    // Execute consensus (only if we're still processing)
+    if (can_process) {
+        int algorithm = get_consensus_algorithm(node, node->phase);
+        telemetry_count_algorithm(ctx->telemetry, algorithm);
+        int result = 0;
+        int witnessed = (g_params.witness_max > 0 && is_cross_zone(node, &tx));
+        int agreed = (!witnessed && algorithm == CONSENSUS_BFT &&
+                      bft_submit(ctx->bft, &tx, current_time));
+        
+        if (pool) {
+            int decide = (!witnessed && algorithm == CONSENSUS_WEIGHTED_DAG);
+            workers_submit_local(pool, &tx, decide, metrics);
+            if (!decide && !witnessed && !agreed) {
+                result = execute_consensus(&tx, node, NULL, algorithm);
+            }
+        } else {
+            // Add to local DAG
+            add_transaction(dag, &tx);
+            if (!witnessed && !agreed) {
+                result = execute_consensus(&tx, node, dag, algorithm);
+                if (!result && algorithm == CONSENSUS_WEIGHTED_DAG) {
+                    finality_track(ctx->pending, dag, dag_find(dag, tx.digest));
+                }
+            }
+        }
+        
+        // Finalization of a witnessed tx arrives later, in witness_poll()
+        if (witnessed && !witness_submit(ctx->witnesses, node, &tx, metrics)) {
+            result = execute_consensus(&tx, node, pool ? NULL : dag, algorithm);
+        }
+        
+        // Record metrics
+        record_transaction(metrics);
+        if (result) {
+            record_finalization(metrics, tx.timestamp);
+            if (ctx->ledger) ledger_submit(ctx->ledger, &tx);
+        }
+    } else {
+        // Just record the transaction without consensus
+        if (pool) {
+            workers_submit_local(pool, &tx, 0, metrics);
+        } else {
+            add_transaction(dag, &tx);
+        }
+        record_transaction(metrics);
+    }
+}
+
+// Adds a tx from another rank to the local DAG (or hands it to the
+// validators) and counts it towards phase detection and affinity.
+// Duplicates are dropped first: a Bloom filter miss proves the digest is
+// new, and a hit is confirmed against the DAG's digest index. With a
+// worker pool the DAG thread does that confirmation on insert.
+static void accept_remote(RunContext* ctx, Transaction* tx, double current_time) {
+    Node* node = ctx->node;
+    
+    if (ctx->seen && bloom_check_insert(ctx->seen, tx->digest)) {
+        if (!ctx->pool && dag_find(ctx->dag, tx->digest) >= 0) {
+            ctx->metrics->duplicates_dropped++;
+            return;
+        }
+    }
+    
+    if (ctx->pool) {
+        workers_submit_remote(ctx->pool, tx, ctx->metrics);
+    } else {
+        add_transaction(ctx->dag, tx);
+    }
+    if (ctx->dag->shared) return;  // Counted by absorb_shared() on every host peer
+    add_timestamp(ctx->window, current_time);
+    affinity_observe(node->affinity, tx->sender, current_time);
+    node->total_tx_count++;
+}
+
+// A tx received from the zone or the relay: held for its link latency when
+// that is emulated, taken in at once otherwise
+static void receive_remote(RunContext* ctx, Transaction* tx, double current_time) {
+    if (ctx->link) {
+        link_hold(ctx->link, ctx->node, tx, current_time);
+    } else {
+        accept_remote(ctx, tx, current_time);
+    }
+}
+
+// Finalizes the tracked weighted-DAG txs that the last weight update made
+// heavy enough
+static void finalize_confirmed(RunContext* ctx) {
+    int position;
+    while (finality_next(ctx->pending, ctx->dag, &position)) {
+        Transaction* tx = &ctx->dag->transactions[position];
+        record_finalization(ctx->metrics, tx->timestamp);
+        if (ctx->ledger) ledger_submit(ctx->ledger, tx);
+    }
+}
+
+// Shared DAG: counts entries other ranks of this host appended, which is
+// how co-located peers of the receiving host leader see remote txs
+static void absorb_shared(RunContext* ctx, double current_time, int can_process) {
+    DAG* dag = ctx->dag;
+    int count = dag_refresh(dag);
+    for (; ctx->scanned < count; ctx->scanned++) {
+        int sender = dag->transactions[ctx->scanned].sender;
+        if (sender == ctx->node->rank || !can_process) continue;
+        add_timestamp(ctx->window, current_time);
+        affinity_observe(ctx->node->affinity, sender, current_time);
+        ctx->node->total_tx_count++;
+    }
+}
+
+// Receives until the zone-wide count of messages sent since the run began
+// equals the count received; after this no transaction message is in
+// flight. Counts are taken relative to the run start because zones may
+// have been re-formed since the previous run. At the end of a run the txs
+// are dropped; at a checkpoint cut (process set) they are taken in.
+static void drain_zone(RunContext* ctx, long sent_before, long received_before, int process) {
+    Node* node = ctx->node;
+    if (node->zone_comm == MPI_COMM_NULL) return;
+    
+    Transaction received_tx;
+    while (1) {
+        if (process) {
+            while (ctx->flow ? flow_receive(ctx->flow, &received_tx)
+                             : receive_transaction(&received_tx, node->zone_comm)) {
+                if (!ctx->pool && !transaction_verify(&received_tx)) {
+                    ctx->metrics->corrupt_dropped++;
+                    continue;
+                }
+                receive_remote(ctx, &received_tx, MPI_Wtime());
+            }
+        } else {
+            while (receive_transaction(&received_tx, node->zone_comm)) {
+                // Just drain, don't process
+            }
+        }
+        long sent, received;
+        transaction_message_counts(&sent, &received);
+        long outstanding = (sent - sent_before) - (received - received_before);
+        long zone_outstanding = 0;
+        MPI_Allreduce(&outstanding, &zone_outstanding, 1, MPI_LONG, MPI_SUM, node->zone_comm);
+        if (zone_outstanding == 0) break;
+        usleep(100);
+    }
+}
+
+// Written next to the target and renamed over it, so a crash during the
+// write leaves the previous checkpoint intact. since is when the cut began.
+static void write_checkpoint(const char* path, Node* node, const RunState* state, double since) {
+    char partial[1024];
+    snprintf(partial, sizeof(partial), "%s.partial", path);
+    if (checkpoint_write(partial, node, state) && node->rank == 0) {
+        if (rename(partial, path) == 0) {
+            printf("Checkpoint written to %s at t=%.2fs in %.2f ms\n", path, state->elapsed,
+                   (MPI_Wtime() - since) * 1000.0);
+        } else {
+            perror(path);
+        }
+    }
+}
+
+// Checkpoint in the middle of a run, collective over MPI_COMM_WORLD. The
+// rank stops generating and drains every layer to the same consistent cut
+// as the end of a run, but takes in what it receives, restarts nothing and
+// skips the shutdown window. Held link-emulated txs are delivered when due.
+// The worker threads are stopped so the DAG is still while it is written.
+static void checkpoint_cut(RunContext* ctx, const char* path, long sent_before,
+                           long received_before, int tx_counter, int process) {
+    Node* node = ctx->node;
+    double t0 = MPI_Wtime();
+    
+    bft_finish(node);
+    relay_drain(ctx->relay, node);
+    Transaction received_tx;
+    while (relay_next(ctx->relay, &received_tx)) {
+        if (process) receive_remote(ctx, &received_tx, MPI_Wtime());
+    }
+    if (ctx->flow) {
+        flow_finish(ctx->flow, MPI_Wtime());
+    }
+    drain_zone(ctx, sent_before, received_before, process);
+    while (ctx->link && ctx->link->wheel->pending > 0) {
+        while (link_next(ctx->link, MPI_Wtime(), &received_tx)) {
+            if (process) accept_remote(ctx, &received_tx, MPI_Wtime());
+        }
+        usleep(100);
+    }
+    if (ctx->dag->shared) {
+        absorb_shared(ctx, MPI_Wtime(), process);
+    }
+    witness_drain(ctx->witnesses, node, ctx->metrics);
+    if (ctx->bft) {
+        bft_replica_finish(ctx->bft, ctx->metrics);
+    }
+    if (ctx->pool) {
+        workers_stop(ctx->pool, ctx->metrics);
+    }
+    
+    double now = MPI_Wtime();
+    RunState state = { ctx->dag, ctx->window, ctx->metrics, ctx->ledger,
+                       ctx->pool ? ctx->pool->pending : ctx->pending, tx_counter,
+                       now - ctx->metrics->start_time };
+    write_checkpoint(path, node, &state, t0);
+    
+    if (ctx->pool) {
+        workers_resume(ctx->pool);
+    }
+    if (ctx->bft) {
+        bft_replica_resume(ctx->bft);
+    }
+}
+
+// Runs the generate/receive/consensus loop for options->duration seconds and
+// drains the zone afterwards so that another run can follow on the same
+// communicators. Returns the run's metrics; the caller reports and frees them.
+Metrics* run_simulation(Node* node, const SimOptions* options) {
+    LoadSpec load_spec;
+    if (!parse_load_spec(g_params.load, &load_spec)) {
+        if (node->rank == 0) {
+            fprintf(stderr, "Warning: invalid load spec '%s', using legacy\n", g_params.load);
+        }
+        parse_load_spec("legacy", &load_spec);
+    }
+    if (options->replay) {
+        load_spec.process = LOAD_TRACE;
+    }
+    // main() has checked the file; a sweep may have swapped it since
+    if (g_params.load_rates[0] != '\0' &&
+        load_rank_rate(g_params.load_rates, node->rank, &load_spec.rate) < 0) {
+        fprintf(stderr, "Node %d: ignoring unreadable load rates '%s'\n",
+                node->rank, g_params.load_rates);
+    }
+    LoadGenerator* loadgen = create_load_generator(&load_spec, node,
+                                                   options->replay, options->recorder);
+    
+    // Create local DAG, recovering it from the DAG log when one is configured.
+    // A restored checkpoint supplies the DAG otherwise.
+    RunState* resume = options->resume;
+    DAG* dag = NULL;
+    int tx_start = resume ? resume->tx_counter : 0;
+    if (g_params.dag_log[0] != '\0') {
+        char path[PARAMS_STR_LEN + 32];
+        snprintf(path, sizeof(path), "%s.%d.dag", g_params.dag_log, node->rank);
+        double t0 = MPI_Wtime();
+        dag = create_logged_dag(path, g_params.max_transactions);
+        if (dag && dag->count > 0) {
+            tx_start = MAX(tx_start, last_tx_id_from(dag, node->rank) + 1);
+            printf("Rank %d: recovered %d transactions from %s in %.2f ms\n",
+                   node->rank, dag->count, path, (MPI_Wtime() - t0) * 1000.0);
+        }
+    }
+    // Undecided weighted-DAG txs of the restored run, tracked by position
+    FinalityTracker* restored_pending = resume ? resume->pending : NULL;
+    if (resume) {
+        resume->pending = NULL;
+        if (dag) {
+            // The logged DAG replaces the restored one; find the pending txs in it
+            if (restored_pending && resume->dag) {
+                FinalityTracker* moved = create_finality_tracker(dag->capacity);
+                for (int i = 0; i < restored_pending->count; i++) {
+                    Transaction* tx = &resume->dag->transactions[restored_pending->heap[i]];
+                    int position = dag_find(dag, tx->digest);
+                    if (position >= 0) finality_track(moved, dag, position);
+                }
+                destroy_finality_tracker(restored_pending);
+                restored_pending = moved;
+            }
+            if (resume->dag) destroy_dag(resume->dag);
+        } else {
+            dag = resume->dag;
+        }
+        resume->dag = NULL;
+    }
+    if (!dag && node->hosts) {
+        dag = create_shared_dag(node->hosts->host_comm, g_params.max_transactions);
+        node->hosts->broadcasts = 0;
+        node->hosts->deliveries = 0;
+        node->hosts->unshared_deliveries = 0;
+    }
+    if (!dag) {
+        dag = create_dag(g_params.max_transactions);
+    }
+    
+    // Members whose DAG lacks what their zone holds (placed in the zone by
+    // the last rebalance, or a shorter DAG log) pull the difference. A
+    // shared DAG is always new, so there is nothing to reconcile.
+    if (g_params.dag_sync && !dag->shared) {
+        DagSyncStats sync;
+        dag_sync(node, dag, &sync);
+        dag_sync_report(&sync, node);
+        tx_start = MAX(tx_start, last_tx_id_from(dag, node->rank) + 1);
+    }
+    
+    // Finalized txs are executed against the account ledger, which a
+    // restored checkpoint carries over
+    Ledger* ledger = NULL;
+    if (resume && resume->ledger) {
+        ledger = resume->ledger;
+        resume->ledger = NULL;
+    } else if (g_params.ledger_batch > 0) {
+        ledger = create_ledger(node->total_nodes, g_params.ledger_accounts,
+                               MAX(parse_ledger_mode(g_params.ledger_mode), LEDGER_STATIC),
+                               g_params.ledger_threads, g_params.ledger_batch);
+    }
+    
+    // Threaded rank: validators and a DAG-owner thread behind lock-free rings
+    WorkerPool* pool = NULL;
+    if (g_params.threads > 0) {
+        pool = create_worker_pool(node, dag, g_params.threads, restored_pending);
+        restored_pending = NULL;
+        pool->ledger = ledger;
+    }
+    
+    long sent_before, received_before;
+    transaction_message_counts(&sent_before, &received_before);
+    
+    // Outstanding cross-zone witness requests and relay batches of this run
+    WitnessClient* witnesses = create_witness_client();
+    witnesses->ledger = ledger;
+    Relay* relay = create_relay(node);
+    
+    // Credits and per-peer queues on the zone broadcast (NULL if disabled)
+    FlowControl* flow = create_flow_control(node);
+    node->flow = flow;
+    
+    // Duplicate suppression on the receive path
+    BloomFilter* seen = NULL;
+    if (g_params.dedup_capacity > 0) {
+        seen = create_bloom_filter(g_params.dedup_capacity, g_params.dedup_fp_rate);
+    }
+    
+    // Received txs wait out their sender's latency here (NULL if disabled)
+    LinkEmulator* link = create_link_emulator(MPI_Wtime());
+    
+    // Zone rebalancing rounds, run alongside the loop
+    ZoneFormation* zones = create_zone_formation(node);
+    
+    // Create sliding window for phase detection and the metrics tracker,
+    // or continue the restored ones. Metrics of a resumed run cover the
+    // whole experiment, so their start is moved back by the time already run.
+    SlidingWindow* window;
+    Metrics* metrics;
+    double run_start = MPI_Wtime();
+    if (resume) {
+        window = resume->window;
+        metrics = resume->metrics;
+        metrics->start_time = run_start - resume->elapsed;
+        resume->window = NULL;
+        resume->metrics = NULL;
+    } else {
+        window = create_window(g_params.window_size * 100);
+        metrics = create_metrics();
+        metrics->start_time = run_start;
+    }
+    long offered_before = metrics->offered_transactions;
+    
+    // Per-interval samples reduced to rank 0 while the loop runs
+    Telemetry* telemetry = create_telemetry(node, metrics, run_start);
+    
+    // Failure roles of this run and the point-to-point BFT replica (both
+    // NULL unless configured). The replica's group is the zone at run start.
+    FaultInjector* faults = create_fault_injector(node, run_start);
+    BftReplica* bft = create_bft_replica(node, faults, run_start);
+    if (bft) {
+        bft->ledger = ledger;
+    }
+    long dropped_before = metrics->dropped_transactions;
+    FinalityTracker* pending = NULL;
+    if (!pool) {
+        pending = restored_pending ? restored_pending : create_finality_tracker(dag->capacity);
+    }
+    RunContext ctx = { node, dag, pool, witnesses, bft, relay, flow, telemetry, seen, ledger, pending,
+                       link, window, metrics, dag->count };
+    
+    // Main simulation loop
+    double end_time = run_start + options->duration;
+    double shutdown_time = end_time - 0.3; // Stop generating new txs 300ms before end
+    double process_time = end_time - 0.1; // Stop processing received txs 100ms before end
+    double last_weights = run_start;
+    int tx_counter = tx_start;
+    long iterations = 0;
+    long allocations_before = heap_allocations();
+    double busy = 0.0;
+    
+    // Checkpoint cuts every checkpoint_interval seconds while generating.
+    // Every rank takes the same number, so the loop runs on until all are.
+    double cut_interval = options->checkpoint ? g_params.checkpoint_interval : 0.0;
+    int cuts = 0, cuts_taken = 0;
+    while (cut_interval > 0.0 && (cuts + 1) * cut_interval < options->duration - 0.3) {
+        cuts++;
+    }
+    
+    while (MPI_Wtime() < end_time || cuts_taken < cuts) {
+        double current_time = MPI_Wtime();
+        arena_reset(&g_scratch.iteration);
+        // A crashed rank neither generates nor processes, but still drains
+        int crashed = fault_crashed(faults, current_time);
+        int can_generate = (current_time < shutdown_time && !crashed);
+        int can_process = (current_time < process_time && !crashed);
+        
+        // Detect phase
+        int old_phase = node->phase;
+        node->phase = detect_phase(node, window, current_time);
+        if (node->phase != old_phase && node->rank == 0) {
+            printf("[%.2fs] Phase transition: %d -> %d\n", 
+                   current_time - metrics->start_time, old_phase, node->phase);
+        }
+        
+        // Returned credits release queued txs to their peers
+        if (flow) {
+            flow_poll(flow, current_time);
+        }
+        
+        // Generate transactions (stop before shutdown_time). Arrivals are
+        // queued by the load generator against the clock; each iteration
+        // drains up to a batch of them, and the time an arrival spent in
+        // the backlog is recorded apart from consensus latency. While a
+        // peer queue is full, arrivals stay in the backlog.
+        if (can_generate) {
+            loadgen_poll(loadgen, current_time - run_start);
+            
+            Arrival arrival;
+            int dispatched = 0;
+            while (dispatched < LOAD_DISPATCH_BATCH && !(flow && flow->blocked) &&
+                   loadgen_next(loadgen, &arrival)) {
+                double now = MPI_Wtime();
+                record_queue_delay(metrics, run_start + arrival.arrival, now);
+                generate_transaction(&ctx, tx_counter++, arrival.receiver, arrival.amount,
+                                     now, now < process_time);
+                dispatched++;
+            }
+        }
+        
+        // Receive transactions from others (only process if can_process)
+        Transaction received_tx;
+        while (flow ? flow_receive(flow, &received_tx)
+                    : receive_transaction(&received_tx, node->zone_comm)) {
+            if (can_process) {
+                // Validators check integrity themselves in a threaded rank
+                if (!pool && !transaction_verify(&received_tx)) {
+                    metrics->corrupt_dropped++;
+                    continue;
+                }
+                receive_remote(&ctx, &received_tx, current_time);
+            }
+            // If can't process, just drain the message
+        }
+        
+        // Cross-zone txs relayed into this zone by its gateway
+        relay_poll(relay, node, current_time);
+        while (relay_next(relay, &received_tx)) {
+            if (can_process) {
+                receive_remote(&ctx, &received_tx, current_time);
+            }
+        }
+        
+        // Held txs whose link latency has elapsed
+        if (link) {
+            while (link_next(link, MPI_Wtime(), &received_tx)) {
+                if (can_process) {
+                    accept_remote(&ctx, &received_tx, current_time);
+                }
+            }
+        }
+        
+        if (dag->shared) {
+            absorb_shared(&ctx, current_time, can_process);
+        }
+        
+        // Serve witness requests and collect votes on our cross-zone txs
+        witness_poll(witnesses, node, metrics);
+        if (bft) {
+            bft_replica_poll(bft, metrics, current_time);
+        }
+        
+        // Update DAG weights periodically (the DAG thread does its own) at
+        // the DAG thread's cadence; a pass is linear in the DAG size
+        if (pool) {
+            workers_drain_results(pool, metrics);
+        } else if (current_time - last_weights >= WORKER_WEIGHT_INTERVAL) {
+            last_weights = current_time;
+            // A shared DAG's weights are maintained by the host leader; the
+            // other ranks re-key their pending txs against them wholesale
+            if (!dag->shared || node->hosts->host_rank == 0) {
+                update_weights(dag);
+                finality_refresh(pending, dag, dag->changed, dag->n_changed);
+            } else {
+                finality_refresh(pending, dag, NULL, 0);
+            }
+            finalize_confirmed(&ctx);
+        }
+        
+        // Zone rebalancing (every zone_rebalance_interval seconds of the
+        // run); consensus stays on the current layout until the swap
+        zone_formation_poll(zones, node, current_time - run_start);
+        
+        if (telemetry) {
+            telemetry_poll(telemetry, node, metrics, loadgen, flow, current_time);
+        }
+        
+        if (cuts_taken < cuts && current_time >= run_start + (cuts_taken + 1) * cut_interval) {
+            checkpoint_cut(&ctx, options->checkpoint, sent_before, received_before,
+                           tx_counter, !crashed);
+            cuts_taken++;
+        }
+        
+        iterations++;
+        busy += MPI_Wtime() - current_time;
+        
+        // Small sleep to prevent busy-waiting
+        usleep(1000);  // 1ms
+    }
+    long allocations = heap_allocations() - allocations_before;
+    
+    if (pool) {
+        workers_stop(pool, metrics);
+    }
+    metrics->end_time = MPI_Wtime();
+    metrics->offered_transactions = offered_before + loadgen->offered;
+    metrics->dropped_transactions = dropped_before + loadgen->dropped;
+    destroy_load_generator(loadgen);
+    
+    // Wait a moment to let any in-flight consensus operations (MPI_Allgather) complete
+    // We stopped starting new ones 100ms before end, so give them time to finish
+    usleep(200000); // 200ms - enough time for any in-flight collectives to complete
+    
+    // Match up the zone's outstanding BFT vote collectives
+    bft_finish(node);
+    
+    // Drain all pending messages to avoid deadlock from blocking sends
+    // Continue receiving until no more messages arrive for a period
+    Transaction received_tx;
+    int consecutive_empty = 0;
+    const int max_empty_iterations = 100; // Stop after 100 empty checks
+    
+    for (int i = 0; i < max_empty_iterations; i++) {
+        if (receive_transaction(&received_tx, node->zone_comm)) {
+            consecutive_empty = 0; // Reset counter if we got a message
+        } else {
+            consecutive_empty++;
+            if (consecutive_empty > 10) {
+                // If we've had 10 consecutive empty checks, likely done
+                break;
+            }
+            usleep(100); // Small sleep between checks
+        }
+    }
+    
+    // Then drain to a consistent cut: keep receiving until every message
+    // sent within the zone has been received somewhere, and the same for
+    // witness traffic across zones
+    relay_drain(relay, node);
+    if (flow) {
+        flow_finish(flow, metrics->end_time);
+    }
+    drain_zone(&ctx, sent_before, received_before, 0);
+    witness_drain(witnesses, node, metrics);
+    if (bft) {
+        bft_replica_finish(bft, metrics);
+    }
+    zone_formation_finish(zones, node, metrics->end_time - run_start);
+    if (telemetry) {
+        telemetry_finish(telemetry, node, metrics, flow, metrics->end_time);
+    }
+    relay_report(relay, node, metrics->end_time - run_start);
+    if (flow) {
+        flow_report(flow, node, metrics->end_time - run_start);
+    }
+    if (ledger) {
+        ledger_report(ledger, node);
+    }
+    if (link) {
+        link_report(link, node);
+    }
+    zone_formation_report(zones, node);
+    if (pbft_enabled()) {
+        bft_replica_report(bft, faults, node, metrics->end_time - run_start);
+    }
+    scratch_report(node, iterations, allocations, busy);
+    arena_reset(&g_scratch.epoch);
+    if (dag->shared) {
+        hosts_report(node, dag);
+    }
+    
+    // Synchronize within zone first to ensure all zone communication completes
+    // This barrier will ensure all sends/receives in the zone are done
+    if (node->zone_comm != MPI_COMM_NULL) {
+        MPI_Barrier(node->zone_comm);
+    }
+    
+    // Then synchronize all ranks globally before printing results
+    MPI_Barrier(MPI_COMM_WORLD);
+    
+    if (options->checkpoint) {
+        RunState state = { dag, window, metrics, ledger, pool ? pool->pending : pending,
+                           tx_counter, metrics->end_time - metrics->start_time };
+        write_checkpoint(options->checkpoint, node, &state, MPI_Wtime());
+    }
+    if (pool) {
+        workers_report(pool);
+        destroy_worker_pool(pool);
+    }
+    destroy_ledger(ledger);
+    destroy_window(window);
+    destroy_dag(dag);
+    destroy_bloom_filter(seen);
+    destroy_link_emulator(link);
+    destroy_zone_formation(zones);
+    destroy_finality_tracker(pending);
+    destroy_witness_client(witnesses);
+    destroy_bft_replica(bft);
+    destroy_fault_injector(faults);
+    destroy_relay(relay);
+    node->flow = NULL;
+    destroy_flow_control(flow);
+    destroy_telemetry(telemetry);
+    
+    return metrics;
+}
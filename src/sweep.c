@@ -0,0 +1,179 @@
+// sweep.c - Runs a grid of configurations back to back in one MPI job
+//
+// Geography, latencies and communicators are set up once by main(); each
+// configuration only re-forms zones when a zone-formation knob changed.
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "sweep.h"
+#include "zones.h"
+#include "metrics.h"
+#include "simulation.h"
+#include <ctype.h>
+
+static char* trim(char* s) {
+    while (isspace((unsigned char)*s)) s++;
+    char* end = s + strlen(s);
+    while (end > s && isspace((unsigned char)end[-1])) end--;
+    *end = '\0';
+    return s;
+}
+
+// Loads "key = v1, v2, ..." lines. Keys are validated against the
+// parameter table. Returns 0 on error.
+int sweep_load(SweepGrid* grid, const char* path) {
+    FILE* f = fopen(path, "r");
+    if (!f) {
+        perror(path);
+        return 0;
+    }
+
+    memset(grid, 0, sizeof(SweepGrid));
+    Params probe;
+    params_set_defaults(&probe);
+
+    char line[2048];
+    int line_no = 0;
+    int ok = 1;
+    while (fgets(line, sizeof(line), f)) {
+        line_no++;
+        char* hash = strchr(line, '#');
+        if (hash) *hash = '\0';
+        char* text = trim(line);
+        if (*text == '\0') continue;
+
+        char* eq = strchr(text, '=');
+        if (!eq || grid->axis_count >= SWEEP_MAX_AXES) {
+            fprintf(stderr, "%s:%d: expected 'key = v1, v2, ...' (max %d keys)\n",
+                    path, line_no, SWEEP_MAX_AXES);
+            ok = 0;
+            continue;
+        }
+        *eq = '\0';
+
+        SweepAxis* axis = &grid->axes[grid->axis_count];
+        snprintf(axis->key, sizeof(axis->key), "%s", trim(text));
+
+        char* saveptr = NULL;
+        for (char* tok = strtok_r(eq + 1, ",", &saveptr);
+             tok && axis->count < SWEEP_MAX_VALUES;
+             tok = strtok_r(NULL, ",", &saveptr)) {
+            char* value = trim(tok);
+            if (*value == '\0') continue;
+            if (!params_set(&probe, axis->key, value)) {
+                fprintf(stderr, "%s:%d: bad value '%s' for '%s'\n",
+                        path, line_no, value, axis->key);
+                ok = 0;
+                continue;
+            }
+            snprintf(axis->values[axis->count++], PARAMS_STR_LEN, "%s", value);
+        }
+        if (axis->count > 0) {
+            grid->axis_count++;
+        }
+    }
+    fclose(f);
+
+    grid->total = grid->axis_count > 0 ? 1 : 0;
+    for (int a = 0; a < grid->axis_count; a++) {
+        grid->total *= grid->axes[a].count;
+    }
+    return ok && grid->total > 0;
+}
+
+// Applies configuration 'index' (mixed-radix over the axes) to params
+void sweep_apply(const SweepGrid* grid, int index, Params* params) {
+    for (int a = grid->axis_count - 1; a >= 0; a--) {
+        const SweepAxis* axis = &grid->axes[a];
+        params_set(params, axis->key, axis->values[index % axis->count]);
+        index /= axis->count;
+    }
+}
+
+void run_sweep(Node* node, const SweepGrid* grid, const Params* base,
+               const char* out_path, uint64_t seed) {
+    // Fail on a configuration main() would reject before running any
+    for (int c = 0; c < grid->total; c++) {
+        Params check = *base;
+        sweep_apply(grid, c, &check);
+        if (!params_check(&check, 0, 0)) {
+            if (node->rank == 0) {
+                fprintf(stderr, "Error: sweep configuration %d is invalid\n", c);
+                params_check(&check, 1, 0);
+            }
+            MPI_Abort(MPI_COMM_WORLD, 2);
+        }
+    }
+
+    FILE* out = NULL;
+    if (node->rank == 0) {
+        out = fopen(out_path, "w");
+        if (!out) {
+            perror(out_path);
+            MPI_Abort(MPI_COMM_WORLD, 1);
+        }
+        fprintf(out, "config");
+        for (int a = 0; a < grid->axis_count; a++) {
+            fprintf(out, ",%s", grid->axes[a].key);
+        }
+        fprintf(out, ",duration,offered_tps,tps,created,finalized,avg_latency_ms,"
+                     "avg_queue_delay_ms,max_queue_delay_ms,dropped\n");
+        fflush(out);
+        printf("Sweep: %d configurations -> %s\n\n", grid->total, out_path);
+    }
+
+    Params formed = *base;  // Parameters the current zones were formed with
+    for (int c = 0; c < grid->total; c++) {
+        g_params = *base;
+        sweep_apply(grid, c, &g_params);
+
+        if (params_zones_differ(&formed, &g_params)) {
+            form_zones(node, g_params.max_zones);
+            create_zone_communicator(node);
+            formed = g_params;
+        }
+
+        // Every configuration starts from the same traffic history and
+        // random streams so that rows differ only by their parameters
+        reset_node_traffic(node);
+        rng_seed(seed, node->rank);
+        MPI_Barrier(MPI_COMM_WORLD);
+
+        if (node->rank == 0) {
+            printf("[sweep %d/%d]", c + 1, grid->total);
+            for (int a = 0; a < grid->axis_count; a++) {
+                char value[PARAMS_STR_LEN];
+                params_format(&g_params, grid->axes[a].key, value, sizeof(value));
+                printf(" %s=%s", grid->axes[a].key, value);
+            }
+            printf("\n");
+            fflush(stdout);
+        }
+        params_check(&g_params, node->rank == 0, 0);
+
+        SimOptions options = { g_params.duration, NULL, NULL, NULL, NULL };
+        Metrics* metrics = run_simulation(node, &options);
+
+        MetricsSummary summary;
+        summarize_metrics(metrics, &summary);
+        destroy_metrics(metrics);
+
+        if (node->rank == 0) {
+            fprintf(out, "%d", c);
+            for (int a = 0; a < grid->axis_count; a++) {
+                char value[PARAMS_STR_LEN];
+                params_format(&g_params, grid->axes[a].key, value, sizeof(value));
+                fprintf(out, ",%s", value);
+            }
+            fprintf(out, ",%.3f,%.2f,%.2f,%d,%d,%.3f,%.3f,%.3f,%.0f\n",
+                    summary.duration, summary.offered_tps, summary.total_tps,
+                    summary.total_transactions, summary.total_finalized,
+                    summary.avg_latency_ms, summary.avg_queue_delay_ms,
+                    summary.max_queue_delay_ms, summary.dropped);
+            fflush(out);
+        }
+    }
+
+    if (out) fclose(out);
+    g_params = *base;
+}
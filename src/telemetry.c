@@ -0,0 +1,244 @@
+// telemetry.c - Per-interval time series reduced to rank 0 during the run
+
+#include "telemetry.h"
+
+// Runs so far in this process; later runs of a sweep append to the file
+static int telemetry_runs = 0;
+
+#define TELEMETRY_COLUMNS 19
+
+static const char* columns[TELEMETRY_COLUMNS] = {
+    "run", "t", "created", "finalized", "tps", "received", "dropped",
+    "avg_latency_ms", "max_latency_ms", "backlog", "backlog_max",
+    "flow_queued", "flow_queued_max", "phase_low", "phase_normal", "phase_high",
+    "fast_voting", "weighted_dag", "bft"
+};
+
+static const int decimals[TELEMETRY_COLUMNS] = {
+    0, 3, 0, 0, 2, 0, 0, 3, 3, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0
+};
+
+// Remote txs this rank has taken in: everything it counted towards phase
+// detection minus what it created itself
+static long received_total(Node* node, Metrics* metrics) {
+    return (long)node->total_tx_count - metrics->total_transactions;
+}
+
+// metrics->dropped_transactions only takes the run's load drops at the end
+static long dropped_total(Metrics* metrics, const LoadGenerator* lg) {
+    return metrics->dropped_transactions + (lg ? lg->dropped : 0) +
+           metrics->duplicates_dropped + metrics->corrupt_dropped;
+}
+
+Telemetry* create_telemetry(Node* node, Metrics* metrics, double now) {
+    if (g_params.telemetry[0] == '\0') return NULL;
+
+    Telemetry* t = (Telemetry*)calloc(1, sizeof(Telemetry));
+    MPI_Comm_dup(MPI_COMM_WORLD, &t->comm);
+    t->rank = node->rank;
+    t->run = telemetry_runs++;
+    t->interval = g_params.telemetry_interval > 0.0 ? g_params.telemetry_interval : 1.0;
+    t->start = metrics->start_time;
+    t->last_sample = now - t->start;
+    // Ranks start a moment apart; tick k must be the k-th reduction on all
+    int first_tick = (int)floor(t->last_sample / t->interval) + 1;
+    MPI_Allreduce(&first_tick, &t->next_tick, 1, MPI_INT, MPI_MAX, t->comm);
+
+    size_t len = strlen(g_params.telemetry);
+    t->jsonl = (len >= 6 && strcmp(g_params.telemetry + len - 6, ".jsonl") == 0);
+    if (t->rank == 0) {
+        t->out = fopen(g_params.telemetry, t->run == 0 ? "w" : "a");
+        if (!t->out) {
+            fprintf(stderr, "Warning: cannot open telemetry file %s\n", g_params.telemetry);
+        } else if (!t->jsonl && t->run == 0) {
+            for (int c = 0; c < TELEMETRY_COLUMNS; c++) {
+                fprintf(t->out, "%s%s", c ? "," : "", columns[c]);
+            }
+            fprintf(t->out, "\n");
+            fflush(t->out);
+        }
+    }
+
+    // Counters at the start; samples report what changed since
+    t->created = metrics->total_transactions;
+    t->finalized = metrics->finalized_transactions;
+    t->received = received_total(node, metrics);
+    t->dropped = dropped_total(metrics, NULL);
+    t->latency_count = metrics->latency_count;
+    t->cross_zone_count = metrics->cross_zone_finalized;
+    t->cross_zone_sum = metrics->cross_zone_latency_sum;
+    return t;
+}
+
+void destroy_telemetry(Telemetry* t) {
+    if (!t) return;
+    if (t->out) fclose(t->out);
+    MPI_Comm_free(&t->comm);
+    free(t);
+}
+
+// Called for every local tx that runs consensus
+void telemetry_count_algorithm(Telemetry* t, int algorithm) {
+    if (!t || algorithm < 0 || algorithm > CONSENSUS_BFT) return;
+    t->algorithm_txs[algorithm]++;
+}
+
+// Fills slot with this rank's changes since the previous sample, labelled
+// with time (elapsed seconds). A NULL node leaves the slot empty, for a
+// tick this rank slept through or padding at the end of the run.
+static void take_sample(Telemetry* t, TelemetrySlot* slot, Node* node, Metrics* metrics,
+                        const LoadGenerator* lg, const FlowControl* flow, double time,
+                        double elapsed) {
+    memset(slot->sums, 0, sizeof(slot->sums));
+    memset(slot->maxes, 0, sizeof(slot->maxes));
+    slot->maxes[TM_TIME] = time;
+    if (!node) return;
+
+    long created = metrics->total_transactions;
+    long finalized = metrics->finalized_transactions;
+    long received = received_total(node, metrics);
+    long dropped = dropped_total(metrics, lg);
+    slot->sums[TM_CREATED] = created - t->created;
+    slot->sums[TM_FINALIZED] = finalized - t->finalized;
+    slot->sums[TM_RATE] = (finalized - t->finalized) / MAX(elapsed - t->last_sample, 1e-3);
+    slot->sums[TM_RECEIVED] = received - t->received;
+    slot->sums[TM_DROPPED] = dropped - t->dropped;
+
+    // Intra-zone latencies are kept one by one, cross-zone ones as a sum
+    double latency_max = 0.0, latency_sum = 0.0;
+    for (int i = t->latency_count; i < metrics->latency_count; i++) {
+        latency_sum += metrics->latencies[i];
+        latency_max = MAX(latency_max, metrics->latencies[i]);
+    }
+    int cross_zone = metrics->cross_zone_finalized - t->cross_zone_count;
+    slot->sums[TM_LATENCY_SUM] = latency_sum + metrics->cross_zone_latency_sum - t->cross_zone_sum;
+    slot->sums[TM_LATENCY_COUNT] = (metrics->latency_count - t->latency_count) + cross_zone;
+    slot->maxes[TM_LATENCY_MAX] = latency_max;
+
+    int backlog = lg ? lg->count : 0;
+    int queued = 0;
+    if (flow) {
+        for (int p = 0; p < flow->size; p++) queued += flow->peers[p].queued;
+    }
+    slot->sums[TM_BACKLOG] = backlog;
+    slot->sums[TM_FLOW_QUEUED] = queued;
+    slot->maxes[TM_BACKLOG_MAX] = backlog;
+    slot->maxes[TM_FLOW_QUEUED_MAX] = queued;
+
+    if (node->phase >= PHASE_LOW && node->phase <= PHASE_HIGH) {
+        slot->sums[TM_PHASE_LOW + node->phase] = 1.0;
+    }
+    for (int a = 0; a <= CONSENSUS_BFT; a++) {
+        slot->sums[TM_FAST_VOTING + a] = t->algorithm_txs[a];
+        t->algorithm_txs[a] = 0;
+    }
+
+    t->last_sample = elapsed;
+    t->created = created;
+    t->finalized = finalized;
+    t->received = received;
+    t->dropped = dropped;
+    t->latency_count = metrics->latency_count;
+    t->cross_zone_count = metrics->cross_zone_finalized;
+    t->cross_zone_sum = metrics->cross_zone_latency_sum;
+}
+
+static void issue(Telemetry* t, TelemetrySlot* slot) {
+    MPI_Ireduce(slot->sums, slot->sums_out, TM_SUMS, MPI_DOUBLE, MPI_SUM, 0, t->comm,
+                &slot->requests[0]);
+    MPI_Ireduce(slot->maxes, slot->maxes_out, TM_MAXES, MPI_DOUBLE, MPI_MAX, 0, t->comm,
+                &slot->requests[1]);
+    t->in_flight++;
+}
+
+static void write_row(Telemetry* t, const TelemetrySlot* slot) {
+    if (!t->out) return;
+    const double* s = slot->sums_out;
+    const double* m = slot->maxes_out;
+    double values[TELEMETRY_COLUMNS] = {
+        t->run, m[TM_TIME], s[TM_CREATED], s[TM_FINALIZED], s[TM_RATE],
+        s[TM_RECEIVED], s[TM_DROPPED],
+        s[TM_LATENCY_COUNT] > 0 ? s[TM_LATENCY_SUM] / s[TM_LATENCY_COUNT] : 0.0,
+        m[TM_LATENCY_MAX], s[TM_BACKLOG], m[TM_BACKLOG_MAX],
+        s[TM_FLOW_QUEUED], m[TM_FLOW_QUEUED_MAX],
+        s[TM_PHASE_LOW], s[TM_PHASE_NORMAL], s[TM_PHASE_HIGH],
+        s[TM_FAST_VOTING], s[TM_WEIGHTED_DAG], s[TM_BFT]
+    };
+    if (t->jsonl) fprintf(t->out, "{");
+    for (int c = 0; c < TELEMETRY_COLUMNS; c++) {
+        if (t->jsonl) {
+            fprintf(t->out, "%s\"%s\":%.*f", c ? "," : "", columns[c], decimals[c], values[c]);
+        } else {
+            fprintf(t->out, "%s%.*f", c ? "," : "", decimals[c], values[c]);
+        }
+    }
+    fprintf(t->out, t->jsonl ? "}\n" : "\n");
+    fflush(t->out);
+}
+
+// Retires completed samples oldest first, writing their rows on rank 0;
+// with wait = 1 it blocks on the oldest until one has retired
+static void progress(Telemetry* t, int wait) {
+    while (t->in_flight > 0) {
+        TelemetrySlot* slot = &t->slots[t->oldest];
+        int done = 1;
+        if (wait) {
+            MPI_Waitall(2, slot->requests, MPI_STATUSES_IGNORE);
+            wait = 0;
+        } else {
+            MPI_Testall(2, slot->requests, &done, MPI_STATUSES_IGNORE);
+        }
+        if (!done) return;
+        if (t->rank == 0) write_row(t, slot);
+        t->oldest = (t->oldest + 1) % TELEMETRY_SLOTS;
+        t->in_flight--;
+        t->written++;
+    }
+}
+
+// Takes a sample into the next free slot and starts its reductions; waits
+// for the oldest sample if every slot is in flight
+static void send_sample(Telemetry* t, Node* node, Metrics* metrics, const LoadGenerator* lg,
+                        const FlowControl* flow, double time, double elapsed) {
+    if (t->in_flight == TELEMETRY_SLOTS) progress(t, 1);
+    TelemetrySlot* slot = &t->slots[(t->oldest + t->in_flight) % TELEMETRY_SLOTS];
+    take_sample(t, slot, node, metrics, lg, flow, time, elapsed);
+    issue(t, slot);
+}
+
+// Never blocks. Ticks that passed since the last poll are sent empty
+// except the latest, which carries the sample; ticks that find every slot
+// in flight are sent on a later poll.
+void telemetry_poll(Telemetry* t, Node* node, Metrics* metrics, const LoadGenerator* lg,
+                    const FlowControl* flow, double now) {
+    progress(t, 0);
+    double elapsed = now - t->start;
+    int due = (int)floor(elapsed / t->interval);
+    while (t->next_tick <= due && t->in_flight < TELEMETRY_SLOTS) {
+        int latest = (t->next_tick == due);
+        send_sample(t, latest ? node : NULL, metrics, lg, flow, t->next_tick * t->interval,
+                    elapsed);
+        t->next_tick++;
+    }
+}
+
+// Collective over MPI_COMM_WORLD at the end of a run. Every rank sends
+// the ticks up to the latest one due on any rank, empty, then one final
+// sample with what changed since its last one, so all ranks issue the same
+// reductions in the same order. Then waits for all of them.
+void telemetry_finish(Telemetry* t, Node* node, Metrics* metrics, const FlowControl* flow,
+                      double now) {
+    double elapsed = now - t->start;
+    int due = (int)floor(elapsed / t->interval);
+    int last_due = 0;
+    MPI_Allreduce(&due, &last_due, 1, MPI_INT, MPI_MAX, MPI_COMM_WORLD);
+    for (; t->next_tick <= last_due; t->next_tick++) {
+        send_sample(t, NULL, metrics, NULL, flow, t->next_tick * t->interval, elapsed);
+    }
+    send_sample(t, node, metrics, NULL, flow, elapsed, elapsed);
+    while (t->in_flight > 0) progress(t, 1);
+
+    if (t->rank == 0 && t->out) {
+        printf("\nTelemetry: %d samples written to %s\n", t->written, g_params.telemetry);
+    }
+}
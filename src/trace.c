@@ -0,0 +1,149 @@
+// trace.c - Binary workload traces (buffered writer, mmap reader)
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "trace.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+void trace_path(char* buf, size_t len, const char* prefix, int rank) {
+    snprintf(buf, len, "%s.%d.trace", prefix, rank);
+}
+
+TraceWriter* trace_writer_open(const char* prefix, int rank, int size, uint64_t seed) {
+    char path[512];
+    trace_path(path, sizeof(path), prefix, rank);
+
+    FILE* file = fopen(path, "wb");
+    if (!file) {
+        perror(path);
+        return NULL;
+    }
+
+    TraceWriter* writer = (TraceWriter*)malloc(sizeof(TraceWriter));
+    writer->file = file;
+    memset(&writer->header, 0, sizeof(TraceHeader));
+    memcpy(writer->header.magic, TRACE_MAGIC, 8);
+    writer->header.version = TRACE_VERSION;
+    writer->header.rank = rank;
+    writer->header.size = size;
+    writer->header.event_size = sizeof(TraceEvent);
+    writer->header.seed = seed;
+    writer->failed = 0;
+
+    // Placeholder header; rewritten with the final count on close
+    if (fwrite(&writer->header, sizeof(TraceHeader), 1, file) != 1) {
+        perror(path);
+        fclose(file);
+        free(writer);
+        return NULL;
+    }
+    return writer;
+}
+
+void trace_write_geography(TraceWriter* writer, double x, double y) {
+    writer->header.x = x;
+    writer->header.y = y;
+}
+
+// On a failed write (e.g. a full disk) tracing stops; the header written
+// on close then covers only the events before it
+void trace_write_event(TraceWriter* writer, double offset, int receiver, double amount) {
+    if (writer->failed) return;
+    TraceEvent ev;
+    ev.offset = offset;
+    ev.receiver = receiver;
+    ev.reserved = 0;
+    ev.amount = amount;
+    if (fwrite(&ev, sizeof(TraceEvent), 1, writer->file) != 1) {
+        fprintf(stderr, "Rank %d: trace write failed after %llu events (%s); tracing stopped\n",
+                writer->header.rank, (unsigned long long)writer->header.event_count,
+                strerror(errno));
+        writer->failed = 1;
+        return;
+    }
+    writer->header.event_count++;
+}
+
+// A trace whose writes failed keeps its header; trace_reader_open() rejects
+// it if the file holds fewer events than the header counts
+void trace_writer_close(TraceWriter* writer) {
+    if (!writer) return;
+    if (fflush(writer->file) != 0) writer->failed = 1;
+    int ok = fseek(writer->file, 0, SEEK_SET) == 0 &&
+             fwrite(&writer->header, sizeof(TraceHeader), 1, writer->file) == 1;
+    ok = (fclose(writer->file) == 0) && ok;
+    if (!ok) {
+        fprintf(stderr, "Rank %d: trace header not written (%s)\n", writer->header.rank,
+                strerror(errno));
+    } else if (writer->failed) {
+        fprintf(stderr, "Rank %d: trace is incomplete\n", writer->header.rank);
+    }
+    free(writer);
+}
+
+TraceReader* trace_reader_open(const char* prefix, int rank, int size) {
+    char path[512];
+    trace_path(path, sizeof(path), prefix, rank);
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        perror(path);
+        return NULL;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(TraceHeader)) {
+        fprintf(stderr, "Error: trace '%s' is truncated\n", path);
+        close(fd);
+        return NULL;
+    }
+
+    void* map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        perror(path);
+        return NULL;
+    }
+
+    const TraceHeader* header = (const TraceHeader*)map;
+    size_t expected = sizeof(TraceHeader) + header->event_count * sizeof(TraceEvent);
+    if (memcmp(header->magic, TRACE_MAGIC, 8) != 0 ||
+        header->version != TRACE_VERSION ||
+        header->event_size != sizeof(TraceEvent) ||
+        header->rank != rank || header->size != size ||
+        expected > (size_t)st.st_size) {
+        fprintf(stderr, "Error: trace '%s' does not match this run (rank %d of %d)\n",
+                path, rank, size);
+        munmap(map, st.st_size);
+        return NULL;
+    }
+
+    TraceReader* reader = (TraceReader*)malloc(sizeof(TraceReader));
+    reader->map = map;
+    reader->map_size = st.st_size;
+    reader->header = header;
+    reader->events = (const TraceEvent*)((const char*)map + sizeof(TraceHeader));
+    reader->cursor = 0;
+
+    // Events are consumed front to back
+    posix_madvise(map, st.st_size, POSIX_MADV_SEQUENTIAL);
+    return reader;
+}
+
+// Returns the next event whose offset has been reached, or NULL
+const TraceEvent* trace_next_due(TraceReader* reader, double offset) {
+    if (reader->cursor >= reader->header->event_count) return NULL;
+    const TraceEvent* ev = &reader->events[reader->cursor];
+    if (ev->offset > offset) return NULL;
+    reader->cursor++;
+    return ev;
+}
+
+void trace_reader_close(TraceReader* reader) {
+    if (!reader) return;
+    munmap(reader->map, reader->map_size);
+    free(reader);
+}
@@ -1,6 +1,11 @@
 // transaction.c - Transaction implementation
 
 #include "transaction.h"
+#include "arena.h"
+
+// Zone messages sent and received by this rank, for drain-to-quiescence
+static long messages_sent = 0;
+static long messages_received = 0;
 
 Transaction create_transaction(int sender, int receiver, double amount,
                                int* parents, int zone_id, int phase) {
@@ -14,9 +19,64 @@ Transaction create_transaction(int sender, int receiver, double amount,
     tx.zone_id = zone_id;
     tx.phase = phase;
     tx.timestamp = 0.0;  // Set by caller
+    memset(tx.digest, 0, sizeof(tx.digest));  // Set by transaction_seal()
     return tx;
 }
 
+static void encode_transaction(const Transaction* tx, uint8_t* out) {
+    uint8_t* p = out;
+    memcpy(p, &tx->tx_id, 4);       p += 4;
+    memcpy(p, &tx->sender, 4);      p += 4;
+    memcpy(p, &tx->receiver, 4);    p += 4;
+    memcpy(p, &tx->amount, 8);      p += 8;
+    memcpy(p, tx->parents, 8);      p += 8;
+    memcpy(p, &tx->zone_id, 4);     p += 4;
+    memcpy(p, &tx->phase, 4);       p += 4;
+    memcpy(p, &tx->timestamp, 8);
+}
+
+// Computes the digest once every other field is final
+void transaction_seal(Transaction* tx) {
+    uint8_t encoded[TX_ENCODED_BYTES];
+    encode_transaction(tx, encoded);
+    hash_digest(encoded, TX_ENCODED_BYTES, tx->digest);
+}
+
+// Integrity check: the digest matches the content
+int transaction_verify(const Transaction* tx) {
+    uint8_t encoded[TX_ENCODED_BYTES];
+    uint8_t digest[HASH_DIGEST_BYTES];
+    encode_transaction(tx, encoded);
+    hash_digest(encoded, TX_ENCODED_BYTES, digest);
+    return memcmp(digest, tx->digest, HASH_DIGEST_BYTES) == 0;
+}
+
+// Verifies n txs through the 4-lane hash; ok[i] receives each result.
+// Returns the number that verified.
+int transaction_verify_batch(const Transaction* txs, int n, int* ok) {
+    enum { CHUNK = 64 };
+    uint8_t encoded[CHUNK][TX_ENCODED_BYTES];
+    uint8_t digests[CHUNK][HASH_DIGEST_BYTES];
+    const void* inputs[CHUNK];
+    uint8_t* outputs[CHUNK];
+    int valid = 0;
+
+    for (int base = 0; base < n; base += CHUNK) {
+        int count = MIN(CHUNK, n - base);
+        for (int i = 0; i < count; i++) {
+            encode_transaction(&txs[base + i], encoded[i]);
+            inputs[i] = encoded[i];
+            outputs[i] = digests[i];
+        }
+        hash_digest_batch(inputs, TX_ENCODED_BYTES, outputs, count);
+        for (int i = 0; i < count; i++) {
+            ok[base + i] = memcmp(digests[i], txs[base + i].digest, HASH_DIGEST_BYTES) == 0;
+            valid += ok[base + i];
+        }
+    }
+    return valid;
+}
+
 int validate_transaction(Transaction* tx) {
     // Simple validation: amount must be positive
     if (tx->amount <= 0) return 0;
@@ -29,8 +89,9 @@ void broadcast_transaction(Transaction* tx, MPI_Comm comm) {
     MPI_Comm_rank(comm, &rank);
     MPI_Comm_size(comm, &size);
     
-    // Use non-blocking sends to avoid deadlocks
-    MPI_Request* requests = (MPI_Request*)malloc((size - 1) * sizeof(MPI_Request));
+    // Use non-blocking sends to avoid deadlocks; a zone is never larger
+    // than the world, which the pooled arrays are sized for
+    MPI_Request* requests = (MPI_Request*)block_pool_get(&g_scratch.requests);
     int req_count = 0;
     
     for (int i = 0; i < size; i++) {
@@ -39,23 +100,74 @@ void broadcast_transaction(Transaction* tx, MPI_Comm comm) {
         }
     }
     
+    messages_sent += req_count;
+    
     // Wait for all sends to complete
     if (req_count > 0) {
         MPI_Waitall(req_count, requests, MPI_STATUSES_IGNORE);
     }
     
-    free(requests);
+    block_pool_put(&g_scratch.requests, requests);
+}
+
+// Sends tx to the listed ranks of comm only
+void broadcast_transaction_to(Transaction* tx, MPI_Comm comm, const int* ranks, int n) {
+    if (n == 0) return;
+    MPI_Request* requests = (MPI_Request*)block_pool_get(&g_scratch.requests);
+    for (int i = 0; i < n; i++) {
+        MPI_Isend(tx, sizeof(Transaction), MPI_BYTE, ranks[i], 0, comm, &requests[i]);
+    }
+    messages_sent += n;
+    MPI_Waitall(n, requests, MPI_STATUSES_IGNORE);
+    block_pool_put(&g_scratch.requests, requests);
 }
 
-int receive_transaction(Transaction* tx, MPI_Comm comm) 
-{
+// Sends n txs to dest as one zone message; the caller keeps txs alive
+// until the request completes
+void send_transactions(const Transaction* txs, int n, int dest, MPI_Comm comm,
+                       MPI_Request* request) {
+    MPI_Isend(txs, n * (int)sizeof(Transaction), MPI_BYTE, dest, 0, comm, request);
+    messages_sent++;
+}
+
+// Receives one pending zone message, growing *buffer to fit it. Returns
+// the number of txs in it (0 if none) and its sender in *source.
+int receive_transactions(Transaction** buffer, int* capacity, MPI_Comm comm, int* source) {
     MPI_Status status;
-int flag;
-MPI_Iprobe(MPI_ANY_SOURCE, 0, comm, &flag, &status);
-if (flag) {
-    MPI_Recv(tx, sizeof(Transaction), MPI_BYTE, status.MPI_SOURCE, 0, comm, &status);
+    int flag, bytes;
+    MPI_Iprobe(MPI_ANY_SOURCE, 0, comm, &flag, &status);
+    if (!flag) return 0;
+
+    MPI_Get_count(&status, MPI_BYTE, &bytes);
+    int count = MAX(bytes / (int)sizeof(Transaction), 1);
+    if (count > *capacity) {
+        *capacity = count;
+        *buffer = (Transaction*)realloc(*buffer, count * sizeof(Transaction));
+    }
+    MPI_Recv(*buffer, bytes, MPI_BYTE, status.MPI_SOURCE, 0, comm, MPI_STATUS_IGNORE);
+    messages_received++;
+    if (source) *source = status.MPI_SOURCE;
+    return count;
+}
+
+// Txs of the last zone message that receive_transaction() has not handed out
+static Transaction* unread = NULL;
+static int unread_capacity = 0;
+static int unread_count = 0;
+static int unread_next = 0;
+
+// One tx at a time, whether it arrived alone or in a coalesced message
+int receive_transaction(Transaction* tx, MPI_Comm comm) {
+    if (unread_next == unread_count) {
+        unread_count = receive_transactions(&unread, &unread_capacity, comm, NULL);
+        unread_next = 0;
+        if (unread_count == 0) return 0;
+    }
+    *tx = unread[unread_next++];
     return 1;
 }
 
-    return 0;
-}
\ No newline at end of file
+void transaction_message_counts(long* sent, long* received) {
+    *sent = messages_sent;
+    *received = messages_received;
+}
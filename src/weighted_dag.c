@@ -2,17 +2,10 @@
 
 #include "consensus.h"
 
+// Immediate decision at insertion time; a tx that is not yet heavy enough
+// is handed to a FinalityTracker, which decides it when its weight grows
 int weighted_dag_consensus(Transaction* tx, Node* node, DAG* dag) {
-    // Find transaction in DAG
-    int tx_index = -1;
-    for (int i = 0; i < dag->count; i++) {
-        if (dag->transactions[i].tx_id == tx->tx_id &&
-            dag->transactions[i].sender == tx->sender) {
-            tx_index = i;
-            break;
-        }
-    }
-    
+    int tx_index = dag_find(dag, tx->digest);
     if (tx_index == -1) {
         return 0;  // Transaction not in DAG
     }
@@ -20,9 +13,9 @@ int weighted_dag_consensus(Transaction* tx, Node* node, DAG* dag) {
     // Check weight
     int weight = get_weight(dag, tx_index);
     
-    if (weight >= WD_MIN_WEIGHT) {
+    if (weight >= g_params.wd_min_weight) {
         return 1;  // Accept
     }
     
     return 0;  // Not enough weight yet
-}
\ No newline at end of file
+}
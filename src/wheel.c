@@ -0,0 +1,156 @@
+// wheel.c - Hierarchical timing wheel
+
+#include "wheel.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define WHEEL_INITIAL_NODES 64
+
+// Every pooled element starts with this header; the payload follows it
+typedef struct {
+    int next;
+    uint64_t due;                // Tick
+} WheelNode;
+
+static WheelNode* node_at(TimingWheel* wheel, int index) {
+    return (WheelNode*)(wheel->nodes + (size_t)index * wheel->stride);
+}
+
+static void* payload_of(WheelNode* node) {
+    return (unsigned char*)node + sizeof(WheelNode);
+}
+
+// Doubles the pool and threads the new nodes onto the free list. Nodes
+// are addressed by index, so moving the pool leaves every list intact.
+static void grow_pool(TimingWheel* wheel) {
+    int old = wheel->capacity;
+    int capacity = old > 0 ? 2 * old : WHEEL_INITIAL_NODES;
+    wheel->nodes = (unsigned char*)realloc(wheel->nodes, (size_t)capacity * wheel->stride);
+    for (int i = old; i < capacity; i++) {
+        node_at(wheel, i)->next = (i + 1 < capacity) ? i + 1 : wheel->free_list;
+    }
+    wheel->free_list = old;
+    wheel->capacity = capacity;
+}
+
+TimingWheel* create_timing_wheel(size_t elem_size, double tick, double now) {
+    TimingWheel* wheel = (TimingWheel*)calloc(1, sizeof(TimingWheel));
+    wheel->tick = tick;
+    wheel->now = (uint64_t)(now / tick);
+    wheel->elem_size = elem_size;
+    wheel->stride = (sizeof(WheelNode) + elem_size + 7) & ~(size_t)7;
+    wheel->free_list = -1;
+    memset(wheel->slots, 0xff, sizeof(wheel->slots));  // All -1
+    wheel->expired_head = -1;
+    wheel->expired_tail = -1;
+    grow_pool(wheel);
+    return wheel;
+}
+
+void destroy_timing_wheel(TimingWheel* wheel) {
+    if (!wheel) return;
+    free(wheel->nodes);
+    free(wheel);
+}
+
+static void push_expired(TimingWheel* wheel, int index) {
+    node_at(wheel, index)->next = -1;
+    if (wheel->expired_tail >= 0) {
+        node_at(wheel, wheel->expired_tail)->next = index;
+    } else {
+        wheel->expired_head = index;
+    }
+    wheel->expired_tail = index;
+}
+
+// Files a node under the level its distance from now falls in, or straight
+// into the expired list if it is already due
+static void place(TimingWheel* wheel, int index) {
+    WheelNode* node = node_at(wheel, index);
+    if (node->due <= wheel->now) {
+        push_expired(wheel, index);
+        return;
+    }
+
+    uint64_t delta = node->due - wheel->now;
+    int level = 0;
+    while (level < WHEEL_LEVELS - 1 && delta >= (1ull << (WHEEL_BITS * (level + 1)))) {
+        level++;
+    }
+    // Beyond the top level's span: park it in the farthest slot; it is
+    // re-placed from its real due tick when that slot cascades
+    uint64_t due = node->due;
+    uint64_t span = 1ull << (WHEEL_BITS * WHEEL_LEVELS);
+    if (delta >= span) due = wheel->now + span - 1;
+
+    int slot = (int)((due >> (WHEEL_BITS * level)) & WHEEL_MASK);
+    node->next = wheel->slots[level][slot];
+    wheel->slots[level][slot] = index;
+    wheel->held++;
+}
+
+// Empties one slot and re-places its nodes against the current tick
+static void cascade(TimingWheel* wheel, int level, int slot) {
+    int index = wheel->slots[level][slot];
+    wheel->slots[level][slot] = -1;
+    while (index >= 0) {
+        int next = node_at(wheel, index)->next;
+        wheel->held--;
+        place(wheel, index);
+        index = next;
+    }
+}
+
+// Holds a copy of elem until the wheel is advanced to `due` (seconds, on
+// the clock passed to wheel_advance). Never releases an element early.
+void wheel_schedule(TimingWheel* wheel, const void* elem, double due) {
+    if (wheel->free_list < 0) grow_pool(wheel);
+    int index = wheel->free_list;
+    WheelNode* node = node_at(wheel, index);
+    wheel->free_list = node->next;
+
+    memcpy(payload_of(node), elem, wheel->elem_size);
+    double ticks = ceil(due / wheel->tick);
+    node->due = ticks > 0.0 ? (uint64_t)ticks : 0;
+    place(wheel, index);
+
+    wheel->scheduled++;
+    wheel->pending++;
+    if (wheel->pending > wheel->max_pending) wheel->max_pending = wheel->pending;
+}
+
+// Moves every element due by `now` to the expired list. Steps one tick at
+// a time while elements are held and jumps straight ahead otherwise.
+void wheel_advance(TimingWheel* wheel, double now) {
+    uint64_t target = (uint64_t)(now / wheel->tick);
+    while (wheel->now < target) {
+        if (wheel->held == 0) {
+            wheel->now = target;
+            break;
+        }
+        wheel->now++;
+
+        // A level wraps when all the bits below it are zero
+        for (int level = 1; level < WHEEL_LEVELS; level++) {
+            if (wheel->now & ((1ull << (WHEEL_BITS * level)) - 1)) break;
+            cascade(wheel, level, (int)((wheel->now >> (WHEEL_BITS * level)) & WHEEL_MASK));
+        }
+        cascade(wheel, 0, (int)(wheel->now & WHEEL_MASK));
+    }
+}
+
+// Takes the oldest expired element. Returns 0 if none is due.
+int wheel_next(TimingWheel* wheel, void* out) {
+    int index = wheel->expired_head;
+    if (index < 0) return 0;
+
+    WheelNode* node = node_at(wheel, index);
+    memcpy(out, payload_of(node), wheel->elem_size);
+    wheel->expired_head = node->next;
+    if (wheel->expired_head < 0) wheel->expired_tail = -1;
+    node->next = wheel->free_list;
+    wheel->free_list = index;
+    wheel->pending--;
+    return 1;
+}
@@ -1,34 +1,333 @@
 // witnesses.c - Cross-zone witness protocol
 
+#define _DEFAULT_SOURCE
+
+#include "witnesses.h"
 #include "consensus.h"
 #include "zones.h"
+#include "netem.h"
+#include <stdint.h>
+
+// ------------------------------------------------------------------
+// Witness table
+// ------------------------------------------------------------------
+
+// This rank's latencies in the table's fixed-point units
+void witness_latency_row(Node* node, uint16_t* row) {
+    for (int j = 0; j < node->total_nodes; j++) {
+        double scaled = node->latencies[j] * WITNESS_LATENCY_SCALE;
+        row[j] = (uint16_t)MIN(scaled, (double)UINT16_MAX);
+    }
+}
+
+// Rebuilds node->witness_table from the current zone assignment. Collective
+// over MPI_COMM_WORLD (one Allgather of uint16 latency rows).
+void build_witness_table(Node* node) {
+    int n = node->total_nodes;
+    uint16_t* row = (uint16_t*)calloc(n, sizeof(uint16_t));
+    witness_latency_row(node, row);
+    uint16_t* all = (uint16_t*)malloc((size_t)n * n * sizeof(uint16_t));
+    MPI_Allgather(row, n, MPI_UINT16_T, all, n, MPI_UINT16_T, MPI_COMM_WORLD);
+    build_witness_table_from(node, all);
+    free(all);
+    free(row);
+}
+
+// Same from already gathered latency rows (all[i * n + j], i's row). Local,
+// except that the first table of a node dups MPI_COMM_WORLD.
+//
+// A candidate's distance to a zone is its lowest latency to any member
+// (zero for its own zone); its score for a zone pair is the larger of the
+// two distances. Each pair keeps the witness_max best candidates scoring
+// within witness_latency ms, or the single best one if none do.
+void build_witness_table_from(Node* node, const uint16_t* all) {
+    int n = node->total_nodes;
+    int width = MAX(g_params.witness_max, 1);
+
+    int n_zones = 0;
+    for (int i = 0; i < n; i++) {
+        n_zones = MAX(n_zones, node->zone_assignments[i] + 1);
+    }
+
+    // near[i][z]: candidate i's distance to zone z, from i's own row
+    uint16_t* near = (uint16_t*)malloc((size_t)n * n_zones * sizeof(uint16_t));
+    for (int i = 0; i < n; i++) {
+        uint16_t* dist = &near[(size_t)i * n_zones];
+        for (int z = 0; z < n_zones; z++) dist[z] = UINT16_MAX;
+        const uint16_t* lat = &all[(size_t)i * n];
+        for (int j = 0; j < n; j++) {
+            int z = node->zone_assignments[j];
+            if (j != i && lat[j] < dist[z]) dist[z] = lat[j];
+        }
+        dist[node->zone_assignments[i]] = 0;
+    }
+
+    WitnessTable* table = node->witness_table;
+    if (table) {
+        free(table->witnesses);
+        free(table->counts);
+    } else {
+        table = (WitnessTable*)malloc(sizeof(WitnessTable));
+        MPI_Comm_dup(MPI_COMM_WORLD, &table->comm);
+        node->witness_table = table;
+    }
+    table->n_zones = n_zones;
+    table->width = width;
+    table->witnesses = (int*)malloc((size_t)n_zones * n_zones * width * sizeof(int));
+    table->counts = (int*)calloc((size_t)n_zones * n_zones, sizeof(int));
+
+    uint16_t limit = (uint16_t)MIN(g_params.witness_latency * WITNESS_LATENCY_SCALE,
+                                   (double)UINT16_MAX);
+    int* best = (int*)malloc(width * sizeof(int));
+    uint16_t* best_score = (uint16_t*)malloc(width * sizeof(uint16_t));
+
+    for (int a = 0; a < n_zones; a++) {
+        for (int b = a + 1; b < n_zones; b++) {
+            // Keep the `width` lowest scores, sorted ascending
+            int kept = 0;
+            for (int i = 0; i < n; i++) {
+                uint16_t da = near[(size_t)i * n_zones + a];
+                uint16_t db = near[(size_t)i * n_zones + b];
+                uint16_t score = MAX(da, db);
+                if (kept == width && score >= best_score[kept - 1]) continue;
+                int pos = (kept < width) ? kept++ : kept - 1;
+                while (pos > 0 && best_score[pos - 1] > score) {
+                    best[pos] = best[pos - 1];
+                    best_score[pos] = best_score[pos - 1];
+                    pos--;
+                }
+                best[pos] = i;
+                best_score[pos] = score;
+            }
+            int count = 0;
+            while (count < kept && best_score[count] <= limit) count++;
+            if (count == 0 && kept > 0) count = 1;
+
+            int* ab = &table->witnesses[((size_t)a * n_zones + b) * width];
+            int* ba = &table->witnesses[((size_t)b * n_zones + a) * width];
+            for (int w = 0; w < width; w++) {
+                ab[w] = ba[w] = (w < count) ? best[w] : -1;
+            }
+            table->counts[a * n_zones + b] = count;
+            table->counts[b * n_zones + a] = count;
+        }
+    }
+
+    free(best);
+    free(best_score);
+    free(near);
+}
+
+void destroy_witness_table(WitnessTable* table) {
+    if (!table) return;
+    free(table->witnesses);
+    free(table->counts);
+    MPI_Comm_free(&table->comm);
+    free(table);
+}
+
+const int* zone_pair_witnesses(const WitnessTable* table, int zone_a, int zone_b, int* count) {
+    *count = 0;
+    if (!table || zone_a < 0 || zone_b < 0 ||
+        zone_a >= table->n_zones || zone_b >= table->n_zones || zone_a == zone_b) {
+        return NULL;
+    }
+    *count = table->counts[zone_a * table->n_zones + zone_b];
+    return &table->witnesses[((size_t)zone_a * table->n_zones + zone_b) * table->width];
+}
+
+int is_cross_zone(Node* node, Transaction* tx) {
+    if (tx->receiver < 0 || tx->receiver >= node->total_nodes) return 0;
+    return node->zone_assignments[tx->receiver] != tx->zone_id;
+}
+
+// Witness-side check of a cross-zone transaction: well formed, the sender
+// really belongs to the zone it claims, and this rank is a witness for the
+// zone pair involved.
+int validate_cross_zone_transaction(Transaction* tx, Node* node) {
+    if (!validate_transaction(tx)) return 0;
+    if (tx->sender >= node->total_nodes || tx->receiver >= node->total_nodes) return 0;
+    if (node->zone_assignments[tx->sender] != tx->zone_id) return 0;
+    if (!is_cross_zone(node, tx)) return 0;
+
+    int count;
+    const int* witnesses = zone_pair_witnesses(node->witness_table, tx->zone_id,
+                                               node->zone_assignments[tx->receiver], &count);
+    for (int w = 0; w < count; w++) {
+        if (witnesses[w] == node->rank) return 1;
+    }
+    return 0;
+}
 
-int validate_cross_zone_transaction(Transaction* tx, Node* node,
-                                     int* witnesses, int witness_count) {
-    // Simplified cross-zone validation
-    // In full implementation, would query witnesses from both zones
-    
-    if (witness_count == 0) {
-        return 0;  // No witnesses available
-    }
-    
-    // Check if transaction references cross-zone parent
-    int is_cross_zone = 0;
-    
-    // Simplified: assume transaction is valid if witnesses exist
-    // Real implementation would:
-    // 1. Send tx to witnesses
-    // 2. Witnesses validate in both zones
-    // 3. Collect witness votes
-    // 4. Check threshold (e.g., 67%)
-    
-    int accept_votes = witness_count;  // Simplified: all witnesses accept
-    double confidence = (double)accept_votes / witness_count;
-    double threshold = 0.67;
-    
-    if (confidence >= threshold) {
-        return 1;  // Accept cross-zone transaction
-    }
-    
-    return 0;  // Reject
-}
\ No newline at end of file
+// ------------------------------------------------------------------
+// Client: requests, votes and finalization
+// ------------------------------------------------------------------
+
+WitnessClient* create_witness_client(void) {
+    WitnessClient* client = (WitnessClient*)calloc(1, sizeof(WitnessClient));
+    for (int i = 0; i < WITNESS_MAX_PENDING; i++) {
+        client->pending[i].tx_id = -1;
+    }
+    if (g_params.link_delay > 0.0) {
+        double now = MPI_Wtime();
+        client->held_requests = create_timing_wheel(sizeof(HeldWitnessRequest),
+                                                    g_params.link_tick, now);
+        client->held_votes = create_timing_wheel(sizeof(WitnessVote), g_params.link_tick, now);
+    }
+    return client;
+}
+
+void destroy_witness_client(WitnessClient* client) {
+    for (int i = 0; i < WITNESS_SEND_SLOTS; i++) {
+        if (client->slot_used[i]) {
+            MPI_Wait(&client->slots[i].request, MPI_STATUS_IGNORE);
+        }
+    }
+    destroy_timing_wheel(client->held_requests);
+    destroy_timing_wheel(client->held_votes);
+    free(client);
+}
+
+// Slots are reused round-robin, so the one waited on is the oldest send
+static void witness_send(WitnessClient* client, MPI_Comm comm, int dest, int tag,
+                         const void* msg, int len) {
+    int index = client->next_slot;
+    WitnessSendSlot* slot = &client->slots[index];
+    if (client->slot_used[index]) {
+        MPI_Wait(&slot->request, MPI_STATUS_IGNORE);
+    }
+    memcpy(&slot->msg, msg, len);
+    MPI_Isend(&slot->msg, len, MPI_BYTE, dest, tag, comm, &slot->request);
+    client->slot_used[index] = 1;
+    client->next_slot = (index + 1) % WITNESS_SEND_SLOTS;
+    client->sent++;
+}
+
+static void handle_vote(WitnessClient* client, const WitnessVote* vote, Metrics* metrics) {
+    PendingWitness* p = &client->pending[vote->tx_id % WITNESS_MAX_PENDING];
+    if (p->tx_id != vote->tx_id) return;  // Already decided or expired
+
+    if (vote->accept) {
+        if (++p->accepts >= p->needed) {
+            record_cross_zone_finalization(metrics, p->tx.timestamp);
+            if (client->ledger) ledger_submit(client->ledger, &p->tx);
+            p->tx_id = -1;
+        }
+    } else if (++p->rejects > p->asked - p->needed) {
+        client->rejected++;
+        p->tx_id = -1;
+    }
+}
+
+// Sends tx to the witnesses of its zone pair. Returns 0 if the pair has no
+// witnesses, in which case the caller falls back to zone consensus.
+int witness_submit(WitnessClient* client, Node* node, Transaction* tx, Metrics* metrics) {
+    WitnessTable* table = node->witness_table;
+    int count;
+    const int* witnesses = zone_pair_witnesses(table, tx->zone_id,
+                                               node->zone_assignments[tx->receiver], &count);
+    if (count == 0) return 0;
+
+    PendingWitness* p = &client->pending[tx->tx_id % WITNESS_MAX_PENDING];
+    if (p->tx_id != -1) client->expired++;
+    p->tx_id = tx->tx_id;
+    p->asked = count;
+    p->needed = MAX(1, (int)ceil(g_params.witness_quorum * count));
+    p->accepts = 0;
+    p->rejects = 0;
+    p->tx = *tx;
+
+    for (int w = 0; w < count; w++) {
+        if (witnesses[w] == node->rank) {
+            WitnessVote vote = { tx->tx_id, node->rank,
+                                 validate_cross_zone_transaction(tx, node), 0, 0.0 };
+            client->requests_served++;
+            handle_vote(client, &vote, metrics);
+        } else {
+            witness_send(client, table->comm, witnesses[w], WITNESS_TAG_REQUEST,
+                         tx, sizeof(Transaction));
+        }
+    }
+    return 1;
+}
+
+static void serve_request(WitnessClient* client, Node* node, Transaction* tx, int source) {
+    WitnessVote vote = { tx->tx_id, node->rank,
+                         validate_cross_zone_transaction(tx, node), 0, MPI_Wtime() };
+    witness_send(client, node->witness_table->comm, source, WITNESS_TAG_VOTE,
+                 &vote, sizeof(vote));
+    client->requests_served++;
+}
+
+// Serves witness requests addressed to this rank and collects votes on
+// this rank's own requests. Never blocks on a receive. With link emulation
+// a request is served once the requester's latency has passed since the
+// tx was created, and a vote counts once the witness's latency has passed
+// since it was cast.
+void witness_poll(WitnessClient* client, Node* node, Metrics* metrics) {
+    WitnessTable* table = node->witness_table;
+    if (!table) return;
+
+    int flag;
+    MPI_Status status;
+    MPI_Iprobe(MPI_ANY_SOURCE, MPI_ANY_TAG, table->comm, &flag, &status);
+    while (flag) {
+        if (status.MPI_TAG == WITNESS_TAG_REQUEST) {
+            HeldWitnessRequest request;
+            MPI_Recv(&request.tx, sizeof(Transaction), MPI_BYTE, status.MPI_SOURCE,
+                     WITNESS_TAG_REQUEST, table->comm, MPI_STATUS_IGNORE);
+            request.source = status.MPI_SOURCE;
+            if (client->held_requests) {
+                wheel_schedule(client->held_requests, &request,
+                               request.tx.timestamp + link_latency(node, request.source));
+            } else {
+                serve_request(client, node, &request.tx, request.source);
+            }
+        } else {
+            WitnessVote vote;
+            MPI_Recv(&vote, sizeof(vote), MPI_BYTE, status.MPI_SOURCE,
+                     WITNESS_TAG_VOTE, table->comm, MPI_STATUS_IGNORE);
+            if (client->held_votes) {
+                wheel_schedule(client->held_votes, &vote,
+                               vote.sent + link_latency(node, vote.witness));
+            } else {
+                handle_vote(client, &vote, metrics);
+            }
+        }
+        client->received++;
+        MPI_Iprobe(MPI_ANY_SOURCE, MPI_ANY_TAG, table->comm, &flag, &status);
+    }
+
+    if (client->held_requests) {
+        double now = MPI_Wtime();
+        HeldWitnessRequest request;
+        WitnessVote vote;
+        wheel_advance(client->held_requests, now);
+        while (wheel_next(client->held_requests, &request)) {
+            serve_request(client, node, &request.tx, request.source);
+        }
+        wheel_advance(client->held_votes, now);
+        while (wheel_next(client->held_votes, &vote)) {
+            handle_vote(client, &vote, metrics);
+        }
+    }
+}
+
+// Collective: keeps serving until every witness message sent anywhere has
+// been received and released, so a following run or checkpoint starts
+// from silence
+void witness_drain(WitnessClient* client, Node* node, Metrics* metrics) {
+    WitnessTable* table = node->witness_table;
+    if (!table) return;
+
+    while (1) {
+        witness_poll(client, node, metrics);
+        long outstanding = client->sent - client->received, total = 0;
+        if (client->held_requests) {
+            outstanding += client->held_requests->pending + client->held_votes->pending;
+        }
+        MPI_Allreduce(&outstanding, &total, 1, MPI_LONG, MPI_SUM, table->comm);
+        if (total == 0) break;
+        usleep(100);
+    }
+}
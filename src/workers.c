@@ -0,0 +1,242 @@
+// workers.c - Validator and DAG threads for the threaded rank
+
+#define _POSIX_C_SOURCE 200809L
+
+#include "workers.h"
+#include "consensus.h"
+#include <sched.h>
+
+static double monotonic_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void* validator_main(void* arg) {
+    Validator* self = (Validator*)arg;
+    WorkerPool* pool = self->pool;
+    WorkItem item;
+
+    for (;;) {
+        if (!spsc_pop(&self->inbound, &item)) {
+            if (atomic_load(&pool->stop)) {
+                // The main thread pushes nothing after stop; one more pop
+                // catches anything that raced with the flag
+                if (!spsc_pop(&self->inbound, &item)) break;
+            } else {
+                sched_yield();
+                continue;
+            }
+        }
+
+        if (!validate_transaction(&item.tx) || !transaction_verify(&item.tx)) {
+            self->rejected++;
+            continue;
+        }
+        self->validated++;
+        while (!mpsc_push(&pool->dag_queue, &item)) {
+            sched_yield();
+        }
+    }
+
+    atomic_fetch_sub(&pool->validators_live, 1);
+    return NULL;
+}
+
+static void push_result(WorkerPool* pool, const Transaction* tx) {
+    WorkResult result;
+    result.tx = *tx;
+    result.accepted = 1;
+    while (!spsc_push(&pool->results, &result)) {
+        sched_yield();
+    }
+}
+
+// A tx that is not heavy enough yet is decided later, when a weight pass
+// makes it so
+static void insert_item(WorkerPool* pool, DAG* dag, WorkItem* item) {
+    add_transaction(dag, &item->tx);
+    pool->inserted++;
+    atomic_store_explicit(&pool->published_count, dag->count, memory_order_release);
+
+    if (item->kind == WORK_LOCAL_DECIDE) {
+        if (weighted_dag_consensus(&item->tx, pool->node, dag)) {
+            push_result(pool, &item->tx);
+        } else {
+            finality_track(pool->pending, dag, dag_find(dag, item->tx.digest));
+        }
+    }
+}
+
+static void* dag_main(void* arg) {
+    WorkerPool* pool = (WorkerPool*)arg;
+    DAG* dag = pool->dag;
+    double last_weights = monotonic_seconds();
+    WorkItem item;
+
+    for (;;) {
+        int drained = 0;
+        while (mpsc_pop(&pool->dag_queue, &item)) {
+            drained++;
+            insert_item(pool, dag, &item);
+        }
+
+        double now = monotonic_seconds();
+        if (now - last_weights >= WORKER_WEIGHT_INTERVAL) {
+            update_weights(dag);
+            finality_refresh(pool->pending, dag, dag->changed, dag->n_changed);
+            int position;
+            while (finality_next(pool->pending, dag, &position)) {
+                push_result(pool, &dag->transactions[position]);
+            }
+            pool->weight_updates++;
+            last_weights = now;
+        }
+
+        if (drained == 0) {
+            if (atomic_load(&pool->stop) && atomic_load(&pool->validators_live) == 0) {
+                // Validators are gone; whatever is queued now is final
+                if (!mpsc_pop(&pool->dag_queue, &item)) break;
+                insert_item(pool, dag, &item);
+                continue;
+            }
+            sched_yield();
+        }
+    }
+    atomic_store(&pool->dag_live, 0);
+    return NULL;
+}
+
+static void start_threads(WorkerPool* pool) {
+    for (int i = 0; i < pool->n_validators; i++) {
+        pthread_create(&pool->validators[i].thread, NULL, validator_main, &pool->validators[i]);
+    }
+    pthread_create(&pool->dag_thread, NULL, dag_main, pool);
+}
+
+// pending carries undecided weighted-DAG txs over from a restored
+// checkpoint; the pool takes it over. NULL starts with none.
+WorkerPool* create_worker_pool(Node* node, DAG* dag, int n_validators,
+                               FinalityTracker* pending) {
+    WorkerPool* pool = (WorkerPool*)malloc(sizeof(WorkerPool));
+    pool->node = node;
+    pool->dag = dag;
+    pool->n_validators = MAX(n_validators, 1);
+    pool->next_validator = 0;
+    pool->inserted = 0;
+    pool->weight_updates = 0;
+    pool->push_stalls = 0;
+    pool->ledger = NULL;
+    atomic_init(&pool->stop, 0);
+    atomic_init(&pool->validators_live, pool->n_validators);
+    atomic_init(&pool->dag_live, 1);
+    atomic_init(&pool->published_count, dag->count);
+    pool->pending = pending ? pending : create_finality_tracker(dag->capacity);
+
+    mpsc_init(&pool->dag_queue, WORKER_RING_CAPACITY, sizeof(WorkItem));
+    spsc_init(&pool->results, WORKER_RING_CAPACITY, sizeof(WorkResult));
+
+    pool->validators = (Validator*)calloc(pool->n_validators, sizeof(Validator));
+    for (int i = 0; i < pool->n_validators; i++) {
+        Validator* v = &pool->validators[i];
+        v->pool = pool;
+        v->index = i;
+        spsc_init(&v->inbound, WORKER_RING_CAPACITY, sizeof(WorkItem));
+    }
+    start_threads(pool);
+    return pool;
+}
+
+// Stops the threads once everything queued has been processed and records
+// the remaining decisions. The results ring is drained until the DAG thread
+// has exited, since it blocks while the ring is full. The DAG is back in
+// the caller's hands afterwards.
+void workers_stop(WorkerPool* pool, Metrics* metrics) {
+    atomic_store(&pool->stop, 1);
+    for (int i = 0; i < pool->n_validators; i++) {
+        pthread_join(pool->validators[i].thread, NULL);
+    }
+    while (atomic_load(&pool->dag_live)) {
+        workers_drain_results(pool, metrics);
+        sched_yield();
+    }
+    pthread_join(pool->dag_thread, NULL);
+    workers_drain_results(pool, metrics);
+}
+
+// Starts the threads again after workers_stop(), for a checkpoint cut in
+// the middle of a run. The DAG and pending confirmations carry on as the
+// stopped threads left them.
+void workers_resume(WorkerPool* pool) {
+    atomic_store(&pool->stop, 0);
+    atomic_store(&pool->validators_live, pool->n_validators);
+    atomic_store(&pool->dag_live, 1);
+    start_threads(pool);
+}
+
+void destroy_worker_pool(WorkerPool* pool) {
+    for (int i = 0; i < pool->n_validators; i++) {
+        spsc_destroy(&pool->validators[i].inbound);
+    }
+    free(pool->validators);
+    mpsc_destroy(&pool->dag_queue);
+    spsc_destroy(&pool->results);
+    destroy_finality_tracker(pool->pending);
+    free(pool);
+}
+
+// Same choice as get_latest_transactions(), from the published count
+void workers_latest_parents(WorkerPool* pool, int* parents) {
+    int count = atomic_load_explicit(&pool->published_count, memory_order_acquire);
+    parents[0] = count >= 2 ? count - 2 : (count == 1 ? 0 : -1);
+    parents[1] = count >= 2 ? count - 1 : -1;
+}
+
+void workers_drain_results(WorkerPool* pool, Metrics* metrics) {
+    WorkResult result;
+    while (spsc_pop(&pool->results, &result)) {
+        if (result.accepted) {
+            record_finalization(metrics, result.tx.timestamp);
+            if (pool->ledger) ledger_submit(pool->ledger, &result.tx);
+        }
+    }
+}
+
+// Main thread only. Spins (draining decisions) while the ring is full.
+void workers_submit_local(WorkerPool* pool, Transaction* tx, int decide, Metrics* metrics) {
+    WorkItem item;
+    item.tx = *tx;
+    item.kind = decide ? WORK_LOCAL_DECIDE : WORK_LOCAL;
+    while (!mpsc_push(&pool->dag_queue, &item)) {
+        pool->push_stalls++;
+        workers_drain_results(pool, metrics);
+        sched_yield();
+    }
+}
+
+void workers_submit_remote(WorkerPool* pool, Transaction* tx, Metrics* metrics) {
+    WorkItem item;
+    item.tx = *tx;
+    item.kind = WORK_REMOTE;
+
+    Validator* v = &pool->validators[pool->next_validator];
+    pool->next_validator = (pool->next_validator + 1) % pool->n_validators;
+    while (!spsc_push(&v->inbound, &item)) {
+        pool->push_stalls++;
+        workers_drain_results(pool, metrics);
+        sched_yield();
+    }
+}
+
+// Call after workers_stop(); the per-thread counters are not atomic
+void workers_report(WorkerPool* pool) {
+    long validated = 0, rejected = 0;
+    for (int i = 0; i < pool->n_validators; i++) {
+        validated += pool->validators[i].validated;
+        rejected += pool->validators[i].rejected;
+    }
+    printf("Node %d: %d validator threads, validated %ld, rejected %ld, "
+           "DAG inserts %ld, weight passes %ld, ring stalls %ld\n",
+           pool->node->rank, pool->n_validators, validated, rejected,
+           pool->inserted, pool->weight_updates, pool->push_stalls);
+}
@@ -1,6 +1,14 @@
 // zones.c - Zone formation with k-means clustering and AI
 
+#define _POSIX_C_SOURCE 200809L
+
 #include "zones.h"
+#include "witnesses.h"
+#include "relay.h"
+#include "hosts.h"
+#include "affinity.h"
+#include "partition.h"
+#include "arena.h"
 #include <string.h>
 #include <unistd.h>
 #include <limits.h>
@@ -11,14 +19,32 @@ double compute_similarity(Node* node, int other_rank) {
     double norm_latency = node->latencies[other_rank] / 300.0;  // Max 300ms
     norm_latency = MIN(norm_latency, 1.0);
     
-    // Affinity (0-1, higher is better)
-    double affinity = 0.0;
-    if (node->total_tx_count > 0) {
-        affinity = (double)node->affinity_counts[other_rank] / node->total_tx_count;
-    }
+    // Affinity (0-1, higher is better): share of recent traffic
+    double affinity = affinity_share(node->affinity, other_rank);
     
     // Combined similarity
-    return LATENCY_WEIGHT * (1.0 - norm_latency) + AFFINITY_WEIGHT * affinity;
+    return g_params.latency_weight * (1.0 - norm_latency) + g_params.affinity_weight * affinity;
+}
+
+// Similarity matrix from what every rank ships: its compact latency row
+// (all_latencies[i * n + j]) and its `top` heaviest partners
+// (all_top[i * top + t]). Row i is compute_similarity() on rank i.
+void assemble_similarity_matrix(int n, const uint16_t* all_latencies,
+                                const AffinityShare* all_top, int top, double* matrix) {
+    for (int i = 0; i < n; i++) {
+        double* row = &matrix[(size_t)i * n];
+        const uint16_t* lat = &all_latencies[(size_t)i * n];
+        for (int j = 0; j < n; j++) {
+            double norm_latency = MIN(lat[j] / WITNESS_LATENCY_SCALE / 300.0, 1.0);
+            row[j] = g_params.latency_weight * (1.0 - norm_latency);
+        }
+        for (int t = 0; t < top; t++) {
+            const AffinityShare* share = &all_top[(size_t)i * top + t];
+            if (share->peer >= 0 && share->peer < n) {
+                row[share->peer] += g_params.affinity_weight * share->share;
+            }
+        }
+    }
 }
 
 // Helper function to compute distance between two feature vectors
@@ -55,7 +81,7 @@ void kmeans_clustering(double* similarity_matrix, int n_nodes, int k,
     } else {
         // Random initialization
         for (int i = 0; i < k; i++) {
-            int centroid_idx = rand() % n_nodes;
+            int centroid_idx = rng_int(RNG_SYSTEM, n_nodes);
             for (int j = 0; j < n_nodes; j++) {
                 centroids[i * n_nodes + j] = similarity_matrix[centroid_idx * n_nodes + j];
             }
@@ -127,7 +153,7 @@ void kmeans_clustering(double* similarity_matrix, int n_nodes, int k,
 // K-means++ initialization (AI technique for better clustering)
 void kmeans_plusplus_init(double* similarity_matrix, int n_nodes, int k, int* centroids) {
     // First centroid: random
-    centroids[0] = rand() % n_nodes;
+    centroids[0] = rng_int(RNG_SYSTEM, n_nodes);
     
     // Convert similarity to distance (higher similarity = lower distance)
     double max_sim = 0.0;
@@ -137,9 +163,10 @@ void kmeans_plusplus_init(double* similarity_matrix, int n_nodes, int k, int* ce
         }
     }
     
-    // Select remaining centroids using k-means++ strategy
+    // Select remaining centroids using k-means++ strategy; the distances
+    // live in the epoch arena until the layout is applied
+    double* distances = (double*)arena_alloc(&g_scratch.epoch, n_nodes * sizeof(double));
     for (int c = 1; c < k; c++) {
-        double* distances = (double*)malloc(n_nodes * sizeof(double));
         double total = 0.0;
         
         for (int i = 0; i < n_nodes; i++) {
@@ -173,7 +200,7 @@ void kmeans_plusplus_init(double* similarity_matrix, int n_nodes, int k, int* ce
         
         // Select next centroid with probability proportional to distance^2
         if (total > 1e-10) {
-            double r = ((double)rand() / RAND_MAX) * total;
+            double r = rng_uniform(RNG_SYSTEM) * total;
             double cumsum = 0.0;
             for (int i = 0; i < n_nodes; i++) {
                 cumsum += distances[i];
@@ -184,10 +211,8 @@ void kmeans_plusplus_init(double* similarity_matrix, int n_nodes, int k, int* ce
             }
         } else {
             // Fallback: select randomly
-            centroids[c] = rand() % n_nodes;
+            centroids[c] = rng_int(RNG_SYSTEM, n_nodes);
         }
-        
-        free(distances);
     }
 }
 
@@ -219,23 +244,40 @@ int call_ai_zone_formation(double* similarity_matrix, int n_nodes, int max_k,
     return 0;
 }
 
+int parse_zone_engine(const char* text) {
+    if (strcmp(text, "kmeans") == 0) return ZONE_KMEANS;
+    if (strcmp(text, "multilevel") == 0) return ZONE_MULTILEVEL;
+    return -1;
+}
+
+// Multilevel engine: partitions the sparse k-NN graph, so no dense
+// similarity matrix is ever built
+static void partition_zones(int n, const uint16_t* all_latencies, const AffinityShare* all_shares,
+                            int top, int k, uint64_t seed, int* assignments) {
+    ZoneGraph* graph = build_knn_graph(n, all_latencies, all_shares, top, g_params.zone_knn);
+    partition_graph(graph, k, g_params.zone_imbalance, seed, assignments);
+    destroy_zone_graph(graph);
+}
+
 int form_zones(Node* node, int k_zones) {
     int rank = node->rank;
     int size = node->total_nodes;
 
-    // Step 1: Compute similarity matrix based on latency and affinity
-    // Similarity combines normalized latency (lower is better) and affinity (higher is better)
-    double* similarities = (double*)malloc(size * sizeof(double));
-    for (int i = 0; i < size; i++) {
-        similarities[i] = compute_similarity(node, i);
-    }
+    // Step 1: Each node ships its compact latency row and only its top
+    // traffic partners from the affinity sketch, not a dense similarity row
+    int top = MAX(g_params.affinity_top, 1);
+    uint16_t* latency_row = (uint16_t*)malloc(size * sizeof(uint16_t));
+    AffinityShare* shares = (AffinityShare*)malloc(top * sizeof(AffinityShare));
+    witness_latency_row(node, latency_row);
+    affinity_top(node->affinity, shares, top);
 
-    // Step 2: Exchange similarities across all nodes to build full similarity matrix
-    // This creates a complete similarity graph where each node knows its similarity to all others
-    double* all_similarities = (double*)malloc(size * size * sizeof(double));
-    MPI_Allgather(similarities, size, MPI_DOUBLE,
-                  all_similarities, size, MPI_DOUBLE,
-                  MPI_COMM_WORLD);
+    // Step 2: Gather them on every rank
+    uint16_t* all_latencies = (uint16_t*)malloc((size_t)size * size * sizeof(uint16_t));
+    AffinityShare* all_shares = (AffinityShare*)malloc((size_t)size * top * sizeof(AffinityShare));
+    MPI_Allgather(latency_row, size, MPI_UINT16_T,
+                  all_latencies, size, MPI_UINT16_T, MPI_COMM_WORLD);
+    MPI_Allgather(shares, top * (int)sizeof(AffinityShare), MPI_BYTE,
+                  all_shares, top * (int)sizeof(AffinityShare), MPI_BYTE, MPI_COMM_WORLD);
 
     // Limit number of zones to not exceed total nodes
     if (k_zones > size)
@@ -243,35 +285,58 @@ int form_zones(Node* node, int k_zones) {
     if (k_zones < 1)
         k_zones = 1;
 
-    // Step 3: Use AI to determine optimal k (number of zones) and initial centroids
-    // The AI analyzes the similarity matrix to find the best clustering
-    int optimal_k = k_zones;
-    int* initial_centroids = NULL;
-    int ai_result = call_ai_zone_formation(all_similarities, size, k_zones, 
-                                           &optimal_k, &initial_centroids);
-    
-    // If AI call failed, use default k
-    if (ai_result != 0 || optimal_k <= 0) {
-        optimal_k = k_zones;
-        initial_centroids = NULL;
-    }
-
-    // Step 4: Perform k-means clustering to group nodes with high similarity/affinity together
-    // Nodes with similar latency and affinity patterns are grouped into the same zone
     int* zone_assignments = (int*)malloc(size * sizeof(int));
-    kmeans_clustering(all_similarities, size, optimal_k, initial_centroids, 
-                      zone_assignments, 100);  // Max 100 iterations
+    if (parse_zone_engine(g_params.zone_engine) == ZONE_MULTILEVEL) {
+        // Step 3: Rank 0 partitions the sparse similarity graph and
+        // broadcasts the layout
+        if (rank == 0) {
+            partition_zones(size, all_latencies, all_shares, top, k_zones,
+                            rng_next(RNG_SYSTEM), zone_assignments);
+        }
+        MPI_Bcast(zone_assignments, size, MPI_INT, 0, MPI_COMM_WORLD);
+    } else {
+        // Step 3: Build the full similarity matrix. Similarity combines
+        // normalized latency (lower is better) and affinity (higher is better)
+        double* all_similarities = (double*)malloc((size_t)size * size * sizeof(double));
+        assemble_similarity_matrix(size, all_latencies, all_shares, top, all_similarities);
 
-    // Step 5: Assign zone to this node based on k-means clustering result
+        // Step 4: Use AI to determine optimal k (number of zones) and initial centroids
+        // The AI analyzes the similarity matrix to find the best clustering
+        int optimal_k = k_zones;
+        int* initial_centroids = NULL;
+        int ai_result = call_ai_zone_formation(all_similarities, size, k_zones, 
+                                               &optimal_k, &initial_centroids);
+        
+        // If AI call failed, use default k
+        if (ai_result != 0 || optimal_k <= 0) {
+            optimal_k = k_zones;
+            initial_centroids = NULL;
+        }
+
+        // Perform k-means clustering to group nodes with high similarity/affinity together
+        // Nodes with similar latency and affinity patterns are grouped into the same zone
+        kmeans_clustering(all_similarities, size, optimal_k, initial_centroids, 
+                          zone_assignments, 100);  // Max 100 iterations
+
+        free(all_similarities);
+        if (initial_centroids != NULL) {
+            free(initial_centroids);
+        }
+    }
+
+    // Step 5: Assign zone to this node
     node->zone_id = zone_assignments[rank];
+    memcpy(node->zone_assignments, zone_assignments, size * sizeof(int));
+
+    // Step 6: Route table of cross-zone witnesses for the new layout
+    build_witness_table_from(node, all_latencies);
 
     // Cleanup
-    free(similarities);
-    free(all_similarities);
+    free(latency_row);
+    free(shares);
+    free(all_latencies);
+    free(all_shares);
     free(zone_assignments);
-    if (initial_centroids != NULL) {
-        free(initial_centroids);
-    }
 
     return node->zone_id;
 }
@@ -292,41 +357,206 @@ void create_zone_communicator(Node* node) {
     printf("Node %d: Zone %d (local rank %d/%d)\n",
            node->rank, node->zone_id, zone_rank, zone_size);
     fflush(stdout);
+    
+    // Each zone's relay endpoint for cross-zone traffic
+    elect_gateways(node);
+    
+    // Co-located members of the zone share one DAG
+    if (g_params.shared_dag) {
+        map_hosts(node);
+    }
 }
 
-int* identify_witnesses(Node* node, int* zone_assignments, int size, int* count) {
-    int* witnesses = (int*)malloc(size * sizeof(int));
-    *count = 0;
-    
-    for (int i = 0; i < size; i++) {
-        int neighbor_zones[MAX_ZONES];
-        int zone_count = 0;
-        
-        // Check neighbors (latency < 50ms)
-        for (int j = 0; j < size; j++) {
-            if (i == j) continue;
-            if (node->latencies[j] < 50.0) {
-                int other_zone = zone_assignments[j];
-                
-                // Add unique zones
-                int found = 0;
-                for (int k = 0; k < zone_count; k++) {
-                    if (neighbor_zones[k] == other_zone) {
-                        found = 1;
-                        break;
-                    }
-                }
-                if (!found) {
-                    neighbor_zones[zone_count++] = other_zone;
+// ------------------------------------------------------------------
+// Background rebalancing
+// ------------------------------------------------------------------
+
+ZoneFormation* create_zone_formation(Node* node) {
+    ZoneFormation* zf = (ZoneFormation*)calloc(1, sizeof(ZoneFormation));
+    int n = node->total_nodes;
+    zf->n = n;
+    zf->k = MAX(MIN(g_params.max_zones, n), 1);
+    zf->engine = MAX(parse_zone_engine(g_params.zone_engine), ZONE_KMEANS);
+    MPI_Comm_dup(MPI_COMM_WORLD, &zf->comm);
+
+    zf->top = MAX(g_params.affinity_top, 1);
+    zf->shares = (AffinityShare*)malloc(zf->top * sizeof(AffinityShare));
+    zf->all_shares = (AffinityShare*)malloc((size_t)n * zf->top * sizeof(AffinityShare));
+    if (node->rank == 0 && zf->engine == ZONE_KMEANS) {
+        zf->all_similarities = (double*)malloc((size_t)n * n * sizeof(double));
+    }
+    zf->latency_row = (uint16_t*)malloc(n * sizeof(uint16_t));
+    zf->all_latencies = (uint16_t*)malloc((size_t)n * n * sizeof(uint16_t));
+    zf->centroids = (int*)malloc(zf->k * sizeof(int));
+    zf->assignments = (int*)malloc(n * sizeof(int));
+    zf->state = ZONE_IDLE;
+    return zf;
+}
+
+void destroy_zone_formation(ZoneFormation* zf) {
+    if (!zf) return;
+    MPI_Comm_free(&zf->comm);
+    free(zf->shares);
+    free(zf->all_shares);
+    free(zf->all_similarities);
+    free(zf->latency_row);
+    free(zf->all_latencies);
+    free(zf->centroids);
+    free(zf->assignments);
+    free(zf);
+}
+
+static void start_round(ZoneFormation* zf, Node* node, double elapsed) {
+    affinity_top(node->affinity, zf->shares, zf->top);
+    witness_latency_row(node, zf->latency_row);
+    int bytes = zf->top * (int)sizeof(AffinityShare);
+    MPI_Iallgather(zf->shares, bytes, MPI_BYTE, zf->all_shares, bytes, MPI_BYTE,
+                   zf->comm, &zf->requests[0]);
+    MPI_Iallgather(zf->latency_row, zf->n, MPI_UINT16_T,
+                   zf->all_latencies, zf->n, MPI_UINT16_T, zf->comm, &zf->requests[1]);
+    zf->state = ZONE_GATHER;
+    zf->rounds++;
+    zf->started_at = elapsed;
+    zf->round_stall = 0.0;
+}
+
+// Helper thread: clustering never touches MPI or the RNG streams
+static void* cluster_main(void* arg) {
+    ZoneFormation* zf = (ZoneFormation*)arg;
+    if (zf->engine == ZONE_MULTILEVEL) {
+        partition_zones(zf->n, zf->all_latencies, zf->all_shares, zf->top, zf->k,
+                        zf->seed, zf->assignments);
+    } else {
+        kmeans_clustering(zf->all_similarities, zf->n, zf->k, zf->centroids,
+                          zf->assignments, 100);  // Max 100 iterations
+    }
+    atomic_store_explicit(&zf->clustered, 1, memory_order_release);
+    return NULL;
+}
+
+static void post_agreement(ZoneFormation* zf, Node* node, double elapsed) {
+    if (node->rank == 0) {
+        zf->swap_at = elapsed + ZONE_SWAP_MARGIN;
+    }
+    MPI_Ibcast(zf->assignments, zf->n, MPI_INT, 0, zf->comm, &zf->requests[0]);
+    MPI_Ibcast(&zf->swap_at, 1, MPI_DOUBLE, 0, zf->comm, &zf->requests[1]);
+    zf->state = ZONE_AGREE;
+}
+
+static void apply_layout(ZoneFormation* zf, Node* node, double elapsed) {
+    node->zone_id = zf->assignments[node->rank];
+    memcpy(node->zone_assignments, zf->assignments, zf->n * sizeof(int));
+    build_witness_table_from(node, zf->all_latencies);
+    zf->applied++;
+    zf->layout_sum += elapsed - zf->started_at;
+    arena_reset(&g_scratch.epoch);
+    zf->state = ZONE_IDLE;
+    if (node->rank == 0) {
+        printf("[%.2fs] Zone rebalancing complete\n", elapsed);
+    }
+}
+
+// Advances the round as far as it can go without blocking, or to the end
+// when `wait` is set
+static void step_round(ZoneFormation* zf, Node* node, double elapsed, int wait) {
+    int done;
+    for (;;) {
+        switch (zf->state) {
+        case ZONE_GATHER:
+            if (wait) {
+                MPI_Waitall(2, zf->requests, MPI_STATUSES_IGNORE);
+            } else {
+                MPI_Testall(2, zf->requests, &done, MPI_STATUSES_IGNORE);
+                if (!done) return;
+            }
+            if (node->rank == 0) {
+                // Seeded here, on the thread that owns the RNG streams
+                if (zf->engine == ZONE_MULTILEVEL) {
+                    zf->seed = rng_next(RNG_SYSTEM);
+                } else {
+                    assemble_similarity_matrix(zf->n, zf->all_latencies, zf->all_shares,
+                                               zf->top, zf->all_similarities);
+                    kmeans_plusplus_init(zf->all_similarities, zf->n, zf->k, zf->centroids);
                 }
+                atomic_store_explicit(&zf->clustered, 0, memory_order_relaxed);
+                pthread_create(&zf->helper, NULL, cluster_main, zf);
+                zf->state = ZONE_CLUSTER;
+            } else {
+                post_agreement(zf, node, elapsed);
             }
-        }
-        
-        // If connects multiple zones, it's a witness
-        if (zone_count > 1) {
-            witnesses[(*count)++] = i;
+            break;
+        case ZONE_CLUSTER:
+            if (!wait && !atomic_load_explicit(&zf->clustered, memory_order_acquire)) return;
+            pthread_join(zf->helper, NULL);
+            post_agreement(zf, node, elapsed);
+            break;
+        case ZONE_AGREE:
+            if (wait) {
+                MPI_Waitall(2, zf->requests, MPI_STATUSES_IGNORE);
+            } else {
+                MPI_Testall(2, zf->requests, &done, MPI_STATUSES_IGNORE);
+                if (!done) return;
+            }
+            zf->state = ZONE_STAGED;
+            break;
+        case ZONE_STAGED:
+            if (!wait && elapsed < zf->swap_at) return;
+            apply_layout(zf, node, elapsed);
+            return;
+        default:
+            return;
         }
     }
-    
-    return witnesses;
-}
\ No newline at end of file
+}
+
+// Called once per main-loop iteration with the seconds since the run
+// began. Starts the next round when it is due and moves the current one
+// along; the time spent here is the round's main-thread stall.
+void zone_formation_poll(ZoneFormation* zf, Node* node, double elapsed) {
+    double interval = g_params.zone_rebalance_interval;
+    if (zf->state == ZONE_IDLE && (interval <= 0.0 || elapsed < (zf->rounds + 1) * interval)) {
+        return;
+    }
+
+    double t0 = MPI_Wtime();
+    if (zf->state == ZONE_IDLE) {
+        start_round(zf, node, elapsed);
+    }
+    step_round(zf, node, elapsed, !g_params.zone_async);
+    zf->round_stall += MPI_Wtime() - t0;
+    if (zf->state == ZONE_IDLE) {
+        zf->stall_sum += zf->round_stall;
+        zf->stall_max = MAX(zf->stall_max, zf->round_stall);
+    }
+}
+
+// Collective over MPI_COMM_WORLD at the end of a run. Ranks whose clock
+// had not yet reached the last round another rank started run it now, so
+// every rank has taken part in the same rounds, and the last is applied.
+void zone_formation_finish(ZoneFormation* zf, Node* node, double elapsed) {
+    int target = 0;
+    MPI_Allreduce(&zf->rounds, &target, 1, MPI_INT, MPI_MAX, MPI_COMM_WORLD);
+    step_round(zf, node, elapsed, 1);
+    while (zf->rounds < target) {
+        start_round(zf, node, elapsed);
+        step_round(zf, node, elapsed, 1);
+    }
+}
+
+// Collective over MPI_COMM_WORLD; silent if no round ran
+void zone_formation_report(ZoneFormation* zf, Node* node) {
+    if (zf->rounds == 0) return;
+    double local[3] = { zf->stall_sum / zf->rounds, zf->stall_max, zf->layout_sum / zf->rounds };
+    double worst[3];
+    MPI_Reduce(local, worst, 3, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+
+    if (node->rank == 0) {
+        printf("\n=== ZONE FORMATION ===\n");
+        printf("Rounds: %d (%s), %d zones max\n", zf->rounds,
+               g_params.zone_async ? "background" : "blocking", zf->k);
+        printf("Main-loop stall per round: avg %.3f ms, max %.3f ms (worst rank)\n",
+               worst[0] * 1000.0, worst[1] * 1000.0);
+        printf("Start to swap: avg %.2f ms\n", worst[2] * 1000.0);
+        printf("========================\n");
+    }
+}